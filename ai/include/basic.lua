@@ -18,11 +18,16 @@ function brake ()
 end
 
 
+-- Scratch vector the goto tasks read their target into, avoids creating
+-- garbage every tick.
+local __goto_target = vec2.new()
+
+
 --[[
 -- Goes to a target position
 --]]
 function __goto_nobrake ()
-   local target   = ai.target()
+   local target   = ai.target( __goto_target )
    local dir      = ai.face( target )
    local dist     = ai.dist( target )
    local bdist    = ai.minbrakedist()
@@ -42,7 +47,7 @@ end
 -- Goes to a target position
 --]]
 function goto ()
-   local target   = ai.target()
+   local target   = ai.target( __goto_target )
    local dir      = ai.face( target )
    local dist     = ai.dist( target )
    local bdist    = ai.minbrakedist()
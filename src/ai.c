@@ -116,6 +116,7 @@
 #define AI_PREFIX       "ai/" /**< AI file prefix. */
 #define AI_SUFFIX       ".lua" /**< AI file suffix. */
 #define AI_INCLUDE      "include/" /**< Where to search for includes. */
+#define AI_MEM_DEFAULT  "ai_memdefault" /**< Registry key of the flattened default memory. */
 
 
 /*
@@ -124,6 +125,10 @@
 static AI_Profile* profiles = NULL; /**< Array of AI_Profiles loaded. */
 static int nprofiles = 0; /**< Number of AI_Profiles loaded. */
 static lua_State *equip_L = NULL; /**< Equipment state. */
+#ifdef DEBUGGING
+static unsigned long ai_ticks = 0; /**< AI ticks run. */
+static unsigned long ai_allocs = 0; /**< Lua blocks allocated by the AI ticks. */
+#endif /* DEBUGGING */
 
 
 /*
@@ -139,6 +144,7 @@ extern int pilot_nstack;
 /* Internal C routines */
 static void ai_run( lua_State *L, const char *funcname );
 static int ai_loadProfile( const char* filename );
+static void ai_flattenMem( AI_Profile *prof );
 static void ai_setMemory (void);
 static void ai_create( Pilot* pilot, char *param );
 static int ai_loadEquip (void);
@@ -154,7 +160,7 @@ static int aiL_taskname( lua_State *L ); /* number taskname() */
 
 /* consult values */
 static int aiL_getplayer( lua_State *L ); /* number getPlayer() */
-static int aiL_gettarget( lua_State *L ); /* pointer gettarget() */
+static int aiL_gettarget( lua_State *L ); /* pointer gettarget( [Vec2] ) */
 static int aiL_getrndpilot( lua_State *L ); /* number getrndpilot() */
 static int aiL_armour( lua_State *L ); /* armour() */
 static int aiL_shield( lua_State *L ); /* shield() */
@@ -185,9 +191,9 @@ static int aiL_turn( lua_State *L ); /* turn(number); abs(number) <= 1. */
 static int aiL_face( lua_State *L ); /* face(number/pointer) */
 static int aiL_aim( lua_State *L ); /* aim(number) */
 static int aiL_brake( lua_State *L ); /* brake() */
-static int aiL_getnearestplanet( lua_State *L ); /* Vec2 getnearestplanet() */
-static int aiL_getrndplanet( lua_State *L ); /* Vec2 getrndplanet() */
-static int aiL_getlandplanet( lua_State *L ); /* Vec2 getlandplanet() */
+static int aiL_getnearestplanet( lua_State *L ); /* Vec2 getnearestplanet( [Vec2] ) */
+static int aiL_getrndplanet( lua_State *L ); /* Vec2 getrndplanet( [Vec2] ) */
+static int aiL_getlandplanet( lua_State *L ); /* Vec2 getlandplanet( [Vec2] ) */
 static int aiL_hyperspace( lua_State *L ); /* [number] hyperspace() */
 static int aiL_stop( lua_State *L ); /* stop() */
 static int aiL_relvel( lua_State *L ); /* relvel( number ) */
@@ -434,23 +440,20 @@ int ai_pinit( Pilot *p, const char *ai )
    p->fuel  = (RNG_2SIGMA()/4. + 0.5) * (p->fuel_max - HYPERSPACE_FUEL);
    p->fuel += HYPERSPACE_FUEL;
 
-   /* Adds a new pilot memory in the memory table. */
+   /* Adds a new pilot memory in the memory table, sized for the defaults. */
    lua_getglobal(L, "pilotmem"); /* pm */
-   lua_newtable(L);              /* pm, nt */
+   lua_createtable(L, 0, prof->nmem); /* pm, nt */
    lua_pushnumber(L, p->id);     /* pm, nt, n */
    lua_pushvalue(L,-2);          /* pm, nt, n, nt */
    lua_settable(L,-4);           /* pm, nt */
 
-   /* Copy defaults over. */
-   lua_pushstring(L, "default"); /* pm, nt, s */
-   lua_gettable(L, -3);          /* pm, nt, dt */
-   lua_pushnil(L);               /* pm, nt, dt, nil */
-   while (lua_next(L,-2) != 0) { /* pm, nt, dt, k, v */
-      lua_pushvalue(L,-2);       /* pm, nt, dt, k, v, k */
-      lua_pushvalue(L,-2);       /* pm, nt, dt, k, v, k, v */
-      lua_remove(L, -3);         /* pm, nt, dt, k, k, v */
-      lua_settable(L,-5);        /* pm, nt, dt, k */
-   }                             /* pm, nt, dt */
+   /* Copy defaults over from the flattened {k1, v1, k2, v2, ...} list. */
+   lua_getfield(L, LUA_REGISTRYINDEX, AI_MEM_DEFAULT); /* pm, nt, dl */
+   for (i=1; i<=2*prof->nmem; i+=2) {
+      lua_rawgeti(L, -1, i);     /* pm, nt, dl, k */
+      lua_rawgeti(L, -2, i+1);   /* pm, nt, dl, k, v */
+      lua_rawset(L, -4);         /* pm, nt, dl */
+   }
    lua_pop(L,3);                 /* */
 
    /* Create the pilot. */
@@ -550,10 +553,10 @@ static int ai_loadEquip (void)
 
    /* Make sure doesn't already exist. */
    if (equip_L != NULL)
-      lua_close(equip_L);
+      nlua_close(equip_L);
 
    /* Create new state. */
-   equip_L = nlua_newState();
+   equip_L = nlua_newState( "ai/equip" );
    L = equip_L;
 
    /* Prepare state. */
@@ -574,6 +577,37 @@ static int ai_loadEquip (void)
 }
 
 
+/**
+ * @brief Flattens the default memory of a profile into a list.
+ *
+ * The default memory is only set when loading the profile, so it can be
+ *  walked once here instead of with lua_next every time a pilot is created.
+ *
+ *    @param prof Profile to flatten default memory of.
+ */
+static void ai_flattenMem( AI_Profile *prof )
+{
+   lua_State *L;
+   int n;
+
+   L = prof->L;
+   n = 0;
+   lua_newtable(L);              /* dl */
+   lua_getglobal(L, "pilotmem"); /* dl, pm */
+   lua_getfield(L, -1, "default"); /* dl, pm, dt */
+   lua_pushnil(L);               /* dl, pm, dt, nil */
+   while (lua_next(L,-2) != 0) { /* dl, pm, dt, k, v */
+      lua_pushvalue(L,-2);       /* dl, pm, dt, k, v, k */
+      lua_rawseti(L, -6, 2*n+1); /* dl, pm, dt, k, v */
+      lua_rawseti(L, -5, 2*n+2); /* dl, pm, dt, k */
+      n++;
+   }                             /* dl, pm, dt */
+   lua_pop(L,2);                 /* dl */
+   lua_setfield(L, LUA_REGISTRYINDEX, AI_MEM_DEFAULT); /* */
+   prof->nmem = n;
+}
+
+
 /**
  * @brief Initializes an AI_Profile and adds it to the stack.
  *
@@ -594,7 +628,8 @@ static int ai_loadProfile( const char* filename )
          strlen(filename)-strlen(AI_PREFIX)-strlen(AI_SUFFIX)+1,
          "%s", filename+strlen(AI_PREFIX) );
 
-   profiles[nprofiles-1].L = nlua_newState();
+   profiles[nprofiles-1].nmem = 0;
+   profiles[nprofiles-1].L    = nlua_newState( filename );
 
    if (profiles[nprofiles-1].L == NULL) {
       ERR("Unable to create a new Lua state");
@@ -640,6 +675,9 @@ static int ai_loadProfile( const char* filename )
    }
    free(buf);
 
+   /* Flatten the default memory so it's cheap to copy to new pilots. */
+   ai_flattenMem( &profiles[nprofiles-1] );
+
    return 0;
 }
 
@@ -675,14 +713,22 @@ void ai_exit (void)
    /* Free AI profiles. */
    for (i=0; i<nprofiles; i++) {
       free(profiles[i].name);
-      lua_close(profiles[i].L);
+      nlua_close(profiles[i].L);
    }
    free(profiles);
 
    /* Free equipment Lua. */
    if (equip_L != NULL)
-      lua_close(equip_L);
+      nlua_close(equip_L);
    equip_L = NULL;
+
+#ifdef DEBUGGING
+   if (ai_ticks > 0)
+      DEBUG("AI: %.2f Lua allocations per tick over %lu ticks",
+            (double)ai_allocs / (double)ai_ticks, ai_ticks );
+   ai_ticks  = 0;
+   ai_allocs = 0;
+#endif /* DEBUGGING */
 }
 
 
@@ -696,9 +742,15 @@ void ai_think( Pilot* pilot, const double dt )
    (void) dt;
 
    lua_State *L;
+#ifdef DEBUGGING
+   unsigned int nalloc;
+#endif /* DEBUGGING */
 
    ai_setPilot(pilot);
    L = cur_pilot->ai->L; /* set the AI profile to the current pilot's */
+#ifdef DEBUGGING
+   nalloc = nlua_allocs(L);
+#endif /* DEBUGGING */
 
    /* clean up some variables */
    pilot_acc         = 0;
@@ -723,6 +775,12 @@ void ai_think( Pilot* pilot, const double dt )
          pilot_runHook( cur_pilot, PILOT_HOOK_IDLE );
    }
 
+#ifdef DEBUGGING
+   /* Keep track of the garbage the scripts create. */
+   ai_allocs += nlua_allocs(L) - nalloc;
+   ai_ticks++;
+#endif /* DEBUGGING */
+
    /* make sure pilot_acc and pilot_turn are legal */
    pilot_acc   = CLAMP( 0., 1., pilot_acc );
    pilot_turn  = CLAMP( -1., 1., pilot_turn );
@@ -1048,15 +1106,18 @@ static int aiL_getplayer( lua_State *L )
 
 /**
  * @brief Gets the pilot's target.
+ *
+ * If the target is a position and a vector is passed, it gets written into
+ *  that vector instead of creating a new one.
+ *
+ *    @luaparam v Optional vector to store a position target in.
  *    @return The pilot's target ship identifier or nil if no target.
- * @luafunc target()
+ * @luafunc target( v )
  *    @param L Lua state.
  *    @return Number of Lua parameters.
  */
 static int aiL_gettarget( lua_State *L )
 {
-   LuaVector lv;
-
    /* Must have a task. */
    if (cur_pilot->task == NULL)
       return 0;
@@ -1068,8 +1129,7 @@ static int aiL_gettarget( lua_State *L )
          return 1;
 
       case TASKDATA_VEC2:
-         lv.vec = cur_pilot->task->dat.vec;
-         lua_pushvector(L, lv);
+         lua_pushvectorInto( L, 1, &cur_pilot->task->dat.vec );
          return 1;
 
       default:
@@ -1691,13 +1751,13 @@ static int aiL_brake( lua_State *L )
 }
 
 /*
- * returns the nearest friendly planet's position to the pilot
+ * returns the nearest friendly planet's position to the pilot, optionally
+ *  written into the vector passed
  */
 static int aiL_getnearestplanet( lua_State *L )
 {
    double dist, d;
    int i, j;
-   LuaVector lv;
 
    if (cur_system->nplanets == 0) return 0; /* no planets */
 
@@ -1714,19 +1774,18 @@ static int aiL_getnearestplanet( lua_State *L )
    /* no friendly planet found */
    if (j == -1) return 0;
 
-   vectcpy( &lv.vec, &cur_system->planets[j]->pos );
-   lua_pushvector(L, lv);
+   lua_pushvectorInto( L, 1, &cur_system->planets[j]->pos );
 
    return 1;
 }
 
 
 /*
- * returns a random planet's position to the pilot
+ * returns a random planet's position to the pilot, optionally written into
+ *  the vector passed
  */
 static int aiL_getrndplanet( lua_State *L )
 {
-   LuaVector lv;
    int p;
 
    if (cur_system->nplanets == 0) return 0; /* no planets */
@@ -1735,20 +1794,20 @@ static int aiL_getrndplanet( lua_State *L )
    p = RNG(0, cur_system->nplanets-1);
 
    /* Copy the data into a vector */
-   vectcpy( &lv.vec, &cur_system->planets[p]->pos );
-   lua_pushvector(L, lv);
+   lua_pushvectorInto( L, 1, &cur_system->planets[p]->pos );
 
    return 1;
 }
 
 /*
- * returns a random friendly planet's position to the pilot
+ * returns a random friendly planet's position to the pilot, optionally
+ *  written into the vector passed
  */
 static int aiL_getlandplanet( lua_State *L )
 {
    Planet** planets;
    int nplanets, i;
-   LuaVector lv;
+   Vector2d v;
 
    if (cur_system->nplanets == 0) return 0; /* no planets */
 
@@ -1769,10 +1828,10 @@ static int aiL_getlandplanet( lua_State *L )
 
    /* we can actually get a random planet now */
    i = RNG(0,nplanets-1);
-   vectcpy( &lv.vec, &planets[i]->pos );
-   vect_cadd( &lv.vec, RNG(0, planets[i]->gfx_space->sw)-planets[i]->gfx_space->sw/2.,
+   vectcpy( &v, &planets[i]->pos );
+   vect_cadd( &v, RNG(0, planets[i]->gfx_space->sw)-planets[i]->gfx_space->sw/2.,
          RNG(0, planets[i]->gfx_space->sh)-planets[i]->gfx_space->sh/2. );
-   lua_pushvector( L, lv );
+   lua_pushvectorInto( L, 1, &v );
    free(planets);
    return 1;
 }
@@ -59,6 +59,7 @@ typedef struct Task_ {
 typedef struct AI_Profile_ {
    char* name; /**< Name of the profile. */
    lua_State *L; /**< Assosciated lua State. */
+   int nmem; /**< Number of entries in the default memory. */
 } AI_Profile;
 
 
@@ -13,9 +13,18 @@
 
 #include "naev.h"
 
+#include <math.h>
+
 #include "log.h"
 
 
+/*
+ * Prototypes.
+ */
+static int CollideLineTrans( const glTexture* bt, int bbx, int bby,
+      double x, double y, double dx, double dy, double tmax, double *t );
+
+
 /**
  * @brief Checks whether or not two sprites collide.
  *
@@ -152,12 +161,104 @@ int CollideLineLine( double s1x, double s1y, double e1x, double e1y,
 }
 
 
+/**
+ * @brief Walks a line over a sprite's transparency map until it hits.
+ *
+ * Uses an exact grid traversal so every pixel the line goes through is checked
+ *  once.  Bytes of the map that are completely transparent are skipped in one
+ *  go along the row.
+ *
+ *    @param[in] bt Texture to walk over.
+ *    @param[in] bbx X position of the sprite in the texture.
+ *    @param[in] bby Y position of the sprite in the texture.
+ *    @param[in] x X start of the line relative to the sprite.
+ *    @param[in] y Y start of the line relative to the sprite.
+ *    @param[in] dx X component of the normalized direction.
+ *    @param[in] dy Y component of the normalized direction.
+ *    @param[in] tmax Distance to walk.
+ *    @param[out] t Distance at which the first solid pixel is entered.
+ *    @return 1 if a solid pixel is hit, 0 else.
+ */
+static int CollideLineTrans( const glTexture* bt, int bbx, int bby,
+      double x, double y, double dx, double dy, double tmax, double *t )
+{
+   int ix,iy, w,h, tw, stepx,stepy, bit, k, kspan;
+   double tmaxx,tmaxy, tdeltax,tdeltay, tcur;
+   uint8_t byte;
+
+   w  = (int)bt->sw;
+   h  = (int)bt->sh;
+   tw = (int)bt->w;
+
+   /* Starting pixel, the start can lie on the far border. */
+   ix = CLAMP( 0, w-1, (int)floor(x) );
+   iy = CLAMP( 0, h-1, (int)floor(y) );
+
+   /* Set up the traversal. */
+   stepx   = (dx > 0.) ? 1 : ((dx < 0.) ? -1 : 0);
+   stepy   = (dy > 0.) ? 1 : ((dy < 0.) ? -1 : 0);
+   tdeltax = (stepx != 0) ? fabs(1./dx) : HUGE_VAL;
+   tdeltay = (stepy != 0) ? fabs(1./dy) : HUGE_VAL;
+   tmaxx   = (stepx > 0) ? (ix+1 - x) / dx :
+         ((stepx < 0) ? (ix - x) / dx : HUGE_VAL);
+   tmaxy   = (stepy > 0) ? (iy+1 - y) / dy :
+         ((stepy < 0) ? (iy - y) / dy : HUGE_VAL);
+   tcur    = 0.;
+
+   for (;;) {
+      bit  = (bby+iy)*tw + bbx+ix;
+      byte = bt->trans[ bit/8 ];
+
+      /* Is non-transparent. */
+      if (byte & (1 << (bit%8))) {
+         *t = tcur;
+         return 1;
+      }
+
+      /* Skip the rest of an empty byte while staying in the row. */
+      if ((byte == 0) && (stepx != 0)) {
+         kspan = (stepx > 0) ? MIN( 7 - bit%8, w-1-ix ) : MIN( bit%8, ix );
+         if (tmaxx >= tmaxy)
+            k = 0;
+         else if (stepy == 0)
+            k = kspan;
+         else
+            k = MIN( kspan, (int)ceil( (tmaxy - tmaxx) / tdeltax ) );
+         if (k > 0) {
+            ix    += k*stepx;
+            tmaxx += k*tdeltax;
+            if (tmaxx - tdeltax > tmax)
+               return 0;
+         }
+      }
+
+      /* Step to the next pixel. */
+      if (tmaxx < tmaxy) {
+         tcur   = tmaxx;
+         ix    += stepx;
+         tmaxx += tdeltax;
+         if ((ix < 0) || (ix >= w))
+            return 0;
+      }
+      else {
+         tcur   = tmaxy;
+         iy    += stepy;
+         tmaxy += tdeltay;
+         if ((iy < 0) || (iy >= h))
+            return 0;
+      }
+      if (tcur > tmax)
+         return 0;
+   }
+}
+
+
 /**
  * @brief Checks to see if a line collides with a sprite.
  *
- * First collisions are detected on all the walls of the sprite's rectangle.
- *  Then the collisions are tested by pixel perfectness until collisions are
- *  actually found with the ship itself.
+ * The line is first checked against the sprite's bounding circle and clipped
+ *  to its rectangle.  Then the transparency map is walked from both ends of
+ *  the clipped line to find the first and last solid pixels.
  *
  *    @param[in] ap Origin of the line.
  *    @param[in] ad Direction of the line.
@@ -175,10 +276,11 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
       const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
       Vector2d crash[2] )
 {
-   int x,y, rbsy, bbx,bby;
-   double ep[2], bl[2], tr[2], v[2], mod;
-   int hits, real_hits;
-   Vector2d tmp_crash, border[2];
+   int rbsy, bbx,bby;
+   double c,s, bx,by, d, r2;
+   double bl[2], t0,t1, tn,tf, ts[2], te[2];
+   double t;
+   int i;
 
    /* Make sure texture has transparency map. */
    if (bt->trans == NULL) {
@@ -186,116 +288,73 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
       return 0;
    }
 
-   /* Set up end point of line. */
-   ep[0] = ap->x + al*cos(ad);
-   ep[1] = ap->y + al*sin(ad);
+   /* Out of reach of the line. */
+   bx = bp->x - ap->x;
+   by = bp->y - ap->y;
+   r2 = (pow2(bt->sw) + pow2(bt->sh)) / 4.;
+   if (pow2(bx) + pow2(by) > pow2(al + sqrt(r2)))
+      return 0;
+
+   /* Direction of the line. */
+   c = cos(ad);
+   s = sin(ad);
+
+   /* Reject with the bounding circle. */
+   d  = CLAMP( 0., al, bx*c + by*s );
+   if (pow2(bx - d*c) + pow2(by - d*s) > r2)
+      return 0;
 
-   /* Set up top right corner of the rectangle. */
-   tr[0] = bp->x + bt->sw/2.;
-   tr[1] = bp->y + bt->sh/2.;
    /* Set up bottom left corner of the rectangle. */
    bl[0] = bp->x - bt->sw/2.;
    bl[1] = bp->y - bt->sh/2.;
 
-   /* 
-    * Start check for rectangular collisions.
-    */
-   hits = 0;
-   /* Left border. */
-   if (CollideLineLine(ap->x, ap->y, ep[0], ep[1],
-         bl[0], bl[1], bl[0], tr[1], &tmp_crash) == 1) {
-      border[hits].x = tmp_crash.x;
-      border[hits].y = tmp_crash.y;
-      hits++;
-   }
-   /* Top border. */
-   if (CollideLineLine(ap->x, ap->y, ep[0], ep[1],
-         bl[0], tr[1], tr[0], tr[1], &tmp_crash) == 1) {
-      border[hits].x = tmp_crash.x;
-      border[hits].y = tmp_crash.y;
-      hits++;
-   }
-   /* Now we have to make sure hits isn't 2. */
-   /* Right border. */
-   if ((hits < 2) && CollideLineLine(ap->x, ap->y, ep[0], ep[1],
-         tr[0], tr[1], tr[0], bl[1], &tmp_crash) == 1) {
-      border[hits].x = tmp_crash.x;
-      border[hits].y = tmp_crash.y;
-      hits++;
-   }
-   /* Bottom border. */
-   if ((hits < 2) && CollideLineLine(ap->x, ap->y, ep[0], ep[1],
-         tr[0], bl[1], bl[0], bl[1], &tmp_crash) == 1) {
-      border[hits].x = tmp_crash.x;
-      border[hits].y = tmp_crash.y;
-      hits++;
+   /* Clip the line to the rectangle, relative to the bottom left. */
+   ts[0] = ap->x - bl[0];
+   ts[1] = ap->y - bl[1];
+   te[0] = c;
+   te[1] = s;
+   t0    = 0.;
+   t1    = al;
+   for (i=0; i<2; i++) {
+      d = (i==0) ? bt->sw : bt->sh;
+      if (te[i] == 0.) {
+         if ((ts[i] < 0.) || (ts[i] > d))
+            return 0;
+         continue;
+      }
+      tn = (0. - ts[i]) / te[i];
+      tf = (d  - ts[i]) / te[i];
+      if (tn > tf) {
+         t  = tn;
+         tn = tf;
+         tf = t;
+      }
+      t0 = MAX( t0, tn );
+      t1 = MIN( t1, tf );
    }
-
-   /* No hits - missed. */
-   if (hits == 0)
+   if (t0 > t1)
       return 0;
 
-   /* Beam must die in the rectangle. */
-   if (hits == 1) {
-      border[1].x = ep[0];
-      border[1].y = ep[1];
-   }
-
-   /* 
-    * Now we do a pixel perfect approach.
-    */
-   real_hits = 0;
-   /* Directonaly vector (normalized). */
-   v[0] = border[1].x - border[0].x;
-   v[1] = border[1].y - border[0].y;
-   /* Normalize. */
-   mod = MOD(v[0],v[1])/2.; /* Multiply by two to reduce check amount. */
-   v[0] /= mod;
-   v[1] /= mod;
-
    /* real vertical sprite value (flipped) */
    rbsy = bt->sy - bsy - 1;
    /* set up the base points */
    bbx =  bsx*(int)(bt->sw);
    bby = rbsy*(int)(bt->sh);
 
-   /* We start checking first border until we find collision. */
-   x = border[0].x - bl[0] + v[0];
-   y = border[0].y - bl[1] + v[1];
-   while ((x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh)) {
-      /* Is non-transparent. */
-      if (!gl_isTrans(bt, bbx+(int)x, bby+(int)y)) {
-         crash[real_hits].x = x + bl[0];
-         crash[real_hits].y = y + bl[1];
-         real_hits++;
-         break;
-      }
-      x += v[0];
-      y += v[1];
-   }
-
-   /* Now we check the second border. */
-   x = border[1].x - bl[0] - v[0];
-   y = border[1].y - bl[1] - v[1];
-   while ((x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh)) {
-      /* Is non-transparent. */
-      if (!gl_isTrans(bt, bbx+(int)x, bby+(int)y)) {
-         crash[real_hits].x = x + bl[0];
-         crash[real_hits].y = y + bl[1];
-         real_hits++;
-         break;
-      }
-      x -= v[0];
-      y -= v[1];
-   }
-
-   /* Actually missed. */
-   if (real_hits == 0)
+   /* First solid pixel from where the line enters. */
+   if (!CollideLineTrans( bt, bbx, bby, ts[0] + t0*c, ts[1] + t0*s,
+            c, s, t1-t0, &t ))
       return 0;
-
-   /* Strange situation, should never happen but just in case we duplicate
-    *  the hit. */
-   if (real_hits == 1) {
+   crash[0].x = ap->x + (t0+t)*c;
+   crash[0].y = ap->y + (t0+t)*s;
+
+   /* Last solid pixel from where the line exits, can't miss now. */
+   if (CollideLineTrans( bt, bbx, bby, ts[0] + t1*c, ts[1] + t1*s,
+            -c, -s, t1-t0, &t )) {
+      crash[1].x = ap->x + (t1-t)*c;
+      crash[1].y = ap->y + (t1-t)*s;
+   }
+   else {
       crash[1].x = crash[0].x;
       crash[1].y = crash[0].y;
    }
@@ -303,5 +362,3 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
    /* We hit. */
    return 1;
 }
-
-
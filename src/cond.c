@@ -29,7 +29,7 @@ int cond_init (void)
    if (cond_L != NULL)
       return 0;
 
-   cond_L = nlua_newState();
+   cond_L = nlua_newState( "cond" );
    if (nlua_loadStandard(cond_L,1)) {
       WARN("Failed to load standard Lua libraries.");
       return -1;
@@ -47,7 +47,7 @@ void cond_exit (void)
    if (cond_L == NULL)
       return;
 
-   lua_close(cond_L);
+   nlua_close(cond_L);
    cond_L = NULL;
 }
 
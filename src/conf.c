@@ -98,6 +98,8 @@ static void print_usage( char **argv )
    LOG("   -m f, --mvol f        sets the music volume to f");
    LOG("   -s f, --svol f        sets the sound volume to f");
    LOG("   -G, --generate         regenerates the nebula (slow)");
+   LOG("   -r f, --record f      records the input to file f");
+   LOG("   -p f, --replay f      replays the input from file f without rendering");
    LOG("   -h, --help            display this message and exit");
    LOG("   -v, --version         print the version and exit");
 }
@@ -185,6 +187,7 @@ void conf_setAudioDefaults (void)
 #endif /* USE_OPENAL */
    conf.al_efx       = 1;
    conf.al_bufsize   = 128;
+   conf.al_nbuffers  = 4;
    conf.nosound      = 0;
    conf.sound        = 0.4;
    conf.music        = 0.8;
@@ -252,6 +255,10 @@ void conf_cleanup (void)
       free(conf.sound_backend);
    if (conf.joystick_nam != NULL)
       free(conf.joystick_nam);
+   if (conf.record != NULL)
+      free(conf.record);
+   if (conf.replay != NULL)
+      free(conf.replay);
 
    /* Clear memory. */
    memset( &conf, 0, sizeof(conf) );
@@ -279,7 +286,7 @@ int conf_loadConfig ( const char* file )
       return nfile_touch(file);
 
    /* Load the configuration. */
-   lua_State *L = nlua_newState();
+   lua_State *L = nlua_newState( "conf" );
    if (luaL_dofile(L, file) == 0) {
 
       /* ndata. */
@@ -319,6 +326,7 @@ int conf_loadConfig ( const char* file )
       conf_loadString("sound_backend",conf.sound_backend);
       conf_loadBool("al_efx",conf.al_efx);
       conf_loadInt("al_bufsize", conf.al_bufsize);
+      conf_loadInt("al_nbuffers", conf.al_nbuffers);
       conf_loadBool("nosound",conf.nosound);
       conf_loadFloat("sound",conf.sound);
       conf_loadFloat("music",conf.music);
@@ -465,11 +473,11 @@ int conf_loadConfig ( const char* file )
    else { /* failed to load the config file */
       WARN("Config file '%s' has invalid syntax:", file );
       WARN("   %s", lua_tostring(L,-1));
-      lua_close(L);
+      nlua_close(L);
       return 1;
    }
 
-   lua_close(L);
+   nlua_close(L);
    return 0;
 }
 
@@ -492,13 +500,15 @@ void conf_parseCLI( int argc, char** argv )
       { "mvol", required_argument, 0, 'm' },
       { "svol", required_argument, 0, 's' },
       { "generate", no_argument, 0, 'G' },
+      { "record", required_argument, 0, 'r' },
+      { "replay", required_argument, 0, 'p' },
       { "help", no_argument, 0, 'h' }, 
       { "version", no_argument, 0, 'v' },
       { NULL, 0, 0, 0 } };
    int option_index = 1;
    int c = 0;
    while ((c = getopt_long(argc, argv,
-         "fF:Vd:j:J:W:H:MSm:s:Ghv",
+         "fF:Vd:j:J:W:H:MSm:s:Gr:p:hv",
          long_options, &option_index)) != -1) {
       switch (c) {
          case 'f':
@@ -539,6 +549,16 @@ void conf_parseCLI( int argc, char** argv )
          case 'G':
             nebu_forceGenerate();
             break;
+         case 'r':
+            if (conf.record != NULL)
+               free(conf.record);
+            conf.record = strdup(optarg);
+            break;
+         case 'p':
+            if (conf.replay != NULL)
+               free(conf.replay);
+            conf.replay = strdup(optarg);
+            break;
 
          case 'v':
             /* by now it has already displayed the version
@@ -869,6 +889,10 @@ int conf_saveConfig ( const char* file )
    conf_saveInt("al_bufsize",conf.al_bufsize);
    conf_saveEmptyLine();
 
+   conf_saveComment("Number of OpenAL music buffers to decode ahead of playback.");
+   conf_saveInt("al_nbuffers",conf.al_nbuffers);
+   conf_saveEmptyLine();
+
    conf_saveComment("Disable all sound");
    conf_saveBool("nosound",conf.nosound);
    conf_saveEmptyLine();
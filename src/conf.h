@@ -40,6 +40,7 @@ typedef struct PlayerConf_s {
    char *sound_backend; /**< Sound backend to use. */
    int al_efx; /**< Should EFX extension be used? (only applicable for OpenAL) */
    int al_bufsize; /**< Size of the buffer (in kilobytes) to use for music. */
+   int al_nbuffers; /**< Number of music buffers to decode ahead. */
    int nosound; /**< Whether or not sound is on. */
    double sound; /**< Sound level for sound effects. */
    double music; /**< Sound level for music. */
@@ -76,6 +77,10 @@ typedef struct PlayerConf_s {
    /* Debugging. */
    int fpu_except; /**< Enable FPU exceptions? */
 
+   /* Replay. */
+   char *record; /**< File to record the input to, not saved. */
+   char *replay; /**< File to replay the input from, not saved. */
+
 } PlayerConf_t;
 extern PlayerConf_t conf; /**< Player configuration. */
 
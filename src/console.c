@@ -267,7 +267,7 @@ int cli_init (void)
    cli_height  = SCREEN_H - 100;
 
    /* Create the state. */
-   cli_state   = nlua_newState();
+   cli_state   = nlua_newState( "console" );
    nlua_loadStandard( cli_state, 0 );
    nlua_loadTk( cli_state );
    nlua_loadCLI( cli_state );
@@ -296,7 +296,7 @@ void cli_exit (void)
 {
    /* Destroy the state. */
    if (cli_state != NULL) {
-      lua_close( cli_state );
+      nlua_close( cli_state );
       cli_state = NULL;
    }
 
@@ -32,6 +32,7 @@
 #include "pause.h"
 #include "opengl.h"
 #include "input.h"
+#include "replay.h"
 
 
 int dialogue_open; /**< Number of dialogues open. */
@@ -520,7 +521,7 @@ static int toolkit_loop (void)
       /* Loop first so exit condition is checked before next iteration. */
       main_loop();
 
-      while (SDL_PollEvent(&event)) { /* event loop */
+      while (replay_pollEvent(&event)) { /* event loop */
          if (event.type == SDL_QUIT) { /* pass quit event to main engine */
             loop_done = 1;
             SDL_PushEvent(&event);
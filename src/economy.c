@@ -21,6 +21,9 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "SDL.h"
+#include "SDL_thread.h"
+
 #include "cs.h"
 
 #include "nxml.h"
@@ -46,6 +49,8 @@
 #define ECON_FACTION_MOD   0.1 /**< Modifier on Base for faction standings. */
 #define ECON_PROD_MODIFIER 500000. /**< Production modifier, divide production by this amount. */
 #define ECON_PROD_VAR      0.01 /**< Defines the variability of production. */
+#define ECON_SOLVE_THREADS 4 /**< Maximum amount of threads to solve prices with. */
+#define ECON_SOLVE_MINWORK 4096 /**< Minimum systems*prices before going threaded. */
 
 
 /* commodity stack */
@@ -62,9 +67,27 @@ extern int systems_nstack; /**< Number of star systems. */
  * Nodal analysis simulation for dynamic economies.
  */
 static int econ_initialized   = 0; /**< Is economy system initialized? */
+static int econ_queued        = 0; /**< Nesting level of delayed refreshes. */
+static int econ_dirty         = 0; /**< A refresh was requested while delayed. */
+static unsigned int econ_time = 0; /**< Time not yet used to drift production. */
+static unsigned int econ_step = 0; /**< Number of production drifts done. */
 static int *econ_comm         = NULL; /**< Commodities to calculate. */
 static int econ_nprices       = 0; /**< Number of prices to calculate. */
 static cs *econ_G             = NULL; /**< Admittance matrix. */
+static css *econ_S            = NULL; /**< Symbolic Cholesky analysis of econ_G. */
+static csn *econ_N            = NULL; /**< Numeric Cholesky factorization of econ_G. */
+static double *econ_X         = NULL; /**< Right hand sides, one column of systems_nstack per price. */
+
+
+/**
+ * @brief Range of price columns solved by a single thread.
+ */
+typedef struct EconSolve_ {
+   int start; /**< First price column to solve. */
+   int end; /**< One past the last price column to solve. */
+   double *work; /**< Permuted workspace of systems_nstack doubles. */
+   int ret; /**< 0 on success. */
+} EconSolve;
 
 
 /*
@@ -75,7 +98,11 @@ static void commodity_freeOne( Commodity* com );
 static int commodity_parse( Commodity *temp, xmlNodePtr parent );
 /* Economy. */
 static double econ_calcJumpR( StarSystem *A, StarSystem *B );
+static void econ_updateProduction( StarSystem *sys, unsigned int step );
+static double econ_calcSysI( const StarSystem *sys, int price );
 static int econ_createGMatrix (void);
+static void econ_freeGMatrix (void);
+static int econ_solveRange( void *data );
 unsigned int economy_getPrice( const Commodity *com,
       const StarSystem *sys, const Planet *p ); /* externed in land.c */
 
@@ -125,6 +152,20 @@ Commodity* commodity_get( const char* name )
 }
 
 
+/**
+ * @brief Gets a commodity by index.
+ *
+ *    @param indx Index of the commodity in the stack.
+ *    @return Commodity at indx or NULL if out of range.
+ */
+Commodity* commodity_getN( int indx )
+{
+   if ((indx < 0) || (indx >= commodity_nstack))
+      return NULL;
+   return &commodity_stack[indx];
+}
+
+
 /**
  * @brief Frees a commodity.
  *
@@ -365,52 +406,74 @@ static double econ_calcJumpR( StarSystem *A, StarSystem *B )
 
 
 /**
- * @brief Calculates the intensity in a system node.
+ * @brief Drifts the production factors of the planets in a system by one
+ *  time unit.
  *
- * @todo Make it time/item dependent.
+ * Each system and step gets its own random stream, so the result doesn't
+ *  depend on the order the systems are updated in.
+ *
+ *    @param sys System to update production of.
+ *    @param step Number of the drift step.
  */
-static double econ_calcSysI( unsigned int dt, StarSystem *sys, int price )
+static void econ_updateProduction( StarSystem *sys, unsigned int step )
 {
-   (void) price;
    int i;
-   double I;
-   double prodfactor, p;
-   double ddt;
+   double prodfactor;
    Planet *planet;
+   RngStream rs;
 
-   ddt = (double)(dt / NTIME_UNIT_LENGTH);
+   rng_streamInit( &rs, "economy", (uint32_t)(sys - systems_stack), step );
 
-   /* Calculate production level. */
-   p = 0.;
    for (i=0; i<sys->nplanets; i++) {
       planet = sys->planets[i];
       if (planet_hasService(planet, PLANET_SERVICE_INHABITED)) {
-         /*
-          * Calculate production.
-          */
          /* We base off the current production. */
          prodfactor  = planet->cur_prodfactor;
          /* Add a variability factor based on the gaussian distribution. */
-         prodfactor += ECON_PROD_VAR * RNG_2SIGMA() * ddt;
+         prodfactor += ECON_PROD_VAR * RNGS_2SIGMA( &rs );
          /* Add a tendency to return to the planet's base production. */
          prodfactor -= ECON_PROD_VAR *
-               (planet->cur_prodfactor - prodfactor)*ddt;
+               (planet->cur_prodfactor - prodfactor);
          /* Save for next iteration. */
          planet->cur_prodfactor = prodfactor;
-         /* We base off the sqrt of the population otherwise it changes too fast. */
-         p += prodfactor * sqrt(planet->population);
       }
    }
+}
 
-   /* The intensity is basically the modified production. */
-   I = p / ECON_PROD_MODIFIER;
 
-   return I;
+/**
+ * @brief Calculates the intensity in a system node.
+ *
+ * @todo Make it time/item dependent.
+ */
+static double econ_calcSysI( const StarSystem *sys, int price )
+{
+   (void) price;
+   int i;
+   double p;
+   Planet *planet;
+
+   /* Calculate production level. */
+   p = 0.;
+   for (i=0; i<sys->nplanets; i++) {
+      planet = sys->planets[i];
+      /* We base off the sqrt of the population otherwise it changes too fast. */
+      if (planet_hasService(planet, PLANET_SERVICE_INHABITED))
+         p += planet->cur_prodfactor * sqrt(planet->population);
+   }
+
+   /* The intensity is basically the modified production. */
+   return p / ECON_PROD_MODIFIER;
 }
 
 
 /**
- * @brief Creates the admittance matrix.
+ * @brief Creates the admittance matrix and factorizes it.
+ *
+ * The admittance matrix is symmetric positive-definite (it's strictly
+ *  diagonally dominant thanks to the self resistance), so it gets Cholesky
+ *  factorized here once and then every economy update just does the
+ *  triangular solves.
  *
  *    @return 0 on success.
  */
@@ -422,6 +485,9 @@ static int econ_createGMatrix (void)
    cs *M;
    StarSystem *sys;
 
+   /* Clean up old matrix. */
+   econ_freeGMatrix();
+
    /* Create the matrix. */
    M = cs_spalloc( systems_nstack, systems_nstack, 1, 1, 1 );
    if (M == NULL)
@@ -440,13 +506,10 @@ static int econ_createGMatrix (void)
          R     = 1./R; /* Must be inverted. */
          Rsum += R;
 
-         /* Matrix is symetrical and non-diagonal is negative. */
+         /* Non-diagonal is negative, symmetric entry gets set by the other system. */
          ret = cs_entry( M, i, sys->jumps[j], -R );
          if (ret != 1)
             WARN("Unable to enter CSparse Matrix Cell.");
-         ret = cs_entry( M, sys->jumps[j], i, -R );
-         if (ret != 1)
-            WARN("Unable to enter CSparse Matrix Cell.");
       }
 
       /* Set the diagonal. */
@@ -455,8 +518,6 @@ static int econ_createGMatrix (void)
    }
 
    /* Compress M matrix and put into G. */
-   if (econ_G != NULL)
-      cs_spfree( econ_G );
    econ_G = cs_compress( M );
    if (econ_G == NULL)
       ERR("Unable to create economy G Matrix.");
@@ -464,10 +525,87 @@ static int econ_createGMatrix (void)
    /* Clean up. */
    cs_spfree(M);
 
+   /* Sum duplicate jumps so the factorization sees them. */
+   if (!cs_dupl( econ_G ))
+      WARN("Unable to sum duplicates in economy G Matrix.");
+
+   /* Factorize with AMD ordering. */
+   econ_S = cs_schol( 1, econ_G );
+   if (econ_S == NULL) {
+      WARN("Unable to analyze economy G Matrix.");
+      return -1;
+   }
+   econ_N = cs_chol( econ_G, econ_S );
+   if (econ_N == NULL) {
+      WARN("Unable to factorize economy G Matrix, it's not positive-definite.");
+      return -1;
+   }
+
+   /* Allocate the solution space. */
+   econ_X = malloc( sizeof(double) * systems_nstack * MAX(econ_nprices,1) );
+   if (econ_X == NULL) {
+      WARN("Out of Memory!");
+      return -1;
+   }
+
    return 0;
 }
 
 
+/**
+ * @brief Frees the admittance matrix, its factorization and the solution space.
+ */
+static void econ_freeGMatrix (void)
+{
+   if (econ_G != NULL) {
+      cs_spfree( econ_G );
+      econ_G = NULL;
+   }
+   if (econ_S != NULL) {
+      cs_sfree( econ_S );
+      econ_S = NULL;
+   }
+   if (econ_N != NULL) {
+      cs_nfree( econ_N );
+      econ_N = NULL;
+   }
+   if (econ_X != NULL) {
+      free( econ_X );
+      econ_X = NULL;
+   }
+}
+
+
+/**
+ * @brief Solves a range of price columns with the factorized matrix.
+ *
+ * Only reads the factorization so it's safe to run multiple at once on
+ *  disjoint ranges.
+ *
+ *    @param data EconSolve to solve.
+ *    @return 0 on success.
+ */
+static int econ_solveRange( void *data )
+{
+   int j;
+   double *X;
+   EconSolve *es;
+
+   es = (EconSolve*) data;
+   es->ret = 0;
+   for (j=es->start; j<es->end; j++) {
+      X = &econ_X[ j*systems_nstack ];
+      if (!cs_ipvec( econ_S->pinv, X, es->work, systems_nstack ) || /* work = P*X */
+            !cs_lsolve( econ_N->L, es->work ) || /* work = L\work */
+            !cs_ltsolve( econ_N->L, es->work ) || /* work = L'\work */
+            !cs_pvec( econ_S->pinv, es->work, X, systems_nstack )) /* X = P'*work */
+         es->ret = -1;
+   }
+
+   return es->ret;
+}
+
+
 /**
  * @brief Initializes the economy.
  *
@@ -499,8 +637,8 @@ int economy_init (void)
 
 
 /**
- * @brief Regenerates the economy matrix.  Should be used if the universe
- *  changes in any permanent way.
+ * @brief Regenerates and refactorizes the economy matrix.  Should be used if
+ *  the universe changes in any permanent way.
  */
 int economy_refresh (void)
 {
@@ -508,6 +646,12 @@ int economy_refresh (void)
    if (econ_initialized == 0)
       return 0;
 
+   /* Refresh once when the batch is done. */
+   if (econ_queued > 0) {
+      econ_dirty = 1;
+      return 0;
+   }
+
    /* Create the resistence matrix. */
    if (econ_createGMatrix())
       return -1;
@@ -519,74 +663,136 @@ int economy_refresh (void)
 }
 
 
+/**
+ * @brief Holds back economy refreshes until economy_execRefresh() is called.
+ *
+ * Meant for batching many universe changes that would each refresh the
+ *  economy.  Calls can be nested.
+ */
+void economy_delayRefresh (void)
+{
+   econ_queued++;
+}
+
+
+/**
+ * @brief Ends a batch started with economy_delayRefresh().
+ *
+ * The economy is refreshed once if any refresh was requested in between.
+ *
+ *    @return 0 on success.
+ */
+int economy_execRefresh (void)
+{
+   if (econ_queued <= 0) {
+      WARN("Economy refresh executed without being delayed.");
+      return -1;
+   }
+
+   econ_queued--;
+   if ((econ_queued > 0) || !econ_dirty)
+      return 0;
+
+   econ_dirty = 0;
+   return economy_refresh();
+}
+
+
 /**
  * @brief Updates the economy.
  *
+ * Production is drifted once for every time unit that elapsed and then all
+ *  the prices are solved as a batch, split among threads if there is enough
+ *  work.  Prices only depend on the final production, so a single update over
+ *  a long time gives the same result as many small ones adding up to it.
+ *
  *    @param dt Deltatick in NTIME.
  */
 int economy_update( unsigned int dt )
 {
    int ret;
-   int i, j;
-   double *X;
+   int i, j, n, nthreads;
+   unsigned int units;
+   double *X, *work;
    double scale, offset;
-   /*double min, max;*/
+   EconSolve es[ ECON_SOLVE_THREADS ];
+   SDL_Thread *threads[ ECON_SOLVE_THREADS ];
 
    /* Economy must be initialized. */
    if (econ_initialized == 0)
       return 0;
 
-   /* Create the vector to solve the system. */
-   X = malloc(sizeof(double)*systems_nstack);
-   if (X == NULL) {
-      WARN("Out of Memory!");
+   /* Must have a factorized matrix. */
+   if ((econ_N == NULL) || (econ_X == NULL) || (econ_nprices <= 0))
       return -1;
+
+   /* Drift production once per elapsed time unit, keeping the remainder. */
+   econ_time += dt;
+   units      = econ_time / NTIME_UNIT_LENGTH;
+   econ_time %= NTIME_UNIT_LENGTH;
+   for (; units>0; units--) {
+      for (i=0; i<systems_nstack; i++)
+         econ_updateProduction( &systems_stack[i], econ_step );
+      econ_step++;
    }
 
-   /* Calculate the results for each price set. */
+   /* Load the right hand sides with intensities. */
    for (j=0; j<econ_nprices; j++) {
+      X = &econ_X[ j*systems_nstack ];
+      for (i=0; i<systems_nstack; i++)
+         X[i] = econ_calcSysI( &systems_stack[i], j );
+   }
 
-      /* First we must load the vector with intensities. */
+   /* Split the prices among the threads. */
+   if (systems_nstack * econ_nprices < ECON_SOLVE_MINWORK)
+      nthreads = 1;
+   else
+      nthreads = MIN( ECON_SOLVE_THREADS, econ_nprices );
+   work = malloc( sizeof(double) * systems_nstack * nthreads );
+   if (work == NULL) {
+      WARN("Out of Memory!");
+      return -1;
+   }
+   n = (econ_nprices + nthreads - 1) / nthreads;
+   for (i=0; i<nthreads; i++) {
+      es[i].start = i*n;
+      es[i].end   = MIN( (i+1)*n, econ_nprices );
+      es[i].work  = &work[ i*systems_nstack ];
+      es[i].ret   = 0;
+   }
+
+   /* Solve the system, main thread takes the first chunk. */
+   for (i=1; i<nthreads; i++) {
+      threads[i] = SDL_CreateThread( econ_solveRange, &es[i] );
+      if (threads[i] == NULL) /* Just do it ourselves. */
+         econ_solveRange( &es[i] );
+   }
+   econ_solveRange( &es[0] );
+   for (i=1; i<nthreads; i++)
+      if (threads[i] != NULL)
+         SDL_WaitThread( threads[i], NULL );
+   free(work);
+
+   ret = 0;
+   for (i=0; i<nthreads; i++)
+      ret |= es[i].ret;
+   if (ret != 0)
+      WARN("Failed to solve the Economy System.");
+
+   /*
+    * I'm not sure I like the filtering of the results, but it would take
+    * much more work to get a sane system working without the need of post
+    * filtering.
+    */
+   scale    = 1.;
+   offset   = 1.;
+   for (j=0; j<econ_nprices; j++) {
+      X = &econ_X[ j*systems_nstack ];
       for (i=0; i<systems_nstack; i++)
-         X[i] = econ_calcSysI( dt, &systems_stack[i], j );
-
-      /* Solve the system. */
-      ret = cs_lsolve( econ_G, X );
-      if (ret != 1)
-         WARN("Failed to solve the Economy System.");
-
-      /*
-       * Get the minimum and maximum to scale.
-       */
-      /*
-      min = +HUGE_VALF;
-      max = -HUGE_VALF;
-      for (i=0; i<systems_nstack; i++) {
-         if (X[i] < min)
-            min = X[i];
-         if (X[i] > max)
-            max = X[i];
-      }
-      scale = 1. / (max - min);
-      offset = 0.5 - min * scale;
-      */
-
-      /*
-       * I'm not sure I like the filtering of the results, but it would take
-       * much more work to get a sane system working without the need of post
-       * filtering.
-       */
-      scale    = 1.;
-      offset   = 1.;
-      for (i=0; i<systems_nstack; i++) {
          systems_stack[i].prices[j] = X[i] * scale + offset;
-      }
    }
 
-   /* Clean up. */
-   free(X);
-
-   return 0;
+   return ret;
 }
 
 
@@ -609,12 +815,11 @@ void economy_destroy (void)
       }
    }
 
-   /* Destroy the economy matrix. */
-   if (econ_G != NULL) {
-      cs_spfree( econ_G );
-      econ_G = NULL;
-   }
+   /* Destroy the economy matrix and its factorization. */
+   econ_freeGMatrix();
 
    /* Economy is now deinitialized. */
    econ_initialized = 0;
+   econ_time        = 0;
+   econ_step        = 0;
 }
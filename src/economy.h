@@ -30,6 +30,7 @@ typedef struct Commodity_ {
  * Commodity stuff.
  */
 Commodity* commodity_get( const char* name );
+Commodity* commodity_getN( int indx );
 int commodity_load (void);
 void commodity_free (void);
 
@@ -40,6 +41,8 @@ void commodity_free (void);
 int economy_init (void);
 int economy_update( unsigned int dt );
 int economy_refresh (void);
+void economy_delayRefresh (void);
+int economy_execRefresh (void);
 void economy_destroy (void);
 
 
@@ -221,7 +221,7 @@ static int event_create( int dataid )
    data = &event_data[dataid];
 
    /* Open the new state. */
-   ev->L = nlua_newState();
+   ev->L = nlua_newState( data->lua );
    L = ev->L;
    nlua_loadStandard(L,0);
    nlua_loadEvt(L);
@@ -260,7 +260,7 @@ static void event_cleanup( Event_t *ev )
    int i;
 
    /* Destroy Lua. */
-   lua_close(ev->L);
+   nlua_close(ev->L);
 
    /* Free hooks. */
    hook_rmEventParent(ev->id);
@@ -449,7 +449,7 @@ static int event_parse( EventData_t *temp, const xmlNodePtr parent )
 
 #ifdef DEBUGGING
          /* Check to see if syntax is valid. */
-         L = luaL_newstate();
+         L = nlua_newState( temp->lua );
          buf = ndata_read( temp->lua, &len );
          ret = luaL_loadbuffer(L, buf, len, temp->name );
          if (ret == LUA_ERRSYNTAX) {
@@ -457,7 +457,7 @@ static int event_parse( EventData_t *temp, const xmlNodePtr parent )
                   temp->name, temp->lua, lua_tostring(L,-1) );
          }
          free(buf);
-         lua_close(L);
+         nlua_close(L);
 #endif /* DEBUGGING */
 
          continue;
@@ -13,6 +13,9 @@
 
 #include "naev.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "log.h"
 #include "pilot.h"
 #include "weapon.h"
@@ -25,6 +28,27 @@ static int exp_m = -1; /**< Medium explosion spfx. */
 static int exp_l = -1; /**< Large explosion spfx. */
 
 
+#define EXPL_CHUNK   32 /**< Size to grow the explosion queue by. */
+
+
+/**
+ * @brief Explosion damage waiting to be applied.
+ */
+typedef struct ExplosionDamage_ {
+   double x; /**< X position of explosion center. */
+   double y; /**< Y position of explosion center. */
+   double radius; /**< Radius of the explosion. */
+   DamageType dtype; /**< Damage type. */
+   double damage; /**< Damage amount. */
+   unsigned int parent; /**< ID of the parent, 0 is none. */
+   int mode; /**< Explosion behaviour. */
+} ExplosionDamage;
+
+static ExplosionDamage *expl_queue = NULL; /**< Explosions queued this frame. */
+static int expl_nqueue = 0; /**< Number of queued explosions. */
+static int expl_mqueue = 0; /**< Memory allocated for the queue. */
+
+
 /**
  * @brief Does explosion in a radius (damage and graphics).
  *
@@ -87,6 +111,9 @@ void expl_explode( double x, double y, double vx, double vy,
 /**
  * @brief Does explosion damage in a radius.
  *
+ * The damage is not applied immediately, it's queued and applied together
+ *  with the rest of the frame's explosions in expl_update().
+ *
  *    @param x X position of explosion center.
  *    @param y Y position of explosion center.
  *    @param radius Radius of the explosion.
@@ -99,20 +126,102 @@ void expl_explodeDamage( double x, double y, double radius,
       DamageType dtype, double damage,
       const Pilot *parent, int mode )
 {
+   ExplosionDamage *e;
+
+   /* Nothing to affect. */
+   if (!(mode & (EXPL_MODE_SHIP | EXPL_MODE_MISSILE | EXPL_MODE_BOLT)))
+      return;
+
+   /* Grow memory. */
+   if (expl_nqueue >= expl_mqueue) {
+      expl_mqueue += EXPL_CHUNK;
+      expl_queue   = realloc( expl_queue, sizeof(ExplosionDamage) * expl_mqueue );
+   }
+
+   e = &expl_queue[ expl_nqueue++ ];
+   e->x      = x;
+   e->y      = y;
+   e->radius = radius;
+   e->dtype  = dtype;
+   e->damage = damage;
+   e->parent = (parent != NULL) ? parent->id : 0;
+   e->mode   = mode;
+}
+
+
+/**
+ * @brief Applies the damage of all the queued explosions.
+ *
+ * Pilots and weapons are each indexed once and all the explosions are run
+ *  against the index, so the cost no longer depends on explosions times
+ *  objects.
+ */
+void expl_update (void)
+{
+   int i, n, ships, weapons;
+   ExplosionDamage *e;
+
+   n = expl_nqueue;
+   if (n == 0)
+      return;
+
+   /* See what has to be indexed. */
+   ships   = 0;
+   weapons = 0;
+   for (i=0; i<n; i++) {
+      if (expl_queue[i].mode & EXPL_MODE_SHIP)
+         ships = 1;
+      if (expl_queue[i].mode & (EXPL_MODE_MISSILE | EXPL_MODE_BOLT))
+         weapons = 1;
+   }
+
    /* Explosion affects ships. */
-   if (mode & EXPL_MODE_SHIP)
-      pilot_explode( x, y, radius, dtype, damage, parent );
+   if (ships) {
+      pilot_explodeBegin();
+      for (i=0; i<n; i++) {
+         /* Hooks may queue more explosions and move the queue. */
+         e = &expl_queue[i];
+         if (e->mode & EXPL_MODE_SHIP)
+            pilot_explode( e->x, e->y, e->radius, e->dtype, e->damage, e->parent );
+      }
+      pilot_explodeEnd();
+   }
 
    /* Explosion affects missiles and bolts. */
-   if ((mode & EXPL_MODE_MISSILE) && (mode & EXPL_MODE_BOLT))
-      weapon_explode( x, y, radius, dtype, damage, parent, mode );
+   if (weapons) {
+      weapon_explodeBegin();
+      for (i=0; i<n; i++) {
+         e = &expl_queue[i];
+         if (e->mode & (EXPL_MODE_MISSILE | EXPL_MODE_BOLT))
+            weapon_explode( e->x, e->y, e->radius, e->dtype, e->damage,
+                  e->parent, e->mode );
+      }
+      weapon_explodeEnd();
+   }
+
+   /* Keep anything queued while applying for next frame. */
+   expl_nqueue -= n;
+   if (expl_nqueue > 0)
+      memmove( expl_queue, &expl_queue[n], sizeof(ExplosionDamage) * expl_nqueue );
+}
 
-   /* Explosion affects missiles. */
-   else if (mode & EXPL_MODE_MISSILE)
-      weapon_explode( x, y, radius, dtype, damage, parent, mode );
 
-   /* Explosion affects bolts. */
-   else if (mode & EXPL_MODE_BOLT)
-      weapon_explode( x, y, radius, dtype, damage, parent, mode );
+/**
+ * @brief Drops all the queued explosions.
+ */
+void expl_clear (void)
+{
+   expl_nqueue = 0;
 }
 
+
+/**
+ * @brief Frees the explosion queue.
+ */
+void expl_free (void)
+{
+   free(expl_queue);
+   expl_queue  = NULL;
+   expl_nqueue = 0;
+   expl_mqueue = 0;
+}
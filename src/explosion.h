@@ -5,7 +5,7 @@
 
 
 #ifndef EXPLOSION_H
-#  define EXPLOSION__H
+#  define EXPLOSION_H
 
 
 #include "outfit.h"
@@ -23,6 +23,9 @@ void expl_explode( double x, double y, double vx, double vy,
 void expl_explodeDamage( double x, double y, double radius,
       DamageType dtype, double damage,
       const Pilot *parent, int mode );
+void expl_update (void);
+void expl_clear (void);
+void expl_free (void);
 
 
 #endif /* EXPLOSION_H */
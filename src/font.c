@@ -7,10 +7,14 @@
  *
  * @brief OpenGL font rendering routines.
  *
- * Use a displaylist to store ASCII chars rendered with freefont
- * There are several drawing methods depending on whether you want
- * print it all, print to a max width, print centered or print a
- * block of text.
+ * Text is UTF-8.  Glyphs are rasterized with FreeType the first time they are
+ *  used and packed into a per-font texture atlas that grows as needed.
+ *
+ * Printed strings are laid out once into vertex runs that are kept in a cache
+ *  keyed by font, string and dimensions, so text that doesn't change is drawn
+ *  without any per-glyph work.  There are several drawing methods depending
+ *  on whether you want print it all, print to a max width, print centered or
+ *  print a block of text.
  *
  * There are hardcoded size limits.  256 characters for all routines
  * except gl_printText which has a 1024 limit.
@@ -23,6 +27,8 @@
 
 #include "naev.h"
 
+#include <stdint.h>
+
 #include "ft2build.h"
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
@@ -33,23 +39,98 @@
 
 #define FONT_DEF  "dat/font.ttf" /**< Default font path. */
 
+#define FONT_GLYPH_HASH    256 /**< Glyph hash buckets, must be power of two. */
+#define FONT_CACHE_HASH    512 /**< Layout cache buckets, must be power of two. */
+#define FONT_CACHE_MAX     512 /**< Maximum amount of cached layouts. */
+#define FONT_REPLACEMENT   '?' /**< Character used for invalid UTF-8. */
+
+#define FONT_LAYOUT_RAW    0 /**< Layout of gl_printRaw. */
+#define FONT_LAYOUT_MAX    1 /**< Layout of gl_printMaxRaw. */
+#define FONT_LAYOUT_MID    2 /**< Layout of gl_printMidRaw. */
+#define FONT_LAYOUT_TEXT   3 /**< Layout of gl_printTextRaw. */
+
 
 /**
- * @brief Stores a font character.
+ * @brief Stores a glyph of the font.
  */
-typedef struct font_char_s {
-   GLubyte *data;
-   int w;
-   int h;
-   int off_x;
-   int off_y;
-   int adv_x;
-   int adv_y;
-   int tx;
-   int ty;
-   int tw;
-   int th;
-} font_char_t;
+typedef struct glFontGlyph_s {
+   uint32_t ch; /**< Unicode code point. */
+   int adv_x; /**< X advancement. */
+   int adv_y; /**< Y advancement. */
+   int vx; /**< X offset of the quad from the pen. */
+   int vy; /**< Y offset of the quad from the pen. */
+   int vw; /**< Width of the quad. */
+   int vh; /**< Height of the quad. */
+   int tx; /**< X position in the atlas. */
+   int ty; /**< Y position in the atlas. */
+   int next; /**< Next glyph in the hash bucket, -1 if last. */
+} glFontGlyph;
+
+
+/**
+ * @brief Glyph atlas and FreeType state of a font.
+ */
+typedef struct glFontStash_s {
+   FT_Library library; /**< FreeType library. */
+   FT_Face face; /**< Font face, kept to rasterize new glyphs. */
+   FT_Byte *buf; /**< Font file, must outlive the face. */
+
+   /* Atlas. */
+   GLubyte *atlas; /**< Local copy of the atlas in luminance alpha. */
+   int w; /**< Atlas width. */
+   int h; /**< Atlas height. */
+   int x; /**< Packing position in the current shelf. */
+   int y; /**< Top of the current shelf. */
+   int shelf; /**< Height of the current shelf. */
+   unsigned int gen; /**< Incremented when texture coordinates change. */
+
+   /* Glyphs. */
+   glFontGlyph *glyphs; /**< Rasterized glyphs. */
+   int nglyphs; /**< Number of glyphs. */
+   int mglyphs; /**< Allocated glyphs. */
+   int ascii[128]; /**< Direct lookup of ASCII glyphs. */
+   int hash[FONT_GLYPH_HASH]; /**< Hash buckets for other glyphs. */
+} glFontStash;
+
+
+/**
+ * @brief Colour run inside a layout.
+ */
+typedef struct glFontRun_s {
+   int start; /**< First vertex of the run. */
+   int col; /**< Escape character of the colour, 0 for the base colour. */
+} glFontRun;
+
+
+/**
+ * @brief Cached layout of a printed string.
+ */
+typedef struct glFontLayout_s {
+   /* Key. */
+   const glFont *font; /**< Font used. */
+   char *text; /**< Text laid out. */
+   uint32_t hash; /**< Hash of the key. */
+   int mode; /**< FONT_LAYOUT_* mode. */
+   int width; /**< Width limit. */
+   int height; /**< Height limit. */
+
+   /* Geometry. */
+   unsigned int gen; /**< Atlas generation it was built with. */
+   double ox; /**< X offset to draw at. */
+   GLfloat *data; /**< Interleaved vertex and texture coordinates. */
+   int nvert; /**< Number of vertices. */
+   int mvert; /**< Allocated vertices. */
+   glFontRun *runs; /**< Colour runs. */
+   int nruns; /**< Number of colour runs. */
+   int mruns; /**< Allocated colour runs. */
+   gl_vbo *vbo; /**< Buffer once it's known to be reused. */
+   int hits; /**< Times it was reused. */
+
+   /* Cache. */
+   struct glFontLayout_s *hnext; /**< Next in the hash bucket. */
+   struct glFontLayout_s *prev; /**< More recently used. */
+   struct glFontLayout_s *next; /**< Less recently used. */
+} glFontLayout;
 
 
 /* default font */
@@ -57,15 +138,40 @@ glFont gl_defFont; /**< Default font. */
 glFont gl_smallFont; /**< Small font. */
 
 
+/* Layout cache. */
+static glFontLayout *font_cache[FONT_CACHE_HASH]; /**< Layout hash buckets. */
+static glFontLayout *font_lruHead = NULL; /**< Most recently used layout. */
+static glFontLayout *font_lruTail = NULL; /**< Least recently used layout. */
+static int font_ncache = 0; /**< Number of cached layouts. */
+static gl_vbo *font_vbo = NULL; /**< Stream buffer for layouts used once. */
+static int font_nfonts = 0; /**< Number of loaded fonts. */
+
+
 /*
  * prototypes
  */
 static int font_limitSize( const glFont *ft_font, int *width,
       const char *text, const int max );
+static uint32_t font_nextChar( const char *text, int *i );
+/* Glyphs. */
+static glFontGlyph* font_getGlyph( const glFont *font, uint32_t ch );
+static int font_makeGlyph( const glFont *font, uint32_t ch );
+static int font_atlasPlace( const glFont *font, int w, int h, int *x, int *y );
+static int font_atlasGrow( const glFont *font );
+static void font_atlasUpload( const glFont *font );
+/* Layouts. */
+static glFontLayout* font_layoutGet( const glFont *font, int mode,
+      int width, int height, const char *text );
+static void font_layoutBuild( glFontLayout *l );
+static void font_layoutEmit( glFontLayout *l, const char *text, int len,
+      double oy, int *state );
+static void font_layoutColour( glFontLayout *l, int col );
+static void font_layoutFree( glFontLayout *l );
+static void font_layoutPurge( const glFont *font );
 /* Render. */
-static void gl_fontRenderStart( const glFont* font, double x, double y, const glColour *c );
-static int gl_fontRenderCharacter( const glFont* font, int ch, const glColour *c, int state );
-static void gl_fontRenderEnd (void);
+static void font_layoutRender( glFontLayout *l, double x, double y,
+      const glColour *c );
+static void font_setColour( int col, const glColour *c );
 
 
 /**
@@ -80,7 +186,8 @@ static void gl_fontRenderEnd (void);
 static int font_limitSize( const glFont *ft_font, int *width,
       const char *text, const int max )
 {
-   int n, i;
+   int n, i, p, adv;
+   uint32_t ch;
 
    /* Avoid segfaults. */
    if (text == NULL)
@@ -88,10 +195,23 @@ static int font_limitSize( const glFont *ft_font, int *width,
 
    /* limit size */
    n = 0;
-   for (i=0; text[i] != '\0'; i++) {
-      n += ft_font->chars[ (int)text[i] ].adv_x;
+   i = 0;
+   while (text[i] != '\0') {
+      p  = i;
+      ch = font_nextChar( text, &i );
+
+      /* Ignore escape sequence. */
+      if (ch == '\e') {
+         if (text[i] != '\0')
+            i++;
+         continue;
+      }
+
+      adv = font_getGlyph( ft_font, ch )->adv_x;
+      n  += adv;
       if (n > max) {
-         n -= ft_font->chars[ (int)text[i] ].adv_x; /* actual size */
+         n -= adv; /* actual size */
+         i  = p;
          break;
       }
    }
@@ -102,6 +222,57 @@ static int font_limitSize( const glFont *ft_font, int *width,
 }
 
 
+/**
+ * @brief Decodes the next UTF-8 character.
+ *
+ *    @param text Text to decode.
+ *    @param[in,out] i Byte position in text, moved past the character.
+ *    @return The Unicode code point of the character.
+ */
+static uint32_t font_nextChar( const char *text, int *i )
+{
+   const unsigned char *s;
+   uint32_t ch;
+   int n, k;
+
+   s = (const unsigned char*) &text[*i];
+
+   /* Lead byte. */
+   if (s[0] < 0x80) {
+      (*i)++;
+      return s[0];
+   }
+   else if ((s[0] & 0xE0) == 0xC0) {
+      ch = s[0] & 0x1F;
+      n  = 1;
+   }
+   else if ((s[0] & 0xF0) == 0xE0) {
+      ch = s[0] & 0x0F;
+      n  = 2;
+   }
+   else if ((s[0] & 0xF8) == 0xF0) {
+      ch = s[0] & 0x07;
+      n  = 3;
+   }
+   else {
+      (*i)++;
+      return FONT_REPLACEMENT;
+   }
+
+   /* Continuation bytes, the terminating NUL is never one. */
+   for (k=1; k<=n; k++) {
+      if ((s[k] & 0xC0) != 0x80) {
+         (*i) += k;
+         return FONT_REPLACEMENT;
+      }
+      ch = (ch << 6) | (s[k] & 0x3F);
+   }
+
+   (*i) += n+1;
+   return ch;
+}
+
+
 /**
  * @brief Gets the number of characters in text that fit into width.
  *
@@ -113,7 +284,8 @@ static int font_limitSize( const glFont *ft_font, int *width,
 int gl_printWidthForText( const glFont *ft_font, const char *text,
       const int width )
 {
-   int i, n, lastspace;
+   int i, n, p, prev, lastspace;
+   uint32_t ch;
 
    if (ft_font == NULL)
       ft_font = &gl_defFont;
@@ -122,6 +294,7 @@ int gl_printWidthForText( const glFont *ft_font, const char *text,
    lastspace = 0; /* last ' ' or '\n' in the text */
    n = 0; /* current width */
    i = 0; /* current position */
+   p = -1; /* start of current character */
    while ((text[i] != '\n') && (text[i] != '\0')) {
 
       /* Characters we should ignore. */
@@ -140,22 +313,22 @@ int gl_printWidthForText( const glFont *ft_font, const char *text,
       }
 
       /* Increase size. */
-      n += ft_font->chars[ (int)text[i] ].adv_x;
+      prev = p;
+      p    = i;
+      ch   = font_nextChar( text, &i );
+      n   += font_getGlyph( ft_font, ch )->adv_x;
 
       /* Save last space. */
-      if (text[i] == ' ')
-         lastspace = i;
+      if (ch == ' ')
+         lastspace = p;
 
       /* Check if out of bounds. */
       if (n > width) {
          if (lastspace > 0)
             return lastspace;
          else
-            return i-1;
+            return prev;
       }
-
-      /* Check next character. */
-      i++;
    }
 
    return i;
@@ -177,17 +350,14 @@ void gl_printRaw( const glFont *ft_font,
       const double x, const double y,
       const glColour* c, const char *text )
 {
-   int i, s;
+   glFontLayout *l;
 
    if (ft_font == NULL)
       ft_font = &gl_defFont;
 
    /* Render it. */
-   s = 0;
-   gl_fontRenderStart(ft_font, x, y, c);
-   for (i=0; text[i] != '\0'; i++)
-      s = gl_fontRenderCharacter( ft_font, text[i], c, s );
-   gl_fontRenderEnd();
+   l = font_layoutGet( ft_font, FONT_LAYOUT_RAW, 0, 0, text );
+   font_layoutRender( l, x, y, c );
 }
 
 
@@ -236,22 +406,14 @@ int gl_printMaxRaw( const glFont *ft_font, const int max,
       const double x, const double y,
       const glColour* c, const char *text )
 {
-   int ret, i, s;
-
-   ret = 0; /* default return value */
+   glFontLayout *l;
 
    if (ft_font == NULL)
       ft_font = &gl_defFont;
 
-   /* Limit size. */
-   ret = font_limitSize( ft_font, NULL, text, max );
-
-   /* Render it. */
-   s = 0;
-   gl_fontRenderStart(ft_font, x, y, c);
-   for (i=0; i < ret; i++)
-      s = gl_fontRenderCharacter( ft_font, text[i], c, s );
-   gl_fontRenderEnd();
+   /* Render it, limited to max. */
+   l = font_layoutGet( ft_font, FONT_LAYOUT_MAX, max, 0, text );
+   font_layoutRender( l, x, y, c );
 
    return 0;
 }
@@ -305,24 +467,14 @@ int gl_printMidRaw( const glFont *ft_font, const int width,
       double x, const double y,
       const glColour* c, const char *text )
 {
-   /*float h = ft_font->h / .63;*/ /* slightly increase fontsize */
-   int n, ret, i, s;
+   glFontLayout *l;
 
    if (ft_font == NULL)
       ft_font = &gl_defFont;
 
-   ret = 0; /* default return value */
-
-   /* limit size */
-   ret = font_limitSize( ft_font, &n, text, width );
-   x += (double)(width - n)/2.;
-
-   /* Render it. */
-   s = 0;
-   gl_fontRenderStart(ft_font, x, y, c);
-   for (i=0; i < ret; i++)
-      s = gl_fontRenderCharacter( ft_font, text[i], c, s );
-   gl_fontRenderEnd();
+   /* Render it, layout has the centering offset. */
+   l = font_layoutGet( ft_font, FONT_LAYOUT_MID, width, 0, text );
+   font_layoutRender( l, x, y, c );
 
    return 0;
 }
@@ -378,34 +530,14 @@ int gl_printTextRaw( const glFont *ft_font,
       double bx, double by,
       glColour* c, const char *text )
 {
-   int ret, i, p, s;
-   double x,y;
+   glFontLayout *l;
 
    if (ft_font == NULL)
       ft_font = &gl_defFont;
 
-   x = bx;
-   y = by + height - (double)ft_font->h; /* y is top left corner */
-
-   s = 0;
-   p = 0; /* where we last drew up to */
-   while (y - by > -1e-5) {
-      ret = gl_printWidthForText( ft_font, &text[p], width );
-
-      /* Render it. */
-      gl_fontRenderStart(ft_font, x, y, c);
-      for (i=0; i < ret; i++)
-         s = gl_fontRenderCharacter( ft_font, text[p+i], c, s );
-      gl_fontRenderEnd();
-
-      if (text[p+i] == '\0')
-         break;
-      p += i;
-      if ((text[p] == '\n') || (text[p] == ' '))
-         p++; /* Skip "empty char". */
-      y -= 1.5*(double)ft_font->h; /* move position down */
-   }
-
+   /* Render it, layout has the line breaks. */
+   l = font_layoutGet( ft_font, FONT_LAYOUT_TEXT, width, height, text );
+   font_layoutRender( l, bx, by, c );
 
    return 0;
 }
@@ -458,22 +590,25 @@ int gl_printText( const glFont *ft_font,
 int gl_printWidthRaw( const glFont *ft_font, const char *text )
 {
    int i, n;
+   uint32_t ch;
 
    if (ft_font == NULL)
       ft_font = &gl_defFont;
 
-   for (n=0,i=0; i<(int)strlen(text); i++) {
+   n = 0;
+   i = 0;
+   while (text[i] != '\0') {
+      ch = font_nextChar( text, &i );
+
       /* Ignore escape sequence. */
-      if (text[i] == '\e') {
-         if (text[i+1] != '\0')
-            i += 2;
-         else
-            i += 1;
+      if (ch == '\e') {
+         if (text[i] != '\0')
+            i++;
          continue;
       }
 
       /* Increment width. */
-      n += ft_font->chars[ (int)text[i] ].adv_x;
+      n += font_getGlyph( ft_font, ch )->adv_x;
    }
 
    return n;
@@ -572,329 +707,626 @@ int gl_printHeight( const glFont *ft_font,
  *
  */
 /**
+ * @brief Gets a glyph of a font, rasterizing it if needed.
+ *
+ * The pointer is only valid until the next glyph is rasterized.
+ *
+ *    @param font Font to get glyph of.
+ *    @param ch Unicode code point of the glyph.
+ *    @return The glyph.
  */
-static int font_makeChar( font_char_t *c, FT_Face face, char ch )
+static glFontGlyph* font_getGlyph( const glFont *font, uint32_t ch )
 {
-   FT_Bitmap bitmap;
+   glFontStash *stash;
+   int i;
+
+   stash = font->stash;
+
+   /* Look it up. */
+   if (ch < 128)
+      i = stash->ascii[ch];
+   else {
+      for (i = stash->hash[ ch & (FONT_GLYPH_HASH-1) ]; i != -1;
+            i = stash->glyphs[i].next)
+         if (stash->glyphs[i].ch == ch)
+            break;
+   }
+
+   /* Create it. */
+   if (i == -1)
+      i = font_makeGlyph( font, ch );
+
+   return &stash->glyphs[i];
+}
+
+
+/**
+ * @brief Rasterizes a glyph into the font atlas.
+ *
+ * Glyphs that fail to render are still created, without size, so they are
+ *  not attempted again.
+ *
+ *    @param font Font to create glyph in.
+ *    @param ch Unicode code point of the glyph.
+ *    @return Index of the new glyph.
+ */
+static int font_makeGlyph( const glFont *font, uint32_t ch )
+{
+   glFontStash *stash;
+   glFontGlyph *g;
    FT_GlyphSlot slot;
-   int w,h;
+   FT_Bitmap bitmap;
+   GLubyte *data, *dst;
+   int i, x, y, w, h, b;
 
-   slot = face->glyph; /* Small shortcut. */
+   stash = font->stash;
 
-   /* Load the glyph. */
-   if (FT_Load_Char( face, ch, FT_LOAD_RENDER )) {
-      WARN("FT_Load_Char failed.");
-      return -1;
+   /* Allocate. */
+   if (stash->nglyphs >= stash->mglyphs) {
+      stash->mglyphs = MAX( 128, 2*stash->mglyphs );
+      stash->glyphs  = realloc( stash->glyphs,
+            sizeof(glFontGlyph) * stash->mglyphs );
+   }
+   i = stash->nglyphs++;
+   g = &stash->glyphs[i];
+   memset( g, 0, sizeof(glFontGlyph) );
+   g->ch = ch;
+
+   /* Add to lookup. */
+   if (ch < 128) {
+      g->next          = -1;
+      stash->ascii[ch] = i;
+   }
+   else {
+      b                = ch & (FONT_GLYPH_HASH-1);
+      g->next          = stash->hash[b];
+      stash->hash[b]   = i;
    }
 
+   /* Load the glyph. */
+   if (FT_Load_Char( stash->face, ch, FT_LOAD_RENDER )) {
+      WARN("FT_Load_Char failed for character %u.", (unsigned int)ch);
+      return i;
+   }
+   slot   = stash->face->glyph; /* Small shortcut. */
    bitmap = slot->bitmap; /* to simplify */
+   w      = bitmap.width;
+   h      = bitmap.rows;
+
+   /* Metrics. */
+   g->adv_x = slot->advance.x >> 6;
+   g->adv_y = slot->advance.y >> 6;
+   if ((w <= 0) || (h <= 0))
+      return i;
+
+   /* Find room. */
+   if (font_atlasPlace( font, w, h, &g->tx, &g->ty )) {
+      WARN("Font atlas is full, unable to add character %u.", (unsigned int)ch);
+      return i;
+   }
+   g->vx = slot->bitmap_left;
+   g->vy = slot->bitmap_top - h;
+   g->vw = w;
+   g->vh = h;
+
+   /* Copy into the atlas. */
+   data = malloc( 2 * w * h );
+   for (y=0; y<h; y++) {
+      dst = &stash->atlas[ 2 * ((g->ty + y) * stash->w + g->tx) ];
+      for (x=0; x<w; x++) {
+         dst[ 2*x     ] = 0xcf; /* Constant luminance. */
+         dst[ 2*x + 1 ] = bitmap.buffer[ y*bitmap.pitch + x ];
+      }
+      memcpy( &data[ 2*y*w ], dst, 2*w );
+   }
 
-   /* need the POT wrapping for opengl */
-   w = bitmap.width;
-   h = bitmap.rows;
-
-   /* Store data. */
-   c->data = malloc( sizeof(GLubyte) * w*h );
-   memcpy( c->data, bitmap.buffer, sizeof(GLubyte) * w*h );
-   c->w     = w;
-   c->h     = h;
-   c->off_x = slot->bitmap_left;
-   c->off_y = slot->bitmap_top;
-   c->adv_x = slot->advance.x >> 6;
-   c->adv_y = slot->advance.y >> 6;
-   return 0;
+   /* Upload only the glyph. */
+   glBindTexture( GL_TEXTURE_2D, font->texture );
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   glTexSubImage2D( GL_TEXTURE_2D, 0, g->tx, g->ty, w, h,
+         GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, data );
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+   free(data);
+
+   /* Check for errors. */
+   gl_checkErr();
+
+   return i;
 }
 
 
 /**
- * @brief Generates the font's texture atlas.
+ * @brief Finds room for a glyph in the atlas.
+ *
+ * Glyphs are packed left to right in shelves, the atlas grows downwards when
+ *  it runs out of shelves.
+ *
+ *    @param font Font to find room in.
+ *    @param w Width of the glyph.
+ *    @param h Height of the glyph.
+ *    @param[out] x X position of the glyph in the atlas.
+ *    @param[out] y Y position of the glyph in the atlas.
+ *    @return 0 on success.
  */
-static int font_genTextureAtlas( glFont* font, FT_Face face )
+static int font_atlasPlace( const glFont *font, int w, int h, int *x, int *y )
 {
-   font_char_t chars[128];
-   int i, n;
-   int x, y, x_off, y_off;
-   int total_w;
-   int w, h, max_h;
-   int offset;
-   GLubyte *data;
-   GLfloat *vbo_tex;
-   GLint *vbo_vert;
-   GLfloat tx, ty, txw, tyh;
-   GLfloat fw, fh;
-   GLint vx, vy, vw, vh;
-
-   /* Render characters into software. */
-   total_w  = 0;
-   max_h    = 0;
-   for (i=0; i<128; i++) {
-      font_makeChar( &chars[i], face, i );
-      total_w += chars[i].w;
-      if (chars[i].h > max_h)
-         max_h = chars[i].h;
-   }
-
-   /* Calculate how to fit them.
-    * rows * Hmax = Wtotal / rows
-    * rows^2 = Wtotal / Hmax
-    * rows = sqrt( Wtotal / Hmax )
-    */
-   n = ceil( sqrt( (double)total_w / (double)max_h ) );
-   w = ceil( total_w / n ) + 1;
-   h = ceil( max_h * n ) + 1;
-
-   /* Check if need to be POT. */
-   if (1) { /*gl_needPOT()) { */ /** @TODO fix this stuff. */
-      w = gl_pot(w);
-      h = gl_pot(h);
-   }
-
-   /* Test fit - formula isn't perfect. */
-   x_off = 0;
-   y_off = 0;
-   for (i=0; i<128; i++) {
-      if (x_off + chars[i].w >= w) {
-         x_off  = 0;
-         y_off += max_h;
-
-         /* Check for overflow. */
-         if (y_off + max_h >= h) {
-            h += max_h;
-
-            /* POT needs even more. */
-            if (1) { /*gl_needPOT()) { */ /** @TODO fix this stuff. */
-               h = gl_pot(h);
-            }
-         }
-      }
+   glFontStash *stash;
 
-      /* Displace offset. */
-      x_off += chars[i].w;
+   stash = font->stash;
+
+   /* Too wide for any shelf. */
+   if (w+1 > stash->w)
+      return -1;
+
+   /* New shelf. */
+   if (stash->x + w+1 > stash->w) {
+      stash->x     = 0;
+      stash->y    += stash->shelf + 1;
+      stash->shelf = 0;
    }
 
-   /* Generate the texture. */
-   data  = calloc( w*h*2, 1 );
-   x_off = 0;
-   y_off = 0;
-   for (i=0; i<128; i++) {
-      /* Check if need to skip to newline. */
-      if (x_off + chars[i].w >= w) {
-         x_off  = 0;
-         y_off += max_h;
+   /* Grow. */
+   while (stash->y + h+1 > stash->h)
+      if (font_atlasGrow( font ))
+         return -1;
 
-         if (y_off + max_h >= h)
-            WARN("Font is still too small - something went wrong.");
-      }
+   *x            = stash->x;
+   *y            = stash->y;
+   stash->x     += w+1;
+   stash->shelf  = MAX( stash->shelf, h );
+   return 0;
+}
 
-      /* Render character. */
-      for (y=0; y<chars[i].h; y++) {
-         for (x=0; x<chars[i].w; x++) {
-            offset  = (y_off + y) * w;
-            offset += x_off + x;
-            data[ offset*2     ] = 0xcf; /* Constant luminance. */
-            data[ offset*2 + 1 ] = chars[i].data[ y*chars[i].w + x ];
-         }
-      }
 
-      /* Store character information. */
-      font->chars[i].adv_x = chars[i].adv_x;
-      font->chars[i].adv_y = chars[i].adv_y;
+/**
+ * @brief Doubles the height of the atlas.
+ *
+ * Texture coordinates change so all the layouts using it get rebuilt.
+ *
+ *    @param font Font to grow atlas of.
+ *    @return 0 on success.
+ */
+static int font_atlasGrow( const glFont *font )
+{
+   glFontStash *stash;
+   GLint max;
 
-      /* Store temporary information. */
-      chars[i].tx = x_off;
-      chars[i].ty = y_off;
-      chars[i].tw = chars[i].w;
-      chars[i].th = chars[i].h;
+   stash = font->stash;
 
-      /* Displace offset. */
-      x_off += chars[i].w;
+   /* Hardware limit. */
+   glGetIntegerv( GL_MAX_TEXTURE_SIZE, &max );
+   if (2*stash->h > max)
+      return -1;
 
-      /* Free memory. */
-      free(chars[i].data);
-   }
+   /* Rows are contiguous so the new part just gets appended. */
+   stash->atlas = realloc( stash->atlas, 2 * stash->w * 2*stash->h );
+   memset( &stash->atlas[ 2 * stash->w * stash->h ], 0,
+         2 * stash->w * stash->h );
+   stash->h    *= 2;
+   stash->gen++;
 
-   /* Create the font texture. */
-   glGenTextures( 1, &font->texture );
-   glBindTexture( GL_TEXTURE_2D, font->texture );
+   font_atlasUpload( font );
+   return 0;
+}
 
-   /* Shouldn't ever scale - we'll generate appropriate size font. */
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-   /* Clamp texture .*/
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+/**
+ * @brief Uploads the whole atlas to the texture.
+ *
+ *    @param font Font to upload atlas of.
+ */
+static void font_atlasUpload( const glFont *font )
+{
+   glFontStash *stash;
 
-   /* Upload data. */
-   glTexImage2D( GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, w, h, 0,
-         GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, data );
+   stash = font->stash;
+
+   glBindTexture( GL_TEXTURE_2D, font->texture );
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, stash->w, stash->h, 0,
+         GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, stash->atlas );
 
    /* Check for errors. */
    gl_checkErr();
+}
 
-   /* Create the VBOs. */
-   n           = 8 * 128;
-   vbo_tex     = malloc(sizeof(GLfloat) * n);
-   vbo_vert    = malloc(sizeof(GLint) * n);
-   for (i=0; i<128; i++) {
-      /* We do something like the following for vertex coordinates.
-       *
-       *
-       *  +----------------- top reference   \  <------- font->h
-       *  |                                  |
-       *  |                                  | --- off_y
-       *  +----------------- glyph top       /
-       *  |
-       *  |
-       *  +----------------- glyph bottom
-       *  |
-       *  v   y
-       *
-       *
-       *  +----+------------->  x
-       *  |    |
-       *  |    glyph start
-       *  |
-       *  side reference
-       *
-       *  \----/
-       *   off_x
-       */
-      /* Temporary variables. */
-      fw  = (GLfloat) w;
-      fh  = (GLfloat) h;
-      tx  = (GLfloat)chars[i].tx / fw;
-      ty  = (GLfloat)chars[i].ty / fh;
-      txw = (GLfloat)(chars[i].tx + chars[i].tw) / fw;
-      tyh = (GLfloat)(chars[i].ty + chars[i].th) / fh;
-      vx  = chars[i].off_x;
-      vy  = chars[i].off_y - chars[i].h;
-      vw  = chars[i].w;
-      vh  = chars[i].h;
-      /* Texture coords. */
-      vbo_tex[  8*i + 0 ] = tx;  /* Top left. */
-      vbo_tex[  8*i + 1 ] = ty;
-      vbo_tex[  8*i + 2 ] = txw; /* Top right. */
-      vbo_tex[  8*i + 3 ] = ty;
-      vbo_tex[  8*i + 4 ] = txw; /* Bottom right. */
-      vbo_tex[  8*i + 5 ] = tyh;
-      vbo_tex[  8*i + 6 ] = tx;  /* Bottom left. */
-      vbo_tex[  8*i + 7 ] = tyh;
-      /* Vertex coords. */
-      vbo_vert[ 8*i + 0 ] = vx;    /* Top left. */
-      vbo_vert[ 8*i + 1 ] = vy+vh;
-      vbo_vert[ 8*i + 2 ] = vx+vw; /* Top right. */
-      vbo_vert[ 8*i + 3 ] = vy+vh;
-      vbo_vert[ 8*i + 4 ] = vx+vw; /* Bottom right. */
-      vbo_vert[ 8*i + 5 ] = vy;
-      vbo_vert[ 8*i + 6 ] = vx;    /* Bottom left. */
-      vbo_vert[ 8*i + 7 ] = vy;
-   }
-   font->vbo_tex  = gl_vboCreateStatic( sizeof(GLfloat)*n, vbo_tex );
-   font->vbo_vert = gl_vboCreateStatic( sizeof(GLint)*n, vbo_vert );
-
-   /* Free the data. */
-   free(data);
-   free(vbo_tex);
-   free(vbo_vert);
 
-   return 0;
+/**
+ * @brief Gets the layout of a string, creating it if it's not cached.
+ *
+ *    @param font Font to use.
+ *    @param mode FONT_LAYOUT_* mode of the layout.
+ *    @param width Width limit for the mode.
+ *    @param height Height limit for the mode.
+ *    @param text Text to lay out.
+ *    @return The layout.
+ */
+static glFontLayout* font_layoutGet( const glFont *font, int mode,
+      int width, int height, const char *text )
+{
+   glFontLayout *l;
+   uint32_t hash;
+   const unsigned char *s;
+   int b;
+
+   /* FNV-1a of the key. */
+   hash = 2166136261U;
+   for (s=(const unsigned char*)text; *s != '\0'; s++)
+      hash = (hash ^ *s) * 16777619U;
+   hash ^= (uint32_t)(size_t)font;
+   hash  = (hash ^ (uint32_t)mode)   * 16777619U;
+   hash  = (hash ^ (uint32_t)width)  * 16777619U;
+   hash  = (hash ^ (uint32_t)height) * 16777619U;
+   b     = hash & (FONT_CACHE_HASH-1);
+
+   /* Look it up. */
+   for (l=font_cache[b]; l!=NULL; l=l->hnext) {
+      if ((l->hash == hash) && (l->font == font) && (l->mode == mode) &&
+            (l->width == width) && (l->height == height) &&
+            (strcmp(l->text, text)==0))
+         break;
+   }
+
+   if (l != NULL) {
+      l->hits++;
+
+      /* Atlas changed under it. */
+      if (l->gen != font->stash->gen)
+         font_layoutBuild( l );
+
+      /* Move to front. */
+      if (l != font_lruHead) {
+         l->prev->next = l->next;
+         if (l->next != NULL)
+            l->next->prev = l->prev;
+         else
+            font_lruTail = l->prev;
+         l->prev        = NULL;
+         l->next        = font_lruHead;
+         font_lruHead->prev = l;
+         font_lruHead   = l;
+      }
+      return l;
+   }
+
+   /* Make room. */
+   if (font_ncache >= FONT_CACHE_MAX)
+      font_layoutFree( font_lruTail );
+
+   /* Create it. */
+   l         = calloc( 1, sizeof(glFontLayout) );
+   l->font   = font;
+   l->text   = strdup( text );
+   l->hash   = hash;
+   l->mode   = mode;
+   l->width  = width;
+   l->height = height;
+   font_layoutBuild( l );
+
+   /* Add to cache. */
+   l->hnext       = font_cache[b];
+   font_cache[b]  = l;
+   l->next        = font_lruHead;
+   if (font_lruHead != NULL)
+      font_lruHead->prev = l;
+   else
+      font_lruTail = l;
+   font_lruHead   = l;
+   font_ncache++;
+
+   return l;
 }
 
 
 /**
- * @brief Starts the rendering engine.
+ * @brief Lays out the text of a layout into vertices.
+ *
+ *    @param l Layout to build.
  */
-static void gl_fontRenderStart( const glFont* font, double x, double y, const glColour *c )
+static void font_layoutBuild( glFontLayout *l )
 {
-   /* Enable textures. */
-   glEnable(GL_TEXTURE_2D);
-   glBindTexture( GL_TEXTURE_2D, font->texture);
+   const glFont *font;
+   unsigned int gen;
+   int n, ret, p, state;
+   double y;
 
-   /* Set up matrix. */
-   gl_matrixMode(GL_MODELVIEW);
-   gl_matrixPush();
-      gl_matrixTranslate( round(x-(double)SCREEN_W/2.),
-            round(y-(double)SCREEN_H/2.) );
+   font = l->font;
 
-   /* Handle colour. */
-   if (c==NULL)
-      glColor4d( 1., 1., 1., 1. );
-   else
-      COLOUR(*c);
+   /* Rasterizing glyphs may grow the atlas, in which case the glyphs laid
+    * out before have stale texture coordinates and it has to be redone. */
+   do {
+      gen       = font->stash->gen;
+      l->nvert  = 0;
+      l->nruns  = 0;
+      l->ox     = 0.;
+      state     = 0;
+      font_layoutColour( l, 0 );
+
+      switch (l->mode) {
+         case FONT_LAYOUT_RAW:
+            font_layoutEmit( l, l->text, strlen(l->text), 0., &state );
+            break;
+
+         case FONT_LAYOUT_MAX:
+            ret = font_limitSize( font, NULL, l->text, l->width );
+            font_layoutEmit( l, l->text, ret, 0., &state );
+            break;
+
+         case FONT_LAYOUT_MID:
+            ret   = font_limitSize( font, &n, l->text, l->width );
+            l->ox = (double)(l->width - n)/2.;
+            font_layoutEmit( l, l->text, ret, 0., &state );
+            break;
+
+         case FONT_LAYOUT_TEXT:
+            y = l->height - (double)font->h; /* y is top left corner */
+            p = 0; /* where we last drew up to */
+            while (y > -1e-5) {
+               ret = gl_printWidthForText( font, &l->text[p], l->width );
+               if (ret < 0)
+                  ret = 0;
+               font_layoutEmit( l, &l->text[p], ret, y, &state );
+
+               if (l->text[p+ret] == '\0')
+                  break;
+               p += ret;
+               if ((l->text[p] == '\n') || (l->text[p] == ' '))
+                  p++; /* Skip "empty char". */
+               y -= 1.5*(double)font->h; /* move position down */
+            }
+            break;
+      }
+   } while (gen != font->stash->gen);
+   l->gen = gen;
 
-   /* Activate the appropriate VBOs. */
-   gl_vboActivateOffset( font->vbo_tex,  GL_TEXTURE_COORD_ARRAY, 0, 2, GL_FLOAT, 0 );
-   gl_vboActivateOffset( font->vbo_vert, GL_VERTEX_ARRAY, 0, 2, GL_INT, 0 );
+   /* Old buffer is stale. */
+   if (l->vbo != NULL) {
+      gl_vboDestroy( l->vbo );
+      l->vbo = NULL;
+   }
 }
 
 
 /**
- * @brief Renders a character.
+ * @brief Lays out a line of text.
+ *
+ *    @param l Layout to add to.
+ *    @param text Text of the line.
+ *    @param len Length of the line in bytes.
+ *    @param oy Y offset of the line.
+ *    @param[in,out] state Escape sequence state.
  */
-static int gl_fontRenderCharacter( const glFont* font, int ch, const glColour *c, int state )
+static void font_layoutEmit( glFontLayout *l, const char *text, int len,
+      double oy, int *state )
 {
-   GLushort ind[6];
-   double a;
+   glFontStash *stash;
+   glFontGlyph *g;
+   GLfloat *v;
+   GLfloat x0, y0, x1, y1, s0, t0, s1, t1;
+   uint32_t ch;
+   int i, px, py;
+
+   stash = l->font->stash;
+   px    = 0;
+   py    = (int)round(oy);
+   i     = 0;
+   while (i < len) {
+      ch = font_nextChar( text, &i );
+
+      /* Handle escape sequences. */
+      if (ch == '\e') { /* Start sequence. */
+         *state = 1;
+         continue;
+      }
+      if (*state == 1) {
+         *state = 0;
+         font_layoutColour( l, (ch=='0') ? 0 : (int)ch );
+         continue;
+      }
+
+      g = font_getGlyph( l->font, ch );
+      if ((g->vw > 0) && (g->vh > 0)) {
+         /* Allocate. */
+         if (l->nvert+6 > l->mvert) {
+            l->mvert = MAX( 96, 2*l->mvert );
+            l->data  = realloc( l->data, sizeof(GLfloat) * 4 * l->mvert );
+         }
 
-   /* Handle escape sequences. */
-   if (ch == '\e') /* Start sequence. */
-      return 1;
-   if (state == 1) {
-      a = (c==NULL) ? 1. : c->a;
-      switch (ch) {
-         /* Colours. */
-         case 'r': ACOLOUR(cFontRed,a); break;
-         case 'g': ACOLOUR(cFontGreen,a); break;
-         case 'b': ACOLOUR(cFontBlue,a); break;
-         case 'y': ACOLOUR(cFontYellow,a); break;
-         case 'w': ACOLOUR(cFontWhite,a); break;
-         case 'p': ACOLOUR(cFontPurple,a); break;
-         /* Fancy states. */
-         case 'F': ACOLOUR(cFriend,a); break;
-         case 'H': ACOLOUR(cHostile,a); break;
-         case 'N': ACOLOUR(cNeutral,a); break;
-         case 'I': ACOLOUR(cInert,a); break;
-         /* Reset state. */
-         case '0':
-             if (c==NULL)
-                glColor4d( 1., 1., 1., 1. );
-             else
-                COLOUR(*c);
-             break;
+         /* We do something like the following for vertex coordinates.
+          *
+          *
+          *  +----------------- top reference   \  <------- font->h
+          *  |                                  |
+          *  |                                  | --- off_y
+          *  +----------------- glyph top       /
+          *  |
+          *  |
+          *  +----------------- glyph bottom
+          *  |
+          *  v   y
+          *
+          *
+          *  +----+------------->  x
+          *  |    |
+          *  |    glyph start
+          *  |
+          *  side reference
+          *
+          *  \----/
+          *   off_x
+          */
+         x0 = (GLfloat)(px + g->vx);
+         y0 = (GLfloat)(py + g->vy);
+         x1 = x0 + (GLfloat)g->vw;
+         y1 = y0 + (GLfloat)g->vh;
+         s0 = (GLfloat)g->tx / (GLfloat)stash->w;
+         t0 = (GLfloat)g->ty / (GLfloat)stash->h;
+         s1 = (GLfloat)(g->tx + g->vw) / (GLfloat)stash->w;
+         t1 = (GLfloat)(g->ty + g->vh) / (GLfloat)stash->h;
+
+         /*
+          * 0--1      0--1 4
+          * | /|  =>  | / /|
+          * |/ |      |/ / |
+          * 3--2      2 3--5
+          */
+         v = &l->data[ 4*l->nvert ];
+         v[ 0] = x0; v[ 1] = y1; v[ 2] = s0; v[ 3] = t0; /* Top left. */
+         v[ 4] = x1; v[ 5] = y1; v[ 6] = s1; v[ 7] = t0; /* Top right. */
+         v[ 8] = x0; v[ 9] = y0; v[10] = s0; v[11] = t1; /* Bottom left. */
+         v[12] = x1; v[13] = y1; v[14] = s1; v[15] = t0; /* Top right. */
+         v[16] = x0; v[17] = y0; v[18] = s0; v[19] = t1; /* Bottom left. */
+         v[20] = x1; v[21] = y0; v[22] = s1; v[23] = t1; /* Bottom right. */
+         l->nvert += 6;
       }
-      return 0;
+
+      /* Advance. */
+      px += g->adv_x;
+      py += g->adv_y;
+   }
+}
+
+
+/**
+ * @brief Changes the colour of the following glyphs of a layout.
+ *
+ *    @param l Layout to change colour of.
+ *    @param col Escape character of the colour, 0 for the base colour.
+ */
+static void font_layoutColour( glFontLayout *l, int col )
+{
+   /* Nothing drawn with the current colour. */
+   if ((l->nruns > 0) && (l->runs[ l->nruns-1 ].start == l->nvert)) {
+      l->runs[ l->nruns-1 ].col = col;
+      return;
    }
 
-   /*
-    * Global  Local
-    * 0--1      0--1 4
-    * | /|  =>  | / /|
-    * |/ |      |/ / |
-    * 3--2      2 3--5
-    */
-   ind[0] = 4*ch + 0;
-   ind[1] = 4*ch + 1;
-   ind[2] = 4*ch + 3;
-   ind[3] = 4*ch + 1;
-   ind[4] = 4*ch + 3;
-   ind[5] = 4*ch + 2;
+   if (l->nruns >= l->mruns) {
+      l->mruns = MAX( 4, 2*l->mruns );
+      l->runs  = realloc( l->runs, sizeof(glFontRun) * l->mruns );
+   }
+   l->runs[ l->nruns ].start = l->nvert;
+   l->runs[ l->nruns ].col   = col;
+   l->nruns++;
+}
 
-   /* Draw the element. */
-   glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, ind );
 
-   /* Translate matrix. */
-   gl_matrixTranslate( font->chars[ch].adv_x, font->chars[ch].adv_y );
+/**
+ * @brief Removes a layout from the cache and frees it.
+ *
+ *    @param l Layout to free.
+ */
+static void font_layoutFree( glFontLayout *l )
+{
+   glFontLayout **pl;
 
-   return 0;
+   /* Remove from the hash bucket. */
+   for (pl=&font_cache[ l->hash & (FONT_CACHE_HASH-1) ]; *pl!=NULL;
+         pl=&(*pl)->hnext) {
+      if (*pl == l) {
+         *pl = l->hnext;
+         break;
+      }
+   }
+
+   /* Remove from the recently used list. */
+   if (l->prev != NULL)
+      l->prev->next = l->next;
+   else
+      font_lruHead = l->next;
+   if (l->next != NULL)
+      l->next->prev = l->prev;
+   else
+      font_lruTail = l->prev;
+   font_ncache--;
+
+   if (l->vbo != NULL)
+      gl_vboDestroy( l->vbo );
+   free(l->text);
+   free(l->data);
+   free(l->runs);
+   free(l);
 }
 
 
 /**
- * @brief Ends the rendering engine.
+ * @brief Frees all the cached layouts of a font.
+ *
+ *    @param font Font to free layouts of.
  */
-static void gl_fontRenderEnd (void)
+static void font_layoutPurge( const glFont *font )
 {
+   glFontLayout *l, *next;
+
+   for (l=font_lruHead; l!=NULL; l=next) {
+      next = l->next;
+      if (l->font == font)
+         font_layoutFree( l );
+   }
+}
+
+
+/**
+ * @brief Renders a layout.
+ *
+ * Layouts are streamed the first time they are drawn, if they get reused
+ *  they get their own buffer.
+ *
+ *    @param l Layout to render.
+ *    @param x X position to render at.
+ *    @param y Y position to render at.
+ *    @param c Base colour to use (NULL defaults to white).
+ */
+static void font_layoutRender( glFontLayout *l, double x, double y,
+      const glColour *c )
+{
+   gl_vbo *vbo;
+   GLsizei size;
+   int i, n, end;
+
+   if (l->nvert == 0)
+      return;
+
+   /* Get the buffer. */
+   size = sizeof(GLfloat) * 4 * l->nvert;
+   if ((l->vbo == NULL) && (l->hits > 0))
+      l->vbo = gl_vboCreateStatic( size, l->data );
+   if (l->vbo != NULL)
+      vbo = l->vbo;
+   else {
+      if (font_vbo == NULL)
+         font_vbo = gl_vboCreateStream( size, l->data );
+      else
+         gl_vboData( font_vbo, size, l->data );
+      vbo = font_vbo;
+   }
+
+   /* Enable textures. */
+   glEnable(GL_TEXTURE_2D);
+   glBindTexture( GL_TEXTURE_2D, l->font->texture );
+
+   /* Set up matrix. */
+   gl_matrixMode(GL_MODELVIEW);
+   gl_matrixPush();
+      gl_matrixTranslate( round(x+l->ox-(double)SCREEN_W/2.),
+            round(y-(double)SCREEN_H/2.) );
+
+   /* Activate the VBO. */
+   gl_vboActivateOffset( vbo, GL_VERTEX_ARRAY, 0,
+         2, GL_FLOAT, 4*sizeof(GLfloat) );
+   gl_vboActivateOffset( vbo, GL_TEXTURE_COORD_ARRAY, 2*sizeof(GLfloat),
+         2, GL_FLOAT, 4*sizeof(GLfloat) );
+
+   /* One draw per colour. */
+   for (i=0; i<l->nruns; i++) {
+      end = (i+1 < l->nruns) ? l->runs[i+1].start : l->nvert;
+      n   = end - l->runs[i].start;
+      if (n <= 0)
+         continue;
+      font_setColour( l->runs[i].col, c );
+      glDrawArrays( GL_TRIANGLES, l->runs[i].start, n );
+   }
+
+   /* Clean up. */
    gl_vboDeactivate();
    gl_matrixPop();
    glDisable(GL_TEXTURE_2D);
@@ -904,6 +1336,41 @@ static void gl_fontRenderEnd (void)
 }
 
 
+/**
+ * @brief Sets the colour of an escape sequence.
+ *
+ *    @param col Escape character of the colour, 0 for the base colour.
+ *    @param c Base colour (NULL defaults to white).
+ */
+static void font_setColour( int col, const glColour *c )
+{
+   double a;
+
+   a = (c==NULL) ? 1. : c->a;
+   switch (col) {
+      /* Colours. */
+      case 'r': ACOLOUR(cFontRed,a); break;
+      case 'g': ACOLOUR(cFontGreen,a); break;
+      case 'b': ACOLOUR(cFontBlue,a); break;
+      case 'y': ACOLOUR(cFontYellow,a); break;
+      case 'w': ACOLOUR(cFontWhite,a); break;
+      case 'p': ACOLOUR(cFontPurple,a); break;
+      /* Fancy states. */
+      case 'F': ACOLOUR(cFriend,a); break;
+      case 'H': ACOLOUR(cHostile,a); break;
+      case 'N': ACOLOUR(cNeutral,a); break;
+      case 'I': ACOLOUR(cInert,a); break;
+      /* Base colour. */
+      default:
+         if (c==NULL)
+            glColor4d( 1., 1., 1., 1. );
+         else
+            COLOUR(*c);
+         break;
+   }
+}
+
+
 /**
  * @brief Initializes a font.
  *
@@ -913,47 +1380,52 @@ static void gl_fontRenderEnd (void)
  */
 void gl_fontInit( glFont* font, const char *fname, const unsigned int h )
 {
-   FT_Library library;
-   FT_Face face;
+   glFontStash *stash;
    uint32_t bufsize;
-   FT_Byte* buf;
+   uint32_t i;
 
    /* Get default font if not set. */
    if (font == NULL)
       font = &gl_defFont;
 
-   /* Read the font. */
-   buf = ndata_read( (fname!=NULL) ? fname : FONT_DEF, &bufsize );
-   if (buf == NULL) {
-      WARN("Unable to read font: %s", (fname!=NULL) ? fname : FONT_DEF);
+   /* Allocage. */
+   stash = calloc( 1, sizeof(glFontStash) );
+   if (stash == NULL) {
+      WARN("Out of memory!");
       return;
    }
-
-   /* Allocage. */
-   font->chars = malloc(sizeof(glFontChar)*128);
    font->h = (int)floor((double)h * gl_screen.scale);
-   if (font->chars==NULL) {
-      WARN("Out of memory!");
+
+   /* Read the font. */
+   stash->buf = ndata_read( (fname!=NULL) ? fname : FONT_DEF, &bufsize );
+   if (stash->buf == NULL) {
+      WARN("Unable to read font: %s", (fname!=NULL) ? fname : FONT_DEF);
+      free(stash);
       return;
    }
 
    /* create a FreeType font library */
-   if (FT_Init_FreeType(&library)) {
+   if (FT_Init_FreeType(&stash->library)) {
       WARN("FT_Init_FreeType failed with font %s.",
             (fname!=NULL) ? fname : FONT_DEF );
+      free(stash->buf);
+      free(stash);
       return;
    }
 
    /* object which freetype uses to store font info */
-   if (FT_New_Memory_Face( library, buf, bufsize, 0, &face )) {
+   if (FT_New_Memory_Face( stash->library, stash->buf, bufsize, 0, &stash->face )) {
       WARN("FT_New_Face failed loading library from %s",
             (fname!=NULL) ? fname : FONT_DEF );
+      FT_Done_FreeType(stash->library);
+      free(stash->buf);
+      free(stash);
       return;
    }
 
    /* Try to resize. */
-   if (FT_IS_SCALABLE(face)) {
-      if (FT_Set_Char_Size( face,
+   if (FT_IS_SCALABLE(stash->face)) {
+      if (FT_Set_Char_Size( stash->face,
                0, /* Same as width. */
                h << 6, /* In 1/64th of a pixel. */
                96, /* Create at 96 DPI */
@@ -964,16 +1436,39 @@ void gl_fontInit( glFont* font, const char *fname, const unsigned int h )
       WARN("Font isn't resizeable!");
 
    /* Select the character map. */
-   if (FT_Select_Charmap( face, FT_ENCODING_UNICODE ))
+   if (FT_Select_Charmap( stash->face, FT_ENCODING_UNICODE ))
       WARN("FT_Select_Charmap failed to change character mapping.");
 
-   /* Generate the font atlas. */
-   font_genTextureAtlas( font, face );
+   /* Empty lookup. */
+   for (i=0; i<128; i++)
+      stash->ascii[i] = -1;
+   for (i=0; i<FONT_GLYPH_HASH; i++)
+      stash->hash[i] = -1;
+
+   /* Start with a small atlas, it grows as needed. */
+   stash->w     = MAX( 128, gl_pot( 16*font->h ) );
+   stash->h     = MAX( 32, gl_pot( 2*font->h ) );
+   stash->atlas = calloc( 2 * stash->w * stash->h, 1 );
+   font->stash  = stash;
 
-   /* we can now free the face and library */
-   FT_Done_Face(face);
-   FT_Done_FreeType(library);
-   free(buf);
+   /* Create the font texture. */
+   glGenTextures( 1, &font->texture );
+   glBindTexture( GL_TEXTURE_2D, font->texture );
+
+   /* Shouldn't ever scale - we'll generate appropriate size font. */
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+   /* Clamp texture .*/
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+   font_atlasUpload( font );
+
+   /* ASCII is always needed. */
+   for (i=0; i<128; i++)
+      font_getGlyph( font, i );
+
+   font_nfonts++;
 }
 
 /**
@@ -983,16 +1478,34 @@ void gl_fontInit( glFont* font, const char *fname, const unsigned int h )
  */
 void gl_freeFont( glFont* font )
 {
+   glFontStash *stash;
+
    if (font == NULL)
       font = &gl_defFont;
+   stash = font->stash;
+   if (stash == NULL)
+      return;
+
+   /* Layouts. */
+   font_layoutPurge( font );
+
+   /* Atlas. */
    glDeleteTextures(1,&font->texture);
-   if (font->chars != NULL)
-      free(font->chars);
-   font->chars = NULL;
-   if (font->vbo_tex != NULL)
-      gl_vboDestroy(font->vbo_tex);
-   font->vbo_tex = NULL;
-   if (font->vbo_vert != NULL)
-      gl_vboDestroy(font->vbo_vert);
-   font->vbo_vert = NULL;
+   free(stash->atlas);
+   free(stash->glyphs);
+
+   /* FreeType. */
+   FT_Done_Face(stash->face);
+   FT_Done_FreeType(stash->library);
+   free(stash->buf);
+
+   free(stash);
+   font->stash = NULL;
+
+   /* Shared stream buffer. */
+   font_nfonts--;
+   if ((font_nfonts <= 0) && (font_vbo != NULL)) {
+      gl_vboDestroy( font_vbo );
+      font_vbo = NULL;
+   }
 }
@@ -11,26 +11,20 @@
 #include "opengl.h"
 
 
-/**
- * @brief Represents a character in the font.
- */
-typedef struct glFontChar_s {
-   double adv_x; /**< X advancement. */
-   double adv_y; /**< Y advancement. */
-} glFontChar;
+struct glFontStash_s;
 
 
 /**
  * @struct glFont
  *
  * @brief Represents a font in memory.
+ *
+ * Glyphs are rasterized into the atlas the first time they are used.
  */
 typedef struct glFont_s {
    int h; /**< Font height. */
    GLuint texture; /**< Font atlas. */
-   gl_vbo *vbo_tex; /**< VBO assosciated to texture coordinates. */
-   gl_vbo *vbo_vert; /**< VBO assosciated to vertex coordinates. */
-   glFontChar *chars; /**< Characters in the font. */
+   struct glFontStash_s *stash; /**< Glyphs and FreeType state of the font. */
 } glFont;
 extern glFont gl_defFont; /**< default font */
 extern glFont gl_smallFont; /**< small font */
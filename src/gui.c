@@ -70,6 +70,7 @@
 static int interference_layer = 0; /**< Layer of the current interference. */
 double interference_alpha     = 0.; /**< Alpha of the current interference layer. */
 static double interference_t  = 0.; /**< Interference timer to control transitions. */
+static RngStream interference_rng; /**< Picks layers without touching the simulation's random numbers. */
 
 /* some blinking stuff. */
 static double blink_pilot     = 0.; /**< Timer on target blinking on radar. */
@@ -79,6 +80,25 @@ static double blink_planet    = 0.; /**< Timer on planet blinking on radar. */
 static gl_vbo *gui_vbo = NULL; /**< GUI VBO. */
 static GLsizei gui_vboColourOffset = 0; /**< Offset of colour pixels. */
 
+
+/**
+ * @brief Primitives of one type waiting to be drawn on the radar.
+ */
+typedef struct RadarBatch_ {
+   GLfloat *vertex; /**< Vertex data, 2 per vertex. */
+   GLfloat *colour; /**< Colour data, 4 per vertex. */
+   int n; /**< Number of vertices. */
+   int m; /**< Allocated vertices. */
+} RadarBatch;
+#define RADAR_BATCH_MIN    256 /**< Minimum vertices allocated per radar batch. */
+static RadarBatch radar_lines; /**< Radar lines, drawn first. */
+static RadarBatch radar_points; /**< Radar points (weapons). */
+static RadarBatch radar_tris; /**< Radar triangles (pilots), drawn last. */
+static gl_vbo *radar_vbo   = NULL; /**< VBO holding the whole radar. */
+static int radar_vboSize   = 0; /**< Vertices the radar VBO can hold. */
+static int radar_draws     = 0; /**< Draw calls used by the radar last frame. */
+static int radar_vertices  = 0; /**< Vertices drawn by the radar last frame. */
+
 /*
  * pilot stuff for GUI
  */
@@ -240,6 +260,15 @@ static glColour* gui_getPilotColour( const Pilot* p );
 static void gui_renderPilot( const Pilot* p );
 static void gui_renderHealth( const HealthBar *bar, const double w );
 static void gui_renderInterference( double dt );
+/* Radar batching. */
+static void gui_radarAdd( RadarBatch *b, GLfloat x, GLfloat y,
+      const glColour *c, GLfloat alpha );
+static void gui_radarLine( GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2,
+      const glColour *c, GLfloat alpha );
+static void gui_radarRect( GLfloat x, GLfloat y, GLfloat w, GLfloat h,
+      const glColour *c, GLfloat alpha );
+static void gui_radarUpload (void);
+static void gui_radarDraw( GLenum mode, int start, int n );
 
 
 
@@ -1005,15 +1034,161 @@ void gui_render( double dt )
 }
 
 
+/**
+ * @brief Adds a vertex to a radar batch.
+ */
+static void gui_radarAdd( RadarBatch *b, GLfloat x, GLfloat y,
+      const glColour *c, GLfloat alpha )
+{
+   if (b->n >= b->m) {
+      b->m      = MAX( RADAR_BATCH_MIN, 2*b->m );
+      b->vertex = realloc( b->vertex, sizeof(GLfloat) * 2 * b->m );
+      b->colour = realloc( b->colour, sizeof(GLfloat) * 4 * b->m );
+   }
+   b->vertex[ 2*b->n + 0 ] = x;
+   b->vertex[ 2*b->n + 1 ] = y;
+   b->colour[ 4*b->n + 0 ] = c->r;
+   b->colour[ 4*b->n + 1 ] = c->g;
+   b->colour[ 4*b->n + 2 ] = c->b;
+   b->colour[ 4*b->n + 3 ] = alpha;
+   b->n++;
+}
+
+
+/**
+ * @brief Adds a point to the radar, coordinates are relative to its center.
+ *
+ *    @param x X position of the point.
+ *    @param y Y position of the point.
+ *    @param c Colour of the point.
+ *    @param alpha Alpha of the point.
+ */
+void gui_radarPoint( GLfloat x, GLfloat y, const glColour *c, GLfloat alpha )
+{
+   gui_radarAdd( &radar_points, x, y, c, alpha );
+}
+
+
+/**
+ * @brief Adds a line to the radar.
+ */
+static void gui_radarLine( GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2,
+      const glColour *c, GLfloat alpha )
+{
+   gui_radarAdd( &radar_lines, x1, y1, c, alpha );
+   gui_radarAdd( &radar_lines, x2, y2, c, alpha );
+}
+
+
+/**
+ * @brief Adds a filled rectangle to the radar.
+ */
+static void gui_radarRect( GLfloat x, GLfloat y, GLfloat w, GLfloat h,
+      const glColour *c, GLfloat alpha )
+{
+   gui_radarAdd( &radar_tris, x,   y,   c, alpha );
+   gui_radarAdd( &radar_tris, x+w, y,   c, alpha );
+   gui_radarAdd( &radar_tris, x,   y+h, c, alpha );
+   gui_radarAdd( &radar_tris, x+w, y,   c, alpha );
+   gui_radarAdd( &radar_tris, x+w, y+h, c, alpha );
+   gui_radarAdd( &radar_tris, x,   y+h, c, alpha );
+}
+
+
+/**
+ * @brief Uploads all the radar batches to the radar VBO in one go.
+ *
+ * Vertices are laid out as lines, then points, then triangles, with all the
+ *  colours following the vertices.
+ */
+static void gui_radarUpload (void)
+{
+   int n;
+   GLsizei cofs;
+
+   n = radar_lines.n + radar_points.n + radar_tris.n;
+   if (n == 0)
+      return;
+
+   /* Make sure the VBO can hold everything. */
+   if (n > radar_vboSize) {
+      radar_vboSize = MAX( RADAR_BATCH_MIN, 2*radar_vboSize );
+      while (radar_vboSize < n)
+         radar_vboSize *= 2;
+      if (radar_vbo == NULL)
+         radar_vbo = gl_vboCreateStream( sizeof(GLfloat) * (2+4) * radar_vboSize, NULL );
+      else
+         gl_vboData( radar_vbo, sizeof(GLfloat) * (2+4) * radar_vboSize, NULL );
+   }
+
+   /* Vertices. */
+   gl_vboSubData( radar_vbo, 0,
+         sizeof(GLfloat) * 2*radar_lines.n, radar_lines.vertex );
+   gl_vboSubData( radar_vbo, sizeof(GLfloat) * 2*radar_lines.n,
+         sizeof(GLfloat) * 2*radar_points.n, radar_points.vertex );
+   gl_vboSubData( radar_vbo, sizeof(GLfloat) * 2*(radar_lines.n+radar_points.n),
+         sizeof(GLfloat) * 2*radar_tris.n, radar_tris.vertex );
+
+   /* Colours. */
+   cofs = sizeof(GLfloat) * 2*radar_vboSize;
+   gl_vboSubData( radar_vbo, cofs,
+         sizeof(GLfloat) * 4*radar_lines.n, radar_lines.colour );
+   gl_vboSubData( radar_vbo, cofs + sizeof(GLfloat) * 4*radar_lines.n,
+         sizeof(GLfloat) * 4*radar_points.n, radar_points.colour );
+   gl_vboSubData( radar_vbo, cofs + sizeof(GLfloat) * 4*(radar_lines.n+radar_points.n),
+         sizeof(GLfloat) * 4*radar_tris.n, radar_tris.colour );
+
+   radar_vertices += n;
+}
+
+
+/**
+ * @brief Draws a range of the uploaded radar VBO.
+ *
+ *    @param mode Primitive to draw.
+ *    @param start First vertex to draw.
+ *    @param n Number of vertices to draw.
+ */
+static void gui_radarDraw( GLenum mode, int start, int n )
+{
+   if (n <= 0)
+      return;
+
+   gl_vboActivateOffset( radar_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( radar_vbo, GL_COLOR_ARRAY,
+         sizeof(GLfloat) * 2*radar_vboSize, 4, GL_FLOAT, 0 );
+   glDrawArrays( mode, start, n );
+   gl_vboDeactivate();
+
+   radar_draws++;
+}
+
+
+/**
+ * @brief Gets the draw statistics of the radar for the last frame.
+ *
+ *    @param[out] draws Draw calls used by the radar.
+ *    @param[out] vertices Vertices drawn by the radar.
+ */
+void gui_radarStats( int *draws, int *vertices )
+{
+   *draws    = radar_draws;
+   *vertices = radar_vertices;
+}
+
+
 /**
  * @brief Renders the GUI radar.
  *
+ * Everything on the radar is accumulated into batches first and then drawn
+ *  with one draw call per primitive type.
+ *
  *    @param dt Current deltatick.
  */
 static void gui_renderRadar( double dt )
 {
    int i, j;
-   GLfloat vertex[2*4], colours[4*4];
+   int nlines;
 
    gl_matrixMode( GL_PROJECTION );
    gl_matrixPush();
@@ -1024,6 +1199,13 @@ static void gui_renderRadar( double dt )
       gl_matrixTranslate( gui.radar.x - SCREEN_W/2.,
             gui.radar.y - SCREEN_H/2.);
 
+   /* Start a new frame. */
+   radar_lines.n  = 0;
+   radar_points.n = 0;
+   radar_tris.n   = 0;
+   radar_draws    = 0;
+   radar_vertices = 0;
+
    /*
     * planets
     */
@@ -1052,34 +1234,25 @@ static void gui_renderRadar( double dt )
    if (j!=0)
       gui_renderPilot(pilot_stack[j]);
 
-   /* Intereference. */
-   gui_renderInterference(dt);
-
    /* the + sign in the middle of the radar representing the player */
-   for (i=0; i<4; i++) {
-      colours[4*i + 0] = cRadar_player.r;
-      colours[4*i + 1] = cRadar_player.g;
-      colours[4*i + 2] = cRadar_player.b;
-      colours[4*i + 3] = cRadar_player.a;
+   nlines = radar_lines.n;
+   gui_radarLine(  0., -3.,  0., +3., &cRadar_player, cRadar_player.a );
+   gui_radarLine( -3.,  0., +3.,  0., &cRadar_player, cRadar_player.a );
+
+   /* Draw everything. */
+   gui_radarUpload();
+   if (interference_alpha <= 0.)
+      gui_radarDraw( GL_LINES, 0, radar_lines.n );
+   else
+      gui_radarDraw( GL_LINES, 0, nlines );
+   gui_radarDraw( GL_POINTS, radar_lines.n, radar_points.n );
+   gui_radarDraw( GL_TRIANGLES, radar_lines.n + radar_points.n, radar_tris.n );
+
+   /* Intereference, the player is drawn over it. */
+   if (interference_alpha > 0.) {
+      gui_renderInterference(dt);
+      gui_radarDraw( GL_LINES, nlines, radar_lines.n - nlines );
    }
-   gl_vboSubData( gui_vbo, gui_vboColourOffset,
-         sizeof(GLfloat) * 4*4, colours );
-   /* Set up vertex. */
-   vertex[0] = 0.;
-   vertex[1] = -3.;
-   vertex[2] = 0.;
-   vertex[3] = +3.;
-   vertex[4] = -3.;
-   vertex[5] = 0.;
-   vertex[6] = +3.;
-   vertex[7] = 0.;
-   gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 4*2, vertex );
-   /* Draw tho VBO. */
-   gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-   gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-         gui_vboColourOffset, 4, GL_FLOAT, 0 );
-   glDrawArrays( GL_LINES, 0, 4 );
-   gl_vboDeactivate();
 
    gl_matrixPop();
 }
@@ -1207,7 +1380,7 @@ static void gui_renderInterference( double dt )
    /* Calculate frame to draw. */
    interference_t += dt;
    if (interference_t > INTERFERENCE_CHANGE_DT) { /* Time to change */
-      t = RNG(0, INTERFERENCE_LAYERS-1);
+      t = RNGS(&interference_rng, 0, INTERFERENCE_LAYERS-1);
       if (t != interference_layer)
          interference_layer = t;
       else
@@ -1263,14 +1436,12 @@ static glColour* gui_getPilotColour( const Pilot* p )
    (gui.radar.shape==RADAR_CIRCLE && (((x)*(x)+(y)*(y)) <= rc))
 static void gui_renderPilot( const Pilot* p )
 {
-   int i, curs;
    int x, y, sx, sy;
    double w, h;
    double px, py;
-   glColour *col, ccol;
+   glColour *col;
    double a;
-   GLfloat vertex[2*8], colours[4*8];
-   GLfloat cx, cy;
+   GLfloat cx, cy, alpha;
    int rc;
 
    /* Make sure is in range. */
@@ -1287,6 +1458,7 @@ static void gui_renderPilot( const Pilot* p )
       sx = 1.;
    if (sy < 1.)
       sy = 1.;
+   alpha = 1.-interference_alpha;
 
    /* Check if pilot in range. */
    if ( ((gui.radar.shape==RADAR_RECT) &&
@@ -1304,27 +1476,7 @@ static void gui_renderPilot( const Pilot* p )
             y = gui.radar.w * sin(a);
             sx = 0.85 * x;
             sy = 0.85 * y;
-
-            /* Set up colours. */
-            for (i=0; i<2; i++) {
-               colours[4*i + 0] = cRadar_tPilot.r;
-               colours[4*i + 1] = cRadar_tPilot.g;
-               colours[4*i + 2] = cRadar_tPilot.b;
-               colours[4*i + 3] = 1.-interference_alpha;
-            }
-            gl_vboSubData( gui_vbo, gui_vboColourOffset,
-                  sizeof(GLfloat) * 2*4, colours );
-            /* Set up vertex. */
-            vertex[0] = x;
-            vertex[1] = y;
-            vertex[2] = sx;
-            vertex[3] = sy;
-            gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 2*2, vertex );
-            /* Draw tho VBO. */
-            gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-            gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-                  gui_vboColourOffset, 4, GL_FLOAT, 0 );
-            glDrawArrays( GL_LINES, 0, 2 );
+            gui_radarLine( x, y, sx, sy, &cRadar_tPilot, alpha );
          }
       }
       return;
@@ -1344,70 +1496,30 @@ static void gui_renderPilot( const Pilot* p )
    /* Draw selection if targetted. */
    if (p->id == player->target) {
       if (blink_pilot < RADAR_BLINK_PILOT/2.) {
-         /* Set up colours. */
-         for (i=0; i<8; i++) {
-            colours[4*i + 0] = cRadar_tPilot.r;
-            colours[4*i + 1] = cRadar_tPilot.g;
-            colours[4*i + 2] = cRadar_tPilot.b;
-            colours[4*i + 3] = 1.-interference_alpha;
-         }
-         gl_vboSubData( gui_vbo, gui_vboColourOffset,
-               sizeof(GLfloat) * 8*4, colours );
-         /* Set up vertex. */
-         curs = 0;
          cx = x-sx;
          cy = y+sy;
-         if (CHECK_PIXEL(cx-3.3,cy+3.3)) {
-            vertex[curs++] = cx-1.5;
-            vertex[curs++] = cy+1.5;
-            vertex[curs++] = cx-3.3;
-            vertex[curs++] = cy+3.3;
-         }
+         if (CHECK_PIXEL(cx-3.3,cy+3.3))
+            gui_radarLine( cx-1.5, cy+1.5, cx-3.3, cy+3.3, &cRadar_tPilot, alpha );
          cx = x+sx;
-         if (CHECK_PIXEL(cx+3.3,cy+3.3)) {
-            vertex[curs++] = cx+1.5;
-            vertex[curs++] = cy+1.5;
-            vertex[curs++] = cx+3.3;
-            vertex[curs++] = cy+3.3;
-         }
+         if (CHECK_PIXEL(cx+3.3,cy+3.3))
+            gui_radarLine( cx+1.5, cy+1.5, cx+3.3, cy+3.3, &cRadar_tPilot, alpha );
          cy = y-sy;
-         if (CHECK_PIXEL(cx+3.3,cy-3.3)) {
-            vertex[curs++] = cx+1.5;
-            vertex[curs++] = cy-1.5;
-            vertex[curs++] = cx+3.3;
-            vertex[curs++] = cy-3.3;
-         }
+         if (CHECK_PIXEL(cx+3.3,cy-3.3))
+            gui_radarLine( cx+1.5, cy-1.5, cx+3.3, cy-3.3, &cRadar_tPilot, alpha );
          cx = x-sx;
-         if (CHECK_PIXEL(cx-3.3,cy-3.3)) {
-            vertex[curs++] = cx-1.5;
-            vertex[curs++] = cy-1.5;
-            vertex[curs++] = cx-3.3;
-            vertex[curs++] = cy-3.3;
-         }
-         gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * (curs/2)*2, vertex );
-         /* Draw tho VBO. */
-         gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-               gui_vboColourOffset, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINES, 0, curs/2 );
+         if (CHECK_PIXEL(cx-3.3,cy-3.3))
+            gui_radarLine( cx-1.5, cy-1.5, cx-3.3, cy-3.3, &cRadar_tPilot, alpha );
       }
 
       if (blink_pilot < 0.)
          blink_pilot += RADAR_BLINK_PILOT;
    }
 
-   /* Deactivate VBO. */
-   gl_vboDeactivate();
-
    /* Draw square. */
    px = MAX(x-sx,-w);
    py = MAX(y-sy, -h);
    col = gui_getPilotColour(p);
-   ccol.r = col->r;
-   ccol.g = col->g;
-   ccol.b = col->b;
-   ccol.a = 1.-interference_alpha;
-   gl_renderRect( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ), &ccol );
+   gui_radarRect( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ), col, alpha );
 }
 
 
@@ -1444,15 +1556,13 @@ static glColour *gui_getPlanetColour( int i )
  */
 static void gui_renderPlanet( int ind )
 {
-   int i, curs;
    int cx, cy, x, y, r, rc;
    int w, h;
    double res;
    double a, tx,ty;
-   GLfloat vx, vy, vr;
+   GLfloat vx, vy, vr, alpha;
    glColour *col;
    Planet *planet;
-   GLfloat vertex[8*2], colours[8*4];
 
    /* Make sure is in range. */
    if (!pilot_inRangePlanet( player, ind ))
@@ -1471,6 +1581,7 @@ static void gui_renderPlanet( int ind )
       rc = (int)(gui.radar.w*gui.radar.w);
    else
       rc = 0;
+   alpha = 1.-interference_alpha;
 
    /* Check if in range. */
    if (gui.radar.shape == RADAR_RECT) {
@@ -1489,27 +1600,7 @@ static void gui_renderPlanet( int ind )
             a = ANGLE(cx,cy);
             tx = w*cos(a);
             ty = w*sin(a);
-
-            /* Set the colour. */
-            for (i=0; i<2; i++) {
-               colours[4*i + 0] = cRadar_tPlanet.r;
-               colours[4*i + 1] = cRadar_tPlanet.g;
-               colours[4*i + 2] = cRadar_tPlanet.b;
-               colours[4*i + 3] = 1.-interference_alpha;
-            }
-            gl_vboSubData( gui_vbo, gui_vboColourOffset,
-                  sizeof(GLfloat) * 2*4, colours );
-            /* Set the vertex. */
-            vertex[0] = tx;
-            vertex[1] = ty;
-            vertex[2] = 0.85*tx;
-            vertex[3] = 0.85*ty;
-            gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 2*2, vertex );
-            /* Draw tho VBO. */
-            gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-            gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-                  gui_vboColourOffset, 4, GL_FLOAT, 0 );
-            glDrawArrays( GL_LINES, 0, 2 );
+            gui_radarLine( tx, ty, 0.85*tx, 0.85*ty, &cRadar_tPlanet, alpha );
          }
          return;
       }
@@ -1518,90 +1609,34 @@ static void gui_renderPlanet( int ind )
    /* Do the blink. */
    if (ind == planet_target) {
       if (blink_planet < RADAR_BLINK_PLANET/2.) {
-         curs = 0;
          vx = cx-vr;
          vy = cy+vr;
-         if (CHECK_PIXEL(vx-3.3, vy+3.3)) {
-            vertex[curs++] = vx-1.5;
-            vertex[curs++] = vy+1.5;
-            vertex[curs++] = vx-3.3;
-            vertex[curs++] = vy+3.3;
-         }
+         if (CHECK_PIXEL(vx-3.3, vy+3.3))
+            gui_radarLine( vx-1.5, vy+1.5, vx-3.3, vy+3.3, &cRadar_tPlanet, alpha );
          vx = cx+vr;
-         if (CHECK_PIXEL(vx+3.3, vy+3.3)) {
-            vertex[curs++] = vx+1.5;
-            vertex[curs++] = vy+1.5;
-            vertex[curs++] = vx+3.3;
-            vertex[curs++] = vy+3.3;
-         }
+         if (CHECK_PIXEL(vx+3.3, vy+3.3))
+            gui_radarLine( vx+1.5, vy+1.5, vx+3.3, vy+3.3, &cRadar_tPlanet, alpha );
          vy = cy-vr;
-         if (CHECK_PIXEL(vx+3.3, vy-3.3)) {
-            vertex[curs++] = vx+1.5;
-            vertex[curs++] = vy-1.5;
-            vertex[curs++] = vx+3.3;
-            vertex[curs++] = vy-3.3;
-         }
+         if (CHECK_PIXEL(vx+3.3, vy-3.3))
+            gui_radarLine( vx+1.5, vy-1.5, vx+3.3, vy-3.3, &cRadar_tPlanet, alpha );
          vx = cx-vr;
-         if (CHECK_PIXEL(vx-3.3, vy-3.3)) {
-            vertex[curs++] = vx-1.5;
-            vertex[curs++] = vy-1.5;
-            vertex[curs++] = vx-3.3;
-            vertex[curs++] = vy-3.3;
-         }
-         gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * (curs/2)*2, vertex );
-         /* Set the colours. */
-         for (i=0; i<curs/2; i++) {
-            colours[4*i + 0] = cRadar_tPlanet.r;
-            colours[4*i + 1] = cRadar_tPlanet.g;
-            colours[4*i + 2] = cRadar_tPlanet.b;
-            colours[4*i + 3] = 1.-interference_alpha;
-         }
-         gl_vboSubData( gui_vbo, gui_vboColourOffset,
-               sizeof(GLfloat) * (curs/2)*4, colours );
-         /* Draw tho VBO. */
-         gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-               gui_vboColourOffset, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINES, 0, curs/2 );
+         if (CHECK_PIXEL(vx-3.3, vy-3.3))
+            gui_radarLine( vx-1.5, vy-1.5, vx-3.3, vy-3.3, &cRadar_tPlanet, alpha );
       }
 
       if (blink_planet < 0.)
          blink_planet += RADAR_BLINK_PLANET;
    }
 
-   /* Get the colour. */
+   /* Draw the diamond as separate lines so it batches with everything else. */
    col = gui_getPlanetColour(ind);
-   for (i=0; i<5; i++) {
-      colours[4*i + 0] = col->r;
-      colours[4*i + 1] = col->g;
-      colours[4*i + 2] = col->b;
-      colours[4*i + 3] = 1.-interference_alpha;
-   }
-   gl_vboSubData( gui_vbo, gui_vboColourOffset,
-      sizeof(GLfloat) * 5*4, colours );
-   /* Now load the data. */
    vx = cx;
    vy = cy;
    vr = MAX( vr, 3. ); /* Make sure it's visible. */
-   vertex[0] = vx;
-   vertex[1] = vy + vr;
-   vertex[2] = vx + vr;
-   vertex[3] = vy;
-   vertex[4] = vx;
-   vertex[5] = vy - vr;
-   vertex[6] = vx - vr;
-   vertex[7] = vy;
-   vertex[8] = vertex[0];
-   vertex[9] = vertex[1];
-   gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 5*2, vertex );
-   /* Draw tho VBO. */
-   gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-   gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-         gui_vboColourOffset, 4, GL_FLOAT, 0 );
-   glDrawArrays( GL_LINE_STRIP, 0, 5 );
-
-   /* Deactivate the VBO. */
-   gl_vboDeactivate();
+   gui_radarLine( vx,    vy+vr, vx+vr, vy,    col, alpha );
+   gui_radarLine( vx+vr, vy,    vx,    vy-vr, col, alpha );
+   gui_radarLine( vx,    vy-vr, vx-vr, vy,    col, alpha );
+   gui_radarLine( vx-vr, vy,    vx,    vy+vr, col, alpha );
 }
 #undef PIXEL
 #undef CHECK_PIXEL
@@ -1724,6 +1759,7 @@ int gui_init (void)
     * radar
     */
    gui.radar.res = RADAR_RES_DEFAULT;
+   rng_streamInit( &interference_rng, "interference", 0, 0 );
 
    /*
     * messages
@@ -2287,6 +2323,22 @@ void gui_free (void)
       gui_vbo = NULL;
    }
 
+   /* Free the radar. */
+   if (radar_vbo != NULL) {
+      gl_vboDestroy( radar_vbo );
+      radar_vbo = NULL;
+   }
+   radar_vboSize = 0;
+   free( radar_lines.vertex );
+   free( radar_lines.colour );
+   free( radar_points.vertex );
+   free( radar_points.colour );
+   free( radar_tris.vertex );
+   free( radar_tris.colour );
+   memset( &radar_lines,  0, sizeof(RadarBatch) );
+   memset( &radar_points, 0, sizeof(RadarBatch) );
+   memset( &radar_tris,   0, sizeof(RadarBatch) );
+
    /* Clean up the osd. */
    osd_exit();
 
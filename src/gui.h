@@ -34,6 +34,8 @@ void gui_cleanup (void);
  */
 void gui_renderReticles( double dt );
 void gui_render( double dt );
+void gui_radarPoint( GLfloat x, GLfloat y, const glColour *c, GLfloat alpha );
+void gui_radarStats( int *draws, int *vertices );
 
 /*
  * Messages.
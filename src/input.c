@@ -27,6 +27,7 @@
 #include "weapon.h"
 #include "console.h"
 #include "conf.h"
+#include "replay.h"
 
 
 #define KEY_PRESS    ( 1.) /**< Key is pressed. */
@@ -594,7 +595,7 @@ void input_update (void)
       return;
 
    /* Get time. */
-   t = SDL_GetTicks();
+   t = replay_getTicks();
 
    /* Should be repeating. */
    if (repeat_keyTimer + conf.repeat_delay + repeat_keyCounter*conf.repeat_freq > t)
@@ -629,7 +630,7 @@ static void input_key( int keynum, double value, double kabs, int repeat )
    if (conf.repeat_delay != 0) {
       if ((value == KEY_PRESS) && !repeat) {
          repeat_key        = keynum;
-         repeat_keyTimer   = SDL_GetTicks();
+         repeat_keyTimer   = replay_getTicks();
          repeat_keyCounter = 0;
       }
       else if (value == KEY_RELEASE) {
@@ -658,7 +659,7 @@ static void input_key( int keynum, double value, double kabs, int repeat )
             player_accelOver();
 
          /* double tap accel = afterburn! */
-         t = SDL_GetTicks();
+         t = replay_getTicks();
          if ((conf.afterburn_sens != 0) &&
                (value==KEY_PRESS) && INGAME() && NOHYP() && NODEAD() &&
                (t-input_accelLast <= conf.afterburn_sens))
@@ -26,6 +26,7 @@
 #include "music.h"
 #include "nstd.h"
 #include "toolkit.h"
+#include "replay.h"
 
 
 #define INTRO_FONT_SIZE    18. /**< Intro text font size. */
@@ -130,6 +131,10 @@ int intro_display( const char *text, const char *mus )
    double density;
    SDL_Event event;
 
+   /* Runs in real time outside of the recorded frames, so skip it. */
+   if (replay_isRecording() || replay_isReplaying())
+      return 0;
+
    /* Load the introduction. */
    if (intro_load(text) < 0)
       return -1;
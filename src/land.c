@@ -131,7 +131,9 @@ static void commodity_sell( unsigned int wid, char* str );
 static void outfits_getSize( unsigned int wid, int *w, int *h,
       int *iw, int *ih, int *bw, int *bh );
 static void outfits_open( unsigned int wid );
-static void outfits_updateQuantities( unsigned int wid );
+static glTexture* outfits_getImage( void *data, int elem );
+static const char* outfits_getCaption( void *data, int elem );
+static int outfits_getQuantity( void *data, int elem, char *buf, int len );
 static void outfits_update( unsigned int wid, char* str );
 static int outfit_canBuy( Outfit* outfit, int q, int errmsg );
 static void outfits_buy( unsigned int wid, char* str );
@@ -142,6 +144,8 @@ static void outfits_renderMod( double bx, double by, double w, double h, void *d
 static void outfits_rmouse( unsigned int wid, char* widget_name );
 /* shipyard */
 static void shipyard_open( unsigned int wid );
+static glTexture* shipyard_getImage( void *data, int elem );
+static const char* shipyard_getCaption( void *data, int elem );
 static void shipyard_update( unsigned int wid, char* str );
 static void shipyard_buy( unsigned int wid, char* str );
 static void shipyard_rmouse( unsigned int wid, char* widget_name );
@@ -343,10 +347,8 @@ static void outfits_getSize( unsigned int wid, int *w, int *h,
  */
 static void outfits_open( unsigned int wid )
 {
-   int i;
    Outfit **outfits;
-   char **soutfits;
-   glTexture **toutfits;
+   ImageArraySource src;
    int noutfits;
    int w, h;
    int iw, ih;
@@ -398,65 +400,65 @@ static void outfits_open( unsigned int wid )
          w-(iw+80), 180, 0, "txtDescription",
          &gl_smallFont, NULL, NULL );
 
-   /* set up the outfits to buy/sell */
+   /* set up the outfits to buy/sell, the image array only looks at them
+    * when they are visible. */
    outfits = outfit_getTech( &noutfits, land_planet->tech, PLANET_TECH_MAX);
    if (noutfits <= 0) { /* No outfits */
-      soutfits    = malloc(sizeof(char*));
-      soutfits[0] = strdup("None");
-      toutfits    = malloc(sizeof(glTexture*));
-      toutfits[0] = NULL;
-      noutfits    = 1;
-   }
-   else {
-      /* Create the outfit arrays. */
-      soutfits = malloc(sizeof(char*)*noutfits);
-      toutfits = malloc(sizeof(glTexture*)*noutfits);
-      for (i=0; i<noutfits; i++) {
-         soutfits[i] = strdup(outfits[i]->name);
-         toutfits[i] = outfits[i]->gfx_store;
-      }
       free(outfits);
+      outfits  = NULL;
+      noutfits = 1;
    }
-   window_addImageArray( wid, 20, 20,
+   src.image    = outfits_getImage;
+   src.caption  = outfits_getCaption;
+   src.quantity = outfits_getQuantity;
+   src.free     = free;
+   src.data     = outfits;
+   window_addImageArraySource( wid, 20, 20,
          iw, ih, "iarOutfits", 64, 64,
-         toutfits, soutfits, noutfits, outfits_update, outfits_rmouse );
+         &src, noutfits, outfits_update, outfits_rmouse );
 
    /* write the outfits stuff */
    outfits_update( wid, NULL );
-   outfits_updateQuantities( wid );
 }
 /**
- * @brief Updates the quantity counter for the outfits.
+ * @brief Gets the store image of an outfit in the outfit window.
+ */
+static glTexture* outfits_getImage( void *data, int elem )
+{
+   Outfit **outfits = data;
+   if (outfits == NULL)
+      return NULL;
+   return outfits[elem]->gfx_store;
+}
+/**
+ * @brief Gets the name of an outfit in the outfit window.
+ */
+static const char* outfits_getCaption( void *data, int elem )
+{
+   Outfit **outfits = data;
+   if (outfits == NULL)
+      return "None";
+   return outfits[elem]->name;
+}
+/**
+ * @brief Gets the amount of an outfit the player owns.
  *
- *    @param wid Window to update counters of.
+ *    @return 1 if the player owns any of the outfit.
  */
-static void outfits_updateQuantities( unsigned int wid )
+static int outfits_getQuantity( void *data, int elem, char *buf, int len )
 {
-   Outfit **outfits, *o;
-   int noutfits;
-   char **quantity;
-   int len, owned;
-   int i;
+   Outfit **outfits = data;
+   int owned;
 
-   /* Get outfits. */
-   outfits = outfit_getTech( &noutfits, land_planet->tech, PLANET_TECH_MAX);
-   if (noutfits <= 0)
-      return;
+   if (outfits == NULL)
+      return 0;
 
-   quantity = malloc(sizeof(char*)*noutfits);
-   for (i=0; i<noutfits; i++) {
-      o = outfits[i];
-      owned = player_outfitOwned(o);
-      len = owned / 10 + 4;
-      if (owned >= 1) {
-         quantity[i] = malloc( len );
-         snprintf( quantity[i], len, "%d", owned );
-      }
-      else
-         quantity[i] = NULL;
-   }
-   free(outfits);
-   toolkit_setImageArrayQuantity( wid, "iarOutfits", quantity );
+   owned = player_outfitOwned( outfits[elem] );
+   if (owned < 1)
+      return 0;
+
+   snprintf( buf, len, "%d", owned );
+   return 1;
 }
 /**
  * @brief Updates the outfits in the outfit window.
@@ -631,7 +633,6 @@ static void outfits_buy( unsigned int wid, char* str )
    player_modCredits( -outfit->price * player_addOutfit( outfit, q ) );
    land_checkAddRefuel();
    outfits_update(wid, NULL);
-   outfits_updateQuantities(wid);
 
    /* Update equipment. */
    equipment_addAmmo();
@@ -691,7 +692,6 @@ static void outfits_sell( unsigned int wid, char* str )
    player_modCredits( outfit->price * player_rmOutfit( outfit, q ) );
    land_checkAddRefuel();
    outfits_update(wid, NULL);
-   outfits_updateQuantities(wid);
 
    /* Update equipment. */
    w = land_getWid( LAND_WINDOW_EQUIPMENT );
@@ -747,10 +747,8 @@ static void outfits_renderMod( double bx, double by, double w, double h, void *d
  */
 static void shipyard_open( unsigned int wid )
 {
-   int i;
    Ship **ships;
-   char **sships;
-   glTexture **tships;
+   ImageArraySource src;
    int nships;
    int w, h;
    int iw, ih;
@@ -824,28 +822,42 @@ static void shipyard_open( unsigned int wid )
    /* set up the ships to buy/sell */
    ships = ship_getTech( &nships, land_planet->tech, PLANET_TECH_MAX );
    if (nships <= 0) {
-      sships    = malloc(sizeof(char*));
-      sships[0] = strdup("None");
-      tships    = malloc(sizeof(glTexture*));
-      tships[0] = NULL;
-      nships    = 1;
-   }
-   else {
-      sships = malloc(sizeof(char*)*nships);
-      tships = malloc(sizeof(glTexture*)*nships);
-      for (i=0; i<nships; i++) {
-         sships[i] = strdup(ships[i]->name);
-         tships[i] = ships[i]->gfx_target;
-      }
       free(ships);
+      ships  = NULL;
+      nships = 1;
    }
-   window_addImageArray( wid, 20, 20,
+   src.image    = shipyard_getImage;
+   src.caption  = shipyard_getCaption;
+   src.quantity = NULL;
+   src.free     = free;
+   src.data     = ships;
+   window_addImageArraySource( wid, 20, 20,
          iw, ih, "iarShipyard", 64./96.*128., 64.,
-         tships, sships, nships, shipyard_update, shipyard_rmouse );
+         &src, nships, shipyard_update, shipyard_rmouse );
 
    /* write the shipyard stuff */
    shipyard_update(wid, NULL);
 }
+/**
+ * @brief Gets the target image of a ship in the shipyard window.
+ */
+static glTexture* shipyard_getImage( void *data, int elem )
+{
+   Ship **ships = data;
+   if (ships == NULL)
+      return NULL;
+   return ships[elem]->gfx_target;
+}
+/**
+ * @brief Gets the name of a ship in the shipyard window.
+ */
+static const char* shipyard_getCaption( void *data, int elem )
+{
+   Ship **ships = data;
+   if (ships == NULL)
+      return "None";
+   return ships[elem]->name;
+}
 /**
  * @brief Updates the ships in the shipyard window.
  *    @param wid Window to update the ships in.
@@ -1834,7 +1846,6 @@ static void land_changeTab( unsigned int wid, char *wgt, int tab )
                break;
             case LAND_WINDOW_OUTFITS:
                outfits_update( w, NULL );
-               outfits_updateQuantities( w );
                to_visit   = VISITED_OUTFITS;
                torun_hook = "outfits";
                break;
@@ -40,8 +40,44 @@ static StarSystem **map_path  = NULL; /**< The path to current selected system.
 int map_npath                 = 0; /**< Number of systems in map_path. */
 glTexture *gl_faction_disk    = NULL; /**< Texture of the disk representing factions. */
 
-/* VBO. */
-static gl_vbo *map_vbo = NULL; /**< Map VBO. */
+/**
+ * @brief Vertex data of one kind of map primitive.
+ *
+ * Cached batches are laid out following the systems in map_cache so that a
+ *  contiguous range of systems maps to a contiguous range of vertices.
+ */
+typedef struct MapBatch_ {
+   GLfloat *vertex; /**< Vertex data, 2 per vertex. */
+   GLfloat *colour; /**< Colour data, 4 per vertex. */
+   GLfloat *tex; /**< Texture coordinates, 2 per vertex, NULL if untextured. */
+   int n; /**< Number of vertices. */
+   int m; /**< Allocated vertices. */
+   int *start; /**< First vertex of each cached system, map_ncache+1 entries. */
+   int textured; /**< Whether the batch has texture coordinates. */
+   gl_vbo *vbo; /**< VBO holding the batch. */
+   int vbo_size; /**< Vertices the VBO can hold. */
+} MapBatch;
+#define MAP_BATCH_MIN      256 /**< Minimum vertices allocated per batch. */
+#define MAP_CIRCLE_SEG     16 /**< Segments used to draw system circles. */
+
+/* Cached static geometry, in zoomed map coordinates. */
+static int map_cacheValid        = 0; /**< Whether the cached geometry is up to date. */
+static int *map_cache            = NULL; /**< Cached systems sorted by X position. */
+static GLfloat *map_cacheX       = NULL; /**< Zoomed X position of each cached system. */
+static int map_ncache            = 0; /**< Number of cached systems. */
+static unsigned int *map_cacheFlags = NULL; /**< System flags the cache was built with. */
+static glColour **map_cacheColour = NULL; /**< Faction colours the cache was built with. */
+static int map_ncacheFlags       = 0; /**< Number of systems in map_cacheFlags. */
+static double map_cacheLane      = 0.; /**< Largest horizontal extent of a jump lane. */
+static double map_cacheName      = 0.; /**< Largest horizontal extent of a system name. */
+static MapBatch map_disks; /**< Faction disks, textured triangles. */
+static MapBatch map_lanes; /**< Jump lanes, lines. */
+static MapBatch map_fills; /**< Filled system centers, triangles. */
+static MapBatch map_rings; /**< System circles, lines. */
+
+/* Dynamic overlays rebuilt every frame. */
+static MapBatch map_dynLines; /**< Path and selection, lines. */
+static MapBatch map_dynTris; /**< Mission markers, triangles. */
 
 
 /*
@@ -64,6 +100,25 @@ static void map_buttonZoom( unsigned int wid, char* str );
 static void map_selectCur (void);
 static void map_drawMarker( double x, double y, double r,
       int num, int cur, int type );
+/* Batching. */
+static void map_batchAdd( MapBatch *b, GLfloat x, GLfloat y,
+      const glColour *c, GLfloat alpha );
+static void map_batchAddTex( MapBatch *b, GLfloat x, GLfloat y,
+      GLfloat s, GLfloat t, const glColour *c, GLfloat alpha );
+static void map_batchRing( MapBatch *b, GLfloat x, GLfloat y, GLfloat r,
+      const glColour *c );
+static void map_batchDisk( MapBatch *b, GLfloat x, GLfloat y, GLfloat r,
+      const glColour *c );
+static void map_batchLane( MapBatch *b, const StarSystem *sys,
+      const StarSystem *jsys, const glColour *c );
+static void map_batchUpload( MapBatch *b, int retained );
+static void map_batchDraw( MapBatch *b, GLenum mode, int start, int n );
+static void map_batchFree( MapBatch *b );
+/* Cache. */
+static int map_cacheCheck (void);
+static int map_cacheCompare( const void *p1, const void *p2 );
+static void map_cacheBuild( double r );
+static int map_cacheFind( double x );
 
 
 /**
@@ -73,8 +128,7 @@ static void map_drawMarker( double x, double y, double r,
  */
 int map_init (void)
 {
-   /* Create the VBO. */
-   map_vbo = gl_vboCreateStream( sizeof(GLfloat) * 3*(2+4), NULL );
+   map_cacheValid = 0;
    return 0;
 }
 
@@ -84,11 +138,36 @@ int map_init (void)
  */
 void map_exit (void)
 {
-   /* Destroy the VBO. */
-   if (map_vbo != NULL) {
-      gl_vboDestroy(map_vbo);
-      map_vbo = NULL;
-   }
+   /* Destroy the cache. */
+   map_batchFree( &map_disks );
+   map_batchFree( &map_lanes );
+   map_batchFree( &map_fills );
+   map_batchFree( &map_rings );
+   map_batchFree( &map_dynLines );
+   map_batchFree( &map_dynTris );
+   free( map_cache );
+   map_cache      = NULL;
+   free( map_cacheX );
+   map_cacheX     = NULL;
+   map_ncache     = 0;
+   free( map_cacheFlags );
+   map_cacheFlags = NULL;
+   free( map_cacheColour );
+   map_cacheColour = NULL;
+   map_ncacheFlags = 0;
+   map_cacheValid = 0;
+}
+
+
+/**
+ * @brief Marks the cached map geometry as outdated.
+ *
+ * Should be called whenever systems change in a way that is not reflected
+ *  in their flags, like when a diff adds or removes planets.
+ */
+void map_invalidate (void)
+{
+   map_cacheValid = 0;
 }
 
 
@@ -439,7 +518,7 @@ int map_isOpen (void)
 
 
 /**
- * @brief Draws a mission marker on the map.
+ * @brief Adds a mission marker to the map overlays.
  *
  * @param x X position to draw at.
  * @param y Y position to draw at.
@@ -456,10 +535,7 @@ static void map_drawMarker( double x, double y, double r,
       &cGreen, &cBlue, &cRed, &cOrange
    };
 
-   int i;
    double alpha, cos_alpha, sin_alpha;
-   GLfloat vertex[3*(2+4)];
-
 
    /* Calculate the angle. */
    if ((num == 1) || (num == 2) || (num == 4))
@@ -476,29 +552,17 @@ static void map_drawMarker( double x, double y, double r,
    sin_alpha = r * sin(alpha);
    r = 3 * r;
 
-   /* Draw the marking triangle. */
-   vertex[0] = x + cos_alpha;
-   vertex[1] = y + sin_alpha;
-   vertex[2] = x + cos_alpha + r * cos(beta + alpha);
-   vertex[3] = y + sin_alpha + r * sin(beta + alpha);
-   vertex[4] = x + cos_alpha + r * cos(beta - alpha);
-   vertex[5] = y + sin_alpha - r * sin(beta - alpha);
-
-   for (i=0; i<3; i++) {
-      vertex[6 + 4*i + 0] = colours[type]->r;
-      vertex[6 + 4*i + 1] = colours[type]->g;
-      vertex[6 + 4*i + 2] = colours[type]->b;
-      vertex[6 + 4*i + 3] = colours[type]->a;
-   }
-
-   glEnable(GL_POLYGON_SMOOTH);
-   gl_vboSubData( map_vbo, 0, sizeof(GLfloat) * 3*(2+4), vertex );
-   gl_vboActivateOffset( map_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-   gl_vboActivateOffset( map_vbo, GL_COLOR_ARRAY,
-         sizeof(GLfloat) * 2*3, 4, GL_FLOAT, 0 );
-   glDrawArrays( GL_TRIANGLES, 0, 3 );
-   gl_vboDeactivate();
-   glDisable(GL_POLYGON_SMOOTH);
+   /* Add the marking triangle, it gets drawn with the other overlays. */
+   map_batchAdd( &map_dynTris, x + cos_alpha, y + sin_alpha,
+         colours[type], colours[type]->a );
+   map_batchAdd( &map_dynTris,
+         x + cos_alpha + r * cos(beta + alpha),
+         y + sin_alpha + r * sin(beta + alpha),
+         colours[type], colours[type]->a );
+   map_batchAdd( &map_dynTris,
+         x + cos_alpha + r * cos(beta - alpha),
+         y + sin_alpha - r * sin(beta - alpha),
+         colours[type], colours[type]->a );
 }
 
 /**
@@ -556,34 +620,257 @@ static glTexture *gl_genFactionDisk( int radius )
 }
 
 /**
- * @brief Renders the custom map widget.
+ * @brief Adds a vertex to a map batch.
+ */
+static void map_batchAdd( MapBatch *b, GLfloat x, GLfloat y,
+      const glColour *c, GLfloat alpha )
+{
+   if (b->n >= b->m) {
+      b->m      = MAX( MAP_BATCH_MIN, 2*b->m );
+      b->vertex = realloc( b->vertex, sizeof(GLfloat) * 2 * b->m );
+      b->colour = realloc( b->colour, sizeof(GLfloat) * 4 * b->m );
+      if (b->textured)
+         b->tex = realloc( b->tex, sizeof(GLfloat) * 2 * b->m );
+   }
+   b->vertex[ 2*b->n + 0 ] = x;
+   b->vertex[ 2*b->n + 1 ] = y;
+   b->colour[ 4*b->n + 0 ] = c->r;
+   b->colour[ 4*b->n + 1 ] = c->g;
+   b->colour[ 4*b->n + 2 ] = c->b;
+   b->colour[ 4*b->n + 3 ] = alpha;
+   b->n++;
+}
+
+
+/**
+ * @brief Adds a textured vertex to a map batch.
+ */
+static void map_batchAddTex( MapBatch *b, GLfloat x, GLfloat y,
+      GLfloat s, GLfloat t, const glColour *c, GLfloat alpha )
+{
+   map_batchAdd( b, x, y, c, alpha );
+   b->tex[ 2*(b->n-1) + 0 ] = s;
+   b->tex[ 2*(b->n-1) + 1 ] = t;
+}
+
+
+/**
+ * @brief Adds a circle outline made of lines to a map batch.
+ */
+static void map_batchRing( MapBatch *b, GLfloat x, GLfloat y, GLfloat r,
+      const glColour *c )
+{
+   int i;
+   double a1, a2;
+
+   for (i=0; i<MAP_CIRCLE_SEG; i++) {
+      a1 = 2.*M_PI * (double)i     / (double)MAP_CIRCLE_SEG;
+      a2 = 2.*M_PI * (double)(i+1) / (double)MAP_CIRCLE_SEG;
+      map_batchAdd( b, x + r*cos(a1), y + r*sin(a1), c, c->a );
+      map_batchAdd( b, x + r*cos(a2), y + r*sin(a2), c, c->a );
+   }
+}
+
+
+/**
+ * @brief Adds a filled circle made of triangles to a map batch.
+ */
+static void map_batchDisk( MapBatch *b, GLfloat x, GLfloat y, GLfloat r,
+      const glColour *c )
+{
+   int i;
+   double a1, a2;
+
+   for (i=0; i<MAP_CIRCLE_SEG; i++) {
+      a1 = 2.*M_PI * (double)i     / (double)MAP_CIRCLE_SEG;
+      a2 = 2.*M_PI * (double)(i+1) / (double)MAP_CIRCLE_SEG;
+      map_batchAdd( b, x, y, c, c->a );
+      map_batchAdd( b, x + r*cos(a1), y + r*sin(a1), c, c->a );
+      map_batchAdd( b, x + r*cos(a2), y + r*sin(a2), c, c->a );
+   }
+}
+
+
+/**
+ * @brief Adds a jump lane that fades out at both ends to a map batch.
+ */
+static void map_batchLane( MapBatch *b, const StarSystem *sys,
+      const StarSystem *jsys, const glColour *c )
+{
+   GLfloat x1, y1, x2, y2, mx, my;
+
+   x1 = sys->pos.x * map_zoom;
+   y1 = sys->pos.y * map_zoom;
+   x2 = jsys->pos.x * map_zoom;
+   y2 = jsys->pos.y * map_zoom;
+   mx = (x1 + x2) / 2.;
+   my = (y1 + y2) / 2.;
+
+   map_batchAdd( b, x1, y1, c, 0. );
+   map_batchAdd( b, mx, my, c, c->a );
+   map_batchAdd( b, mx, my, c, c->a );
+   map_batchAdd( b, x2, y2, c, 0. );
+}
+
+
+/**
+ * @brief Uploads a map batch to its VBO.
  *
- *    @param bx Base X position to render at.
- *    @param by Base Y position to render at.
- *    @param w Width of the widget.
- *    @param h Height of the widget.
+ * Vertices, colours and texture coordinates are stored one after another.
+ *
+ *    @param b Batch to upload.
+ *    @param retained Whether the batch is kept for many frames.
  */
-static void map_render( double bx, double by, double w, double h, void *data )
+static void map_batchUpload( MapBatch *b, int retained )
 {
-   (void) data;
-   int i,j, n,m;
-   double x,y,r, tx,ty, fuel;
-   StarSystem *sys, *jsys, *hsys, *lsys;
-   glColour *col, c;
-   GLfloat vertex[8*(2+4)];
-   int sw, sh;
+   GLsizei size;
 
-   /* Parameters. */
-   r = round(CLAMP(5., 15., 6.*map_zoom));
-   x = round((bx - map_xpos + w/2) * 1.);
-   y = round((by - map_ypos + h/2) * 1.);
+   if (b->n == 0)
+      return;
 
-   /* background */
-   gl_renderRect( bx, by, w, h, &cBlack );
+   /* Make sure the VBO can hold everything. */
+   if (b->n > b->vbo_size) {
+      b->vbo_size = b->m;
+      size = sizeof(GLfloat) * (2+4+(b->textured ? 2 : 0)) * b->vbo_size;
+      if (b->vbo == NULL)
+         b->vbo = retained ? gl_vboCreateStatic( size, NULL ) :
+               gl_vboCreateStream( size, NULL );
+      else
+         gl_vboData( b->vbo, size, NULL );
+   }
+
+   gl_vboSubData( b->vbo, 0, sizeof(GLfloat) * 2*b->n, b->vertex );
+   gl_vboSubData( b->vbo, sizeof(GLfloat) * 2*b->vbo_size,
+         sizeof(GLfloat) * 4*b->n, b->colour );
+   if (b->textured)
+      gl_vboSubData( b->vbo, sizeof(GLfloat) * 6*b->vbo_size,
+            sizeof(GLfloat) * 2*b->n, b->tex );
+}
+
+
+/**
+ * @brief Draws a range of an uploaded map batch.
+ *
+ *    @param b Batch to draw.
+ *    @param mode Primitive to draw.
+ *    @param start First vertex to draw.
+ *    @param n Number of vertices to draw.
+ */
+static void map_batchDraw( MapBatch *b, GLenum mode, int start, int n )
+{
+   if ((b->vbo == NULL) || (n <= 0))
+      return;
+
+   gl_vboActivateOffset( b->vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( b->vbo, GL_COLOR_ARRAY,
+         sizeof(GLfloat) * 2*b->vbo_size, 4, GL_FLOAT, 0 );
+   if (b->textured)
+      gl_vboActivateOffset( b->vbo, GL_TEXTURE_COORD_ARRAY,
+            sizeof(GLfloat) * 6*b->vbo_size, 2, GL_FLOAT, 0 );
+   glDrawArrays( mode, start, n );
+   gl_vboDeactivate();
+}
+
+
+/**
+ * @brief Frees a map batch.
+ */
+static void map_batchFree( MapBatch *b )
+{
+   free( b->vertex );
+   free( b->colour );
+   free( b->tex );
+   free( b->start );
+   if (b->vbo != NULL)
+      gl_vboDestroy( b->vbo );
+   memset( b, 0, sizeof(MapBatch) );
+}
+
+
+/**
+ * @brief Checks to see if the cached map geometry is still valid.
+ *
+ * Knowing or marking a system changes what the map shows, so the flags are
+ *  compared against the ones the cache was built with.  So are the faction
+ *  colours since they follow the player's standing.
+ *
+ *    @return 1 if the cache is valid, 0 if it must be rebuilt.
+ */
+static int map_cacheCheck (void)
+{
+   int i, valid;
+   glColour *col;
+
+   valid = map_cacheValid;
+
+   /* Universe changed size. */
+   if (map_ncacheFlags != systems_nstack) {
+      map_cacheFlags  = realloc( map_cacheFlags,
+            sizeof(unsigned int) * systems_nstack );
+      map_cacheColour = realloc( map_cacheColour,
+            sizeof(glColour*) * systems_nstack );
+      map_ncacheFlags = systems_nstack;
+      for (i=0; i<systems_nstack; i++) {
+         map_cacheFlags[i]  = systems_stack[i].flags;
+         map_cacheColour[i] = faction_getColour( systems_stack[i].faction );
+      }
+      return 0;
+   }
 
-   /*
-    * First pass renders everything almost (except names and markers).
-    */
+   for (i=0; i<systems_nstack; i++) {
+      if (map_cacheFlags[i] != systems_stack[i].flags) {
+         map_cacheFlags[i] = systems_stack[i].flags;
+         valid = 0;
+      }
+      col = faction_getColour( systems_stack[i].faction );
+      if (map_cacheColour[i] != col) {
+         map_cacheColour[i] = col;
+         valid = 0;
+      }
+   }
+
+   return valid;
+}
+
+
+/**
+ * @brief Compares two systems by X position for qsort.
+ */
+static int map_cacheCompare( const void *p1, const void *p2 )
+{
+   double x1, x2;
+
+   x1 = systems_stack[ *(const int*)p1 ].pos.x;
+   x2 = systems_stack[ *(const int*)p2 ].pos.x;
+
+   if (x1 < x2)
+      return -1;
+   else if (x1 > x2)
+      return +1;
+   return 0;
+}
+
+
+/**
+ * @brief Rebuilds the cached static map geometry.
+ *
+ * Systems are sorted by X position so that the columns visible in the
+ *  viewport map to contiguous vertex ranges.
+ *
+ *    @param r Radius of the system circles.
+ */
+static void map_cacheBuild( double r )
+{
+   int i, k;
+   StarSystem *sys, *jsys;
+   glColour *col;
+   GLfloat tx, ty, sw, srw;
+   MapBatch *batches[4];
+
+   /* Collect the systems to draw. */
+   map_cache  = realloc( map_cache,  sizeof(int) * systems_nstack );
+   map_cacheX = realloc( map_cacheX, sizeof(GLfloat) * systems_nstack );
+   map_ncache = 0;
    for (i=0; i<systems_nstack; i++) {
       sys = system_getIndex( i );
 
@@ -592,95 +879,208 @@ static void map_render( double bx, double by, double w, double h, void *data )
             && !space_sysReachable(sys))
          continue;
 
-      tx = x + sys->pos.x*map_zoom;
-      ty = y + sys->pos.y*map_zoom;
-
-      /* draws the disk representing the faction */
+      map_cache[ map_ncache++ ] = i;
+   }
+   qsort( map_cache, map_ncache, sizeof(int), map_cacheCompare );
+
+   /* Reset batches. */
+   map_disks.textured = 1;
+   batches[0] = &map_disks;
+   batches[1] = &map_lanes;
+   batches[2] = &map_fills;
+   batches[3] = &map_rings;
+   for (i=0; i<4; i++) {
+      batches[i]->n     = 0;
+      batches[i]->start = realloc( batches[i]->start,
+            sizeof(int) * (map_ncache+1) );
+   }
+   map_cacheLane = 0.;
+   map_cacheName = 0.;
+   sw  = gl_faction_disk->sw;
+   srw = gl_faction_disk->srw;
+
+   for (k=0; k<map_ncache; k++) {
+      sys = system_getIndex( map_cache[k] );
+      tx  = sys->pos.x * map_zoom;
+      ty  = sys->pos.y * map_zoom;
+      map_cacheX[k] = tx;
+      for (i=0; i<4; i++)
+         batches[i]->start[k] = batches[i]->n;
+
+      /* the disk representing the faction */
       if (sys_isKnown(sys) && (sys->faction != -1)) {
-         sw = gl_faction_disk->sw;
-         sh = gl_faction_disk->sw;
-
          col = faction_colour(sys->faction);
-         c.r = col->r;
-         c.g = col->g;
-         c.b = col->b;
-         c.a = 0.7;
-
-         gl_blitTexture(
-               gl_faction_disk,
-               tx - sw/2, ty - sh/2, sw, sh,
-               0., 0., gl_faction_disk->srw, gl_faction_disk->srw, &c );
+         map_batchAddTex( &map_disks, tx-sw/2., ty-sw/2., 0.,  0.,  col, 0.7 );
+         map_batchAddTex( &map_disks, tx+sw/2., ty-sw/2., srw, 0.,  col, 0.7 );
+         map_batchAddTex( &map_disks, tx-sw/2., ty+sw/2., 0.,  srw, col, 0.7 );
+         map_batchAddTex( &map_disks, tx+sw/2., ty-sw/2., srw, 0.,  col, 0.7 );
+         map_batchAddTex( &map_disks, tx+sw/2., ty+sw/2., srw, srw, col, 0.7 );
+         map_batchAddTex( &map_disks, tx-sw/2., ty+sw/2., 0.,  srw, col, 0.7 );
       }
 
-      /* Draw the system. */
+      /* The system. */
       if (!sys_isKnown(sys) || (sys->nfleets==0)) col = &cInert;
       else if (sys->security >= 1.) col = &cGreen;
       else if (sys->security >= 0.6) col = &cOrange;
       else if (sys->security >= 0.3) col = &cRed;
       else col = &cDarkRed;
+      map_batchRing( &map_rings, tx, ty, r, col );
+
+      /* If system is known fill it, radius slightly shorter. */
+      if (sys_isKnown(sys) && (sys->nplanets > 0))
+         map_batchDisk( &map_fills, tx, ty, 0.5*r,
+               faction_getColour( sys->faction ) );
 
-      gl_drawCircleInRect( tx, ty, r, bx, by, w, h, col, 0 );
+      if (!sys_isKnown(sys))
+         continue; /* we don't draw hyperspace lines */
 
-      /* If system is known fill it. */
-      if (sys_isKnown(sys) && (sys->nplanets > 0)) {
-         /* Planet colours */
-         if (!sys_isKnown(sys)) col = &cInert;
-         else if (sys->nplanets==0) col = &cInert;
-         else col = faction_getColour( sys->faction);
+      /* Name extends to the right of the system. */
+      map_cacheName = MAX( map_cacheName, 11.*map_zoom +
+            gl_printWidthRaw( &gl_smallFont, sys->name ) );
 
-         /* Radius slightly shorter. */
-         gl_drawCircleInRect( tx, ty, 0.5*r, bx, by, w, h, col, 1 );
+      /* the hyperspace paths */
+      for (i=0; i<sys->njumps; i++) {
+         jsys = system_getIndex( sys->jumps[i] );
+         map_batchLane( &map_lanes, sys, jsys, &cDarkBlue );
+         map_cacheLane = MAX( map_cacheLane,
+               ABS(jsys->pos.x - sys->pos.x) * map_zoom );
       }
+   }
+
+   /* Upload. */
+   for (i=0; i<4; i++) {
+      batches[i]->start[ map_ncache ] = batches[i]->n;
+      map_batchUpload( batches[i], 1 );
+   }
+
+   map_cacheValid = 1;
+}
 
-      if (!sys_isKnown(sys))
-         continue; /* we don't draw hyperspace lines */
 
-      /* draw the hyperspace paths */
-      glShadeModel(GL_SMOOTH);
-      col = &cDarkBlue;
-      /* first we draw all of the paths. */  
-      for (j=0; j<sys->njumps; j++) {
-
-         jsys = system_getIndex( sys->jumps[j] );
-         if (hyperspace_target != -1)
-            hsys = system_getIndex( cur_system->jumps[hyperspace_target] );
-
-         /* Draw the lines. */
-         vertex[0]  = x + sys->pos.x * map_zoom;
-         vertex[1]  = y + sys->pos.y * map_zoom;
-         vertex[2]  = vertex[0] + (jsys->pos.x - sys->pos.x)/2. * map_zoom;
-         vertex[3]  = vertex[1] + (jsys->pos.y - sys->pos.y)/2. * map_zoom;
-         vertex[4]  = x + jsys->pos.x * map_zoom;
-         vertex[5]  = y + jsys->pos.y * map_zoom;
-         vertex[6]  = col->r;
-         vertex[7]  = col->g;
-         vertex[8]  = col->b;
-         vertex[9]  = 0.;
-         vertex[10] = col->r;
-         vertex[11] = col->g;
-         vertex[12] = col->b;
-         vertex[13] = col->a;
-         vertex[14] = col->r;
-         vertex[15] = col->g;
-         vertex[16] = col->b;
-         vertex[17] = 0.;
-         gl_vboSubData( map_vbo, 0, sizeof(GLfloat) * 3*(2+4), vertex );
-         gl_vboActivateOffset( map_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( map_vbo, GL_COLOR_ARRAY,
-               sizeof(GLfloat) * 2*3, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINE_STRIP, 0, 3 );
-         gl_vboDeactivate();
+/**
+ * @brief Finds the first cached system at or past a zoomed X position.
+ *
+ *    @param x Zoomed X position to look for.
+ *    @return Index in map_cache of the first system with X >= x.
+ */
+static int map_cacheFind( double x )
+{
+   int lo, hi, mid;
+
+   lo = 0;
+   hi = map_ncache;
+   while (lo < hi) {
+      mid = (lo + hi) / 2;
+      if (map_cacheX[mid] < x)
+         lo = mid+1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+
+/**
+ * @brief Renders the custom map widget.
+ *
+ * Static geometry comes from the cache and only the columns of systems
+ *  visible in the widget are drawn.  Paths and markers are batched every
+ *  frame on top.
+ *
+ *    @param bx Base X position to render at.
+ *    @param by Base Y position to render at.
+ *    @param w Width of the widget.
+ *    @param h Height of the widget.
+ */
+static void map_render( double bx, double by, double w, double h, void *data )
+{
+   (void) data;
+   int j,k, n,m;
+   int i0, i1;
+   double x,y,r, tx,ty, fuel, left,right, margin;
+   StarSystem *sys, *jsys, *lsys;
+   glColour *col;
+
+   /* Parameters. */
+   r = round(CLAMP(5., 15., 6.*map_zoom));
+   x = round((bx - map_xpos + w/2) * 1.);
+   y = round((by - map_ypos + h/2) * 1.);
+
+   /* background */
+   gl_renderRect( bx, by, w, h, &cBlack );
+
+   /* Make sure the static geometry is up to date. */
+   if (!map_cacheCheck())
+      map_cacheBuild( r );
+
+   /* Visible columns in zoomed map coordinates. */
+   left  = bx - x;
+   right = bx + w - x;
+
+   gl_matrixMode( GL_PROJECTION );
+   gl_matrixPush();
+   gl_matrixTranslate( x, y );
+
+   /* Faction disks. */
+   margin = gl_faction_disk->sw / 2.;
+   i0 = map_cacheFind( left - margin );
+   i1 = map_cacheFind( right + margin );
+   glEnable( GL_TEXTURE_2D );
+   glBindTexture( GL_TEXTURE_2D, gl_faction_disk->texture );
+   map_batchDraw( &map_disks, GL_TRIANGLES, map_disks.start[i0],
+         map_disks.start[i1] - map_disks.start[i0] );
+   glDisable( GL_TEXTURE_2D );
+
+   /* Jump lanes, they can cross the viewport from far away. */
+   i0 = map_cacheFind( left - map_cacheLane );
+   i1 = map_cacheFind( right + map_cacheLane );
+   glShadeModel( GL_SMOOTH );
+   map_batchDraw( &map_lanes, GL_LINES, map_lanes.start[i0],
+         map_lanes.start[i1] - map_lanes.start[i0] );
+   glShadeModel( GL_FLAT );
+
+   /* Systems. */
+   i0 = map_cacheFind( left - r );
+   i1 = map_cacheFind( right + r );
+   map_batchDraw( &map_fills, GL_TRIANGLES, map_fills.start[i0],
+         map_fills.start[i1] - map_fills.start[i0] );
+   map_batchDraw( &map_rings, GL_LINES, map_rings.start[i0],
+         map_rings.start[i1] - map_rings.start[i0] );
+
+   gl_matrixPop();
+
+   /*
+    * System names
+    */
+   if (map_zoom > 0.5) {
+      i0 = map_cacheFind( left - map_cacheName );
+      i1 = map_cacheFind( right );
+      for (k=i0; k<i1; k++) {
+         sys = system_getIndex( map_cache[k] );
+
+         /* Skip system. */
+         if (!sys_isKnown(sys))
+            continue;
+
+         tx = x + (sys->pos.x+11.) * map_zoom;
+         ty = y + (sys->pos.y-5.) * map_zoom;
+         gl_print( &gl_smallFont,
+               tx + SCREEN_W/2., ty + SCREEN_H/2.,
+               &cWhite, sys->name );
       }
-      glShadeModel( GL_FLAT );
    }
-   
-   /* Now we'll draw over the lines with the new pathways. */
+
+   /*
+    * Overlays, built every frame.
+    */
+   map_dynLines.n = 0;
+   map_dynTris.n  = 0;
+
+   /* Draw over the lanes with the new pathways. */
    if (map_path != NULL) {
       lsys = cur_system;
-      glShadeModel(GL_SMOOTH);
-      col = &cGreen;
       fuel = player->fuel;
-      
+
       for (j=0; j<map_npath; j++) {
          jsys = map_path[j];
          if (fuel == player->fuel)
@@ -690,70 +1090,25 @@ static void map_render( double bx, double by, double w, double h, void *data )
          else
             col = &cYellow;
          fuel -= 100;
-         
-         /* Draw the lines. */
-         vertex[0]  = x + lsys->pos.x * map_zoom;
-         vertex[1]  = y + lsys->pos.y * map_zoom;
-         vertex[2]  = vertex[0] + (jsys->pos.x - lsys->pos.x)/2. * map_zoom;
-         vertex[3]  = vertex[1] + (jsys->pos.y - lsys->pos.y)/2. * map_zoom;
-         vertex[4]  = x + jsys->pos.x * map_zoom;
-         vertex[5]  = y + jsys->pos.y * map_zoom;
-         vertex[6]  = col->r;
-         vertex[7]  = col->g;
-         vertex[8]  = col->b;
-         vertex[9]  = 0.;
-         vertex[10] = col->r;
-         vertex[11] = col->g;
-         vertex[12] = col->b;
-         vertex[13] = col->a;
-         vertex[14] = col->r;
-         vertex[15] = col->g;
-         vertex[16] = col->b;
-         vertex[17] = 0.;
-         gl_vboSubData( map_vbo, 0, sizeof(GLfloat) * 3*(2+4), vertex );
-         gl_vboActivateOffset( map_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( map_vbo, GL_COLOR_ARRAY,
-               sizeof(GLfloat) * 2*3, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINE_STRIP, 0, 3 );
-         gl_vboDeactivate();
-         
+
+         map_batchLane( &map_dynLines, lsys, jsys, col );
          lsys = jsys;
       }
-      
-      glShadeModel( GL_FLAT );
-   }
-
-   /*
-    * Second pass - System names
-    */
-   for (i=0; i<systems_nstack; i++) {
-      sys = system_getIndex( i );
-
-      /* Skip system. */
-      if (!sys_isKnown(sys) || (map_zoom <= 0.5 ))
-         continue;
-
-      tx = x + (sys->pos.x+11.) * map_zoom;
-      ty = y + (sys->pos.y-5.) * map_zoom;
-      gl_print( &gl_smallFont,
-            tx + SCREEN_W/2., ty + SCREEN_H/2.,
-            &cWhite, sys->name );
    }
 
-
-   /*
-    * Third pass - system markers
-    */
-   for (i=0; i<systems_nstack; i++) {
-      sys = system_getIndex( i );
+   /* System markers, marked systems are always cached. */
+   i0 = map_cacheFind( left - 4.*r );
+   i1 = map_cacheFind( right + 4.*r );
+   for (k=i0; k<i1; k++) {
+      sys = system_getIndex( map_cache[k] );
 
       /* We only care about marked now. */
       if (!sys_isFlag(sys, SYSTEM_MARKED | SYSTEM_CMARKED))
          continue;
 
       /* Get the position. */
-      tx = x + sys->pos.x*map_zoom;
-      ty = y + sys->pos.y*map_zoom;
+      tx = sys->pos.x*map_zoom;
+      ty = sys->pos.y*map_zoom;
 
       /* Count markers. */
       n  = (sys_isFlag(sys, SYSTEM_CMARKED)) ? 1 : 0;
@@ -784,15 +1139,30 @@ static void map_render( double bx, double by, double w, double h, void *data )
    /* Selected planet. */
    if (map_selected != -1) {
       sys = system_getIndex( map_selected );
-      gl_drawCircleInRect( x + sys->pos.x * map_zoom, y + sys->pos.y * map_zoom,
-            1.5*r, bx, by, w, h, &cRed, 0 );
+      map_batchRing( &map_dynLines, sys->pos.x * map_zoom,
+            sys->pos.y * map_zoom, 1.5*r, &cRed );
    }
 
    /* Current planet. */
-   gl_drawCircleInRect( x + cur_system->pos.x * map_zoom,
-         y + cur_system->pos.y * map_zoom,
-         1.5*r, bx, by, w, h, &cRadar_tPlanet, 0 );
+   map_batchRing( &map_dynLines, cur_system->pos.x * map_zoom,
+         cur_system->pos.y * map_zoom, 1.5*r, &cRadar_tPlanet );
+
+   /* Draw the overlays. */
+   map_batchUpload( &map_dynLines, 0 );
+   map_batchUpload( &map_dynTris, 0 );
+   gl_matrixMode( GL_PROJECTION );
+   gl_matrixPush();
+   gl_matrixTranslate( x, y );
+   glShadeModel( GL_SMOOTH );
+   map_batchDraw( &map_dynLines, GL_LINES, 0, map_dynLines.n );
+   glShadeModel( GL_FLAT );
+   glEnable( GL_POLYGON_SMOOTH );
+   map_batchDraw( &map_dynTris, GL_TRIANGLES, 0, map_dynTris.n );
+   glDisable( GL_POLYGON_SMOOTH );
+   gl_matrixPop();
 }
+
+
 /**
  * @brief Map custom widget mouse handling.
  *
@@ -1205,6 +1575,7 @@ static void A_freeList( SysNode *first )
 void map_setZoom(double zoom)
 {
    map_zoom = zoom;
+   map_cacheValid = 0; /* Geometry is stored zoomed. */
    if (gl_faction_disk != NULL)
       gl_freeTexture( gl_faction_disk );
    gl_faction_disk = gl_genFactionDisk( 50 * zoom );
@@ -170,7 +170,7 @@ static int mission_init( Mission* mission, MissionData* misn, int genid, int cre
    }
 
    /* init lua */
-   mission->L = nlua_newState();
+   mission->L = nlua_newState( misn->lua );
    if (mission->L == NULL) {
       WARN("Unable to create a new lua state.");
       return -1;
@@ -527,7 +527,7 @@ void mission_cleanup( Mission* misn )
    if (misn->osd > 0)
       osd_destroy(misn->osd);
    if (misn->L)
-      lua_close(misn->L);
+      nlua_close(misn->L);
 
    /* Clear the memory. */
    memset( misn, 0, sizeof(Mission) );
@@ -747,7 +747,7 @@ static int mission_parse( MissionData* temp, const xmlNodePtr parent )
 
 #ifdef DEBUGGING
          /* Check to see if syntax is valid. */
-         L = luaL_newstate();
+         L = nlua_newState( temp->lua );
          buf = ndata_read( temp->lua, &len );
          ret = luaL_loadbuffer(L, buf, len, temp->name );
          if (ret == LUA_ERRSYNTAX) {
@@ -755,7 +755,7 @@ static int mission_parse( MissionData* temp, const xmlNodePtr parent )
                   temp->name, temp->lua, lua_tostring(L,-1) );
          }
          free(buf);
-         lua_close(L);
+         nlua_close(L);
 #endif /* DEBUGGING */
 
          continue;
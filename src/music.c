@@ -21,6 +21,8 @@
 #include "nluadef.h"
 #include "nlua_var.h"
 #include "nlua_music.h"
+#include "nlua_rnd.h"
+#include "rng.h"
 #include "log.h"
 #include "ndata.h"
 #include "conf.h"
@@ -55,6 +57,7 @@ static char music_situation[PATH_MAX]; /**< What situation music is in. */
  * global music lua
  */
 static lua_State *music_lua = NULL; /**< The Lua music control state. */
+static RngStream music_rng; /**< Random numbers for the music choices. */
 /* functions */
 static int music_runLua( const char *situation );
 
@@ -532,11 +535,15 @@ static int music_luaInit (void)
    if (music_lua != NULL)
       music_luaQuit();
 
-   music_lua = nlua_newState();
+   music_lua = nlua_newState( MUSIC_LUA_PATH );
    nlua_loadBasic(music_lua);
    nlua_loadStandard(music_lua,1);
    nlua_loadMusic(music_lua,0); /* write it */
 
+   /* Music choices must not eat into the simulation's random numbers. */
+   rng_streamInit( &music_rng, "music", 0, 0 );
+   nlua_loadRndStream( music_lua, &music_rng );
+
    /* load the actual lua music code */
    buf = ndata_read( MUSIC_LUA_PATH, &bufsize );
    if (luaL_dobuffer(music_lua, buf, bufsize, MUSIC_LUA_PATH) != 0) {
@@ -563,7 +570,7 @@ static void music_luaQuit (void)
    if (music_lua == NULL)
       return;
 
-   lua_close(music_lua);
+   nlua_close(music_lua);
    music_lua = NULL;
 }
 
@@ -8,6 +8,9 @@
 #include "music_openal.h"
 
 #include <math.h>
+#if HAS_POSIX
+#include <sys/time.h>
+#endif /* HAS_POSIX */
 
 #include "SDL.h"
 #include "SDL_thread.h"
@@ -28,6 +31,8 @@
  */
 #define RG_PREAMP_DB       0.0
 
+#define MUSIC_FADE_STEP    10 /**< Milliseconds between gain updates while fading. */
+
 
 /* Lock for OpenAL operations. */
 #define soundLock()        SDL_mutexP(sound_lock)
@@ -76,6 +81,19 @@ static SDL_Thread *music_player = NULL; /**< Music player thread. */
  */
 static int music_bufSize            = 32*1024; /**< Size of music playing buffer. */
 static char *music_buf              = NULL; /**< Music playing buffer. */
+static int music_nbuf               = 0; /**< Number of buffers decoded ahead. */
+static ALuint *music_buffer         = NULL; /**< Ring of buffers queued on the source. */
+static ALuint *music_processed      = NULL; /**< Buffers unqueued from the source. */
+
+
+/*
+ * Statistics.
+ */
+static Uint32 music_statStart       = 0; /**< Ticks when the thread started. */
+static Uint32 music_statIdle        = 0; /**< Milliseconds the thread spent sleeping. */
+static double music_statDecode      = 0.; /**< Microseconds spent decoding. */
+static int music_statBuffers        = 0; /**< Number of buffers decoded. */
+static int music_statUnderruns      = 0; /**< Times the source ran out of buffers. */
 
 
 /*
@@ -109,7 +127,6 @@ typedef struct alMusic_ {
  * song currently playing
  */
 static alMusic music_vorbis; /**< Current music. */
-static ALuint music_buffer[2]; /**< Front and back buffer. */
 ALuint music_source                    = 0; /**< Source assosciated to music. */
 
 
@@ -126,28 +143,105 @@ static ALfloat music_vol = 1.; /**< Current volume level. */
 static void rg_filter( float **pcm, long channels, long samples, void *filter_param );
 #endif /* HAVE_OV_READ_FILTER */
 static void music_kill (void);
+static Uint32 music_waitTime( music_state_t state, Uint32 buf_ms );
 static int music_thread( void* unused );
+static double music_time (void);
 static int stream_loadBuffer( ALuint buffer );
+static int stream_queueBuffers( ALuint *buffers, int n, int *eof );
+
+
+/**
+ * @brief Decodes the stream into buffers and queues them on the music source.
+ *
+ *    @param buffers Buffers to fill.
+ *    @param n Number of buffers to fill.
+ *    @param[out] eof Set to 1 once the end of the stream is reached.
+ *    @return Number of buffers queued.
+ */
+static int stream_queueBuffers( ALuint *buffers, int n, int *eof )
+{
+   int i, ret, queued;
+
+   queued = 0;
+   for (i=0; (i<n) && !(*eof); i++) {
+      ret = stream_loadBuffer( buffers[i] );
+      if (ret < 0) {
+         *eof = 1;
+         break;
+      }
+
+      soundLock();
+      alSourceQueueBuffers( music_source, 1, &buffers[i] );
+      /* Check for errors. */
+      al_checkErr();
+      soundUnlock();
+      queued++;
+
+      /* Last chunk of the song. */
+      if (ret > 0)
+         *eof = 1;
+   }
+
+   return queued;
+}
+
+
+/**
+ * @brief Gets how long the music thread may sleep in a state.
+ *
+ *    @param state State the thread is in.
+ *    @param buf_ms Duration of a single buffer in milliseconds.
+ *    @return Milliseconds to sleep, SDL_MUTEX_MAXWAIT to sleep until woken up
+ *            or 0 to not sleep at all.
+ */
+static Uint32 music_waitTime( music_state_t state, Uint32 buf_ms )
+{
+   switch (state) {
+      /* Nothing to do until a command arrives. */
+      case MUSIC_STATE_IDLE:
+      case MUSIC_STATE_PAUSED:
+         return SDL_MUTEX_MAXWAIT;
+
+      /* Wake up before the queue runs dry. */
+      case MUSIC_STATE_PLAYING:
+         return MAX( 1, buf_ms/2 );
+
+      /* Fades need a smooth gain ramp. */
+      case MUSIC_STATE_FADEIN:
+      case MUSIC_STATE_FADEOUT:
+         return MAX( 1, MIN( MUSIC_FADE_STEP, buf_ms/2 ) );
+
+      /* Transient states are handled right away. */
+      default:
+         return 0;
+   }
+}
 
 
 /**
  * @brief The music thread.
  *
+ * Keeps a ring of music_nbuf buffers decoded ahead of playback.  Between
+ *  updates the thread sleeps on music_state_cond, either until a command
+ *  arrives or until about half a buffer has been played.
+ *
  *    @param unused Unused.
  */
 static int music_thread( void* unused )
 {
    (void)unused;
 
-   int ret;
-   int active = 0; /* active buffer */
+   int eof;
    ALint state;
-   ALuint removed[2];
-   ALenum value;
+   ALint value;
    music_state_t cur_state;
    ALfloat gain;
    int fadein_start = 0;
    uint32_t fade, fade_timer = 0;
+   Uint32 buf_ms, wait, t;
+
+   eof    = 1;
+   buf_ms = 0;
 
    while (1) {
 
@@ -167,8 +261,10 @@ static int music_thread( void* unused )
 
          case MUSIC_CMD_STOP:
             /* Notify of stopped. */
-            if (music_state == MUSIC_STATE_IDLE)
+            if (music_state == MUSIC_STATE_IDLE) {
+               music_command = MUSIC_CMD_NONE;
                SDL_CondBroadcast( music_state_cond );
+            }
             else
                music_state = MUSIC_STATE_STOPPING;
             break;
@@ -300,7 +396,7 @@ static int music_thread( void* unused )
             alSourceStop( music_source );
             alGetSourcei( music_source, AL_BUFFERS_PROCESSED, &value );
             if (value > 0)
-               alSourceUnqueueBuffers( music_source, value, removed );
+               alSourceUnqueueBuffers( music_source, value, music_processed );
             /* Clear timer. */
             fade_timer = 0;
 
@@ -322,14 +418,16 @@ static int music_thread( void* unused )
           */
          case MUSIC_STATE_LOADING:
 
-            /* Load buffer and start playing. */
-            active = 0; /* load first buffer */
-            ret = stream_loadBuffer( music_buffer[active] );
-            soundLock();
-            alSourceQueueBuffers( music_source, 1, &music_buffer[active] );
-            /* Special case NULL file or error. */
-            if (ret < 0) {
-               soundUnlock();
+            /* Duration of a buffer, used to pace the thread. */
+            musicVorbisLock();
+            if (music_vorbis.rw != NULL)
+               buf_ms = (Uint32)(1000. * (double)music_bufSize /
+                     (2. * music_vorbis.info->channels * music_vorbis.info->rate));
+            musicVorbisUnlock();
+
+            /* Decode ahead as much as the ring holds. */
+            eof = 0;
+            if (stream_queueBuffers( music_buffer, music_nbuf, &eof ) == 0) {
                /* Force state to stopped. */
                musicLock();
                music_state = MUSIC_STATE_IDLE;
@@ -339,6 +437,8 @@ static int music_thread( void* unused )
                musicUnlock();
                break;
             }
+
+            soundLock();
             /* Force volume level. */
             alSourcef( music_source, AL_GAIN, (fadein_start) ? 0. : music_vol );
 
@@ -349,34 +449,6 @@ static int music_thread( void* unused )
             al_checkErr();
 
             soundUnlock();
-            /* Special case of a very short song. */
-            if (ret > 1) {
-               active = -1;
-
-               musicLock();
-               if (fadein_start)
-                  music_state = MUSIC_STATE_FADEIN;
-               else
-                  music_state = MUSIC_STATE_PLAYING;
-               SDL_CondBroadcast( music_state_cond );
-               musicUnlock();
-               break;
-            }
-
-            /* Load second buffer. */
-            active = 1;
-            ret = stream_loadBuffer( music_buffer[active] );
-            if (ret < 0) {
-               active = -1;
-            }
-            else {
-               soundLock();
-               alSourceQueueBuffers( music_source, 1, &music_buffer[active] );
-               /* Check for errors. */
-               al_checkErr();
-               soundUnlock();
-               active = 1 - active;
-            }
 
             musicLock();
             if (fadein_start)
@@ -445,59 +517,62 @@ static int music_thread( void* unused )
           */
          case MUSIC_STATE_PLAYING:
 
-            /* Special case where file has ended. */
-            if (active < 0) {
-               soundLock();
-               alGetSourcei( music_source, AL_SOURCE_STATE, &state );
+            soundLock();
 
-               if (state == AL_STOPPED) {
-                  alGetSourcei( music_source, AL_BUFFERS_PROCESSED, &value );
-                  if (value > 0)
-                     alSourceUnqueueBuffers( music_source, value, removed );
-                  soundUnlock();
+            /* Reclaim the buffers that were played. */
+            alGetSourcei( music_source, AL_BUFFERS_PROCESSED, &value );
+            if (value > 0)
+               alSourceUnqueueBuffers( music_source, value, music_processed );
+            alGetSourcei( music_source, AL_SOURCE_STATE, &state );
+
+            /* Check for errors. */
+            al_checkErr();
+
+            soundUnlock();
 
+            /* Special case where file has ended. */
+            if (eof) {
+               if (state == AL_STOPPED) {
                   musicLock();
                   music_state = MUSIC_STATE_IDLE;
                   if (!music_forced)
                      music_rechoose();
                   musicUnlock();
-                  break;
                }
-
-               soundUnlock();
-
                break;
             }
 
-            soundLock();
-
-            /* See if needs another buffer set. */
-            alGetSourcei( music_source, AL_BUFFERS_PROCESSED, &state );
-            if (state > 0) {
+            /* Refill and requeue them. */
+            if (value > 0)
+               stream_queueBuffers( music_processed, value, &eof );
 
-               /* refill active buffer */
-               alSourceUnqueueBuffers( music_source, 1, removed );
-               ret = stream_loadBuffer( music_buffer[active] );
-               if (ret < 0) {
-                  active = -1;
-               }
-               else {
-                  alSourceQueueBuffers( music_source, 1, &music_buffer[active] );
-                  active = 1 - active;
-               }
+            /* The source ran dry before we refilled it, restart it. */
+            if (state == AL_STOPPED) {
+               music_statUnderruns++;
+               soundLock();
+               alSourcePlay( music_source );
+               al_checkErr();
+               soundUnlock();
             }
-
-            /* Check for errors. */
-            al_checkErr();
-
-            soundUnlock();
+            break;
       }
 
       /*
-       * Global thread delay.
+       * Sleep until a command arrives or the queue needs attention.
        */
-      SDL_Delay(0);
-
+      musicLock();
+      if (music_command == MUSIC_CMD_NONE) {
+         wait = music_waitTime( music_state, buf_ms );
+         if (wait != 0) {
+            t = SDL_GetTicks();
+            if (wait == SDL_MUTEX_MAXWAIT)
+               SDL_CondWait( music_state_cond, music_state_lock );
+            else
+               SDL_CondWaitTimeout( music_state_cond, music_state_lock, wait );
+            music_statIdle += SDL_GetTicks() - t;
+         }
+      }
+      musicUnlock();
    }
 
    return 0;
@@ -544,6 +619,21 @@ static void rg_filter( float **pcm, long channels, long samples, void *filter_pa
 #endif /* HAVE_OV_READ_FILTER */
 
 
+/**
+ * @brief Gets the time in seconds, fine enough to time decoding a buffer.
+ */
+static double music_time (void)
+{
+#if HAS_POSIX
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.;
+#else /* HAS_POSIX */
+   return (double)SDL_GetTicks() / 1000.;
+#endif /* HAS_POSIX */
+}
+
+
 /**
  * @brief Loads a buffer.
  *
@@ -552,6 +642,7 @@ static void rg_filter( float **pcm, long channels, long samples, void *filter_pa
 static int stream_loadBuffer( ALuint buffer )
 {
    int ret, size, section, result;
+   double t;
 
    musicVorbisLock();
 
@@ -561,6 +652,8 @@ static int stream_loadBuffer( ALuint buffer )
       return -1;
    }
 
+   t    = music_time();
+
    ret  = 0;
    size = 0;
    while (size < music_bufSize) { /* fille up the entire data buffer */
@@ -596,11 +689,10 @@ static int stream_loadBuffer( ALuint buffer )
          ret = 1;
          break;
       }
-      /* Hole error. */
+      /* Hole error, decoding can carry on past it. */
       else if (result == OV_HOLE) {
-         musicVorbisUnlock();
          WARN("OGG: Vorbis hole detected in music!");
-         return 0;
+         continue;
       }
       /* Bad link error. */
       else if (result == OV_EBADLINK) {
@@ -612,6 +704,9 @@ static int stream_loadBuffer( ALuint buffer )
       size += result;
    }
 
+   music_statDecode += (music_time() - t) * 1000000.;
+   music_statBuffers++;
+
    musicVorbisUnlock();
 
    /* load the buffer up */
@@ -640,13 +735,16 @@ int music_al_init (void)
    /* Create the buffer. */
    music_bufSize     = conf.al_bufsize * 1024;
    music_buf         = malloc( music_bufSize );
+   music_nbuf        = MAX( 2, conf.al_nbuffers );
+   music_buffer      = malloc( sizeof(ALuint) * music_nbuf );
+   music_processed   = malloc( sizeof(ALuint) * music_nbuf );
 
    soundLock();
 
    /* music_source created in sound_al_init. */
 
    /* Generate buffers and sources. */
-   alGenBuffers( 2, music_buffer );
+   alGenBuffers( music_nbuf, music_buffer );
 
    /* Set up OpenAL properties. */
    alSourcef(  music_source, AL_GAIN, music_vol );
@@ -667,6 +765,7 @@ int music_al_init (void)
     */
    musicLock();
    music_state  = MUSIC_STATE_STARTUP;
+   music_statStart = SDL_GetTicks();
    music_player = SDL_CreateThread( music_thread, NULL );
    SDL_CondWait( music_state_cond, music_state_lock );
    musicUnlock();
@@ -679,14 +778,25 @@ int music_al_init (void)
  */
 void music_al_exit (void)
 {
+#ifdef DEBUGGING
+   double idle, decode;
+   int underruns;
+#endif /* DEBUGGING */
+
    /* Kill the thread. */
    music_kill();
    SDL_WaitThread( music_player, NULL );
 
+#ifdef DEBUGGING
+   music_al_stats( &idle, &underruns, &decode );
+   DEBUG("Music thread: %.1f%% idle, %d underruns, %.2f ms decode per buffer",
+         idle*100., underruns, decode );
+#endif /* DEBUGGING */
+
    soundLock();
 
    /* Free the music. */
-   alDeleteBuffers( 2, music_buffer );
+   alDeleteBuffers( music_nbuf, music_buffer );
    alDeleteSources( 1, &music_source );
 
    /* Check for errors. */
@@ -698,6 +808,11 @@ void music_al_exit (void)
    if (music_buf != NULL)
       free(music_buf);
    music_buf = NULL;
+   free(music_buffer);
+   music_buffer = NULL;
+   free(music_processed);
+   music_processed = NULL;
+   music_nbuf = 0;
 
    /* Destroy the mutex. */
    SDL_DestroyMutex( music_vorbis_lock );
@@ -771,6 +886,7 @@ void music_al_free (void)
    if (music_state != MUSIC_STATE_IDLE) {
       music_command = MUSIC_CMD_STOP;
       music_forced  = 1;
+      SDL_CondBroadcast( music_state_cond );
       while (1) {
          SDL_CondWait( music_state_cond, music_state_lock );
          if (music_state == MUSIC_STATE_IDLE) {
@@ -833,6 +949,7 @@ void music_al_play (void)
    musicLock();
 
    music_command = MUSIC_CMD_FADEIN;
+   SDL_CondBroadcast( music_state_cond );
    while (1) {
       SDL_CondWait( music_state_cond, music_state_lock );
       if (music_isPlaying())
@@ -851,6 +968,7 @@ void music_al_stop (void)
    musicLock();
 
    music_command = MUSIC_CMD_FADEOUT;
+   SDL_CondBroadcast( music_state_cond );
    while (1) {
       SDL_CondWait( music_state_cond, music_state_lock );
       if ((music_state == MUSIC_STATE_IDLE) ||
@@ -870,6 +988,7 @@ void music_al_pause (void)
    musicLock();
 
    music_command = MUSIC_CMD_PAUSE;
+   SDL_CondBroadcast( music_state_cond );
    while (1) {
       SDL_CondWait( music_state_cond, music_state_lock );
       if ((music_state == MUSIC_STATE_IDLE) ||
@@ -889,6 +1008,7 @@ void music_al_resume (void)
    musicLock();
 
    music_command = MUSIC_CMD_PLAY;
+   SDL_CondBroadcast( music_state_cond );
    while (1) {
       SDL_CondWait( music_state_cond, music_state_lock );
       if (music_isPlaying())
@@ -945,6 +1065,30 @@ int music_al_isPlaying (void)
 }
 
 
+/**
+ * @brief Gets statistics on the music streaming thread.
+ *
+ *    @param[out] idle Fraction of time the thread spent sleeping.
+ *    @param[out] underruns Times the source ran out of queued buffers.
+ *    @param[out] decode Average milliseconds spent decoding a buffer.
+ */
+void music_al_stats( double *idle, int *underruns, double *decode )
+{
+   Uint32 t;
+
+   musicLock();
+   t          = SDL_GetTicks() - music_statStart;
+   *idle      = (t > 0) ? (double)music_statIdle / (double)t : 1.;
+   *underruns = music_statUnderruns;
+   musicUnlock();
+
+   musicVorbisLock();
+   *decode    = (music_statBuffers > 0) ?
+         music_statDecode / 1000. / (double)music_statBuffers : 0.;
+   musicVorbisUnlock();
+}
+
+
 /**
  * @brief Tells the music thread to die.
  */
@@ -954,6 +1098,7 @@ static void music_kill (void)
 
    music_command = MUSIC_CMD_KILL;
    music_forced  = 1;
+   SDL_CondBroadcast( music_state_cond );
 
    musicUnlock();
 }
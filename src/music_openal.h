@@ -49,6 +49,12 @@ void music_al_setPos( double sec );
 int music_al_isPlaying (void);
 
 
+/*
+ * Statistics.
+ */
+void music_al_stats( double *idle, int *underruns, double *decode );
+
+
 #endif /* USE_OPENAL */
 
 
@@ -65,6 +65,7 @@
 #include "economy.h"
 #include "menu.h"
 #include "mission.h"
+#include "nlua.h"
 #include "nlua_misn.h"
 #include "nfile.h"
 #include "nebula.h"
@@ -77,6 +78,9 @@
 #include "event.h"
 #include "cond.h"
 #include "land.h"
+#include "save.h"
+#include "explosion.h"
+#include "replay.h"
 
 
 #define CONF_FILE       "conf.lua" /**< Configuration file by default. */
@@ -85,6 +89,8 @@
 #define FONT_SIZE_SMALL 10 /**< Small font size. */
 
 #define NAEV_INIT_DELAY 3000 /**< Minimum amount of time_ms to wait with loading screen */
+#define NAEV_SIM_DT     (1./60.) /**< Length of a simulation step. */
+#define NAEV_SIM_MAXSTEPS 15 /**< Maximum simulation steps run in a single frame. */
 
 
 static int quit = 0; /**< For primary loop */
@@ -103,6 +109,8 @@ static int fps_skipped = 0; /**< Skipped last frame? */
 static double fps_dt  = 1.; /**< Display fps accumulator. */
 static double game_dt = 0.; /**< Current game deltatick (uses dt_mod). */
 static double real_dt = 0.; /**< Real deltatick. */
+static double sim_acc   = 0.; /**< Game time not yet simulated. */
+static double sim_alpha = 1.; /**< Fraction of a step to present past the last step. */
 
 #if HAS_LINUX && defined(DEBUGGING)
 static bfd *abfd      = NULL;
@@ -212,6 +220,10 @@ int main( int argc, char** argv )
    /* random numbers */
    rng_init();
 
+   /* Recording or replaying, seeds the random numbers again. */
+   if (replay_init())
+      WARN("Unable to set up recording or replaying!");
+
 
    /*
     * OpenGL
@@ -284,7 +296,7 @@ int main( int argc, char** argv )
    menu_main();
 
    /* Force a minimum delay with loading screen */
-   if ((SDL_GetTicks() - time_ms) < NAEV_INIT_DELAY)
+   if (!replay_isReplaying() && ((SDL_GetTicks() - time_ms) < NAEV_INIT_DELAY))
       SDL_Delay( NAEV_INIT_DELAY - (SDL_GetTicks() - time_ms) );
    time_ms = SDL_GetTicks(); /* initializes the time_ms */
    /* 
@@ -296,7 +308,7 @@ int main( int argc, char** argv )
    while (SDL_PollEvent(&event));
    /* primary loop */
    while (!quit) {
-      while (SDL_PollEvent(&event)) { /* event loop */
+      while (replay_pollEvent(&event)) { /* event loop */
          if (event.type == SDL_QUIT)
             quit = 1; /* quit is handled here */
 
@@ -304,16 +316,25 @@ int main( int argc, char** argv )
       }
 
       main_loop();
+
+      /* Report savegames that failed to write in the background. */
+      save_update();
    }
 
 
-   /* Save configuration. */
-   conf_saveConfig(buf);
+   /* Save configuration, replays leave it alone like the savegames. */
+   if (!replay_isReplaying())
+      conf_saveConfig(buf);
+
+   /* Make sure the savegame makes it to disk. */
+   if (save_wait() < 0)
+      WARN("The last savegame failed to be written, the previous one was kept.");
 
    /* cleanup some stuff */
    player_cleanup(); /* cleans up the player stuff */
    gui_free(); /* cleans up the player's GUI */
    weapon_exit(); /* destroys all active weapons */
+   expl_free(); /* destroys pending explosions */
    pilots_free(); /* frees the pilots, they were locked up :( */
    cond_exit(); /* destroy conditional subsystem. */
    land_exit(); /* Destroys landing vbo and friends. */
@@ -328,6 +349,9 @@ int main( int argc, char** argv )
    /* Close data. */
    ndata_close();
 
+   /* Stop recording or replaying. */
+   replay_exit();
+
    /* Destroy conf. */
    conf_cleanup(); /* Frees some memory the configuration allocated. */
 
@@ -341,6 +365,7 @@ int main( int argc, char** argv )
    gl_exit(); /* kills video output */
    sound_exit(); /* kills the sound */
    news_exit(); /* destroys the news. */
+   nlua_exit(); /* frees the Lua allocation pool */
 
    /* Free the icon. */
    if (naev_icon)
@@ -513,6 +538,7 @@ void load_all (void)
 void unload_all (void)
 {
    /* data unloading - inverse load_all is a good order */
+   diff_free(); /* parsed diffs reference fleets, ships and outfits */
    economy_destroy(); /* must be called before space_exit */
    space_exit(); /* cleans up the universe itself */
    fleet_free();
@@ -530,13 +556,18 @@ void unload_all (void)
  */
 void main_loop (void)
 {
-   int tk;
+   int tk, headless;
+   double t;
 
    /* Check to see if toolkit is open. */
    tk = toolkit_isOpen();
 
+   /* Nothing is drawn while replaying. */
+   headless = replay_isReplaying();
+
    /* Clear buffer. */
-   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   if (!headless)
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
    fps_control(); /* everyone loves fps control */
 
@@ -547,10 +578,21 @@ void main_loop (void)
    if (!menu_isOpen(MENU_MAIN)) {
       if (!paused)
          update_all(); /* update game */
-      render_all();
+      if (!headless)
+         render_all();
    }
    /* Toolkit is rendered on top. */
-   if (tk) toolkit_render();
+   if (tk && !headless) toolkit_render();
+
+   t = replay_time();
+   nlua_gcUpdate(); /* Collect Lua garbage within the frame budget. */
+   replay_lap( REPLAY_TIMER_LUAGC, t );
+
+   /* Checkpoint the recording. */
+   replay_endFrame();
+
+   if (headless)
+      return;
 
    gl_checkErr(); /* check error every loop */
 
@@ -568,13 +610,17 @@ static void fps_control (void)
    double delay;
    double fps_max;
 
-   /* dt in s */
+   /* dt in s, recorded frames are replayed with their original length. */
    t = SDL_GetTicks();
-   real_dt  = (double)(t - time_ms); /* Get the elapsed ms. */
+   real_dt  = (double)replay_frame( t - time_ms ); /* Get the elapsed ms. */
    real_dt /= 1000.; /* Convert to seconds. */
    game_dt  = real_dt * dt_mod; /* Apply the modifier. */
    time_ms = t;
 
+   /* Replays run as fast as they can. */
+   if (replay_isReplaying())
+      return;
+
    /* if fps is limited */                       
    if (!conf.vsync && conf.fps_max != 0) {
       fps_max = 1./(double)conf.fps_max;
@@ -590,37 +636,36 @@ static void fps_control (void)
 /**
  * @brief Updates the game itself (player flying around and friends).
  *
+ * The simulation always advances in fixed steps of NAEV_SIM_DT no matter the
+ *  framerate.  Time that doesn't fill a whole step is carried over to the next
+ *  frame and the world is displayed interpolated between the last two steps.
+ *
  *    @brief Mainly uses game dt.
  */
 static void update_all (void)
 {
-   double tempdt;
-   static const double fps_min = 1./50.; /**< Minimum fps to run at. */
+   int n;
 
    if ((real_dt > 0.25) && (fps_skipped==0)) { /* slow timers down and rerun calculations */
       pause_delay((unsigned int)game_dt*1000);
       fps_skipped = 1;
       return;
    }
-   else if (game_dt > fps_min) { /* we'll force a minimum of 50 FPS */
-
-      /* First iteration. */
-      tempdt = game_dt - fps_min;
-      pause_delay( (unsigned int)(tempdt*1000));
-      update_routine(fps_min);
-
-      /* run as many cycles of dt=fps_min as needed */
-      while (tempdt > fps_min) {
-         pause_delay((unsigned int)(-fps_min*1000)); /* increment counters */
-         update_routine(fps_min);
-         tempdt -= fps_min;
-      }
 
-      update_routine(tempdt); /* leftovers */
-      /* Note we don't touch game_dt so that fps_display works well */
+   /* Run as many fixed steps as fit. */
+   sim_acc += game_dt;
+   n = 0;
+   while (sim_acc >= NAEV_SIM_DT) {
+      /* Can't keep up, drop the time instead of spiralling. */
+      if (n >= NAEV_SIM_MAXSTEPS) {
+         sim_acc = 0.;
+         break;
+      }
+      update_routine(NAEV_SIM_DT);
+      sim_acc -= NAEV_SIM_DT;
+      n++;
    }
-   else /* Standard, just update with the last dt */
-      update_routine(game_dt);
+   sim_alpha = sim_acc / NAEV_SIM_DT;
 
    fps_skipped = 0;
 }
@@ -633,12 +678,28 @@ static void update_all (void)
  */
 static void update_routine( double dt )
 {
+   double t;
+
+   /* Keep the previous step around for interpolation. */
+   pilots_snapshot();
+   weapons_snapshot();
+
+   /* Subsystems are timed when replaying. */
+   t = replay_time();
    space_update(dt);
+   t = replay_lap( REPLAY_TIMER_SPACE, t );
    weapons_update(dt);
+   t = replay_lap( REPLAY_TIMER_WEAPONS, t );
    spfx_update(dt);
+   t = replay_lap( REPLAY_TIMER_SPFX, t );
    pilots_update(dt);
+   t = replay_lap( REPLAY_TIMER_PILOTS, t );
+   expl_update(); /* applies the frame's explosions at once */
+   t = replay_lap( REPLAY_TIMER_EXPLOSIONS, t );
    missions_update(dt);
+   t = replay_lap( REPLAY_TIMER_MISSIONS, t );
    events_update(dt);
+   replay_lap( REPLAY_TIMER_EVENTS, t );
 }
 
 
@@ -666,6 +727,10 @@ static void render_all (void)
 
    dt = (paused) ? 0. : game_dt;
 
+   /* Display the world between the last two simulation steps. */
+   pilots_presentBegin( sim_alpha, NAEV_SIM_DT );
+   weapons_presentBegin( sim_alpha, NAEV_SIM_DT );
+
    /* setup */
    spfx_begin(dt);
    /* BG */
@@ -684,6 +749,11 @@ static void render_all (void)
    pilots_renderOverlay(dt);
    spfx_end();
    gui_render(dt);
+
+   /* Back to the simulated world. */
+   weapons_presentEnd();
+   pilots_presentEnd();
+
    display_fps( real_dt ); /* Exception. */
 }
 
@@ -698,6 +768,12 @@ static double fps_cur = 0.; /**< FPS accumulator to trigger change. */
 static void display_fps( const double dt )
 {
    double x,y;
+#ifdef DEBUGGING
+   int draws, vertices;
+   int active, virt, stolen;
+   int nstates, mem;
+   double gctime;
+#endif /* DEBUGGING */
 
    fps_dt  += dt;
    fps_cur += 1.;
@@ -711,6 +787,21 @@ static void display_fps( const double dt )
    if (conf.fps_show) {
       gl_print( NULL, x, y, NULL, "%3.2f", fps );
       y -= gl_defFont.h + 5.;
+#ifdef DEBUGGING
+      gui_radarStats( &draws, &vertices );
+      gl_print( NULL, x, y, NULL, "radar: %d draws, %d vertices", draws, vertices );
+      y -= gl_defFont.h + 5.;
+      gl_print( NULL, x, y, NULL, "widgets: %d draws", toolkit_widgetDraws() );
+      y -= gl_defFont.h + 5.;
+      sound_stats( &active, &virt, &stolen );
+      gl_print( NULL, x, y, NULL, "voices: %d active, %d virtual, %d stolen",
+            active, virt, stolen );
+      y -= gl_defFont.h + 5.;
+      nlua_stats( &nstates, &mem, &gctime );
+      gl_print( NULL, x, y, NULL, "lua: %d states, %d KiB, %.2f ms gc",
+            nstates, mem, gctime );
+      y -= gl_defFont.h + 5.;
+#endif /* DEBUGGING */
    }
    if (dt_mod != 1.)
       gl_print( NULL, x, y, NULL, "%3.1fx", dt_mod);
@@ -243,7 +243,7 @@ int news_init (void)
       return 0;
 
    /* Create the state. */
-   news_state = nlua_newState();
+   news_state = nlua_newState( "news" );
    L = news_state;
 
    /* Load the libraries. */
@@ -319,7 +319,7 @@ void news_exit (void)
    news_mlines = 0;
 
    /* Clean up. */
-   lua_close(news_state);
+   nlua_close(news_state);
    news_state = NULL;
 }
 
@@ -234,6 +234,58 @@ int nfile_backupIfExists( const char* path, ... )
 }
 
 
+/**
+ * @brief Backup a file, if it exists, without moving it.
+ *
+ * Unlike nfile_backupIfExists() the file stays where it is, so it can then be
+ *  replaced with a single rename without ever going missing.
+ *
+ *    @param path printf formatted string pointing to the file to backup.
+ *    @return 0 on success, or if file does not exist, -1 on error.
+ */
+int nfile_backupCopyIfExists( const char* path, ... )
+{
+   char file[PATH_MAX], backup[PATH_MAX];
+   char *buf;
+   int len, ret;
+   va_list ap;
+
+   if (path == NULL)
+      return -1;
+   else { /* get the message */
+      va_start(ap, path);
+      vsnprintf(file, PATH_MAX, path, ap);
+      va_end(ap);
+   }
+
+   if (!nfile_fileExists(file))
+      return 0;
+
+   snprintf(backup, PATH_MAX, "%s.backup", file);
+   if (nfile_fileExists(backup))
+      remove(backup);
+
+#if HAS_POSIX
+   /* A hard link is free, fall back to copying if the filesystem can't. */
+   if (link(file, backup) == 0)
+      return 0;
+#endif /* HAS_POSIX */
+
+   buf = nfile_readFile( &len, "%s", file );
+   if (buf == NULL) {
+      WARN("Unable to create back up of '%s'.", file);
+      return -1;
+   }
+   ret = nfile_writeFile( buf, len, "%s", backup );
+   free(buf);
+   if (ret < 0) {
+      WARN("Unable to create back up of '%s'.", file);
+      return -1;
+   }
+   return 0;
+}
+
+
 /**
  * @brief Lists all the visible files in a directory.
  *
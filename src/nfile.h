@@ -12,6 +12,7 @@ char* nfile_dirname( char *path );
 int nfile_dirMakeExist( const char* path, ... ); /* Creates if doesn't exist, 0 success */
 int nfile_fileExists( const char* path, ... ); /* Returns 1 on exists */
 int nfile_backupIfExists( const char* path, ... );
+int nfile_backupCopyIfExists( const char* path, ... ); /* Leaves the original in place */
 char** nfile_readDir( int* nfiles, const char* path, ... );
 char* nfile_readFile( int* filesize, const char* path, ... );
 int nfile_touch( const char* path, ... );
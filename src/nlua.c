@@ -12,6 +12,14 @@
 
 #include "naev.h"
 
+#include <stdlib.h>
+#include <string.h>
+#if HAS_POSIX
+#include <sys/time.h>
+#endif /* HAS_POSIX */
+
+#include "SDL.h"
+
 #include "lauxlib.h"
 
 #include "nluadef.h"
@@ -29,32 +37,491 @@
 #include "nlua_diff.h"
 
 
+#define NLUA_CHUNK         32 /**< Minimum states to allocate. */
+
+#define NLUA_POOL_GRAIN    16 /**< Size class granularity, also the alignment. */
+#define NLUA_POOL_MAX      256 /**< Largest pooled allocation. */
+#define NLUA_POOL_CLASSES  (NLUA_POOL_MAX/NLUA_POOL_GRAIN) /**< Number of size classes. */
+#define NLUA_POOL_CHUNK    (64*1024) /**< Size of the chunks the pool carves blocks from. */
+
+#define NLUA_GC_BUDGET     0.001 /**< Seconds per frame spent collecting garbage. */
+#define NLUA_GC_MINBASE    (64*1024) /**< Smallest size a state is considered to have. */
+#define NLUA_GC_RUNAWAY    4 /**< Growth at which a state is collected regardless of budget. */
+
+
+/**
+ * @brief A free block in the allocation pool.
+ */
+typedef struct NLuaBlock_s {
+   struct NLuaBlock_s *next; /**< Next free block of the same size class. */
+} NLuaBlock_t;
+
+
+/**
+ * @brief A chunk of memory blocks are carved from.
+ */
+typedef struct NLuaChunk_s {
+   struct NLuaChunk_s *next; /**< Next allocated chunk. */
+} NLuaChunk_t;
+
+
+/**
+ * @brief Bookkeeping of a Lua state, used as the allocator's userdata.
+ */
+typedef struct NLuaState_s {
+   lua_State *L; /**< The state. */
+   char name[32]; /**< Name of the state. */
+   size_t mem; /**< Bytes in use. */
+   size_t peak; /**< Most bytes ever in use. */
+   size_t base; /**< Bytes in use after the last collection cycle. */
+   unsigned int nalloc; /**< Number of new blocks allocated. */
+   int collecting; /**< In the middle of a collection cycle. */
+   int runaway; /**< Lua's own collector was restarted between frames. */
+   double gctime; /**< Seconds spent collecting garbage. */
+} NLuaState_t;
+
+
+/*
+ * Allocation pool, all Lua runs on the main thread so it isn't locked.
+ */
+static NLuaBlock_t *nlua_pool[NLUA_POOL_CLASSES]; /**< Free blocks per size class. */
+static NLuaChunk_t *nlua_chunks = NULL; /**< Allocated chunks. */
+static char *nlua_poolCur       = NULL; /**< Next free byte in the current chunk. */
+static char *nlua_poolEnd       = NULL; /**< End of the current chunk. */
+static size_t nlua_poolBytes    = 0; /**< Bytes allocated for the pool. */
+
+
+/*
+ * Open states.
+ */
+static NLuaState_t **nlua_states = NULL; /**< Open states. */
+static int nlua_nstates          = 0; /**< Number of open states. */
+static int nlua_mstates          = 0; /**< Allocated states. */
+static int nlua_gcNext           = 0; /**< Next state to collect. */
+static double nlua_gcFrame       = 0.; /**< Seconds spent collecting this frame. */
+
+
 /*
  * prototypes
  */
+static double nlua_time (void);
+static int nlua_poolClass( size_t size );
+static void* nlua_poolAlloc( size_t size );
+static void nlua_poolFree( void *ptr, size_t size );
+static void* nlua_alloc( void *ud, void *ptr, size_t osize, size_t nsize );
+static int nlua_panic( lua_State *L );
+static void nlua_gcStep( NLuaState_t *ns );
 static int nlua_packfileLoader( lua_State* L );
 
 
 /**
- * @brief Wrapper around luaL_newstate.
+ * @brief Gets the time in seconds, used for GC accounting.
+ */
+static double nlua_time (void)
+{
+#if HAS_POSIX
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.;
+#else /* HAS_POSIX */
+   return (double)SDL_GetTicks() / 1000.;
+#endif /* HAS_POSIX */
+}
+
+
+/**
+ * @brief Gets the size class of an allocation.
+ *
+ *    @return The size class or -1 if it's too big to be pooled.
+ */
+static int nlua_poolClass( size_t size )
+{
+   if ((size == 0) || (size > NLUA_POOL_MAX))
+      return -1;
+   return (int)((size-1) / NLUA_POOL_GRAIN);
+}
+
+
+/**
+ * @brief Allocates memory from the pool.
  *
+ *    @param size Size to allocate, must be non-zero.
+ *    @return Newly allocated memory or NULL on failure.
+ */
+static void* nlua_poolAlloc( size_t size )
+{
+   int c;
+   size_t bsize;
+   NLuaBlock_t *b;
+   NLuaChunk_t *chunk;
+
+   c = nlua_poolClass( size );
+   if (c < 0)
+      return malloc( size );
+
+   /* Reuse a freed block. */
+   b = nlua_pool[c];
+   if (b != NULL) {
+      nlua_pool[c] = b->next;
+      return b;
+   }
+
+   /* Carve from the current chunk, growing if needed. */
+   bsize = (size_t)(c+1) * NLUA_POOL_GRAIN;
+   if (nlua_poolCur + bsize > nlua_poolEnd) {
+      chunk = malloc( NLUA_POOL_CHUNK );
+      if (chunk == NULL)
+         return NULL;
+      chunk->next    = nlua_chunks;
+      nlua_chunks    = chunk;
+      nlua_poolCur   = (char*)chunk + NLUA_POOL_GRAIN;
+      nlua_poolEnd   = (char*)chunk + NLUA_POOL_CHUNK;
+      nlua_poolBytes += NLUA_POOL_CHUNK;
+   }
+   b = (NLuaBlock_t*) nlua_poolCur;
+   nlua_poolCur += bsize;
+   return b;
+}
+
+
+/**
+ * @brief Returns memory to the pool.
+ *
+ *    @param ptr Memory to free.
+ *    @param size Size it was allocated with.
+ */
+static void nlua_poolFree( void *ptr, size_t size )
+{
+   int c;
+   NLuaBlock_t *b;
+
+   c = nlua_poolClass( size );
+   if (c < 0) {
+      free( ptr );
+      return;
+   }
+
+   b = (NLuaBlock_t*) ptr;
+   b->next = nlua_pool[c];
+   nlua_pool[c] = b;
+}
+
+
+/**
+ * @brief Allocator used by all the Lua states.
+ *
+ * Small allocations come from size class pools, the rest go to the system
+ *  allocator.  Memory use is tracked per state.  A state that runs away
+ *  before the next nlua_gcUpdate(), like a script loading a lot at once, gets
+ *  Lua's own incremental collector back until then.  It can't be stepped
+ *  from here as Lua may be in the middle of building the object, restarting
+ *  only lets it collect at its next safe point.
+ */
+static void* nlua_alloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+   NLuaState_t *ns;
+   void *ret;
+   int oc, nc;
+
+   ns = (NLuaState_t*) ud;
+
+   /* Free. */
+   if (nsize == 0) {
+      if (ptr != NULL) {
+         nlua_poolFree( ptr, osize );
+         ns->mem -= osize;
+      }
+      return NULL;
+   }
+
+   /* New allocation. */
+   if (ptr == NULL) {
+      ret = nlua_poolAlloc( nsize );
+      ns->nalloc++;
+   }
+
+   /* Reallocation. */
+   else {
+      oc = nlua_poolClass( osize );
+      nc = nlua_poolClass( nsize );
+      if ((oc < 0) && (nc < 0))
+         ret = realloc( ptr, nsize );
+      else if (oc == nc)
+         ret = ptr;
+      else {
+         ret = nlua_poolAlloc( nsize );
+         if (ret != NULL) {
+            memcpy( ret, ptr, MIN(osize, nsize) );
+            nlua_poolFree( ptr, osize );
+         }
+      }
+   }
+
+   /* Lua handles the failure and keeps the old block. */
+   if (ret == NULL)
+      return NULL;
+
+   if (ptr != NULL)
+      ns->mem -= osize;
+   ns->mem += nsize;
+   ns->peak = MAX( ns->peak, ns->mem );
+
+   /* Emergency collection. */
+   if ((ns->L != NULL) && !ns->runaway &&
+         (ns->mem >= NLUA_GC_RUNAWAY*ns->base)) {
+      ns->runaway = 1;
+      lua_gc( ns->L, LUA_GCRESTART, 0 );
+   }
+   return ret;
+}
+
+
+/**
+ * @brief Handles errors outside of protected calls.
+ */
+static int nlua_panic( lua_State *L )
+{
+   WARN("Unprotected error in call to Lua API: %s", lua_tostring(L,-1));
+   return 0;
+}
+
+
+/**
+ * @brief Creates a new Lua state.
+ *
+ * The state uses the pooled allocator and is collected by nlua_gcUpdate()
+ *  instead of whenever Lua decides to.
+ *
+ *    @param name Name to identify the state by in the statistics.
  *    @return A newly created lua_State.
  */
-lua_State *nlua_newState (void)
+lua_State *nlua_newState( const char *name )
 {
+   NLuaState_t *ns;
    lua_State *L;
 
+   ns = calloc( 1, sizeof(NLuaState_t) );
+   strncpy( ns->name, name, sizeof(ns->name)-1 );
+
    /* try to create the new state */
-   L = luaL_newstate();
+   L = lua_newstate( nlua_alloc, ns );
    if (L == NULL) {
       WARN("Failed to create new lua state.");
+      free(ns);
       return NULL;
    }
+   lua_atpanic( L, nlua_panic );
+
+   /* Collection is done by the scheduler. */
+   lua_gc( L, LUA_GCSTOP, 0 );
+   ns->L    = L;
+   ns->base = MAX( ns->mem, NLUA_GC_MINBASE );
+
+   /* Register it. */
+   if (nlua_nstates >= nlua_mstates) {
+      nlua_mstates = MAX( 2*nlua_mstates, NLUA_CHUNK );
+      nlua_states  = realloc( nlua_states, sizeof(NLuaState_t*) * nlua_mstates );
+   }
+   nlua_states[ nlua_nstates++ ] = ns;
 
    return L;
 }
 
 
+/**
+ * @brief Closes a Lua state created with nlua_newState().
+ *
+ *    @param L State to close.
+ */
+void nlua_close( lua_State *L )
+{
+   int i;
+   NLuaState_t *ns;
+
+   for (i=0; i<nlua_nstates; i++)
+      if (nlua_states[i]->L == L)
+         break;
+   if (i >= nlua_nstates) {
+      WARN("Closing Lua state not created by nlua_newState().");
+      lua_close(L);
+      return;
+   }
+   ns = nlua_states[i];
+
+   /* Unregister. */
+   nlua_nstates--;
+   memmove( &nlua_states[i], &nlua_states[i+1],
+         sizeof(NLuaState_t*) * (nlua_nstates-i) );
+   if (nlua_gcNext > i)
+      nlua_gcNext--;
+
+   lua_close(L);
+
+#ifdef DEBUGGING
+   DEBUG("Lua state '%s': %u KiB peak, %.3f ms collecting garbage",
+         ns->name, (unsigned int)(ns->peak / 1024), ns->gctime * 1000. );
+#endif /* DEBUGGING */
+   free(ns);
+}
+
+
+/**
+ * @brief Runs a single incremental collection step on a state.
+ *
+ *    @param ns State to collect.
+ */
+static void nlua_gcStep( NLuaState_t *ns )
+{
+   double t;
+
+   t = nlua_time();
+   ns->collecting = !lua_gc( ns->L, LUA_GCSTEP, 0 );
+   /* Stepping re-enables automatic collection. */
+   lua_gc( ns->L, LUA_GCSTOP, 0 );
+   t = nlua_time() - t;
+
+   ns->gctime   += t;
+   nlua_gcFrame += t;
+
+   /* Cycle done, wait until it grows again. */
+   if (!ns->collecting)
+      ns->base = MAX( ns->mem, NLUA_GC_MINBASE );
+}
+
+
+/**
+ * @brief Runs incremental garbage collection on the Lua states.
+ *
+ * States are stepped round robin within a fixed time budget per frame.  A
+ *  state starts a new cycle once its memory doubles since the last one, like
+ *  Lua's default pause.  States that grow well past that are collected even if
+ *  the budget is spent so memory can't run away.  States nlua_alloc() handed
+ *  back to Lua's collector are taken back and finish their cycle here.
+ */
+void nlua_gcUpdate (void)
+{
+   int i, n, stepped;
+   double start;
+   NLuaState_t *ns;
+
+   nlua_gcFrame = 0.;
+   if (nlua_nstates == 0)
+      return;
+
+   /* Take back the states that ran away since last frame. */
+   for (i=0; i<nlua_nstates; i++) {
+      ns = nlua_states[i];
+      if (!ns->runaway)
+         continue;
+      lua_gc( ns->L, LUA_GCSTOP, 0 );
+      ns->runaway    = 0;
+      ns->collecting = 1;
+   }
+
+   /* Budgeted steps. */
+   start = nlua_time();
+   do {
+      stepped = 0;
+      for (n=0; n<nlua_nstates; n++) {
+         if (nlua_time() - start > NLUA_GC_BUDGET)
+            break;
+         i  = nlua_gcNext;
+         nlua_gcNext = (nlua_gcNext+1) % nlua_nstates;
+         ns = nlua_states[i];
+         if (!ns->collecting && (ns->mem < 2*ns->base))
+            continue;
+         nlua_gcStep( ns );
+         stepped = 1;
+      }
+   } while (stepped && (nlua_time() - start <= NLUA_GC_BUDGET));
+
+   /* Runaway states. */
+   for (i=0; i<nlua_nstates; i++) {
+      ns = nlua_states[i];
+      if (ns->mem < NLUA_GC_RUNAWAY*ns->base)
+         continue;
+      do {
+         nlua_gcStep( ns );
+      } while (ns->collecting);
+   }
+}
+
+
+/**
+ * @brief Gets statistics on the Lua states.
+ *
+ *    @param[out] nstates Number of open states.
+ *    @param[out] mem Memory used by all states in KiB.
+ *    @param[out] gctime Milliseconds spent collecting garbage last frame.
+ */
+void nlua_stats( int *nstates, int *mem, double *gctime )
+{
+   int i;
+   size_t total;
+
+   total = 0;
+   for (i=0; i<nlua_nstates; i++)
+      total += nlua_states[i]->mem;
+
+   *nstates = nlua_nstates;
+   *mem     = (int)(total / 1024);
+   *gctime  = nlua_gcFrame * 1000.;
+}
+
+
+/**
+ * @brief Gets the number of blocks a Lua state has allocated.
+ *
+ * Only the difference between two calls is meaningful, it is used to check
+ *  how much garbage a script creates.
+ *
+ *    @param L State to get the count of.
+ *    @return Number of blocks allocated by the state so far.
+ */
+unsigned int nlua_allocs( lua_State *L )
+{
+   void *ud;
+
+   if (lua_getallocf( L, &ud ) != nlua_alloc)
+      return 0;
+   return ((NLuaState_t*) ud)->nalloc;
+}
+
+
+/**
+ * @brief Frees the allocation pool, all states must be closed.
+ */
+void nlua_exit (void)
+{
+   int i;
+   NLuaChunk_t *chunk;
+
+   DEBUG("Lua pool used %u KiB.", (unsigned int)(nlua_poolBytes / 1024));
+
+   /* Pool is still in use. */
+   if (nlua_nstates > 0) {
+      DEBUG("%d Lua states still open, not freeing the pool.", nlua_nstates);
+      return;
+   }
+
+   while (nlua_chunks != NULL) {
+      chunk       = nlua_chunks;
+      nlua_chunks = chunk->next;
+      free(chunk);
+   }
+   for (i=0; i<NLUA_POOL_CLASSES; i++)
+      nlua_pool[i] = NULL;
+   nlua_poolCur   = NULL;
+   nlua_poolEnd   = NULL;
+   nlua_poolBytes = 0;
+
+   free(nlua_states);
+   nlua_states  = NULL;
+   nlua_mstates = 0;
+   nlua_gcNext  = 0;
+}
+
+
 /**
  * @brief Opens a lua library.
  *
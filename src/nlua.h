@@ -13,12 +13,22 @@
 /*
  * standard lua stuff wrappers
  */
-lua_State *nlua_newState (void); /* creates a new state */
+lua_State *nlua_newState( const char *name ); /* creates a new state */
+void nlua_close( lua_State *L );
 int nlua_load( lua_State* L, lua_CFunction f );
 int nlua_loadBasic( lua_State* L );
 int nlua_loadStandard( lua_State *L, int readonly );
 
 
+/*
+ * memory management
+ */
+void nlua_gcUpdate (void);
+void nlua_stats( int *nstates, int *mem, double *gctime );
+unsigned int nlua_allocs( lua_State *L );
+void nlua_exit (void);
+
+
 #endif /* NLUA_H */
 
 
@@ -14,6 +14,9 @@
 
 #include "naev.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "lauxlib.h"
 
 #include "nlua.h"
@@ -37,10 +40,52 @@ extern Pilot** pilot_stack;
 extern int pilot_nstack;
 
 
+/**
+ * @brief Filter used by pilot queries.
+ *
+ * Tri-state fields are -1 when they don't matter, otherwise the state the
+ *  pilot must be in.
+ */
+typedef struct PilotQuery_s {
+   int *factions; /**< Factions to match. */
+   int nfactions; /**< Number of factions, negative matches all. */
+   int haspos; /**< Whether or not pos is set. */
+   Vector2d pos; /**< Center of the query. */
+   double r2; /**< Squared radius around pos, negative for infinite. */
+   int hostile; /**< Hostility to the player. */
+   int disabled; /**< Disabled state. */
+   int boardable; /**< Boardable state. */
+   int n; /**< Maximum number of results, nearest first, 0 is unlimited. */
+} PilotQuery;
+
+/**
+ * @brief A pilot matching a query.
+ */
+typedef struct PilotQueryMatch_s {
+   unsigned int id; /**< ID of the pilot. */
+   double d2; /**< Squared distance to the query center. */
+} PilotQueryMatch;
+
+
+/*
+ * Query buffers, reused between calls.
+ */
+static int *pilotL_qfactions = NULL; /**< Faction buffer. */
+static int pilotL_mqfactions = 0; /**< Allocated factions. */
+static PilotQueryMatch *pilotL_qmatch = NULL; /**< Match buffer. */
+static int pilotL_mqmatch = 0; /**< Allocated matches. */
+
+
 /*
  * Prototypes.
  */
 static Task *pilotL_newtask( lua_State *L, Pilot* p, const char *task );
+static int pilotL_checkfactions( lua_State *L, int ind );
+static int pilotL_checkstate( lua_State *L, int ind, const char *field );
+static int pilotL_queryMatch( const PilotQuery *q, const Pilot *p, double *d2 );
+static int pilotL_queryCmp( const void *p1, const void *p2 );
+static int pilotL_queryRun( const PilotQuery *q );
+static void pilotL_queryPush( lua_State *L, int ind, int n );
 
 
 /* Pilot metatable methods. */
@@ -50,6 +95,7 @@ static int pilotL_remove( lua_State *L );
 static int pilotL_clear( lua_State *L );
 static int pilotL_toggleSpawn( lua_State *L );
 static int pilotL_getPilots( lua_State *L );
+static int pilotL_query( lua_State *L );
 static int pilotL_eq( lua_State *L );
 static int pilotL_name( lua_State *L );
 static int pilotL_id( lua_State *L );
@@ -57,6 +103,7 @@ static int pilotL_exists( lua_State *L );
 static int pilotL_rename( lua_State *L );
 static int pilotL_position( lua_State *L );
 static int pilotL_velocity( lua_State *L );
+static int pilotL_distance( lua_State *L );
 static int pilotL_dir( lua_State *L );
 static int pilotL_setPosition( lua_State *L );
 static int pilotL_setVelocity( lua_State *L );
@@ -94,6 +141,7 @@ static const luaL_reg pilotL_methods[] = {
    { "add", pilotL_addFleet },
    { "rm", pilotL_remove },
    { "get", pilotL_getPilots },
+   { "query", pilotL_query },
    { "__eq", pilotL_eq },
    /* Info. */
    { "name", pilotL_name },
@@ -102,6 +150,7 @@ static const luaL_reg pilotL_methods[] = {
    { "rename", pilotL_rename },
    { "pos", pilotL_position },
    { "vel", pilotL_velocity },
+   { "dist", pilotL_distance },
    { "dir", pilotL_dir },
    /* System. */
    { "clear", pilotL_clear },
@@ -515,64 +564,294 @@ static int pilotL_toggleSpawn( lua_State *L )
  */
 static int pilotL_getPilots( lua_State *L )
 {
-   int i, j, k;
-   int *factions;
-   int nfactions;
+   PilotQuery q;
+   int n;
+
+   /* Same as a query that only filters by faction. */
+   memset( &q, 0, sizeof(q) );
+   q.nfactions = -1;
+   q.r2        = -1.;
+   q.hostile   = -1;
+   q.disabled  = 0;
+   q.boardable = -1;
+   if (lua_istable(L,1)) {
+      q.nfactions = pilotL_checkfactions( L, 1 );
+      q.factions  = pilotL_qfactions;
+   }
+
+   /* Now put all the matching pilots in a table. */
+   n = pilotL_queryRun( &q );
+   lua_newtable(L);
+   pilotL_queryPush( L, lua_gettop(L), n );
+   return 1;
+}
+/**
+ * @brief Loads a table of factions into the faction query buffer.
+ *
+ *    @param L Lua state.
+ *    @param ind Index of the table of factions.
+ *    @return Number of factions loaded.
+ */
+static int pilotL_checkfactions( lua_State *L, int ind )
+{
+   int n;
    LuaFaction *f;
-   LuaPilot p;
 
-   /* Check for belonging to faction. */
-   if (lua_istable(L,1)) {
-      /* Get table length and preallocate. */
-      nfactions = (int) lua_objlen(L,1);
-      factions = malloc( sizeof(int) * nfactions );
-      /* Load up the table. */
-      lua_pushnil(L);
-      i = 0;
-      while (lua_next(L, -2) != 0) {
-         f = lua_tofaction(L, -1);
-         factions[i++] = f->f;
-         lua_pop(L,1);
-      }
+   n = (int) lua_objlen(L,ind);
+   if (n > pilotL_mqfactions) {
+      pilotL_mqfactions = n;
+      pilotL_qfactions  = realloc( pilotL_qfactions, sizeof(int) * n );
+   }
 
-      /* Now put all the matching pilots in a table. */
-      lua_newtable(L);
-      k = 1;
-      for (i=0; i<pilot_nstack; i++) {
-         for (j=0; j<nfactions; j++) {
-            if ((pilot_stack[i]->faction == factions[j]) &&
-                  !pilot_isDisabled(pilot_stack[i]) &&
-                  !pilot_isFlag(pilot_stack[i], PILOT_DELETE)) {
-               lua_pushnumber(L, k++); /* key */
-               p.pilot = pilot_stack[i]->id;
-               lua_pushpilot(L, p); /* value */
-               lua_rawset(L,-3); /* table[key] = value */
-               break; /* Continue to next pilot. */
-            }
-         }
-      }
+   /* Load up the table. */
+   n = 0;
+   lua_pushnil(L);
+   while (lua_next(L, ind) != 0) {
+      f = lua_tofaction(L, -1);
+      if ((f != NULL) && (n < pilotL_mqfactions))
+         pilotL_qfactions[n++] = f->f;
+      lua_pop(L,1);
+   }
+   return n;
+}
+/**
+ * @brief Gets a tri-state field from a query table.
+ *
+ *    @return -1 if the field isn't set, otherwise the boolean it's set to.
+ */
+static int pilotL_checkstate( lua_State *L, int ind, const char *field )
+{
+   int ret;
+
+   lua_getfield(L, ind, field);
+   if (lua_isnil(L,-1))
+      ret = -1;
+   else
+      ret = lua_toboolean(L,-1);
+   lua_pop(L,1);
+   return ret;
+}
+/**
+ * @brief Checks to see if a pilot matches a query.
+ *
+ *    @param q Query to check against.
+ *    @param p Pilot to check.
+ *    @param[out] d2 Squared distance to the query center.
+ *    @return 1 if the pilot matches.
+ */
+static int pilotL_queryMatch( const PilotQuery *q, const Pilot *p, double *d2 )
+{
+   int j;
+
+   if (pilot_isFlag(p, PILOT_DELETE))
+      return 0;
 
-      /* clean up. */
-      free(factions);
+   /* Cheap flag checks first. */
+   if ((q->disabled >= 0) && (!pilot_isDisabled(p) != !q->disabled))
+      return 0;
+   if ((q->boardable >= 0) && (!q->boardable != !(pilot_isDisabled(p) &&
+         !pilot_isFlag(p, PILOT_NOBOARD) && !pilot_isFlag(p, PILOT_BOARDED))))
+      return 0;
+
+   /* Faction. */
+   if (q->nfactions >= 0) {
+      for (j=0; j<q->nfactions; j++)
+         if (p->faction == q->factions[j])
+            break;
+      if (j >= q->nfactions)
+         return 0;
    }
-   else {
-      /* Now put all the matching pilots in a table. */
-      lua_newtable(L);
-      k = 1;
-      for (i=0; i<pilot_nstack; i++) {
-         if (!pilot_isDisabled(pilot_stack[i]) &&
-               !pilot_isFlag(pilot_stack[i], PILOT_DELETE)) {
-            lua_pushnumber(L, k++); /* key */
-            p.pilot = pilot_stack[i]->id;
-            lua_pushpilot(L, p); /* value */
-            lua_rawset(L,-3); /* table[key] = value */
-            break; /* Continue to next pilot. */
-         }
-      }
+
+   /* Distance. */
+   if (q->haspos) {
+      *d2 = vect_dist2( &p->solid->pos, &q->pos );
+      if ((q->r2 >= 0.) && (*d2 > q->r2))
+         return 0;
    }
+   else
+      *d2 = 0.;
+
+   /* Hostility is the most expensive, leave it for last. */
+   if ((q->hostile >= 0) && (!pilot_isHostile(p) != !q->hostile))
+      return 0;
 
    return 1;
 }
+/**
+ * @brief Compares two matches by distance for qsort.
+ */
+static int pilotL_queryCmp( const void *p1, const void *p2 )
+{
+   const PilotQueryMatch *m1, *m2;
+   m1 = (const PilotQueryMatch*) p1;
+   m2 = (const PilotQueryMatch*) p2;
+   if (m1->d2 < m2->d2)
+      return -1;
+   else if (m1->d2 > m2->d2)
+      return +1;
+   return 0;
+}
+/**
+ * @brief Runs a query over the pilot stack.
+ *
+ * The matches are left in the match buffer.
+ *
+ *    @param q Query to run.
+ *    @return Number of matches.
+ */
+static int pilotL_queryRun( const PilotQuery *q )
+{
+   int i, n;
+   double d2;
+
+   if (pilot_nstack > pilotL_mqmatch) {
+      pilotL_mqmatch = pilot_nstack;
+      pilotL_qmatch  = realloc( pilotL_qmatch,
+            sizeof(PilotQueryMatch) * pilotL_mqmatch );
+   }
+
+   n = 0;
+   for (i=0; i<pilot_nstack; i++) {
+      if (!pilotL_queryMatch( q, pilot_stack[i], &d2 ))
+         continue;
+      pilotL_qmatch[n].id = pilot_stack[i]->id;
+      pilotL_qmatch[n].d2 = d2;
+      n++;
+   }
+
+   /* Keep only the nearest. */
+   if ((q->n > 0) && q->haspos) {
+      qsort( pilotL_qmatch, n, sizeof(PilotQueryMatch), pilotL_queryCmp );
+      n = MIN( n, q->n );
+   }
+   else if (q->n > 0)
+      n = MIN( n, q->n );
+
+   return n;
+}
+/**
+ * @brief Writes the query matches into a table.
+ *
+ * Entries that already hold the matching pilot are left alone, the rest get
+ *  a new pilot since the old one may still be referenced elsewhere.  Leftover
+ *  entries from a previous query are removed.
+ *
+ *    @param L Lua state.
+ *    @param ind Index of the table to write to.
+ *    @param n Number of matches.
+ */
+static void pilotL_queryPush( lua_State *L, int ind, int n )
+{
+   int i, len;
+   LuaPilot *lp, p;
+
+   len = (int) lua_objlen(L,ind);
+   for (i=0; i<n; i++) {
+      lua_rawgeti(L, ind, i+1);
+      lp = lua_ispilot(L,-1) ? lua_topilot(L,-1) : NULL;
+      lua_pop(L,1);
+
+      /* Already there. */
+      if ((lp != NULL) && (lp->pilot == pilotL_qmatch[i].id))
+         continue;
+
+      p.pilot = pilotL_qmatch[i].id;
+      lua_pushpilot(L, p); /* value */
+      lua_rawseti(L, ind, i+1); /* table[key] = value */
+   }
+
+   /* Clear the rest, from the end so the length shrinks properly. */
+   for (i=len; i>n; i--) {
+      lua_pushnil(L);
+      lua_rawseti(L, ind, i);
+   }
+}
+/**
+ * @brief Gets the pilots matching a filter.
+ *
+ * The filtering is done in a single pass over the pilots, which is much
+ *  cheaper than getting all the pilots and filtering them in Lua.  The filter
+ *  is a table with the following optional fields:
+ *
+ *  - factions: Table of factions the pilot must belong to.
+ *  - pos: Position to filter around, also used to sort by distance.
+ *  - radius: Maximum distance to pos.
+ *  - hostile: Whether or not the pilot must be hostile to the player.
+ *  - disabled: Whether or not the pilot must be disabled.
+ *  - boardable: Whether or not the pilot must be boardable.
+ *  - n: Maximum amount of pilots to get, the nearest to pos if it is set.
+ *
+ * When a result table is passed it gets overwritten instead of creating a new
+ *  one, so scripts that query every frame create less garbage.  Pilots taken
+ *  out of a previous result are not changed.
+ *
+ * @usage p = pilot.query( { hostile=true, pos=player.pilot():pos(), radius=3000 } )
+ * @usage p = pilot.query( { factions={ faction.get("Pirate") }, disabled=true } )
+ * @usage pilot.query( { pos=v, n=3 }, t ) -- Three nearest pilots stored in t
+ *
+ *    @luaparam filter Table containing the filter.
+ *    @luaparam t Optional table to store the results in.
+ *    @luareturn A table containing the matching pilots.
+ * @luafunc query( filter, t )
+ */
+static int pilotL_query( lua_State *L )
+{
+   PilotQuery q;
+   LuaVector *v;
+   double r;
+   int n;
+
+   luaL_checktype(L, 1, LUA_TTABLE);
+   memset( &q, 0, sizeof(q) );
+   q.nfactions = -1;
+   q.r2        = -1.;
+
+   /* Factions. */
+   lua_getfield(L, 1, "factions");
+   if (lua_istable(L,-1)) {
+      q.nfactions = pilotL_checkfactions( L, lua_gettop(L) );
+      q.factions  = pilotL_qfactions;
+   }
+   lua_pop(L,1);
+
+   /* Position and radius. */
+   lua_getfield(L, 1, "pos");
+   if (lua_isvector(L,-1)) {
+      v        = lua_tovector(L,-1);
+      q.haspos = 1;
+      vectcpy( &q.pos, &v->vec );
+   }
+   lua_pop(L,1);
+   lua_getfield(L, 1, "radius");
+   if (lua_isnumber(L,-1)) {
+      if (!q.haspos) {
+         NLUA_ERROR(L, "Query radius needs a position.");
+         return 0;
+      }
+      r    = lua_tonumber(L,-1);
+      q.r2 = r*r;
+   }
+   lua_pop(L,1);
+
+   /* State. */
+   q.hostile   = pilotL_checkstate( L, 1, "hostile" );
+   q.disabled  = pilotL_checkstate( L, 1, "disabled" );
+   q.boardable = pilotL_checkstate( L, 1, "boardable" );
+   lua_getfield(L, 1, "n");
+   q.n = MAX( 0, (int)lua_tonumber(L,-1) );
+   lua_pop(L,1);
+
+   /* Run the query. */
+   n = pilotL_queryRun( &q );
+
+   /* Write the results. */
+   if (lua_istable(L,2))
+      lua_pushvalue(L,2);
+   else
+      lua_newtable(L);
+   pilotL_queryPush( L, lua_gettop(L), n );
+   return 1;
+}
 
 /**
  * @brief Checks to see if pilot and p are the same.
@@ -702,46 +981,83 @@ static int pilotL_rename( lua_State *L )
 /**
  * @brief Gets the pilot's position.
  *
+ * If a vector is passed it is overwritten and returned instead of creating a
+ *  new one, which avoids allocating in scripts that run every frame.
+ *
  * @usage v = p:pos()
+ * @usage p:pos( v ) -- Stores the position in v
  *
  *    @luaparam p Pilot to get the position of.
+ *    @luaparam v Optional vector to store the position in.
  *    @luareturn The pilot's current position as a vec2.
- * @luafunc pos( p )
+ * @luafunc pos( p, v )
  */
 static int pilotL_position( lua_State *L )
 {
    Pilot *p;
-   LuaVector v;
 
    /* Parse parameters */
    p     = luaL_validpilot(L,1);
 
    /* Push position. */
-   vectcpy( &v.vec, &p->solid->pos );
-   lua_pushvector(L, v);
+   lua_pushvectorInto( L, 2, &p->solid->pos );
    return 1;
 }
 
 /**
  * @brief Gets the pilot's velocity.
  *
+ * If a vector is passed it is overwritten and returned instead of creating a
+ *  new one.
+ *
  * @usage vel = p:vel()
  *
  *    @luaparam p Pilot to get the velocity of.
+ *    @luaparam v Optional vector to store the velocity in.
  *    @luareturn The pilot's current velocity as a vec2.
- * @luafunc vel( p )
+ * @luafunc vel( p, v )
  */
 static int pilotL_velocity( lua_State *L )
 {
    Pilot *p;
-   LuaVector v;
 
    /* Parse parameters */
    p     = luaL_validpilot(L,1);
 
    /* Push velocity. */
-   vectcpy( &v.vec, &p->solid->vel );
-   lua_pushvector(L, v);
+   lua_pushvectorInto( L, 2, &p->solid->vel );
+   return 1;
+}
+
+/**
+ * @brief Gets the distance from the pilot to another pilot or a position.
+ *
+ * @usage d = p:dist( player.pilot() )
+ * @usage d = p:dist( vec2.new( 0, 0 ) )
+ *
+ *    @luaparam p Pilot to get the distance from.
+ *    @luaparam target Pilot or vec2 to get the distance to.
+ *    @luareturn The distance as a number.
+ * @luafunc dist( p, target )
+ */
+static int pilotL_distance( lua_State *L )
+{
+   Pilot *p, *t;
+   LuaVector *v;
+   Vector2d *pos;
+
+   /* Parse parameters */
+   p     = luaL_validpilot(L,1);
+   if (lua_ispilot(L,2)) {
+      t   = luaL_validpilot(L,2);
+      pos = &t->solid->pos;
+   }
+   else {
+      v   = luaL_checkvector(L,2);
+      pos = &v->vec;
+   }
+
+   lua_pushnumber( L, vect_dist( &p->solid->pos, pos ) );
    return 1;
 }
 
@@ -23,6 +23,8 @@
 
 
 /* rnd */
+static double rnd_fp( lua_State *L );
+static int rnd_range( lua_State *L, int l, int h );
 static int rnd_int( lua_State *L );
 static int rnd_sigma( lua_State *L );
 static int rnd_twosigma( lua_State *L );
@@ -45,11 +47,65 @@ static const luaL_reg rnd_methods[] = {
  */
 int nlua_loadRnd( lua_State *L )
 {
-   luaL_register(L, "rnd", rnd_methods);
+   return nlua_loadRndStream( L, NULL );
+}
+
+
+/**
+ * @brief Loads the Random Number Lua library drawing from its own stream.
+ *
+ * Used by states like the music one that must not touch the simulation's
+ *  random numbers.  Replaces the rnd library if already loaded.
+ *
+ *    @param L Lua state.
+ *    @param rs Stream to draw from, NULL uses the global generator.
+ *    @return 0 on success.
+ */
+int nlua_loadRndStream( lua_State *L, RngStream *rs )
+{
+   if (rs == NULL)
+      lua_pushnil(L);
+   else
+      lua_pushlightuserdata(L, rs);
+   luaI_openlib(L, "rnd", rnd_methods, 1);
+   lua_pop(L,1);
    return 0;
 }
 
 
+/**
+ * @brief Gets a random float from the stream the library was loaded with.
+ *
+ *    @param L Lua state.
+ *    @return Random number in [0:1].
+ */
+static double rnd_fp( lua_State *L )
+{
+   RngStream *rs;
+
+   rs = lua_touserdata(L, lua_upvalueindex(1));
+   if (rs == NULL)
+      return RNGF();
+   return RNGSF(rs);
+}
+
+
+/**
+ * @brief Gets a random integer like RNG() from the library's stream.
+ *
+ *    @param L Lua state.
+ *    @param l One end of the range.
+ *    @param h Other end of the range.
+ *    @return Random integer between both ends (both included).
+ */
+static int rnd_range( lua_State *L, int l, int h )
+{
+   if (l > h)
+      return h + (int)((double)(l-h+1) * rnd_fp(L));
+   return l + (int)((double)(h-l+1) * rnd_fp(L));
+}
+
+
 /**
  * @brief Bindings for interacting with the random number generator.
  *
@@ -92,15 +148,15 @@ static int rnd_int( lua_State *L )
    o = lua_gettop(L);
    
    if (o==0)
-      lua_pushnumber(L, RNGF() ); /* random double 0 <= x <= 1 */
+      lua_pushnumber(L, rnd_fp(L) ); /* random double 0 <= x <= 1 */
    else if (o==1) { /* random int 0 <= x <= parameter */
       l = luaL_checkint(L,1);
-      lua_pushnumber(L, RNG(0, l));
+      lua_pushnumber(L, rnd_range(L, 0, l));
    }
    else if (o>=2) { /* random int paramater 1 <= x <= parameter 2 */
       l = luaL_checkint(L,1);
       h = luaL_checkint(L,2);
-      lua_pushnumber(L, RNG(l,h));
+      lua_pushnumber(L, rnd_range(L, l, h));
    }
    else NLUA_INVALID_PARAMETER();
    
@@ -119,7 +175,7 @@ static int rnd_int( lua_State *L )
  */
 static int rnd_sigma( lua_State *L )
 {
-   lua_pushnumber(L, RNG_1SIGMA());
+   lua_pushnumber(L, NormalInverse(0.158 + rnd_fp(L)*(1.-0.341*2.)));
    return 1;
 }
 /**
@@ -137,7 +193,7 @@ static int rnd_sigma( lua_State *L )
  */
 static int rnd_twosigma( lua_State *L )
 {
-   lua_pushnumber(L, RNG_2SIGMA());
+   lua_pushnumber(L, NormalInverse(0.021 + rnd_fp(L)*(1.-0.021*2.)));
    return 1;
 }
 /**
@@ -156,6 +212,6 @@ static int rnd_twosigma( lua_State *L )
  */
 static int rnd_threesigma( lua_State *L )
 {
-   lua_pushnumber(L, RNG_3SIGMA());
+   lua_pushnumber(L, NormalInverse(0.001 + rnd_fp(L)*(1.-0.001*2.)));
    return 1;
 }
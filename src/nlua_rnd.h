@@ -9,8 +9,11 @@
 
 #include "lua.h"
 
+#include "rng.h"
+
 
 int nlua_loadRnd( lua_State *L ); /* always read only */
+int nlua_loadRndStream( lua_State *L, RngStream *rs );
 
 
 #endif /* NLUA_RND_H */
@@ -14,6 +14,8 @@
 
 #include "naev.h"
 
+#include <math.h>
+
 #include "lauxlib.h"
 
 #include "nlua.h"
@@ -21,6 +23,9 @@
 #include "log.h"
 
 
+/* Helpers. */
+static int vector_getCoords( lua_State *L, int ind, double *x, double *y );
+
 /* Vector metatable methods */
 static int vectorL_new( lua_State *L );
 static int vectorL_add( lua_State *L );
@@ -31,6 +36,13 @@ static int vectorL_get( lua_State *L );
 static int vectorL_set( lua_State *L );
 static int vectorL_distance( lua_State *L );
 static int vectorL_mod( lua_State *L );
+static int vectorL_iadd( lua_State *L );
+static int vectorL_isub( lua_State *L );
+static int vectorL_imul( lua_State *L );
+static int vectorL_idiv( lua_State *L );
+static int vectorL_distance2( lua_State *L );
+static int vectorL_dot( lua_State *L );
+static int vectorL_angle( lua_State *L );
 static const luaL_reg vector_methods[] = {
    { "new", vectorL_new },
    { "__add", vectorL_add },
@@ -45,6 +57,15 @@ static const luaL_reg vector_methods[] = {
    { "set", vectorL_set },
    { "dist", vectorL_distance },
    { "mod", vectorL_mod },
+   /* In place, these don't create new vectors. */
+   { "iadd", vectorL_iadd },
+   { "isub", vectorL_isub },
+   { "imul", vectorL_imul },
+   { "idiv", vectorL_idiv },
+   /* Scalar results. */
+   { "dist2", vectorL_distance2 },
+   { "dot", vectorL_dot },
+   { "angle", vectorL_angle },
    {0,0}
 }; /**< Vector metatable methods. */
 
@@ -139,6 +160,32 @@ LuaVector* lua_pushvector( lua_State *L, LuaVector vec )
    return v;
 }
 
+/**
+ * @brief Pushes a vector on the stack, reusing an existing one if possible.
+ *
+ * If there is a vector at ind it gets overwritten and pushed again, otherwise
+ *  a new vector is created.  Lets scripts avoid creating garbage in loops.
+ *
+ *    @param L Lua state to push vector onto.
+ *    @param ind Index of the vector to reuse.
+ *    @param vec Value to push.
+ *    @return Vector just pushed.
+ */
+LuaVector* lua_pushvectorInto( lua_State *L, int ind, const Vector2d *vec )
+{
+   LuaVector *v, lv;
+
+   if ((ind != 0) && lua_isvector(L,ind)) {
+      v = lua_tovector(L,ind);
+      vectcpy( &v->vec, vec );
+      lua_pushvalue(L,ind);
+      return v;
+   }
+
+   vectcpy( &lv.vec, vec );
+   return lua_pushvector( L, lv );
+}
+
 /**
  * @brief Checks to see if ind is a vector.
  *
@@ -341,6 +388,144 @@ static int vectorL_div( lua_State *L )
 }
 
 
+/**
+ * @brief Gets a vector or cartesian coordinates from the parameters.
+ *
+ *    @param L Lua state to get parameters from.
+ *    @param ind Index of the vector or X coordinate.
+ *    @param[out] x X coordinate.
+ *    @param[out] y Y coordinate.
+ *    @return 0 on success.
+ */
+static int vector_getCoords( lua_State *L, int ind, double *x, double *y )
+{
+   LuaVector *v;
+
+   if (lua_isvector(L,ind)) {
+      v  = lua_tovector(L,ind);
+      *x = v->vec.x;
+      *y = v->vec.y;
+   }
+   else if ((lua_gettop(L) > ind) && lua_isnumber(L,ind) && lua_isnumber(L,ind+1)) {
+      *x = lua_tonumber(L,ind);
+      *y = lua_tonumber(L,ind+1);
+   }
+   else
+      return -1;
+   return 0;
+}
+
+/**
+ * @ingroup META_VECTOR
+ *
+ * @brief Adds a vector or cartesian coordinates to a vector in place.
+ *
+ * Unlike add, this does not create a new vector.
+ *
+ * @usage my_vec:iadd( your_vec ) -- my_vec is now my_vec + your_vec
+ * @usage my_vec:iadd( 5, 3 )
+ *
+ *    @luaparam v Vector to modify.
+ *    @luaparam x X coordinate or vector to add.
+ *    @luaparam y Y coordinate or nil to add.
+ *    @luareturn The modified vector.
+ * @luafunc iadd( v, x, y )
+ */
+static int vectorL_iadd( lua_State *L )
+{
+   LuaVector *v1;
+   double x, y;
+
+   v1 = luaL_checkvector(L,1);
+   if (vector_getCoords( L, 2, &x, &y ))
+      NLUA_INVALID_PARAMETER();
+
+   vect_cset( &v1->vec, v1->vec.x + x, v1->vec.y + y );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @ingroup META_VECTOR
+ *
+ * @brief Subtracts a vector or cartesian coordinates from a vector in place.
+ *
+ * Unlike sub, this does not create a new vector.
+ *
+ * @usage my_vec:isub( your_vec ) -- my_vec is now my_vec - your_vec
+ * @usage my_vec:isub( 5, 3 )
+ *
+ *    @luaparam v Vector to modify.
+ *    @luaparam x X coordinate or vector to subtract.
+ *    @luaparam y Y coordinate or nil to subtract.
+ *    @luareturn The modified vector.
+ * @luafunc isub( v, x, y )
+ */
+static int vectorL_isub( lua_State *L )
+{
+   LuaVector *v1;
+   double x, y;
+
+   v1 = luaL_checkvector(L,1);
+   if (vector_getCoords( L, 2, &x, &y ))
+      NLUA_INVALID_PARAMETER();
+
+   vect_cset( &v1->vec, v1->vec.x - x, v1->vec.y - y );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @ingroup META_VECTOR
+ *
+ * @brief Multiplies a vector by a number in place.
+ *
+ * @usage my_vec:imul( 3 )
+ *
+ *    @luaparam v Vector to modify.
+ *    @luaparam mod Amount to multiply by.
+ *    @luareturn The modified vector.
+ * @luafunc imul( v, mod )
+ */
+static int vectorL_imul( lua_State *L )
+{
+   LuaVector *v1;
+   double mod;
+
+   v1  = luaL_checkvector(L,1);
+   mod = luaL_checknumber(L,2);
+
+   vect_cset( &v1->vec, v1->vec.x * mod, v1->vec.y * mod );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+/**
+ * @ingroup META_VECTOR
+ *
+ * @brief Divides a vector by a number in place.
+ *
+ * @usage my_vec:idiv( 3 )
+ *
+ *    @luaparam v Vector to modify.
+ *    @luaparam mod Amount to divide by.
+ *    @luareturn The modified vector.
+ * @luafunc idiv( v, mod )
+ */
+static int vectorL_idiv( lua_State *L )
+{
+   LuaVector *v1;
+   double mod;
+
+   v1  = luaL_checkvector(L,1);
+   mod = luaL_checknumber(L,2);
+
+   vect_cset( &v1->vec, v1->vec.x / mod, v1->vec.y / mod );
+   lua_pushvalue(L,1);
+   return 1;
+}
+
+
 /**
  * @ingroup META_VECTOR
  *
@@ -368,25 +553,26 @@ static int vectorL_get( lua_State *L )
 /**
  * @ingroup META_VECTOR
  *
- * @brief Sets the vector by cartesian coordinates.
+ * @brief Sets the vector by cartesian coordinates or copies another vector.
  *
  * @usage my_vec:set(5, 3) -- my_vec is now (5,3)
+ * @usage my_vec:set(your_vec) -- my_vec is now a copy of your_vec
  *
  *    @luaparam v Vector to set coordinates of.
- *    @luaparam x X coordinate to set.
+ *    @luaparam x X coordinate or vector to set.
  *    @luaparam y Y coordinate to set.
  * @luafunc set( v, x, y )
  */
 static int vectorL_set( lua_State *L )
 {
-   NLUA_MIN_ARGS(3);
+   NLUA_MIN_ARGS(2);
    LuaVector *v1;
    double x, y;
 
    /* Get parameters. */
    v1 = luaL_checkvector(L,1);
-   x  = luaL_checknumber(L,2);
-   y  = luaL_checknumber(L,3);
+   if (vector_getCoords( L, 2, &x, &y ))
+      NLUA_INVALID_PARAMETER();
 
    vect_cset( &v1->vec, x, y );
    return 0;
@@ -447,3 +633,91 @@ static int vectorL_mod( lua_State *L )
    return 1;
 }
 
+/**
+ * @ingroup META_VECTOR
+ *
+ * @brief Gets the squared distance from the Vec2.
+ *
+ * Cheaper than dist when only comparing distances.
+ *
+ * @usage my_vec:dist2() -- Gets squared length of the vector.
+ * @usage my_vec:dist2( your_vec ) -- Gets squared distance between both vectors.
+ *
+ *    @luaparam v Vector to act as origin.
+ *    @luaparam v2 Vector to get distance from, uses origin (0,0) if not set.
+ *    @luareturn The squared distance calculated.
+ * @luafunc dist2( v, v2 )
+ */
+static int vectorL_distance2( lua_State *L )
+{
+   LuaVector *v1, *v2;
+   Vector2d o;
+
+   v1 = luaL_checkvector(L,1);
+   if (lua_gettop(L) > 1)
+      v2 = luaL_checkvector(L,2);
+   else
+      v2 = NULL;
+
+   if (v2 == NULL) {
+      vectnull( &o );
+      lua_pushnumber(L, vect_dist2(&v1->vec, &o));
+   }
+   else
+      lua_pushnumber(L, vect_dist2(&v1->vec, &v2->vec));
+   return 1;
+}
+
+/**
+ * @ingroup META_VECTOR
+ *
+ * @brief Gets the dot product of two vectors.
+ *
+ * @usage d = my_vec:dot( your_vec )
+ *
+ *    @luaparam v First vector.
+ *    @luaparam v2 Second vector.
+ *    @luareturn The dot product.
+ * @luafunc dot( v, v2 )
+ */
+static int vectorL_dot( lua_State *L )
+{
+   LuaVector *v1, *v2;
+
+   v1 = luaL_checkvector(L,1);
+   v2 = luaL_checkvector(L,2);
+
+   lua_pushnumber(L, vect_dot(&v1->vec, &v2->vec));
+   return 1;
+}
+
+/**
+ * @ingroup META_VECTOR
+ *
+ * @brief Gets the angle of a vector or the direction between two positions.
+ *
+ * @usage my_vec:angle() -- Angle of the vector.
+ * @usage my_vec:angle( your_vec ) -- Direction from my_vec to your_vec.
+ *
+ *    @luaparam v Vector to act as origin.
+ *    @luaparam v2 Position to get the direction to, if not set gets the angle
+ *                 of v itself.
+ *    @luareturn The angle in degrees.
+ * @luafunc angle( v, v2 )
+ */
+static int vectorL_angle( lua_State *L )
+{
+   LuaVector *v1, *v2;
+   double a;
+
+   v1 = luaL_checkvector(L,1);
+   if (lua_gettop(L) > 1) {
+      v2 = luaL_checkvector(L,2);
+      a  = vect_angle( &v1->vec, &v2->vec );
+   }
+   else
+      a  = ANGLE( v1->vec.x, v1->vec.y );
+
+   lua_pushnumber(L, a * 180. / M_PI);
+   return 1;
+}
@@ -33,6 +33,7 @@ int nlua_loadVector( lua_State *L );
 LuaVector* lua_tovector( lua_State *L, int ind );
 LuaVector* luaL_checkvector( lua_State *L, int ind );
 LuaVector* lua_pushvector( lua_State *L, LuaVector vec );
+LuaVector* lua_pushvectorInto( lua_State *L, int ind, const Vector2d *vec );
 int lua_isvector( lua_State *L, int ind );
 
 
@@ -29,18 +29,8 @@
 #include "economy.h"
 
 
-/**
- * @brief Used for storing time increments to not trigger hooks during Lua
- *        calls and such.
- */
-typedef struct NTimeUpdate_s {
-   struct NTimeUpdate_s *next; /**< Next in the linked list. */
-   unsigned int inc; /**< Time increment assosciated. */
-} NTimeUpdate_t;
-static NTimeUpdate_t *ntime_inclist = NULL; /**< Time increment list. */
-
-
 static unsigned int naev_time = 0; /**< Contains the current time in mSTU. */
+static unsigned int ntime_pending = 0; /**< Lagged increments not yet applied. */
 
 
 /**
@@ -90,20 +80,23 @@ char* ntime_pretty( unsigned int t )
  */
 void ntime_set( unsigned int t )
 {
-   naev_time = t;
+   naev_time     = t;
+   ntime_pending = 0;
 }
 
 
 /**
  * @brief Sets the time relatively.
  *
+ * Any lagged increments are merged into this one so hooks and the economy
+ *  only run once for the total.
+ *
  *    @param t Time modifier in STU.
  */
 void ntime_inc( unsigned int t )
 {
-   naev_time += t;
-   hooks_run("time");
-   economy_update( t );
+   ntime_incLagged( t );
+   ntime_refresh();
 }
 
 
@@ -111,54 +104,35 @@ void ntime_inc( unsigned int t )
  * @brief Sets the time relatively.
  *
  * This does NOT call hooks and such, they must be run with ntime_refresh
- *  manually later.
+ *  manually later.  Consecutive increments are merged.
  *
  *    @param t Time modifier in STU.
  */
 void ntime_incLagged( unsigned int t )
 {
-   NTimeUpdate_t *ntu, *iter;
-
-   /* Create the time increment. */
-   ntu = malloc(sizeof(NTimeUpdate_t));
-   ntu->next = NULL;
-   ntu->inc = t;
-
-   /* Only member. */
-   if (ntime_inclist == NULL)
-      ntime_inclist = ntu;
-
-   else {
-      /* Find end of list. */
-      for (iter = ntime_inclist; iter->next != NULL; iter = iter->next);
-      /* Append to end. */
-      iter->next = ntu;
-   }
+   ntime_pending += t;
 }
 
 
 /**
- * @brief Checks to see if ntime has any hooks pending to run.
+ * @brief Applies the pending time increments.
+ *
+ * All the pending increments are applied as a single advance, the "time"
+ *  hooks run once and the economy catches up over the whole elapsed time.
  */
 void ntime_refresh (void)
 {
-   NTimeUpdate_t *ntu;
-
-   /* We have to run all the increments one by one to ensure all hooks get
-    * run and that no collisions occur. */
-   while (ntime_inclist != NULL) {
-      ntu = ntime_inclist;
+   unsigned int inc;
 
-      /* Run hook stuff and actually update time. */
-      naev_time += ntu->inc;
-      hooks_run("time");
-      economy_update( ntu->inc );
+   if (ntime_pending == 0)
+      return;
 
-      /* Remove the increment. */
-      ntime_inclist = ntu->next;
+   /* Clear first in case the hooks increment time again. */
+   inc           = ntime_pending;
+   ntime_pending = 0;
 
-      /* Free the increment. */
-      free(ntu);
-   }
+   /* Run hook stuff and actually update time. */
+   naev_time += inc;
+   hooks_run("time");
+   economy_update( inc );
 }
-
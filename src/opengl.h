@@ -24,6 +24,7 @@
 #include "opengl_matrix.h"
 #include "opengl_vbo.h"
 #include "opengl_render.h"
+#include "opengl_shader.h"
 
 
 /* Recommended for compatibility and such */
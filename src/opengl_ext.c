@@ -30,6 +30,8 @@ static int gl_extVBO (void);
 static int gl_extMultitexture (void);
 static int gl_extMipmaps (void);
 static int gl_extCompression (void);
+static int gl_extShaders (void);
+static int gl_extFBO (void);
 
 
 /**
@@ -124,6 +126,98 @@ static int gl_extVBO (void)
 }
 
 
+/**
+ * @brief Loads the framebuffer object extensions.
+ *
+ * Separate alpha blending is loaded too, since rendering into a texture that
+ *  gets blended again needs it to keep the alpha right.
+ */
+static int gl_extFBO (void)
+{
+   if (gl_hasVersion( 3, 0 )) {
+      nglGenFramebuffers         = gl_extGetProc("glGenFramebuffers");
+      nglBindFramebuffer         = gl_extGetProc("glBindFramebuffer");
+      nglFramebufferTexture2D    = gl_extGetProc("glFramebufferTexture2D");
+      nglCheckFramebufferStatus  = gl_extGetProc("glCheckFramebufferStatus");
+      nglDeleteFramebuffers      = gl_extGetProc("glDeleteFramebuffers");
+   }
+   else if (gl_hasExt("GL_EXT_framebuffer_object")) {
+      nglGenFramebuffers         = gl_extGetProc("glGenFramebuffersEXT");
+      nglBindFramebuffer         = gl_extGetProc("glBindFramebufferEXT");
+      nglFramebufferTexture2D    = gl_extGetProc("glFramebufferTexture2DEXT");
+      nglCheckFramebufferStatus  = gl_extGetProc("glCheckFramebufferStatusEXT");
+      nglDeleteFramebuffers      = gl_extGetProc("glDeleteFramebuffersEXT");
+   }
+   else {
+      nglGenFramebuffers         = NULL;
+      nglBindFramebuffer         = NULL;
+      nglFramebufferTexture2D    = NULL;
+      nglCheckFramebufferStatus  = NULL;
+      nglDeleteFramebuffers      = NULL;
+      DEBUG("GL_EXT_framebuffer_object not found.");
+      return -1;
+   }
+
+   /* Separate blending. */
+   if (gl_hasVersion( 1, 4 ))
+      nglBlendFuncSeparate = gl_extGetProc("glBlendFuncSeparate");
+   else if (gl_hasExt("GL_EXT_blend_func_separate"))
+      nglBlendFuncSeparate = gl_extGetProc("glBlendFuncSeparateEXT");
+   else {
+      nglBlendFuncSeparate = NULL;
+      DEBUG("GL_EXT_blend_func_separate not found.");
+      return -1;
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Loads the GLSL shader functions.
+ */
+static int gl_extShaders (void)
+{
+   if (gl_hasVersion( 2, 0 )) {
+      nglCreateShader         = gl_extGetProc("glCreateShader");
+      nglShaderSource         = gl_extGetProc("glShaderSource");
+      nglCompileShader        = gl_extGetProc("glCompileShader");
+      nglGetShaderiv          = gl_extGetProc("glGetShaderiv");
+      nglGetShaderInfoLog     = gl_extGetProc("glGetShaderInfoLog");
+      nglDeleteShader         = gl_extGetProc("glDeleteShader");
+      nglCreateProgram        = gl_extGetProc("glCreateProgram");
+      nglAttachShader         = gl_extGetProc("glAttachShader");
+      nglLinkProgram          = gl_extGetProc("glLinkProgram");
+      nglGetProgramiv         = gl_extGetProc("glGetProgramiv");
+      nglGetProgramInfoLog    = gl_extGetProc("glGetProgramInfoLog");
+      nglUseProgram           = gl_extGetProc("glUseProgram");
+      nglDeleteProgram        = gl_extGetProc("glDeleteProgram");
+      nglGetUniformLocation   = gl_extGetProc("glGetUniformLocation");
+      nglUniform2f            = gl_extGetProc("glUniform2f");
+   }
+   else {
+      nglCreateShader         = NULL;
+      nglShaderSource         = NULL;
+      nglCompileShader        = NULL;
+      nglGetShaderiv          = NULL;
+      nglGetShaderInfoLog     = NULL;
+      nglDeleteShader         = NULL;
+      nglCreateProgram        = NULL;
+      nglAttachShader         = NULL;
+      nglLinkProgram          = NULL;
+      nglGetProgramiv         = NULL;
+      nglGetProgramInfoLog    = NULL;
+      nglUseProgram           = NULL;
+      nglDeleteProgram        = NULL;
+      nglGetUniformLocation   = NULL;
+      nglUniform2f            = NULL;
+      DEBUG("GLSL shaders not available.");
+      return -1;
+   }
+   return 0;
+}
+
+
 /**
  * @brief Wrapper for glGenerateMipmap around GL_SGIS_generate_mipmap
  */
@@ -226,6 +320,8 @@ int gl_initExtensions (void)
    gl_extVBO();
    gl_extMipmaps();
    gl_extCompression();
+   gl_extShaders();
+   gl_extFBO();
 
    return 0;
 }
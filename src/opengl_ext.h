@@ -26,6 +26,31 @@ void* (APIENTRY *nglMapBuffer)(GLenum target, GLenum access);
 void (APIENTRY *nglUnmapBuffer)(GLenum target);
 void (APIENTRY *nglDeleteBuffers)(GLsizei n, const GLuint* ids);
 
+/* GL_EXT_framebuffer_object */
+void (APIENTRY *nglGenFramebuffers)(GLsizei n, GLuint *ids);
+void (APIENTRY *nglBindFramebuffer)(GLenum target, GLuint id);
+void (APIENTRY *nglFramebufferTexture2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+GLenum (APIENTRY *nglCheckFramebufferStatus)(GLenum target);
+void (APIENTRY *nglDeleteFramebuffers)(GLsizei n, const GLuint *ids);
+void (APIENTRY *nglBlendFuncSeparate)(GLenum srgb, GLenum drgb, GLenum salpha, GLenum dalpha);
+
+/* GL 2.0 shaders */
+GLuint (APIENTRY *nglCreateShader)(GLenum type);
+void (APIENTRY *nglShaderSource)(GLuint shader, GLsizei count, const GLchar **string, const GLint *length);
+void (APIENTRY *nglCompileShader)(GLuint shader);
+void (APIENTRY *nglGetShaderiv)(GLuint shader, GLenum pname, GLint *params);
+void (APIENTRY *nglGetShaderInfoLog)(GLuint shader, GLsizei size, GLsizei *length, GLchar *log);
+void (APIENTRY *nglDeleteShader)(GLuint shader);
+GLuint (APIENTRY *nglCreateProgram)(void);
+void (APIENTRY *nglAttachShader)(GLuint program, GLuint shader);
+void (APIENTRY *nglLinkProgram)(GLuint program);
+void (APIENTRY *nglGetProgramiv)(GLuint program, GLenum pname, GLint *params);
+void (APIENTRY *nglGetProgramInfoLog)(GLuint program, GLsizei size, GLsizei *length, GLchar *log);
+void (APIENTRY *nglUseProgram)(GLuint program);
+void (APIENTRY *nglDeleteProgram)(GLuint program);
+GLint (APIENTRY *nglGetUniformLocation)(GLuint program, const GLchar *name);
+void (APIENTRY *nglUniform2f)(GLint location, GLfloat v0, GLfloat v1);
+
 /* GL_ARB_texture_compression */
 void (APIENTRY *nglCompressedTexImage2D)(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei, const GLvoid *);
 
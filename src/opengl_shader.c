@@ -0,0 +1,153 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file opengl_shader.c
+ *
+ * @brief Handles compiling and linking GLSL programs.
+ *
+ * Shaders are optional, everything using them must keep working with the
+ *  fixed function pipeline when gl_hasShaders() fails.
+ */
+
+
+#include "opengl.h"
+
+#include "naev.h"
+
+#include <stdlib.h>
+
+#include "log.h"
+
+
+/*
+ * Prototypes.
+ */
+static GLuint gl_shaderCompile( const char *name, GLenum type, const char *src );
+
+
+/**
+ * @brief Checks to see if GLSL programs are available.
+ *
+ *    @return 1 if programs can be created, 0 otherwise.
+ */
+int gl_hasShaders (void)
+{
+   return (nglCreateProgram != NULL);
+}
+
+
+/**
+ * @brief Compiles a single shader.
+ *
+ *    @param name Name of the program, used for error messages.
+ *    @param type Type of shader to compile.
+ *    @param src Source of the shader.
+ *    @return The compiled shader or 0 on error.
+ */
+static GLuint gl_shaderCompile( const char *name, GLenum type, const char *src )
+{
+   GLuint shader;
+   GLint status, len;
+   GLchar *log;
+
+   shader = nglCreateShader( type );
+   nglShaderSource( shader, 1, (const GLchar**)&src, NULL );
+   nglCompileShader( shader );
+
+   /* Check for errors. */
+   nglGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+   if (status == GL_FALSE) {
+      nglGetShaderiv( shader, GL_INFO_LOG_LENGTH, &len );
+      log = malloc( len+1 );
+      nglGetShaderInfoLog( shader, len, NULL, log );
+      log[len] = '\0';
+      WARN("Unable to compile %s shader for '%s':\n%s",
+            (type == GL_VERTEX_SHADER) ? "vertex" : "fragment", name, log );
+      free(log);
+      nglDeleteShader( shader );
+      return 0;
+   }
+
+   return shader;
+}
+
+
+/**
+ * @brief Creates a GLSL program.
+ *
+ *    @param name Name of the program, used for error messages.
+ *    @param vert Source of the vertex shader or NULL to use fixed function.
+ *    @param frag Source of the fragment shader or NULL to use fixed function.
+ *    @return The linked program or 0 on error.
+ */
+GLuint gl_shaderCreate( const char *name, const char *vert, const char *frag )
+{
+   GLuint program, vs, fs;
+   GLint status, len;
+   GLchar *log;
+
+   if (!gl_hasShaders())
+      return 0;
+
+   /* Compile the shaders. */
+   vs = fs = 0;
+   if (vert != NULL) {
+      vs = gl_shaderCompile( name, GL_VERTEX_SHADER, vert );
+      if (vs == 0)
+         return 0;
+   }
+   if (frag != NULL) {
+      fs = gl_shaderCompile( name, GL_FRAGMENT_SHADER, frag );
+      if (fs == 0) {
+         if (vs != 0)
+            nglDeleteShader( vs );
+         return 0;
+      }
+   }
+
+   /* Link the program. */
+   program = nglCreateProgram();
+   if (vs != 0)
+      nglAttachShader( program, vs );
+   if (fs != 0)
+      nglAttachShader( program, fs );
+   nglLinkProgram( program );
+
+   /* Program keeps them around. */
+   if (vs != 0)
+      nglDeleteShader( vs );
+   if (fs != 0)
+      nglDeleteShader( fs );
+
+   /* Check for errors. */
+   nglGetProgramiv( program, GL_LINK_STATUS, &status );
+   if (status == GL_FALSE) {
+      nglGetProgramiv( program, GL_INFO_LOG_LENGTH, &len );
+      log = malloc( len+1 );
+      nglGetProgramInfoLog( program, len, NULL, log );
+      log[len] = '\0';
+      WARN("Unable to link program '%s':\n%s", name, log );
+      free(log);
+      nglDeleteProgram( program );
+      return 0;
+   }
+
+   gl_checkErr();
+
+   return program;
+}
+
+
+/**
+ * @brief Destroys a GLSL program.
+ *
+ *    @param program Program to destroy.
+ */
+void gl_shaderDestroy( GLuint program )
+{
+   if ((program == 0) || !gl_hasShaders())
+      return;
+   nglDeleteProgram( program );
+}
@@ -0,0 +1,26 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef OPENGL_SHADER_H
+#  define OPENGL_SHADER_H
+
+
+#include "opengl.h"
+
+
+/*
+ * Availability.
+ */
+int gl_hasShaders (void);
+
+
+/*
+ * Create/destroy.
+ */
+GLuint gl_shaderCreate( const char *name, const char *vert, const char *frag );
+void gl_shaderDestroy( GLuint program );
+
+
+#endif /* OPENGL_SHADER_H */
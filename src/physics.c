@@ -404,6 +404,8 @@ void solid_init( Solid* dest, const double mass, const double dir,
       vectnull( &dest->pos );
    else
       vectcpy( &dest->pos, pos);
+   vectcpy( &dest->pos_prev, &dest->pos );
+   vectcpy( &dest->pos_sim, &dest->pos );
 
 /*
  * FreeBSD seems to have a bug with optimizations in rk4_update causing it to
@@ -446,3 +448,53 @@ void solid_free( Solid* src )
    free(src);
 }
 
+
+/**
+ * @brief Stores the current position of a solid as the previous step.
+ *
+ * Should be called right before every simulation step.
+ *
+ *    @param obj Solid to snapshot.
+ */
+void solid_snapshot( Solid* obj )
+{
+   vectcpy( &obj->pos_prev, &obj->pos );
+}
+
+
+/**
+ * @brief Moves a solid to where it should be displayed.
+ *
+ * The simulated position is stored and the solid is placed between its two
+ *  last simulation steps.  Solids that moved much more than their velocity
+ *  allows (jumps, teleports) are left where they are.
+ *
+ *    @param obj Solid to present.
+ *    @param alpha Fraction of a step elapsed since the last simulation step.
+ *    @param dt Length of a simulation step.
+ */
+void solid_presentBegin( Solid* obj, const double alpha, const double dt )
+{
+   double dx, dy;
+
+   vectcpy( &obj->pos_sim, &obj->pos );
+
+   dx = obj->pos.x - obj->pos_prev.x;
+   dy = obj->pos.y - obj->pos_prev.y;
+   if (pow2(dx) + pow2(dy) >
+         4.*pow2(dt) * (pow2(obj->vel.x) + pow2(obj->vel.y)) + 1.)
+      return;
+
+   vect_cset( &obj->pos, obj->pos_prev.x + alpha*dx, obj->pos_prev.y + alpha*dy );
+}
+
+
+/**
+ * @brief Puts a presented solid back at its simulated position.
+ *
+ *    @param obj Solid to restore.
+ */
+void solid_presentEnd( Solid* obj )
+{
+   vectcpy( &obj->pos, &obj->pos_sim );
+}
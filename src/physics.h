@@ -68,6 +68,8 @@ typedef struct Solid_ {
    double force_x; /**< X force in RELATIVE to solid position. */
    /*double force_y;*/ /**< Y force in RELATIVE to solid position. */
    void (*update)( struct Solid_*, const double ); /**< Update method. */
+   Vector2d pos_prev; /**< Position at the previous simulation step. */
+   Vector2d pos_sim; /**< Simulated position, kept while presenting. */
 } Solid;
 
 
@@ -81,6 +83,14 @@ Solid* solid_create( const double mass, const double dir,
 void solid_free( Solid* src );
 
 
+/*
+ * presentation
+ */
+void solid_snapshot( Solid* obj );
+void solid_presentBegin( Solid* obj, const double alpha, const double dt );
+void solid_presentEnd( Solid* obj );
+
+
 #endif /* PHYSICS_H */
 
 
@@ -39,6 +39,7 @@
 #include "ai_extra.h"
 #include "faction.h"
 #include "font.h"
+#include "spatial.h"
 
 
 #define PILOT_CHUNK_MIN 128 /**< Maximum chunks to increment pilot_stack by */
@@ -47,7 +48,6 @@
 
 
 /* ID Generators. */
-static unsigned int pilot_id = PLAYER_ID; /**< Stack of pilot ids to assure uniqueness */
 static unsigned int mission_cargo_id = 0; /**< ID generator for special mission cargo.
                                                Not guaranteed to be absolutely unique, 
                                                only unique for each pilot. */
@@ -59,6 +59,72 @@ int pilot_nstack = 0; /**< same */
 static int pilot_mstack = 0; /**< Memory allocated for pilot_stack. */
 
 
+/* Pilot arena. */
+#define PILOT_ARENA_CHUNK  128 /**< Pilots per arena chunk. */
+/**
+ * @brief Chunk of the pilot arena.
+ *
+ * The solids are kept apart from the pilots so that the physics state of all
+ *  the pilots in a chunk is packed together.  Chunks never move, so pointers
+ *  to pilots stay valid for their whole life.
+ */
+typedef struct PilotChunk_ {
+   Solid solids[PILOT_ARENA_CHUNK]; /**< Physics state of the pilots. */
+   Pilot pilots[PILOT_ARENA_CHUNK]; /**< The pilots. */
+} PilotChunk;
+static PilotChunk **pilot_chunks = NULL; /**< Chunks of the pilot arena. */
+static int pilot_nchunks   = 0; /**< Number of chunks in the arena. */
+static int *pilot_free_slots = NULL; /**< Queue of free arena slots. */
+static int pilot_free_head = 0; /**< First slot in the free queue. */
+static int pilot_nfree     = 0; /**< Number of free arena slots. */
+static int pilot_nretired  = 0; /**< Slots that ran out of generations. */
+static int pilot_arenaUsed = 0; /**< Number of pilots alive in the arena. */
+
+
+/* Pilot handles. */
+#define PILOT_HANDLE_SLOTBITS 16 /**< Bits of the ID used for the arena slot. */
+#define PILOT_HANDLE_SLOTMASK ((1U<<PILOT_HANDLE_SLOTBITS)-1) /**< Mask of the slot in an ID. */
+#define PILOT_HANDLE_GENMAX   0xFFFFU /**< Largest generation, the slot is retired after it. */
+/**
+ * @brief Handle of a pilot in the arena.
+ *
+ * Pilot IDs are the arena slot in the low bits and the generation of the slot
+ *  in the high bits.  The generation goes up every time the slot gets a new
+ *  pilot, so stale IDs don't match the handle anymore.  The generation is
+ *  never 0, so IDs are never 0 nor PLAYER_ID.
+ *
+ * Free slots are reused oldest first so a slot's generation goes up as slowly
+ *  as possible, and a slot that used up all its generations is never reused
+ *  so an ID can't come back.
+ */
+typedef struct PilotHandle_ {
+   unsigned int id; /**< Last ID given out for the slot. */
+   Pilot *p; /**< Pilot in the stack with that ID or NULL. */
+} PilotHandle;
+static PilotHandle *pilot_handles = NULL; /**< Handles of all the arena slots. */
+
+
+/**
+ * @brief Pilot state that only depends on the ship.
+ *
+ * Built the first time a ship is used and copied into every new pilot of
+ *  that ship instead of setting up the slots and stats from scratch.
+ */
+typedef struct PilotTemplate_ {
+   Ship *ship; /**< Ship the template is for. */
+   Pilot base; /**< Pilot with slots and base stats set up. */
+   Solid solid; /**< Solid used while building the template. */
+} PilotTemplate;
+static PilotTemplate **pilot_templates = NULL; /**< Pilot templates. */
+static int pilot_ntemplates = 0; /**< Number of pilot templates. */
+
+
+/* Area damage. */
+#define PILOT_INDEX_CELL   256. /**< Grid cell size of the explosion index. */
+static SpatialIndex pilot_index; /**< Spatial index of pilots for explosions. */
+static int pilot_indexed = 0; /**< Whether pilot_index is currently valid. */
+
+
 /* misc */
 static double sensor_curRange    = 0.; /**< Current base sensor range, used to calculate
                                          what is in range and what isn't. */
@@ -81,30 +147,202 @@ static int pilot_addCargoRaw( Pilot* pilot, Commodity* cargo,
 /* clean up. */
 void pilot_free( Pilot* p ); /* externed in player.c */
 static void pilot_dead( Pilot* p );
+/* templates. */
+static const Pilot* pilot_getTemplate( Ship *ship );
+static void pilot_copySlots( Pilot *dest, const Pilot *src );
+static void pilot_freeTemplates (void);
+/* arena. */
+static Pilot* pilot_arenaAlloc (void);
+static void pilot_arenaRelease( Pilot* p );
+static void pilot_arenaFree (void);
+static unsigned int pilot_handleNew( int slot );
+static Pilot* pilot_handleGet( const unsigned int id );
 /* misc */
 static void pilot_setCommMsg( Pilot *p, const char *s );
 static int pilot_getStackPos( const unsigned int id );
 static void pilot_updateMass( Pilot *pilot );
 
 
+/**
+ * @brief Gets a free pilot from the pilot arena.
+ *
+ * Slots are reused first freed first, see PilotHandle.
+ *
+ *    @return A cleared pilot with its solid set, NULL on error.
+ */
+static Pilot* pilot_arenaAlloc (void)
+{
+   int i, slot;
+   PilotChunk *chunk;
+   Pilot *p;
+
+   /* Need a new chunk. */
+   if (pilot_nfree == 0) {
+      if ((pilot_nchunks+1)*PILOT_ARENA_CHUNK > (int)PILOT_HANDLE_SLOTMASK+1) {
+         WARN("Too many pilots, unable to create more.");
+         return NULL;
+      }
+      chunk = malloc( sizeof(PilotChunk) );
+      if (chunk == NULL) {
+         WARN("Unable to allocate memory");
+         return NULL;
+      }
+      pilot_chunks = realloc( pilot_chunks, sizeof(PilotChunk*) * (pilot_nchunks+1) );
+      pilot_chunks[ pilot_nchunks ] = chunk;
+      /* Queue is empty so it can start over. */
+      pilot_free_slots = realloc( pilot_free_slots,
+            sizeof(int) * PILOT_ARENA_CHUNK * (pilot_nchunks+1) );
+      pilot_free_head  = 0;
+      pilot_handles = realloc( pilot_handles,
+            sizeof(PilotHandle) * PILOT_ARENA_CHUNK * (pilot_nchunks+1) );
+      memset( &pilot_handles[ pilot_nchunks*PILOT_ARENA_CHUNK ], 0,
+            sizeof(PilotHandle) * PILOT_ARENA_CHUNK );
+
+      /* Lowest slots get used first. */
+      for (i=0; i<PILOT_ARENA_CHUNK; i++)
+         pilot_free_slots[ pilot_nfree++ ] = pilot_nchunks*PILOT_ARENA_CHUNK + i;
+      pilot_nchunks++;
+   }
+
+   slot  = pilot_free_slots[ pilot_free_head ];
+   pilot_free_head = (pilot_free_head+1) % (pilot_nchunks*PILOT_ARENA_CHUNK);
+   pilot_nfree--;
+   chunk = pilot_chunks[ slot / PILOT_ARENA_CHUNK ];
+   p     = &chunk->pilots[ slot % PILOT_ARENA_CHUNK ];
+   memset( p, 0, sizeof(Pilot) );
+   p->slot  = slot;
+   p->solid = &chunk->solids[ slot % PILOT_ARENA_CHUNK ];
+   pilot_arenaUsed++;
+
+   return p;
+}
+
+
+/**
+ * @brief Gives a pilot back to the pilot arena.
+ *
+ *    @param p Pilot to release, must already be cleaned up.
+ */
+static void pilot_arenaRelease( Pilot* p )
+{
+   int slot;
+
+   slot = p->slot;
+
+   /* Invalidate the handle. */
+   if (pilot_handles[slot].p == p)
+      pilot_handles[slot].p = NULL;
+
+#ifdef DEBUGGING
+   memset( p->solid, 0, sizeof(Solid) );
+   memset( p, 0, sizeof(Pilot) );
+#endif /* DEBUGGING */
+
+   pilot_arenaUsed--;
+
+   /* Out of generations, the slot is never used again. */
+   if ((pilot_handles[slot].id >> PILOT_HANDLE_SLOTBITS) >= PILOT_HANDLE_GENMAX) {
+      pilot_nretired++;
+      DEBUG("Retired pilot arena slot %d, %d retired so far.", slot, pilot_nretired);
+      return;
+   }
+
+   pilot_free_slots[ (pilot_free_head+pilot_nfree) %
+         (pilot_nchunks*PILOT_ARENA_CHUNK) ] = slot;
+   pilot_nfree++;
+}
+
+
+/**
+ * @brief Frees the pilot arena memory.
+ */
+static void pilot_arenaFree (void)
+{
+   int i;
+
+   /* Pilots may still be around, like the player's ships. */
+   if (pilot_arenaUsed > 0)
+      return;
+
+   for (i=0; i<pilot_nchunks; i++)
+      free( pilot_chunks[i] );
+   free( pilot_chunks );
+   free( pilot_free_slots );
+   free( pilot_handles );
+   pilot_chunks     = NULL;
+   pilot_nchunks    = 0;
+   pilot_free_slots = NULL;
+   pilot_free_head  = 0;
+   pilot_nfree      = 0;
+   pilot_nretired   = 0;
+   pilot_handles    = NULL;
+}
+
+
+/**
+ * @brief Gives out a new ID for an arena slot.
+ *
+ * Slots that used up their generations are retired when released, so the
+ *  generation never wraps.
+ *
+ *    @param slot Arena slot to get an ID for.
+ *    @return The new ID.
+ */
+static unsigned int pilot_handleNew( int slot )
+{
+   unsigned int gen;
+
+   gen = (pilot_handles[slot].id >> PILOT_HANDLE_SLOTBITS) + 1;
+
+   pilot_handles[slot].id = (gen << PILOT_HANDLE_SLOTBITS) | (unsigned int)slot;
+   pilot_handles[slot].p  = NULL;
+   return pilot_handles[slot].id;
+}
+
+
+/**
+ * @brief Gets the pilot in the stack with an ID, even if it is being deleted.
+ *
+ *    @param id ID of the pilot to get.
+ *    @return The pilot or NULL if the ID is stale or invalid.
+ */
+static Pilot* pilot_handleGet( const unsigned int id )
+{
+   unsigned int slot;
+
+   if (id==PLAYER_ID)
+      return player;
+
+   slot = id & PILOT_HANDLE_SLOTMASK;
+   if (slot >= (unsigned int)(pilot_nchunks*PILOT_ARENA_CHUNK))
+      return NULL;
+   if (pilot_handles[slot].id != id)
+      return NULL;
+   return pilot_handles[slot].p;
+}
+
+
 /**
  * @brief Gets the pilot's position in the stack.
  *
+ * The stack is in creation order, so this has to look through it.  Only used
+ *  when cycling targets and removing pilots.
+ *
  *    @param id ID of the pilot to get.
  *    @return Position of pilot in stack or -1 if not found.
  */
 static int pilot_getStackPos( const unsigned int id )
 {
-   /* binary search */
-   int l,m,h;
-   l = 0;
-   h = pilot_nstack-1;
-   while (l <= h) {
-      m = (l+h) >> 1; /* for impossible overflow returning neg value */
-      if (pilot_stack[m]->id > id) h = m-1;
-      else if (pilot_stack[m]->id < id) l = m+1;
-      else return m;
-   }
+   int i;
+   Pilot *p;
+
+   p = pilot_handleGet( id );
+   if (p == NULL)
+      return -1;
+
+   for (i=0; i<pilot_nstack; i++)
+      if (pilot_stack[i] == p)
+         return i;
 
    /* Not found. */
    return -1;
@@ -300,26 +538,24 @@ unsigned int pilot_getNearestPilot( const Pilot* p )
 /**
  * @brief Pulls a pilot out of the pilot_stack based on ID.
  *
- * It's a binary search ( O(logn) ) therefore it's pretty fast and can be
- *  abused all the time.  Maximum iterations is 32 on a platfom with 32 bit
- *  unsigned ints.
+ * The ID is a handle into the pilot arena, so it's a single lookup and can be
+ *  abused all the time.  IDs of pilots that are gone are detected by their
+ *  generation.
  *
  *    @param id ID of the pilot to get.
  *    @return The actual pilot who has matching ID or NULL if not found.
  */
 Pilot* pilot_get( const unsigned int id )
 {
-   int m;
+   Pilot *p;
 
    if (id==PLAYER_ID)
       return player; /* special case player */
-  
-   m = pilot_getStackPos(id);
 
-   if ((m==-1) || (pilot_isFlag(pilot_stack[m], PILOT_DELETE)))
+   p = pilot_handleGet(id);
+   if ((p==NULL) || (pilot_isFlag(p, PILOT_DELETE)))
       return NULL;
-   else
-      return pilot_stack[m];
+   return p;
 }
 
 
@@ -1383,28 +1619,76 @@ int pilot_hasDeployed( Pilot *p )
 }
 
 
+/**
+ * @brief Prepares the pilots for a batch of explosions.
+ *
+ * Builds a spatial index of the pilots so that each explosion only has to
+ *  look at the pilots near it.  Must be paired with pilot_explodeEnd().
+ */
+void pilot_explodeBegin (void)
+{
+   int i;
+   Pilot *p;
+
+   if (pilot_index.cell <= 0.)
+      spatial_init( &pilot_index, PILOT_INDEX_CELL );
+
+   spatial_clear( &pilot_index );
+   for (i=0; i<pilot_nstack; i++) {
+      p = pilot_stack[i];
+      spatial_add( &pilot_index, (int)p->id, p->solid->pos.x, p->solid->pos.y,
+            p->ship->gfx_space->sw );
+   }
+   spatial_build( &pilot_index );
+   pilot_indexed = 1;
+}
+
+
+/**
+ * @brief Finishes a batch of explosions.
+ */
+void pilot_explodeEnd (void)
+{
+   pilot_indexed = 0;
+}
+
+
 /**
  * @brief Makes the pilot explosion.
+ *
+ * Must be called between pilot_explodeBegin() and pilot_explodeEnd().
+ *
  *    @param x X position of the pilot.
  *    @param y Y position of the pilot.
  *    @param radius Radius of the explosion.
  *    @param dtype Damage type of the explosion.
  *    @param damage Amount of damage by the explosion.
- *    @param parent The exploding pilot.
+ *    @param parent ID of the exploding pilot, 0 is none.
  */
 void pilot_explode( double x, double y, double radius,
-      DamageType dtype, double damage, const Pilot *parent )
+      DamageType dtype, double damage, unsigned int parent )
 {
-   int i;
+   int i, n;
+   const int *res;
    double rx, ry;
-   double dist, rad2;
+   double dist, rad2, dmg;
    Pilot *p;
    Solid s; /* Only need to manipulate mass and vel. */
 
+   if (!pilot_indexed) {
+      WARN("Pilot explosion without a pilot index!");
+      return;
+   }
+
    rad2 = radius*radius;
 
-   for (i=0; i<pilot_nstack; i++) {
-      p = pilot_stack[i];
+   /* Only check pilots near the explosion. */
+   n = spatial_query( &pilot_index, x, y, radius, &res );
+   for (i=0; i<n; i++) {
+      /* Pilot may have gone away from a previous hit. */
+      p = pilot_get( (unsigned int)res[i] );
+      if (p == NULL)
+         continue;
 
       /* Calculate a bit. */
       rx = p->solid->pos.x - x;
@@ -1418,19 +1702,19 @@ void pilot_explode( double x, double y, double radius,
       if (dist < rad2) {
 
          /* Adjust damage based on distance. */
-         damage *= 1. - sqrt(dist / rad2);
+         dmg = damage * (1. - sqrt(dist / rad2));
 
          /* Impact settings. */
-         s.mass =  pow2(damage) / 30.;
+         s.mass =  pow2(dmg) / 30.;
          s.vel.x = rx;
          s.vel.y = ry;
 
          /* Actual damage calculations. */
-         pilot_hit( p, &s, (parent!=NULL)?parent->id:0, dtype, damage );
+         pilot_hit( p, &s, parent, dtype, dmg );
 
          /* Shock wave from the explosion. */
          if (p->id == PILOT_PLAYER)
-            spfx_shake( pow2(damage) / pow2(100.) * SHAKE_MAX );
+            spfx_shake( pow2(dmg) / pow2(100.) * SHAKE_MAX );
       }
    }
 }
@@ -3066,41 +3350,32 @@ unsigned long pilot_modCredits( Pilot *p, int amount )
 
 
 /**
- * @brief Initialize pilot.
+ * @brief Gets the template for pilots of a ship, building it if needed.
  *
- *    @param pilot Pilot to initialise.
- *    @param ship Ship pilot will be flying.
- *    @param name Pilot's name, if NULL ship's name will be used.
- *    @param faction Faction of the pilot.
- *    @param ai Name of the AI profile to use for the pilot.
- *    @param dir Initial direction to face (radians).
- *    @param pos Initial position.
- *    @param vel Initial velocity.
- *    @param flags Used for tweaking the pilot.
+ *    @param ship Ship to get the template of.
+ *    @return The template pilot, its solid holds the base mass.
  */
-void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const char *ai,
-      const double dir, const Vector2d* pos, const Vector2d* vel,
-      const unsigned int flags )
+static const Pilot* pilot_getTemplate( Ship *ship )
 {
    int i, p;
+   PilotTemplate *t;
+   Pilot *pilot;
 
-   /* Clear memory. */
-   memset(pilot, 0, sizeof(Pilot));
-
-   if (flags & PILOT_PLAYER) /* player is ID 0 */
-      pilot->id = PLAYER_ID;
-   else
-      pilot->id = ++pilot_id; /* new unique pilot id based on pilot_id, can't be 0 */
-
-   /* Basic information. */
-   pilot->ship = ship;
-   pilot->name = strdup( (name==NULL) ? ship->name : name );
+   for (i=0; i<pilot_ntemplates; i++)
+      if (pilot_templates[i]->ship == ship)
+         return &pilot_templates[i]->base;
 
-   /* faction */
-   pilot->faction = faction;
+   /* Create the template. */
+   t = calloc( 1, sizeof(PilotTemplate) );
+   pilot_templates = realloc( pilot_templates,
+         sizeof(PilotTemplate*) * (pilot_ntemplates+1) );
+   pilot_templates[ pilot_ntemplates++ ] = t;
+   t->ship = ship;
+   pilot   = &t->base;
 
-   /* solid */
-   pilot->solid = solid_create(ship->mass, dir, pos, vel);
+   pilot->ship  = ship;
+   pilot->solid = &t->solid;
+   solid_init( pilot->solid, ship->mass, 0., NULL, NULL );
 
    /* First pass to make sure requirements make sense. */
    pilot->armour = pilot->armour_max = 1.; /* hack to have full armour */
@@ -3147,6 +3422,117 @@ void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const
    /* set the pilot stats based on his ship and outfits */
    pilot_calcStats(pilot);
 
+   return pilot;
+}
+
+
+/**
+ * @brief Copies the outfit slots of a pilot into another.
+ *
+ *    @param dest Pilot to set slots of, previous slots are not freed.
+ *    @param src Pilot to copy slots from.
+ */
+static void pilot_copySlots( Pilot *dest, const Pilot *src )
+{
+   int i, p;
+
+   dest->noutfits = src->noutfits;
+   dest->outfits  = malloc( sizeof(PilotOutfitSlot*) * dest->noutfits );
+   dest->outfit_nlow = src->outfit_nlow;
+   dest->outfit_low  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nlow );
+   memcpy( dest->outfit_low, src->outfit_low,
+         sizeof(PilotOutfitSlot) * dest->outfit_nlow );
+   dest->outfit_nmedium = src->outfit_nmedium;
+   dest->outfit_medium  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
+   memcpy( dest->outfit_medium, src->outfit_medium,
+         sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
+   dest->outfit_nhigh = src->outfit_nhigh;
+   dest->outfit_high  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
+   memcpy( dest->outfit_high, src->outfit_high,
+         sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
+   p = 0;
+   for (i=0; i<dest->outfit_nlow; i++)
+      dest->outfits[p++] = &dest->outfit_low[i];
+   for (i=0; i<dest->outfit_nmedium; i++)
+      dest->outfits[p++] = &dest->outfit_medium[i];
+   for (i=0; i<dest->outfit_nhigh; i++)
+      dest->outfits[p++] = &dest->outfit_high[i];
+   dest->secondary   = NULL;
+   dest->afterburner = NULL;
+}
+
+
+/**
+ * @brief Frees the pilot templates.
+ */
+static void pilot_freeTemplates (void)
+{
+   int i;
+   Pilot *p;
+
+   for (i=0; i<pilot_ntemplates; i++) {
+      p = &pilot_templates[i]->base;
+      free(p->outfits);
+      free(p->outfit_low);
+      free(p->outfit_medium);
+      free(p->outfit_high);
+      free(pilot_templates[i]);
+   }
+   free(pilot_templates);
+   pilot_templates  = NULL;
+   pilot_ntemplates = 0;
+}
+
+
+/**
+ * @brief Initialize pilot.
+ *
+ *    @param pilot Pilot to initialise.
+ *    @param ship Ship pilot will be flying.
+ *    @param name Pilot's name, if NULL ship's name will be used.
+ *    @param faction Faction of the pilot.
+ *    @param ai Name of the AI profile to use for the pilot.
+ *    @param dir Initial direction to face (radians).
+ *    @param pos Initial position.
+ *    @param vel Initial velocity.
+ *    @param flags Used for tweaking the pilot.
+ */
+void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const char *ai,
+      const double dir, const Vector2d* pos, const Vector2d* vel,
+      const unsigned int flags )
+{
+   int slot;
+   Solid *solid;
+   const Pilot *tpl;
+
+   /* Start from the ship's template, keeping the arena storage. */
+   tpl   = pilot_getTemplate( ship );
+   slot  = pilot->slot;
+   solid = pilot->solid;
+   memcpy( pilot, tpl, sizeof(Pilot) );
+   pilot->slot = slot;
+
+   if (flags & PILOT_PLAYER) /* player is ID 0 */
+      pilot->id = PLAYER_ID;
+   else {
+      pilot->id = pilot_handleNew( slot ); /* handle of the arena slot, can't be 0 */
+      if (!(flags & PILOT_EMPTY)) /* only pilots in the stack can be looked up */
+         pilot_handles[slot].p = pilot;
+   }
+
+   /* Basic information. */
+   pilot->name = strdup( (name==NULL) ? ship->name : name );
+
+   /* faction */
+   pilot->faction = faction;
+
+   /* solid, the template already has the mass from pilot_calcStats */
+   pilot->solid = solid;
+   solid_init( pilot->solid, tpl->solid->mass, dir, pos, vel );
+
+   /* Allocate outfit memory, stats are already computed for the empty slots. */
+   pilot_copySlots( pilot, tpl );
+
    /* Sanity check. */
 #ifdef DEBUGGING
    const char *str = pilot_checkSanity( pilot );
@@ -3214,11 +3600,9 @@ unsigned int pilot_create( Ship* ship, const char* name, int faction, const char
    Pilot *dyn;
 
    /* Allocate pilot memory. */
-   dyn = malloc(sizeof(Pilot));
-   if (dyn == NULL) {
-      WARN("Unable to allocate memory");
+   dyn = pilot_arenaAlloc();
+   if (dyn == NULL)
       return 0;
-   }
 
    /* See if memory needs to grow */
    if (pilot_nstack+1 > pilot_mstack) { /* needs to grow */
@@ -3254,11 +3638,9 @@ Pilot* pilot_createEmpty( Ship* ship, const char* name,
       int faction, const char *ai, const unsigned int flags )
 {
    Pilot* dyn;
-   dyn = malloc(sizeof(Pilot));
-   if (dyn == NULL) {
-      WARN("Unable to allocate memory");
-      return 0;
-   }
+   dyn = pilot_arenaAlloc();
+   if (dyn == NULL)
+      return NULL;
    pilot_init( dyn, ship, name, faction, ai, 0., NULL, NULL, flags | PILOT_EMPTY );
    return dyn;
 }
@@ -3272,11 +3654,19 @@ Pilot* pilot_createEmpty( Ship* ship, const char* name,
  */
 Pilot* pilot_copy( Pilot* src )
 {
-   int i, p;
-   Pilot *dest = malloc(sizeof(Pilot));
+   int i, slot;
+   Solid *solid;
+   Pilot *dest;
+
+   dest = pilot_arenaAlloc();
+   if (dest == NULL)
+      return NULL;
+   slot  = dest->slot;
+   solid = dest->solid;
 
    /* Copy data over, we'll have to reset all the pointers though. */
    memcpy( dest, src, sizeof(Pilot) );
+   dest->slot = slot;
 
    /* Copy names. */
    if (src->name)
@@ -3285,33 +3675,11 @@ Pilot* pilot_copy( Pilot* src )
       dest->title = strdup(src->title);
 
    /* Copy solid. */
-   dest->solid = malloc(sizeof(Solid));
+   dest->solid = solid;
    memcpy( dest->solid, src->solid, sizeof(Solid) );
 
    /* Copy outfits. */
-   dest->noutfits = src->noutfits;
-   dest->outfits  = malloc( sizeof(PilotOutfitSlot*) * dest->noutfits );
-   dest->outfit_nlow = src->outfit_nlow;
-   dest->outfit_low  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nlow );
-   memcpy( dest->outfit_low, src->outfit_low,
-         sizeof(PilotOutfitSlot) * dest->outfit_nlow );
-   dest->outfit_nmedium = src->outfit_nmedium;
-   dest->outfit_medium  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
-   memcpy( dest->outfit_medium, src->outfit_medium,
-         sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
-   dest->outfit_nhigh = src->outfit_nhigh;
-   dest->outfit_high  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
-   memcpy( dest->outfit_high, src->outfit_high,
-         sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
-   p = 0;
-   for (i=0; i<dest->outfit_nlow; i++)
-      dest->outfits[p++] = &dest->outfit_low[i];
-   for (i=0; i<dest->outfit_nmedium; i++)
-      dest->outfits[p++] = &dest->outfit_medium[i];
-   for (i=0; i<dest->outfit_nhigh; i++)
-      dest->outfits[p++] = &dest->outfit_high[i];
-   dest->secondary   = NULL;
-   dest->afterburner = NULL;
+   pilot_copySlots( dest, src );
 
    /* Hooks get cleared. */
    dest->hooks          = NULL;
@@ -3386,7 +3754,6 @@ void pilot_free( Pilot* p )
    /* Case if pilot is the player. */
    if (player==p)
       player = NULL;
-   solid_free(p->solid);
    if (p->mounted != NULL)
       free(p->mounted);
 
@@ -3400,11 +3767,8 @@ void pilot_free( Pilot* p )
    if (p->comm_msg != NULL)
       free(p->comm_msg);
 
-#ifdef DEBUGGING
-   memset( p, 0, sizeof(Pilot) );
-#endif /* DEBUGGING */
-
-   free(p);
+   /* Give back the memory. */
+   pilot_arenaRelease(p);
 }
 
 
@@ -3418,9 +3782,11 @@ void pilot_destroy(Pilot* p)
    int i;
 
    /* find the pilot */
-   for (i=0; i < pilot_nstack; i++)
-      if (pilot_stack[i]==p)
-         break;
+   i = pilot_getStackPos( p->id );
+   if ((i < 0) || (pilot_stack[i] != p)) {
+      WARN("Trying to destroy pilot '%s' not found in stack!", p->name);
+      return;
+   }
 
    /* pilot is eliminated */
    pilot_free(p);
@@ -3443,6 +3809,13 @@ void pilots_free (void)
    pilot_stack = NULL;
    player = NULL;
    pilot_nstack = 0;
+
+   /* Free the explosion index. */
+   spatial_free( &pilot_index );
+
+   /* Free the templates and the arena if nothing is left in it. */
+   pilot_freeTemplates();
+   pilot_arenaFree();
 }
 
 
@@ -3514,18 +3887,26 @@ void pilot_updateSensorRange (void)
  */
 void pilots_update( double dt )
 {
-   int i;
+   int i, j;
    Pilot *p;
 
+   /* Destroy pilots in a single pass, keeping the stack in order. */
+   for (i=0, j=0; i < pilot_nstack; i++) {
+      p = pilot_stack[i];
+      if (pilot_isFlag(p, PILOT_DELETE))
+         pilot_free(p);
+      else
+         pilot_stack[j++] = p;
+   }
+   pilot_nstack = j;
+
    /* Now update all the pilots. */
    for ( i=0; i < pilot_nstack; i++ ) {
       p = pilot_stack[i];
 
-      /* Destroy pilot and go on. */
-      if (pilot_isFlag(p, PILOT_DELETE)) {
-         pilot_destroy(p);
+      /* Deleted this frame, destroyed next frame. */
+      if (pilot_isFlag(p, PILOT_DELETE))
          continue;
-      }
 
       /* See if should think. */
       if (p->think && !pilot_isDisabled(p) && !pilot_isFlag(p,PILOT_DEAD)) {
@@ -3551,6 +3932,44 @@ void pilots_update( double dt )
 }
 
 
+/**
+ * @brief Stores the pilots' positions before a simulation step.
+ */
+void pilots_snapshot (void)
+{
+   int i;
+   for (i=0; i<pilot_nstack; i++)
+      solid_snapshot( pilot_stack[i]->solid );
+}
+
+
+/**
+ * @brief Places the pilots where they should be displayed.
+ *
+ * Must be paired with pilots_presentEnd() before the next simulation step.
+ *
+ *    @param alpha Fraction of a step elapsed since the last simulation step.
+ *    @param dt Length of a simulation step.
+ */
+void pilots_presentBegin( double alpha, double dt )
+{
+   int i;
+   for (i=0; i<pilot_nstack; i++)
+      solid_presentBegin( pilot_stack[i]->solid, alpha, dt );
+}
+
+
+/**
+ * @brief Puts the pilots back at their simulated positions.
+ */
+void pilots_presentEnd (void)
+{
+   int i;
+   for (i=0; i<pilot_nstack; i++)
+      solid_presentEnd( pilot_stack[i]->solid );
+}
+
+
 /**
  * @brief Renders all the pilots.
  *
@@ -183,26 +183,29 @@ typedef struct Escort_s {
 
 /**
  * @brief The representation of an in-game pilot.
+ *
+ * Pilots live in the pilot arena.  The data touched every frame by
+ *  pilots_update() and weapons_update() comes first so it shares cache lines,
+ *  the bookkeeping only used occasionally follows.  The solid is stored
+ *  packed with the solids of the other pilots in the arena.
  */
 typedef struct Pilot_ {
 
+   /* Hot data, used every frame. */
    unsigned int id; /**< pilot's id, used for many functions */
-   char* name; /**< pilot's name (if unique) */
-   char* title; /**< title - usually indicating special properties - @todo use */
-
-   int faction; /**< Pilot's faction. */
-
-   /* Object characteristics */
-   Ship* ship; /**< ship pilot is flying */
+   uint32_t flags; /**< used for AI and others */
    Solid* solid; /**< associated solid (physics) */
-   double mass_cargo; /**< Amount of cargo mass added. */
-   double mass_outfit; /**< Amount of outfit mass added. */
+   Ship* ship; /**< ship pilot is flying */
+   int faction; /**< Pilot's faction. */
    int tsx; /**< current sprite x position, calculated on update. */
    int tsy; /**< current sprite y position, calculated on update. */
+   int lockons; /**< Stores how many seeking weapons are targeting pilot */
 
-   /* Properties. */
-   double cpu; /**< Amount of CPU the pilot has left. */
-   double cpu_max; /**< Maximum amount of CPU the pilot has. */
+   /* Associated functions */
+   void (*think)(struct Pilot_*, const double); /**< AI thinking for the pilot */
+   void (*update)(struct Pilot_*, const double); /**< Updates the pilot. */
+   void (*render)(struct Pilot_*, const double); /**< For rendering the pilot. */
+   void (*render_overlay)(struct Pilot_*, const double); /**< For rendering the pilot overlay. */
 
    /* Movement */
    double thrust; /**< Pilot's thrust. */
@@ -226,15 +229,30 @@ typedef struct Pilot_ {
    double energy_regen; /**< Energy regeneration rate (per second). */
    double energy_tau; /**< Tau regeneration rate for energy. */
 
+   /* Timers. */
+   unsigned int target; /**< AI target. */
+   double tcontrol; /**< timer for control tick */
+   double timer[MAX_AI_TIMERS]; /**< timers for AI */
+   double ptimer; /**< generic timer for internal pilot use */
+   double htimer; /**< Hail animation timer. */
+   double engine_glow; /**< Amount of engine glow to display. */
+
+   /* Cold data, bookkeeping. */
+   int slot; /**< Slot in the pilot arena. */
+   char* name; /**< pilot's name (if unique) */
+   char* title; /**< title - usually indicating special properties - @todo use */
+
+   /* Object characteristics */
+   double mass_cargo; /**< Amount of cargo mass added. */
+   double mass_outfit; /**< Amount of outfit mass added. */
+
+   /* Properties. */
+   double cpu; /**< Amount of CPU the pilot has left. */
+   double cpu_max; /**< Maximum amount of CPU the pilot has. */
+
    /* Ship statistics. */
    ShipStats stats; /**< Pilot's copy of ship statistics. */
 
-   /* Associated functions */
-   void (*think)(struct Pilot_*, const double); /**< AI thinking for the pilot */
-   void (*update)(struct Pilot_*, const double); /**< Updates the pilot. */
-   void (*render)(struct Pilot_*, const double); /**< For rendering the pilot. */
-   void (*render_overlay)(struct Pilot_*, const double); /**< For rendering the pilot overlay. */
-
    /* Outfit management */
    /* Global outfits. */
    int noutfits; /**< Total amount of slots. */
@@ -274,25 +292,17 @@ typedef struct Pilot_ {
    int nescorts; /**< Number of pilot escorts. */
 
    /* AI */
-   unsigned int target; /**< AI target. */
    AI_Profile* ai; /**< ai personality profile */
-   double tcontrol; /**< timer for control tick */
-   double timer[MAX_AI_TIMERS]; /**< timers for AI */
    Task* task; /**< current action */
 
    /* Misc */
    double comm_msgTimer; /**< Message timer for the comm. */
    double comm_msgWidth; /**< Width of the message. */
    char *comm_msg; /**< Comm message to display overhead. */
-   uint32_t flags; /**< used for AI and others */
-   double ptimer; /**< generic timer for internal pilot use */
-   double htimer; /**< Hail animation timer. */
    int hail_pos; /**< Hail animation position. */
-   int lockons; /**< Stores how many seeking weapons are targeting pilot */
    int *mounted; /**< Number of mounted outfits on the mount. */
    double player_damage; /**< Accumulates damage done by player for hostileness.
                               In per one of max shield + armour. */
-   double engine_glow; /**< Amount of engine glow to display. */
 } Pilot;
 
 
@@ -317,8 +327,10 @@ void pilot_shootSecondary( Pilot* p );
 void pilot_shootStop( Pilot* p, const int secondary );
 double pilot_hit( Pilot* p, const Solid* w, const unsigned int shooter,
       const DamageType dtype, const double damage );
+void pilot_explodeBegin (void);
 void pilot_explode( double x, double y, double radius,
-      DamageType dtype, double damage, const Pilot *parent );
+      DamageType dtype, double damage, unsigned int parent );
+void pilot_explodeEnd (void);
 double pilot_face( Pilot* p, const double dir );
 
 
@@ -408,6 +420,9 @@ void pilot_setTurn( Pilot *p, double turn );
  */
 void pilot_update( Pilot* pilot, const double dt );
 void pilots_update( double dt );
+void pilots_snapshot (void);
+void pilots_presentBegin( double alpha, double dt );
+void pilots_presentEnd (void);
 void pilots_render( double dt );
 void pilots_renderOverlay( double dt );
 void pilot_render( Pilot* pilot, const double dt );
@@ -0,0 +1,772 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file replay.c
+ *
+ * @brief Records the input of a session and replays it deterministically.
+ *
+ * A recording holds the random seed, the length of every frame and the input
+ *  events the game polled during it.  Replaying feeds them back at maximum
+ *  speed without rendering, times the subsystems and checks a hash of the
+ *  state of the pilots every few frames to detect divergence.
+ *
+ * File format, all integers little endian:
+ *  - Header: "NRPL", version (u8), seed (u32), width (u16), height (u16) and
+ *     frames between checkpoints (u32).
+ *  - Records: a type (u8) followed by its data.  Frame lengths are variable
+ *     length integers since they are almost always small.
+ */
+
+
+#include "replay.h"
+
+#include "naev.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#if HAS_POSIX
+#include <sys/time.h>
+#endif /* HAS_POSIX */
+
+#include "log.h"
+#include "conf.h"
+#include "rng.h"
+#include "ntime.h"
+#include "pilot.h"
+
+
+/*
+ * From pilot.c
+ */
+extern Pilot** pilot_stack;
+extern int pilot_nstack;
+
+
+#define REPLAY_MAGIC          "NRPL" /**< Magic at the start of a recording. */
+#define REPLAY_VERSION        1 /**< Version of the recording format. */
+#define REPLAY_CHECK_FRAMES   60 /**< Frames between checkpoints when recording. */
+
+/* Record types. */
+#define REPLAY_REC_FRAME      0 /**< End of a frame, length in ms. */
+#define REPLAY_REC_CHECK      1 /**< Checkpoint, state hash. */
+#define REPLAY_REC_KEYDOWN    2 /**< Key pressed. */
+#define REPLAY_REC_KEYUP      3 /**< Key released. */
+#define REPLAY_REC_MOTION     4 /**< Mouse moved. */
+#define REPLAY_REC_BUTTONDOWN 5 /**< Mouse button pressed. */
+#define REPLAY_REC_BUTTONUP   6 /**< Mouse button released. */
+#define REPLAY_REC_JOYAXIS    7 /**< Joystick axis moved. */
+#define REPLAY_REC_JOYDOWN    8 /**< Joystick button pressed. */
+#define REPLAY_REC_JOYUP      9 /**< Joystick button released. */
+#define REPLAY_REC_QUIT       10 /**< Quit requested. */
+
+
+/**
+ * @brief Replay modes.
+ */
+typedef enum ReplayMode_e {
+   REPLAY_OFF, /**< Not recording nor replaying. */
+   REPLAY_RECORD, /**< Recording. */
+   REPLAY_PLAY /**< Replaying. */
+} ReplayMode;
+
+
+/*
+ * State.
+ */
+static ReplayMode replay_mode = REPLAY_OFF; /**< Current mode. */
+static FILE *replay_file = NULL; /**< Recording being written or read. */
+static int replay_peek = -1; /**< Type of the next record if already read. */
+static int replay_eof = 0; /**< Reached the end of the recording. */
+static int replay_quitSent = 0; /**< Already asked the game to quit. */
+static int replay_inFrame = 0; /**< A frame has been started. */
+static unsigned int replay_frames = 0; /**< Frames recorded or replayed. */
+static unsigned int replay_ticks = 0; /**< Frame clock in ms. */
+static unsigned int replay_checkFrames = REPLAY_CHECK_FRAMES; /**< Frames between checkpoints. */
+
+
+/*
+ * Statistics.
+ */
+static unsigned int replay_checks = 0; /**< Checkpoints passed. */
+static unsigned int replay_checkFail = 0; /**< Checkpoints failed. */
+static unsigned int replay_firstFail = 0; /**< Frame of the first failed checkpoint. */
+static unsigned int replay_skipped = 0; /**< Recorded events the game never polled. */
+static double replay_timers[REPLAY_TIMER_MAX]; /**< Time spent in each subsystem. */
+static double replay_wallStart = 0.; /**< Time the replay started. */
+static double replay_wallFrame = 0.; /**< Time the last frame ended. */
+static double replay_frameMax = 0.; /**< Slowest frame. */
+static const char *replay_timerNames[REPLAY_TIMER_MAX] = {
+   "space", "weapons", "spfx", "pilots", "explosions",
+   "missions", "events", "lua gc"
+}; /**< Names of the timers. */
+
+
+/*
+ * Prototypes.
+ */
+/* File. */
+static void replay_putU8( unsigned int n );
+static void replay_putU16( unsigned int n );
+static void replay_putU32( uint32_t n );
+static void replay_putVar( uint32_t n );
+static unsigned int replay_getU8 (void);
+static unsigned int replay_getU16 (void);
+static uint32_t replay_getU32 (void);
+static uint32_t replay_getVar (void);
+static int replay_nextType (void);
+/* Events. */
+static void replay_writeEvent( const SDL_Event *event );
+static void replay_readEvent( SDL_Event *event, int type );
+/* Checks. */
+static uint32_t replay_hash (void);
+static uint32_t replay_hashData( uint32_t h, const void *data, size_t len );
+static void replay_report (void);
+
+
+/**
+ * @brief Writes a byte.
+ */
+static void replay_putU8( unsigned int n )
+{
+   fputc( (int)(n & 0xFF), replay_file );
+}
+/**
+ * @brief Writes a 16 bit integer.
+ */
+static void replay_putU16( unsigned int n )
+{
+   replay_putU8( n );
+   replay_putU8( n >> 8 );
+}
+/**
+ * @brief Writes a 32 bit integer.
+ */
+static void replay_putU32( uint32_t n )
+{
+   replay_putU16( n & 0xFFFF );
+   replay_putU16( n >> 16 );
+}
+/**
+ * @brief Writes a variable length integer, 7 bits per byte.
+ */
+static void replay_putVar( uint32_t n )
+{
+   while (n >= 0x80) {
+      replay_putU8( (n & 0x7F) | 0x80 );
+      n >>= 7;
+   }
+   replay_putU8( n );
+}
+/**
+ * @brief Reads a byte, 0 at the end of the recording.
+ */
+static unsigned int replay_getU8 (void)
+{
+   int c;
+
+   c = fgetc( replay_file );
+   if (c == EOF) {
+      replay_eof = 1;
+      return 0;
+   }
+   return (unsigned int)c;
+}
+/**
+ * @brief Reads a 16 bit integer.
+ */
+static unsigned int replay_getU16 (void)
+{
+   unsigned int n;
+   n  = replay_getU8();
+   n |= replay_getU8() << 8;
+   return n;
+}
+/**
+ * @brief Reads a 32 bit integer.
+ */
+static uint32_t replay_getU32 (void)
+{
+   uint32_t n;
+   n  = replay_getU16();
+   n |= (uint32_t)replay_getU16() << 16;
+   return n;
+}
+/**
+ * @brief Reads a variable length integer.
+ */
+static uint32_t replay_getVar (void)
+{
+   uint32_t n;
+   unsigned int b;
+   int shift;
+
+   n     = 0;
+   shift = 0;
+   do {
+      b      = replay_getU8();
+      n     |= (uint32_t)(b & 0x7F) << shift;
+      shift += 7;
+   } while ((b & 0x80) && (shift < 32) && !replay_eof);
+   return n;
+}
+/**
+ * @brief Gets the type of the next record without consuming it.
+ *
+ *    @return Type of the next record or -1 at the end of the recording.
+ */
+static int replay_nextType (void)
+{
+   if (replay_peek < 0) {
+      replay_peek = fgetc( replay_file );
+      if (replay_peek == EOF) {
+         replay_peek = -1;
+         replay_eof  = 1;
+      }
+   }
+   return replay_peek;
+}
+
+
+/**
+ * @brief Starts recording or replaying if set in the configuration.
+ *
+ * Must be called after rng_init() and before the sound is initialized.
+ *
+ *    @return 0 on success.
+ */
+int replay_init (void)
+{
+   char magic[4];
+   uint32_t seed;
+   unsigned int version, w, h;
+
+   /* Start clean. */
+   replay_peek        = -1;
+   replay_eof         = 0;
+   replay_quitSent    = 0;
+   replay_inFrame     = 0;
+   replay_frames      = 0;
+   replay_ticks       = 0;
+   replay_checks      = 0;
+   replay_checkFail   = 0;
+   replay_firstFail   = 0;
+   replay_skipped     = 0;
+   replay_frameMax    = 0.;
+   replay_checkFrames = REPLAY_CHECK_FRAMES;
+   memset( replay_timers, 0, sizeof(replay_timers) );
+
+   /* Replaying. */
+   if (conf.replay != NULL) {
+      replay_file = fopen( conf.replay, "rb" );
+      if (replay_file == NULL) {
+         WARN("Unable to open replay '%s'.", conf.replay);
+         return -1;
+      }
+      if ((fread( magic, 1, 4, replay_file ) != 4) ||
+            (memcmp( magic, REPLAY_MAGIC, 4 ) != 0)) {
+         WARN("'%s' is not a replay.", conf.replay);
+         fclose( replay_file );
+         replay_file = NULL;
+         return -1;
+      }
+      version = replay_getU8();
+      if (version != REPLAY_VERSION) {
+         WARN("Replay '%s' is version %u, expected %u.",
+               conf.replay, version, REPLAY_VERSION);
+         fclose( replay_file );
+         replay_file = NULL;
+         return -1;
+      }
+      seed               = replay_getU32();
+      w                  = replay_getU16();
+      h                  = replay_getU16();
+      replay_checkFrames = replay_getU32();
+      if (replay_checkFrames == 0) {
+         WARN("Replay '%s' is corrupt.", conf.replay);
+         fclose( replay_file );
+         replay_file = NULL;
+         return -1;
+      }
+      if ((w != (unsigned int)conf.width) || (h != (unsigned int)conf.height))
+         WARN("Replay was recorded at %ux%u, mouse input may not match.", w, h);
+
+      /* Same random numbers, no sound. */
+      rng_initSeed( seed );
+      conf.nosound = 1;
+
+      replay_mode = REPLAY_PLAY;
+      LOG("Replaying '%s'.", conf.replay);
+   }
+
+   /* Recording. */
+   else if (conf.record != NULL) {
+      replay_file = fopen( conf.record, "wb" );
+      if (replay_file == NULL) {
+         WARN("Unable to open '%s' to record to.", conf.record);
+         return -1;
+      }
+
+      /* Use a known seed and record without sound like the replay runs. */
+      seed = randint();
+      rng_initSeed( seed );
+      conf.nosound = 1;
+
+      fwrite( REPLAY_MAGIC, 1, 4, replay_file );
+      replay_putU8( REPLAY_VERSION );
+      replay_putU32( seed );
+      replay_putU16( conf.width );
+      replay_putU16( conf.height );
+      replay_putU32( replay_checkFrames );
+
+      replay_mode = REPLAY_RECORD;
+      LOG("Recording to '%s'.", conf.record);
+   }
+   else
+      return 0;
+
+   replay_wallStart = replay_time();
+   replay_wallFrame = replay_wallStart;
+   return 0;
+}
+
+
+/**
+ * @brief Stops recording or replaying, reporting the replay results.
+ */
+void replay_exit (void)
+{
+   if (replay_mode == REPLAY_OFF)
+      return;
+
+   if (replay_mode == REPLAY_PLAY)
+      replay_report();
+   else
+      LOG("Recorded %u frames to '%s'.", replay_frames, conf.record);
+
+   fclose( replay_file );
+   replay_file = NULL;
+   replay_mode = REPLAY_OFF;
+}
+
+
+/**
+ * @brief Checks to see if a recording is being made.
+ */
+int replay_isRecording (void)
+{
+   return (replay_mode == REPLAY_RECORD);
+}
+
+
+/**
+ * @brief Checks to see if a recording is being replayed.
+ *
+ * Nothing should be rendered while replaying.
+ */
+int replay_isReplaying (void)
+{
+   return (replay_mode == REPLAY_PLAY);
+}
+
+
+/**
+ * @brief Writes an input event.
+ */
+static void replay_writeEvent( const SDL_Event *event )
+{
+   switch (event->type) {
+      case SDL_KEYDOWN:
+      case SDL_KEYUP:
+         replay_putU8( (event->type==SDL_KEYDOWN) ?
+               REPLAY_REC_KEYDOWN : REPLAY_REC_KEYUP );
+         replay_putU16( event->key.keysym.sym );
+         replay_putU16( event->key.keysym.mod );
+         replay_putU16( event->key.keysym.unicode );
+         break;
+
+      case SDL_MOUSEMOTION:
+         replay_putU8( REPLAY_REC_MOTION );
+         replay_putU8( event->motion.state );
+         replay_putU16( event->motion.x );
+         replay_putU16( event->motion.y );
+         replay_putU16( (uint16_t)event->motion.xrel );
+         replay_putU16( (uint16_t)event->motion.yrel );
+         break;
+
+      case SDL_MOUSEBUTTONDOWN:
+      case SDL_MOUSEBUTTONUP:
+         replay_putU8( (event->type==SDL_MOUSEBUTTONDOWN) ?
+               REPLAY_REC_BUTTONDOWN : REPLAY_REC_BUTTONUP );
+         replay_putU8( event->button.button );
+         replay_putU16( event->button.x );
+         replay_putU16( event->button.y );
+         break;
+
+      case SDL_JOYAXISMOTION:
+         replay_putU8( REPLAY_REC_JOYAXIS );
+         replay_putU8( event->jaxis.axis );
+         replay_putU16( (uint16_t)event->jaxis.value );
+         break;
+
+      case SDL_JOYBUTTONDOWN:
+      case SDL_JOYBUTTONUP:
+         replay_putU8( (event->type==SDL_JOYBUTTONDOWN) ?
+               REPLAY_REC_JOYDOWN : REPLAY_REC_JOYUP );
+         replay_putU8( event->jbutton.button );
+         break;
+
+      case SDL_QUIT:
+         replay_putU8( REPLAY_REC_QUIT );
+         break;
+
+      default: /* Nothing the game reacts to. */
+         break;
+   }
+}
+
+
+/**
+ * @brief Reads an input event.
+ *
+ *    @param[out] event Event to fill.
+ *    @param type Type of the record, already consumed.
+ */
+static void replay_readEvent( SDL_Event *event, int type )
+{
+   memset( event, 0, sizeof(SDL_Event) );
+   switch (type) {
+      case REPLAY_REC_KEYDOWN:
+      case REPLAY_REC_KEYUP:
+         event->type    = (type==REPLAY_REC_KEYDOWN) ? SDL_KEYDOWN : SDL_KEYUP;
+         event->key.state = (type==REPLAY_REC_KEYDOWN) ? SDL_PRESSED : SDL_RELEASED;
+         event->key.keysym.sym     = (SDLKey) replay_getU16();
+         event->key.keysym.mod     = (SDLMod) replay_getU16();
+         event->key.keysym.unicode = (Uint16) replay_getU16();
+         break;
+
+      case REPLAY_REC_MOTION:
+         event->type         = SDL_MOUSEMOTION;
+         event->motion.state = (Uint8) replay_getU8();
+         event->motion.x     = (Uint16) replay_getU16();
+         event->motion.y     = (Uint16) replay_getU16();
+         event->motion.xrel  = (Sint16) replay_getU16();
+         event->motion.yrel  = (Sint16) replay_getU16();
+         break;
+
+      case REPLAY_REC_BUTTONDOWN:
+      case REPLAY_REC_BUTTONUP:
+         event->type = (type==REPLAY_REC_BUTTONDOWN) ?
+               SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+         event->button.state  = (type==REPLAY_REC_BUTTONDOWN) ?
+               SDL_PRESSED : SDL_RELEASED;
+         event->button.button = (Uint8) replay_getU8();
+         event->button.x      = (Uint16) replay_getU16();
+         event->button.y      = (Uint16) replay_getU16();
+         break;
+
+      case REPLAY_REC_JOYAXIS:
+         event->type        = SDL_JOYAXISMOTION;
+         event->jaxis.axis  = (Uint8) replay_getU8();
+         event->jaxis.value = (Sint16) replay_getU16();
+         break;
+
+      case REPLAY_REC_JOYDOWN:
+      case REPLAY_REC_JOYUP:
+         event->type = (type==REPLAY_REC_JOYDOWN) ?
+               SDL_JOYBUTTONDOWN : SDL_JOYBUTTONUP;
+         event->jbutton.state  = (type==REPLAY_REC_JOYDOWN) ?
+               SDL_PRESSED : SDL_RELEASED;
+         event->jbutton.button = (Uint8) replay_getU8();
+         break;
+
+      case REPLAY_REC_QUIT:
+         event->type = SDL_QUIT;
+         break;
+
+      default:
+         WARN("Unknown replay record type %d.", type);
+         replay_eof = 1;
+         break;
+   }
+}
+
+
+/**
+ * @brief Polls for an input event.
+ *
+ * Use instead of SDL_PollEvent() in the game loops.  Records the events when
+ *  recording.  When replaying the events of the current frame come from the
+ *  recording instead and real events are ignored except for quitting.
+ *
+ *    @param[out] event Event polled.
+ *    @return 1 if there was an event, 0 else.
+ */
+int replay_pollEvent( SDL_Event *event )
+{
+   int type;
+
+   if (replay_mode == REPLAY_OFF)
+      return SDL_PollEvent( event );
+
+   if (replay_mode == REPLAY_RECORD) {
+      if (!SDL_PollEvent( event ))
+         return 0;
+      replay_writeEvent( event );
+      return 1;
+   }
+
+   /* Only real quit events get through. */
+   while (SDL_PollEvent( event ))
+      if (event->type == SDL_QUIT)
+         return 1;
+
+   /* Quit once the replay is over. */
+   if (replay_eof) {
+      if (replay_quitSent)
+         return 0;
+      replay_quitSent = 1;
+      memset( event, 0, sizeof(SDL_Event) );
+      event->type = SDL_QUIT;
+      return 1;
+   }
+
+   /* Frames and checkpoints end the events. */
+   type = replay_nextType();
+   if (type < REPLAY_REC_KEYDOWN)
+      return 0;
+
+   replay_peek = -1;
+   replay_readEvent( event, type );
+   return 1;
+}
+
+
+/**
+ * @brief Starts a frame.
+ *
+ *    @param dt Length of the frame in ms.
+ *    @return Length of the frame to use in ms, the recorded one when replaying.
+ */
+unsigned int replay_frame( unsigned int dt )
+{
+   int type;
+   SDL_Event event;
+
+   if (replay_mode == REPLAY_OFF)
+      return dt;
+
+   if (replay_mode == REPLAY_RECORD)
+      replay_putU8( REPLAY_REC_FRAME );
+   else {
+      /* Drop anything the game didn't poll for, it has diverged. */
+      while (((type = replay_nextType()) != REPLAY_REC_FRAME) && !replay_eof) {
+         replay_peek = -1;
+         if (type == REPLAY_REC_CHECK)
+            replay_getU32();
+         else {
+            replay_readEvent( &event, type );
+            replay_skipped++;
+         }
+      }
+      if (replay_eof)
+         return 0;
+      replay_peek = -1;
+   }
+
+   /* Frame length. */
+   if (replay_mode == REPLAY_RECORD)
+      replay_putVar( dt );
+   else
+      dt = replay_getVar();
+
+   replay_frames++;
+   replay_ticks  += dt;
+   replay_inFrame = 1;
+   return dt;
+}
+
+
+/**
+ * @brief Ends a frame, writing or checking the checkpoint if it is due.
+ */
+void replay_endFrame (void)
+{
+   uint32_t hash, rec;
+   double t;
+
+   if ((replay_mode == REPLAY_OFF) || !replay_inFrame)
+      return;
+   replay_inFrame = 0;
+
+   /* Frame time. */
+   t = replay_time();
+   replay_frameMax  = MAX( replay_frameMax, t - replay_wallFrame );
+   replay_wallFrame = t;
+
+   if (replay_frames % replay_checkFrames != 0)
+      return;
+
+   hash = replay_hash();
+   if (replay_mode == REPLAY_RECORD) {
+      replay_putU8( REPLAY_REC_CHECK );
+      replay_putU32( hash );
+      return;
+   }
+
+   /* Compare with the recording. */
+   if (replay_nextType() != REPLAY_REC_CHECK)
+      rec = ~hash;
+   else {
+      replay_peek = -1;
+      rec = replay_getU32();
+   }
+   if (replay_eof)
+      return;
+   if (rec == hash)
+      replay_checks++;
+   else {
+      if (replay_checkFail == 0) {
+         replay_firstFail = replay_frames;
+         WARN("Replay diverged at frame %u.", replay_frames);
+      }
+      replay_checkFail++;
+   }
+}
+
+
+/**
+ * @brief Gets the time in ms used for key repeats and such.
+ *
+ * Goes by whole frames when recording or replaying so that it is the same in
+ *  both.
+ */
+unsigned int replay_getTicks (void)
+{
+   if (replay_mode == REPLAY_OFF)
+      return SDL_GetTicks();
+   return replay_ticks;
+}
+
+
+/**
+ * @brief Adds data to a FNV-1a hash.
+ */
+static uint32_t replay_hashData( uint32_t h, const void *data, size_t len )
+{
+   const uint8_t *p;
+   size_t i;
+
+   p = (const uint8_t*) data;
+   for (i=0; i<len; i++) {
+      h ^= p[i];
+      h *= 16777619U;
+   }
+   return h;
+}
+
+
+/**
+ * @brief Hashes the state of the game.
+ */
+static uint32_t replay_hash (void)
+{
+   int i;
+   uint32_t h;
+   unsigned int t;
+   Pilot *p;
+
+   h = 2166136261U;
+   t = ntime_get();
+   h = replay_hashData( h, &t, sizeof(t) );
+   h = replay_hashData( h, &pilot_nstack, sizeof(pilot_nstack) );
+   for (i=0; i<pilot_nstack; i++) {
+      p = pilot_stack[i];
+      h = replay_hashData( h, &p->id, sizeof(p->id) );
+      h = replay_hashData( h, &p->faction, sizeof(p->faction) );
+      h = replay_hashData( h, &p->flags, sizeof(p->flags) );
+      h = replay_hashData( h, &p->solid->pos, sizeof(Vector2d) );
+      h = replay_hashData( h, &p->solid->vel, sizeof(Vector2d) );
+      h = replay_hashData( h, &p->solid->dir, sizeof(double) );
+      h = replay_hashData( h, &p->armour, sizeof(double) );
+      h = replay_hashData( h, &p->shield, sizeof(double) );
+      h = replay_hashData( h, &p->energy, sizeof(double) );
+      h = replay_hashData( h, &p->fuel, sizeof(double) );
+   }
+   return h;
+}
+
+
+/**
+ * @brief Gets the current time in seconds for timing, 0 when not active.
+ */
+double replay_time (void)
+{
+#if HAS_POSIX
+   struct timeval tv;
+#endif /* HAS_POSIX */
+
+   if (replay_mode == REPLAY_OFF)
+      return 0.;
+
+#if HAS_POSIX
+   gettimeofday( &tv, NULL );
+   return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.;
+#else /* HAS_POSIX */
+   return (double)SDL_GetTicks() / 1000.;
+#endif /* HAS_POSIX */
+}
+
+
+/**
+ * @brief Adds the time since t to a subsystem timer.
+ *
+ * @usage t = replay_time(); space_update(dt); t = replay_lap( REPLAY_TIMER_SPACE, t );
+ *
+ *    @param timer Timer to add to.
+ *    @param t Time the subsystem started.
+ *    @return The current time to start the next subsystem with.
+ */
+double replay_lap( ReplayTimer timer, double t )
+{
+   double now;
+
+   if (replay_mode == REPLAY_OFF)
+      return 0.;
+
+   now = replay_time();
+   replay_timers[timer] += now - t;
+   return now;
+}
+
+
+/**
+ * @brief Reports the results of a replay.
+ */
+static void replay_report (void)
+{
+   int i;
+   double wall, frames;
+
+   wall   = MAX( replay_time() - replay_wallStart, 1e-9 );
+   frames = MAX( 1., (double)replay_frames );
+
+   LOG("Replay: %u frames, %.1f s of game in %.2f s (%.0f fps)",
+         replay_frames, (double)replay_ticks / 1000., wall, frames / wall );
+   for (i=0; i<REPLAY_TIMER_MAX; i++)
+      LOG("   %-12s %10.2f ms %8.3f ms/frame %5.1f%%", replay_timerNames[i],
+            replay_timers[i] * 1000., replay_timers[i] * 1000. / frames,
+            100. * replay_timers[i] / wall );
+   LOG("   slowest frame %.2f ms", replay_frameMax * 1000.);
+
+   if (replay_skipped > 0)
+      WARN("%u recorded events were never polled for.", replay_skipped);
+   if (replay_checkFail > 0)
+      WARN("Replay diverged: %u of %u checkpoints failed, first at frame %u.",
+            replay_checkFail, replay_checkFail + replay_checks, replay_firstFail );
+   else
+      LOG("All %u checkpoints matched.", replay_checks);
+}
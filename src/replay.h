@@ -0,0 +1,57 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+
+#ifndef REPLAY_H
+#  define REPLAY_H
+
+
+#include "SDL.h"
+
+
+/**
+ * @brief Subsystems timed while replaying.
+ */
+typedef enum ReplayTimer_e {
+   REPLAY_TIMER_SPACE, /**< space_update() */
+   REPLAY_TIMER_WEAPONS, /**< weapons_update() */
+   REPLAY_TIMER_SPFX, /**< spfx_update() */
+   REPLAY_TIMER_PILOTS, /**< pilots_update(), includes the AI. */
+   REPLAY_TIMER_EXPLOSIONS, /**< expl_update() */
+   REPLAY_TIMER_MISSIONS, /**< missions_update() */
+   REPLAY_TIMER_EVENTS, /**< events_update() */
+   REPLAY_TIMER_LUAGC, /**< nlua_gcUpdate() */
+   REPLAY_TIMER_MAX /**< Number of timers. */
+} ReplayTimer;
+
+
+/*
+ * Init/exit.
+ */
+int replay_init (void);
+void replay_exit (void);
+
+/*
+ * State.
+ */
+int replay_isRecording (void);
+int replay_isReplaying (void);
+
+/*
+ * Frames.
+ */
+int replay_pollEvent( SDL_Event *event );
+unsigned int replay_frame( unsigned int dt );
+void replay_endFrame (void);
+unsigned int replay_getTicks (void);
+
+/*
+ * Timing.
+ */
+double replay_time (void);
+double replay_lap( ReplayTimer timer, double t );
+
+
+#endif /* REPLAY_H */
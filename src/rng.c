@@ -8,6 +8,13 @@
  * @brief Handles all the random number logic.
  *
  * Random numbers are currently generated using the mersenne twister.
+ *
+ * Subsystems that need reproducible numbers independent of the order things
+ *  happen in use streams instead.  A stream is identified by a name, an id and
+ *  a substream, and its numbers are the Philox4x32-10 counter based generator
+ *  applied to that identity and the position in the stream.  They don't share
+ *  any state, so they can be used from any thread and always give the same
+ *  numbers for the same seed.
  */
 
 
@@ -16,6 +23,7 @@
 #include "naev.h"
 
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <unistd.h>
 #include <time.h>
@@ -42,6 +50,19 @@ static uint32_t mt_y; /**< Internal mersenne twister variable. */
 static int mt_pos = 0; /**< Current number being used. */
 
 
+/*
+ * philox stream key
+ */
+#define PHILOX_M0    0xD2511F53U /**< Philox multiplier for the first word. */
+#define PHILOX_M1    0xCD9E8D57U /**< Philox multiplier for the third word. */
+#define PHILOX_W0    0x9E3779B9U /**< Philox key bump for the first word. */
+#define PHILOX_W1    0xBB67AE85U /**< Philox key bump for the second word. */
+#define PHILOX_ROUNDS 10 /**< Philox rounds. */
+#define RNG_KEY_SEED 0x6E616576U /**< Second key word when seeding by hand. */
+#define RNG_LANES    4 /**< Blocks generated together when filling in bulk. */
+static uint32_t rng_key[2] = { 0, RNG_KEY_SEED }; /**< Key of all the streams. */
+
+
 /*
  * prototypes
  */
@@ -50,6 +71,14 @@ static uint32_t rng_timeEntropy (void);
 static void mt_initArray( uint32_t seed );
 static void mt_genArray (void);
 static uint32_t mt_getInt (void);
+/* philox */
+static void philox_block( const uint32_t ctr[4], uint32_t out[4] );
+static void philox_lanes( const uint32_t ctr[4], uint32_t out[4*RNG_LANES] );
+static uint32_t rng_hash( const char *str );
+#ifdef RNG_CHECK
+static int rng_checkWords( const char *what, const uint32_t *got,
+      const uint32_t *want, int n );
+#endif /* RNG_CHECK */
 
 
 /**
@@ -84,6 +113,33 @@ void rng_init (void)
       mt_initArray( i );
    for (i=0; i<10; i++) /* generate numbers to get away from poor initial values */
       mt_genArray();
+
+   /* Streams get their key from the twister. */
+   rng_key[0] = mt_getInt();
+   rng_key[1] = mt_getInt();
+}
+
+
+/**
+ * @fn void rng_initSeed( uint32_t seed )
+ *
+ * @brief Initializes the random subsystem with a known seed.
+ *
+ * Useful for reproducible simulations.
+ *
+ *    @param seed Seed to use.
+ */
+void rng_initSeed( uint32_t seed )
+{
+   int i;
+
+   mt_initArray( seed );
+   for (i=0; i<10; i++) /* generate numbers to get away from poor initial values */
+      mt_genArray();
+
+   /* Streams depend only on the seed. */
+   rng_key[0] = seed;
+   rng_key[1] = RNG_KEY_SEED;
 }
 
 
@@ -197,6 +253,355 @@ double randfp (void)
 }
 
 
+/**
+ * @brief Runs Philox4x32-10 on a counter with the stream key.
+ *
+ *    @param ctr Counter to encrypt.
+ *    @param[out] out The four random words.
+ */
+static void philox_block( const uint32_t ctr[4], uint32_t out[4] )
+{
+   int i;
+   uint32_t c0,c1,c2,c3, k0,k1;
+   uint64_t p0,p1;
+
+   c0 = ctr[0];
+   c1 = ctr[1];
+   c2 = ctr[2];
+   c3 = ctr[3];
+   k0 = rng_key[0];
+   k1 = rng_key[1];
+   for (i=0; i<PHILOX_ROUNDS; i++) {
+      p0 = (uint64_t)PHILOX_M0 * c0;
+      p1 = (uint64_t)PHILOX_M1 * c2;
+      c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+      c1 = (uint32_t)p1;
+      c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+      c3 = (uint32_t)p0;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+   }
+   out[0] = c0;
+   out[1] = c1;
+   out[2] = c2;
+   out[3] = c3;
+}
+
+
+/**
+ * @brief Runs Philox4x32-10 on RNG_LANES consecutive counters at once.
+ *
+ * Same as calling philox_block() for each counter, but written lane by lane
+ *  so the compiler can vectorize it.
+ *
+ *    @param ctr First counter, the following ones increase the first word.
+ *    @param[out] out The random words of each counter one after the other.
+ */
+static void philox_lanes( const uint32_t ctr[4], uint32_t out[4*RNG_LANES] )
+{
+   int i, j;
+   uint32_t c0[RNG_LANES], c1[RNG_LANES], c2[RNG_LANES], c3[RNG_LANES];
+   uint32_t k0, k1;
+   uint64_t p0, p1;
+
+   for (j=0; j<RNG_LANES; j++) {
+      c0[j] = ctr[0] + (uint32_t)j;
+      c1[j] = ctr[1];
+      c2[j] = ctr[2];
+      c3[j] = ctr[3];
+   }
+   k0 = rng_key[0];
+   k1 = rng_key[1];
+   for (i=0; i<PHILOX_ROUNDS; i++) {
+      for (j=0; j<RNG_LANES; j++) {
+         p0    = (uint64_t)PHILOX_M0 * c0[j];
+         p1    = (uint64_t)PHILOX_M1 * c2[j];
+         c0[j] = (uint32_t)(p1 >> 32) ^ c1[j] ^ k0;
+         c1[j] = (uint32_t)p1;
+         c2[j] = (uint32_t)(p0 >> 32) ^ c3[j] ^ k1;
+         c3[j] = (uint32_t)p0;
+      }
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+   }
+   for (j=0; j<RNG_LANES; j++) {
+      out[4*j+0] = c0[j];
+      out[4*j+1] = c1[j];
+      out[4*j+2] = c2[j];
+      out[4*j+3] = c3[j];
+   }
+}
+
+
+/**
+ * @brief Hashes a stream name (FNV-1a).
+ */
+static uint32_t rng_hash( const char *str )
+{
+   uint32_t h;
+
+   h = 2166136261U;
+   for (; *str != '\0'; str++) {
+      h ^= (uint8_t)*str;
+      h *= 16777619U;
+   }
+   return h;
+}
+
+
+/**
+ * @brief Sets up a random stream.
+ *
+ * Streams with the same name, id and substream always give the same numbers
+ *  for the same seed, no matter when or from which thread they are used.
+ *
+ * @usage rng_streamInit( &rs, "stars", sys_id, 0 );
+ *
+ *    @param rs Stream to set up.
+ *    @param name Name of the subsystem using the stream.
+ *    @param id Entity using the stream, like a system or pilot.
+ *    @param sub Substream, like a time step.
+ */
+void rng_streamInit( RngStream *rs, const char *name, uint32_t id, uint32_t sub )
+{
+   rs->ctr[0] = 0;
+   rs->ctr[1] = sub;
+   rs->ctr[2] = id;
+   rs->ctr[3] = rng_hash( name );
+   rs->pos    = 4; /* Buffer is empty. */
+}
+
+
+/**
+ * @brief Moves a stream to a position.
+ *
+ * Lets work be split among threads, each seeking to its share of the stream.
+ *
+ *    @param rs Stream to move.
+ *    @param index Position of the next number to get.
+ */
+void rng_streamSeek( RngStream *rs, uint32_t index )
+{
+   rs->ctr[0] = index / 4;
+   rs->pos    = index % 4;
+   if (rs->pos > 0) {
+      philox_block( rs->ctr, rs->buf );
+      rs->ctr[0]++;
+   }
+   else
+      rs->pos = 4;
+}
+
+
+/**
+ * @brief Gets the next random integer of a stream.
+ *
+ *    @param rs Stream to get from.
+ *    @return A random 4 byte number.
+ */
+uint32_t rng_streamInt( RngStream *rs )
+{
+   if (rs->pos >= 4) {
+      philox_block( rs->ctr, rs->buf );
+      rs->ctr[0]++;
+      rs->pos = 0;
+   }
+   return rs->buf[ rs->pos++ ];
+}
+
+
+/**
+ * @brief Gets the next random float of a stream between 0 and 1 (inclusive).
+ *
+ *    @param rs Stream to get from.
+ *    @return A random float between 0 and 1 (inclusive).
+ */
+double rng_streamFp( RngStream *rs )
+{
+   return (double)rng_streamInt(rs) / m_div;
+}
+
+
+/**
+ * @brief Fills an array with the next random integers of a stream.
+ *
+ * Gives the same numbers as calling rng_streamInt() n times, but generates
+ *  several blocks at once.
+ *
+ *    @param rs Stream to get from.
+ *    @param[out] out Array to fill.
+ *    @param n Number of integers to get.
+ */
+void rng_streamFill( RngStream *rs, uint32_t *out, int n )
+{
+   int i;
+
+   /* Use up what is buffered. */
+   i = 0;
+   while ((i < n) && (rs->pos < 4))
+      out[i++] = rs->buf[ rs->pos++ ];
+
+   /* Whole blocks go straight to the output. */
+   for (; n-i >= 4*RNG_LANES; i += 4*RNG_LANES) {
+      philox_lanes( rs->ctr, &out[i] );
+      rs->ctr[0] += RNG_LANES;
+   }
+
+   /* The rest goes through the buffer. */
+   for (; i<n; i++)
+      out[i] = rng_streamInt( rs );
+}
+
+
+/**
+ * @brief Fills an array with the next random floats of a stream.
+ *
+ * Gives the same numbers as calling rng_streamFp() n times.
+ *
+ *    @param rs Stream to get from.
+ *    @param[out] out Array to fill.
+ *    @param n Number of floats to get.
+ */
+void rng_streamFillFp( RngStream *rs, double *out, int n )
+{
+   int i, j, m;
+   uint32_t buf[4*RNG_LANES];
+
+   for (i=0; i<n; i+=m) {
+      m = MIN( n-i, 4*RNG_LANES );
+      rng_streamFill( rs, buf, m );
+      for (j=0; j<m; j++)
+         out[i+j] = (double)buf[j] / m_div;
+   }
+}
+
+
+#ifdef RNG_CHECK
+/**
+ * @brief Compares random words with the expected ones.
+ *
+ *    @return 0 if they match.
+ */
+static int rng_checkWords( const char *what, const uint32_t *got,
+      const uint32_t *want, int n )
+{
+   int i;
+
+   for (i=0; i<n; i++) {
+      if (got[i] != want[i]) {
+         WARN("RNG check '%s' failed at word %d: got %08x, expected %08x.",
+               what, i, got[i], want[i]);
+         return 1;
+      }
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Checks that the streams give the numbers they should.
+ *
+ * Verifies the Philox4x32-10 known answers from Random123, a pinned
+ *  stream so changes to naming or seeding get caught, and that bulk filling,
+ *  seeking and single draws all give the same numbers.  The stream key is
+ *  left as it was.
+ *
+ *    @return 0 if everything matches, the number of failed checks otherwise.
+ */
+int rng_streamCheck (void)
+{
+   /* Random123 kat_vectors for philox4x32_R(10): counter, key, result. */
+   static const uint32_t kat[3][10] = {
+      { 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+        0x00000000, 0x00000000,
+        0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+      { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+        0xffffffff, 0xffffffff,
+        0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+      { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
+        0xa4093822, 0x299f31d0,
+        0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+   };
+   /* First words of the "economy" stream 7, substream 3 when seeded with 1234. */
+   static const uint32_t pinned[8] = {
+      0xaf3ea6dd, 0xd33eab86, 0xf686228a, 0x3d879251,
+      0x36fffbcc, 0x4136e9be, 0x2e3acd08, 0xf32dc8c8
+   };
+   static const int sizes[] = { 1, 3, 4, 5, 15, 16, 17, 33, 100 };
+   static const uint32_t seeks[] = { 0, 1, 3, 4, 5, 17, 63, 64, 65, 199 };
+   uint32_t key[2], out[4], lanes[4*RNG_LANES], ctr[4];
+   uint32_t seq[256], got[256];
+   double fp[256];
+   RngStream rs;
+   int i, j, k, fail;
+
+   fail   = 0;
+   key[0] = rng_key[0];
+   key[1] = rng_key[1];
+
+   /* Known answers, lane 0 of the bulk version too. */
+   for (i=0; i<3; i++) {
+      rng_key[0] = kat[i][4];
+      rng_key[1] = kat[i][5];
+      philox_block( kat[i], out );
+      fail += rng_checkWords( "philox block", out, &kat[i][6], 4 );
+      philox_lanes( kat[i], lanes );
+      fail += rng_checkWords( "philox lanes", lanes, &kat[i][6], 4 );
+      /* The other lanes are the following counters. */
+      for (j=1; j<RNG_LANES; j++) {
+         memcpy( ctr, kat[i], sizeof(ctr) );
+         ctr[0] += (uint32_t)j;
+         philox_block( ctr, out );
+         fail += rng_checkWords( "philox lane", &lanes[4*j], out, 4 );
+      }
+   }
+
+   /* Pinned stream. */
+   rng_key[0] = 1234;
+   rng_key[1] = RNG_KEY_SEED;
+   rng_streamInit( &rs, "economy", 7, 3 );
+   for (i=0; i<256; i++)
+      seq[i] = rng_streamInt( &rs );
+   fail += rng_checkWords( "pinned stream", seq, pinned, 8 );
+
+   /* Bulk filling after any number of single draws. */
+   for (i=0; i<(int)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+      for (k=0; k<5; k++) {
+         rng_streamInit( &rs, "economy", 7, 3 );
+         for (j=0; j<k; j++)
+            got[j] = rng_streamInt( &rs );
+         rng_streamFill( &rs, &got[k], sizes[i] );
+         got[k+sizes[i]] = rng_streamInt( &rs );
+         fail += rng_checkWords( "bulk fill", got, seq, k+sizes[i]+1 );
+      }
+   }
+
+   /* Seeking. */
+   for (i=0; i<(int)(sizeof(seeks)/sizeof(seeks[0])); i++) {
+      rng_streamInit( &rs, "economy", 7, 3 );
+      rng_streamSeek( &rs, seeks[i] );
+      rng_streamFill( &rs, got, 20 );
+      fail += rng_checkWords( "seek", got, &seq[ seeks[i] ], 20 );
+   }
+
+   /* Floats. */
+   rng_streamInit( &rs, "economy", 7, 3 );
+   rng_streamFillFp( &rs, fp, 101 );
+   for (i=0; i<101; i++) {
+      if (fp[i] != (double)seq[i] / m_div) {
+         WARN("RNG check 'bulk floats' failed at %d.", i);
+         fail++;
+         break;
+      }
+   }
+
+   rng_key[0] = key[0];
+   rng_key[1] = key[1];
+   return fail;
+}
+#endif /* RNG_CHECK */
+
+
 /**
  * @fn double Normal( double x )
  *
@@ -8,6 +8,9 @@
 #  define RNG_H
 
 
+#include <stdint.h>
+
+
 /**
  * @brief Gets a random number between L and H (L <= RNG <= H).
  *
@@ -44,13 +47,54 @@
 #define RNG_3SIGMA()       NormalInverse(0.001 + RNGF()*(1.-0.001*2.))
 
 
+/**
+ * @brief Gets a random number from stream S between L and H (L <= RNGS <= H).
+ *
+ * Result unspecified in L is bigger then H.
+ */
+#define RNGS(S,L,H) ((int)(L) + (int)((double)((H)-(L)+1) * rng_streamFp(S)))
+/**
+ * @brief Gets a random float from stream S between 0 and 1 (0. <= RNGSF <= 1.).
+ */
+#define RNGSF(S)    (rng_streamFp(S))
+/**
+ * @brief Gets a random mu within two-sigma (-2 to 2) from stream S.
+ */
+#define RNGS_2SIGMA(S)     NormalInverse(0.021 + RNGSF(S)*(1.-0.021*2.))
+
+
+/**
+ * @brief Independent random stream.
+ *
+ * Set up with rng_streamInit(), holds no shared state so each thread can use
+ *  its own.
+ */
+typedef struct RngStream_ {
+   uint32_t ctr[4]; /**< Counter of the next block: index, substream, id and name. */
+   uint32_t buf[4]; /**< Current block. */
+   int pos; /**< Next number to use from buf, 4 if it is empty. */
+} RngStream;
+
+
 /* Init */
 void rng_init (void);
+void rng_initSeed( uint32_t seed );
 
 /* Random functions */
 unsigned int randint (void);
 double randfp (void);
 
+/* Streams */
+void rng_streamInit( RngStream *rs, const char *name, uint32_t id, uint32_t sub );
+void rng_streamSeek( RngStream *rs, uint32_t index );
+uint32_t rng_streamInt( RngStream *rs );
+double rng_streamFp( RngStream *rs );
+void rng_streamFill( RngStream *rs, uint32_t *out, int n );
+void rng_streamFillFp( RngStream *rs, double *out, int n );
+#ifdef RNG_CHECK
+int rng_streamCheck (void);
+#endif /* RNG_CHECK */
+
 /* Probability functions */
 double Normal( double x );
 double NormalInverse( double p );
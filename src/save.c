@@ -15,6 +15,9 @@
 #include <stdio.h> /* remove() */
 #include <errno.h> /* errno */
 
+#include "SDL.h"
+#include "SDL_thread.h"
+
 #include "log.h"
 #include "nxml.h"
 #include "player.h"
@@ -28,6 +31,7 @@
 #include "nlua_var.h"
 #include "event.h"
 #include "conf.h"
+#include "replay.h"
 
 
 #define LOAD_WIDTH      400 /**< Load window width. */
@@ -37,6 +41,19 @@
 #define BUTTON_HEIGHT   30 /**< Button height. */
 
 
+/**
+ * @brief A savegame snapshot waiting to be written to disk.
+ */
+typedef struct SaveJob_ {
+   char file[PATH_MAX]; /**< Savegame to write. */
+   xmlBufferPtr buf; /**< Serialized savegame. */
+   int compress; /**< Compression level to write with. */
+} SaveJob;
+static SDL_Thread *save_thread = NULL; /**< Thread writing the last savegame. */
+static volatile int save_done = 0; /**< Set by the thread once it's finished. */
+static int save_failed = 0; /**< A background save failed and the player wasn't told yet. */
+
+
 /*
  * prototypes
  */
@@ -66,6 +83,7 @@ extern int diff_load( xmlNodePtr parent ); /**< Loads the universe diffs. */
 extern void menu_main_close (void); /**< Closes the main menu. */
 /* static */
 static int save_data( xmlTextWriterPtr writer );
+static int save_write( void *data );
 static void load_menu_close( unsigned int wdw, char *str );
 static void load_menu_load( unsigned int wdw, char *str );
 static void load_menu_delete( unsigned int wdw, char *str );
@@ -93,21 +111,140 @@ static int save_data( xmlTextWriterPtr writer )
 }
 
 
+/**
+ * @brief Writes a savegame snapshot to disk.
+ *
+ * Runs on its own thread, the savegame gets written to a temporary file which
+ *  is then renamed over the old savegame so it's never left half written.  The
+ *  old savegame is backed up by copying so it stays in place until then.
+ *
+ *    @param data SaveJob to write, gets freed.
+ *    @return 0 on success.
+ */
+static int save_write( void *data )
+{
+   char tmp[PATH_MAX];
+   SaveJob *job;
+   xmlOutputBufferPtr out;
+   int ret;
+
+   job = (SaveJob*) data;
+   ret = -1;
+   snprintf(tmp, PATH_MAX, "%s.tmp", job->file);
+
+   /* Compress and write to the temporary file. */
+   out = xmlOutputBufferCreateFilename(tmp, NULL, job->compress);
+   if (out == NULL) {
+      WARN("Unable to open '%s' for writing, aborting save...", tmp);
+      goto err;
+   }
+   xmlOutputBufferWrite(out, xmlBufferLength(job->buf),
+         (const char*)xmlBufferContent(job->buf));
+   if (xmlOutputBufferClose(out) < 0) {
+      WARN("Failed to write savegame to '%s', aborting save...", tmp);
+      remove(tmp);
+      goto err;
+   }
+
+   /* Back up old savegame. */
+   if (nfile_backupCopyIfExists("%s", job->file) < 0) {
+      WARN("Aborting save...");
+      remove(tmp);
+      goto err;
+   }
+
+   /* Put new savegame in place. */
+#if HAS_WIN32
+   remove(job->file); /* Windows won't rename over existing files. */
+#endif /* HAS_WIN32 */
+   if (rename(tmp, job->file) < 0) {
+      WARN("Unable to move '%s' to '%s': %s", tmp, job->file, strerror(errno));
+      goto err;
+   }
+   ret = 0;
+
+err:
+   xmlBufferFree(job->buf);
+   free(job);
+   save_done = 1;
+   return ret;
+}
+
+
+/**
+ * @brief Waits for any savegame being written to finish.
+ *
+ *    @return 0 if it was written, -1 if it failed.
+ */
+int save_wait (void)
+{
+   int status;
+
+   if (save_thread == NULL)
+      return 0;
+   SDL_WaitThread(save_thread, &status);
+   save_thread = NULL;
+   if (status < 0) {
+      save_failed = 1;
+      return -1;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Tells the player if a savegame failed to be written in the background.
+ *
+ * Should be called from the main loop since it may open a dialogue.
+ */
+void save_update (void)
+{
+   if ((save_thread != NULL) && save_done)
+      save_wait();
+
+   if (save_failed) {
+      save_failed = 0;
+      dialogue_alert( "Failed to save game!  You should exit and check the log to see what happened and then file a bug report!" );
+   }
+}
+
+
 /**
  * @brief Saves the current game.
  *
+ * The game state is serialized into memory here and then compressed and
+ *  written to disk in the background.
+ *
+ * Nothing is written while replaying, so a replay never touches the
+ *  player's real savegames.
+ *
  *    @return 0 on success.
  */
 int save_all (void)
 {
-   char file[PATH_MAX];
-   xmlDocPtr doc;
+   xmlBufferPtr buf;
    xmlTextWriterPtr writer;
+   SaveJob *job;
+
+   /* Replays must not overwrite the player's savegames. */
+   if (replay_isReplaying()) {
+      DEBUG("Not saving the game while replaying.");
+      return 0;
+   }
+
+   /* Only one save in flight. */
+   save_wait();
 
    /* Create the writer. */
-   writer = xmlNewTextWriterDoc(&doc, conf.save_compress);
+   buf = xmlBufferCreate();
+   if (buf == NULL) {
+      WARN("Error creating the xml buffer");
+      return -1;
+   }
+   writer = xmlNewTextWriterMemory(buf, 0);
    if (writer == NULL) {
       ERR("testXmlwriterDoc: Error creating the xml writer");
+      xmlBufferFree(buf);
       return -1;
    }
 
@@ -134,35 +271,36 @@ int save_all (void)
    /* Finish element. */
    xmlw_endElem(writer); /* "naev_save" */
    xmlw_done(writer);
+   xmlFreeTextWriter(writer); /* Flushes into buf. */
 
-   /* Write to file. */
+   /* Make sure directory exists. */
    if (nfile_dirMakeExist("%ssaves", nfile_basePath()) < 0) {
       WARN("Aborting save...");
-      goto err_writer;
-   }
-   snprintf(file, PATH_MAX, "%ssaves/%s.ns", nfile_basePath(), player_name);
-
-   /* Back up old savegame. */
-   if (nfile_backupIfExists(file) < 0) {
-      WARN("Aborting save...");
-      goto err_writer;
+      goto err;
    }
 
-   /* Critical section, if crashes here player's game gets corrupted.
-    * Luckily we have a copy just in case... */
-   xmlFreeTextWriter(writer);
-   if (xmlSaveFileEnc(file, doc, "UTF-8") < 0) {
-      WARN("Failed to write savegame!  You'll most likely have to restore it by copying your backup savegame over your current savegame.");
+   /* Hand off to the writer thread. */
+   job = malloc(sizeof(SaveJob));
+   if (job == NULL) {
+      WARN("Out of Memory!");
       goto err;
    }
-   xmlFreeDoc(doc);
+   snprintf(job->file, PATH_MAX, "%ssaves/%s.ns", nfile_basePath(), player_name);
+   job->buf      = buf;
+   job->compress = conf.save_compress;
+   save_done     = 0;
+   save_thread   = SDL_CreateThread( save_write, job );
+   if (save_thread == NULL) {
+      WARN("Unable to create save thread, saving synchronously.");
+      return save_write( job );
+   }
 
    return 0;
 
 err_writer:
    xmlFreeTextWriter(writer);
 err:
-   xmlFreeDoc(doc);
+   xmlBufferFree(buf);
    return -1;
 }
 
@@ -189,7 +327,8 @@ void load_game_menu (void)
    wid = window_create( "Load Game", -1, -1, LOAD_WIDTH, LOAD_HEIGHT );
    window_setCancel( wid, load_menu_close );
 
-   /* load the saves */
+   /* load the saves, making sure the last one is written */
+   save_wait();
    files = nfile_readDir( &nfiles, "%ssaves", nfile_basePath() );
    for (i=0; i<nfiles; i++) {
       len = strlen(files[i]);
@@ -284,6 +423,12 @@ static void load_menu_delete( unsigned int wdw, char *str )
       "Are you sure you want to permanently delete '%s'?", save) == 0)
       return;
 
+   /* Replays must not delete the player's savegames either. */
+   if (replay_isReplaying()) {
+      DEBUG("Not deleting '%s' while replaying.", save);
+      return;
+   }
+
    snprintf( path, PATH_MAX, "%ssaves/%s.ns", nfile_basePath(), save );
    remove(path); /* remove is portable and will call unlink on linux. */
 
@@ -304,7 +449,8 @@ static int load_game( const char* file )
    xmlNodePtr node;
    xmlDocPtr doc;
 
-   /* Make sure it exists. */
+   /* Make sure it exists and is completely written. */
+   save_wait();
    if (!nfile_fileExists(file)) {
       dialogue_alert("Savegame file seems to have been deleted.");
       return -1;
@@ -8,6 +8,8 @@
 
 
 int save_all (void);
+int save_wait (void);
+void save_update (void);
 void reload (void);
 void load_game_menu (void);
 
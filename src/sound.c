@@ -86,6 +86,7 @@ void (*sound_sys_stop) ( alVoice *v )  = NULL;
 void (*sound_sys_pause) (void)         = NULL;
 void (*sound_sys_resume) (void)        = NULL;
 void (*sound_sys_setSpeed) (double s ) = NULL;
+void (*sound_sys_stats) ( int *active, int *virt, int *stolen ) = NULL;
 /* Listener. */
 int (*sound_sys_updateListener) ( double dir, double px, double py,
       double vx, double vy )           = NULL;
@@ -155,6 +156,7 @@ int sound_init (void)
       sound_sys_pause      = sound_al_pause;
       sound_sys_resume     = sound_al_resume;
       sound_sys_setSpeed   = sound_al_setSpeed;
+      sound_sys_stats      = sound_al_stats;
       /* Listener. */
       sound_sys_updateListener = sound_al_updateListener;
       /* Groups. */
@@ -608,6 +610,26 @@ void sound_setSpeed( double s )
 }
 
 
+/**
+ * @brief Gets the voice statistics of the last update.
+ *
+ *    @param[out] active Voices playing on a source.
+ *    @param[out] virt Voices tracked without a source.
+ *    @param[out] stolen Sources taken from lower priority voices.
+ */
+void sound_stats( int *active, int *virt, int *stolen )
+{
+   *active = 0;
+   *virt   = 0;
+   *stolen = 0;
+
+   if (sound_disabled || (sound_sys_stats == NULL))
+      return;
+
+   sound_sys_stats( active, virt, stolen );
+}
+
+
 /**
  * @brief Makes the list of available sounds.
  */
@@ -45,12 +45,27 @@
  * will pretend to play the buffer.
  * Every so often we'll check to see if the important voices are being
  * played and take away the sources from the lesser ones.
+ *
+ * Voices are scored by the loudness of their buffer, how much the distance to
+ * the listener attenuates them and whether they are relative to the listener.
+ * When the pool is empty a new voice steals the source of the lowest scored
+ * voice if it scores higher.  Voices without a source, or that can't be
+ * heard, are virtual: they keep their position and play time and get a
+ * source back once one is free.
  */
 
 
 #define SOUND_MAX_SOURCES     128
 #define SOUND_FADEOUT         100
 
+#define SOUND_REFERENCE_DIST  500. /**< Distance at which sounds start to attenuate. */
+#define SOUND_MAX_DIST        5000. /**< Distance after which voices are virtual. */
+#define SOUND_ROLLOFF         1. /**< Rolloff factor of the distance model. */
+
+#define SOUND_PRIORITY_RELATIVE  4. /**< Weight of voices relative to the listener. */
+#define SOUND_PRIORITY_POSITION  1. /**< Weight of positional voices. */
+#define SOUND_PRIORITY_AUDIBLE   1e-3 /**< Voices scoring below are virtual. */
+
 
 #define soundLock()     SDL_mutexP(sound_lock)
 #define soundUnlock()   SDL_mutexV(sound_lock)
@@ -84,6 +99,22 @@ static int source_nall        = 0; /**< Total number of sources. */
 static int source_mstack      = 0; /**< Memory allocated for sources in the pool. */
 
 
+/*
+ * Voice management.
+ */
+static ALfloat al_listener[3] = { 0., 0., 0. }; /**< Listener position. */
+static unsigned int al_ticks  = 0; /**< Ticks of the last update. */
+static double al_dt           = 0.; /**< Play time elapsed since the last update. */
+static double al_speed        = 1.; /**< Current playing speed. */
+static int al_paused          = 0; /**< Whether the sounds are paused. */
+static int al_nactive         = 0; /**< Voices on a source this update. */
+static int al_nvirtual        = 0; /**< Virtual voices this update. */
+static int al_nstolen         = 0; /**< Sources stolen this update. */
+static int al_nactiveLast     = 0; /**< Voices on a source last update. */
+static int al_nvirtualLast    = 0; /**< Virtual voices last update. */
+static int al_nstolenLast     = 0; /**< Sources stolen last update. */
+
+
 /*
  * EFX stuff.
  */
@@ -128,6 +159,11 @@ static int sound_al_wavGetLen16( SDL_RWops *rw, uint16_t *out );
  * General.
  */
 static ALuint sound_al_getSource (void);
+static ALfloat sound_al_loudness( const char *buf, size_t len, int bits );
+static double al_voicePriority( alVoice *v );
+static ALuint al_stealSource( double priority );
+static void al_voiceStart( alVoice *v, ALuint source );
+static void al_voiceVirtualize( alVoice *v );
 static int al_playVoice( alVoice *v, alSound *s,
       ALfloat px, ALfloat py, ALfloat vx, ALfloat vy, ALint relative );
 static int sound_al_loadWav( alSound *snd, SDL_RWops *rw );
@@ -270,9 +306,9 @@ int sound_al_init (void)
       source_stack[source_nstack] = s;
 
       /* Distance model defaults. */
-      alSourcef( s, AL_MAX_DISTANCE,       5000. );
-      alSourcef( s, AL_ROLLOFF_FACTOR,     1. );
-      alSourcef( s, AL_REFERENCE_DISTANCE, 500. );
+      alSourcef( s, AL_MAX_DISTANCE,       SOUND_MAX_DIST );
+      alSourcef( s, AL_ROLLOFF_FACTOR,     SOUND_ROLLOFF );
+      alSourcef( s, AL_REFERENCE_DISTANCE, SOUND_REFERENCE_DIST );
 
       /* Set the filter. */
       if (al_info.efx == AL_TRUE)
@@ -735,6 +771,9 @@ static int sound_al_loadWav( alSound *snd, SDL_RWops *rw )
    alBufferData( snd->u.al.buf, format, buf, chunklen, rate );
    soundUnlock();
 
+   /* Used to prioritize voices. */
+   snd->u.al.loudness = sound_al_loudness( buf, chunklen, align );
+
    free(buf);
    return 0;
 
@@ -811,6 +850,9 @@ static int sound_al_loadOgg( alSound *snd, OggVorbis_File *vf )
    alBufferData( snd->u.al.buf, format, buf, len, info->rate );
    soundUnlock();
 
+   /* Used to prioritize voices. */
+   snd->u.al.loudness = sound_al_loudness( buf, len, 16 );
+
    /* Clean up. */
    free(buf);
    ov_clear(vf);
@@ -819,6 +861,45 @@ static int sound_al_loadOgg( alSound *snd, OggVorbis_File *vf )
 }
 
 
+/**
+ * @brief Gets the loudness of sound data.
+ *
+ *    @param buf Sample data, unsigned for 8 bits, signed for 16 bits.
+ *    @param len Length of buf in bytes.
+ *    @param bits Bits per sample.
+ *    @return The RMS level of the data from 0 to 1.
+ */
+static ALfloat sound_al_loudness( const char *buf, size_t len, int bits )
+{
+   const int16_t *s16;
+   const uint8_t *s8;
+   size_t i, n;
+   double sum, d;
+
+   sum = 0.;
+   if (bits == 16) {
+      s16 = (const int16_t*) buf;
+      n   = len / 2;
+      for (i=0; i<n; i++) {
+         d    = (double)s16[i] / 32768.;
+         sum += d*d;
+      }
+   }
+   else {
+      s8 = (const uint8_t*) buf;
+      n  = len;
+      for (i=0; i<n; i++) {
+         d    = ((double)s8[i] - 128.) / 128.;
+         sum += d*d;
+      }
+   }
+
+   if (n == 0)
+      return 0.;
+   return (ALfloat) sqrt( sum / (double)n );
+}
+
+
 /**
  * @brief Loads the sound.
  *
@@ -940,16 +1021,85 @@ static ALuint sound_al_getSource (void)
 
 
 /**
- * @brief Plays a voice.
+ * @brief Gets the priority of a voice.
+ *
+ * Loudness of the sound weighted by category and attenuated with the same
+ *  distance model OpenAL uses.  Voices past the maximum distance can't be
+ *  heard.
+ *
+ *    @param v Voice to get priority of.
+ *    @return The priority of the voice.
  */
-static int al_playVoice( alVoice *v, alSound *s,
-      ALfloat px, ALfloat py, ALfloat vx, ALfloat vy, ALint relative )
+static double al_voicePriority( alVoice *v )
 {
-   /* Set up the source and buffer. */
-   v->u.al.source = sound_al_getSource();
-   if (v->u.al.source == 0)
-      return -1;
-   v->u.al.buffer = s->u.al.buf;
+   double d, gain;
+
+   /* Relative voices are always next to the listener. */
+   if (v->u.al.relative)
+      return SOUND_PRIORITY_RELATIVE * svolume * v->u.al.loudness;
+
+   /* Distance to the listener. */
+   d = hypot( v->u.al.pos[0] - al_listener[0], v->u.al.pos[1] - al_listener[1] );
+   if (d > SOUND_MAX_DIST)
+      return 0.;
+
+   /* AL_INVERSE_DISTANCE_CLAMPED. */
+   d    = MAX( d, SOUND_REFERENCE_DIST );
+   gain = SOUND_REFERENCE_DIST /
+         (SOUND_REFERENCE_DIST + SOUND_ROLLOFF * (d - SOUND_REFERENCE_DIST));
+
+   return SOUND_PRIORITY_POSITION * svolume * gain * v->u.al.loudness;
+}
+
+
+/**
+ * @brief Steals the source of the lowest priority voice.
+ *
+ *    @param priority Priority of the voice that needs a source.
+ *    @return The stolen source or 0 if all voices have higher priority.
+ */
+static ALuint al_stealSource( double priority )
+{
+   alVoice *v, *victim;
+
+   voice_lock();
+
+   /* Find the lowest priority voice with a source. */
+   victim = NULL;
+   for (v=voice_active; v!=NULL; v=v->next) {
+      if ((v->u.al.source == 0) || (v->state != VOICE_PLAYING))
+         continue;
+      if ((victim == NULL) || (v->u.al.priority < victim->u.al.priority))
+         victim = v;
+   }
+
+   /* Must be less important. */
+   if ((victim == NULL) || (victim->u.al.priority >= priority)) {
+      voice_unlock();
+      return 0;
+   }
+
+   /* Victim keeps on playing virtually. */
+   al_voiceVirtualize( victim );
+   al_nstolen++;
+
+   voice_unlock();
+
+   return sound_al_getSource();
+}
+
+
+/**
+ * @brief Starts playing a voice on a source.
+ *
+ * Picks up where the voice was if it was virtual.
+ *
+ *    @param v Voice to start.
+ *    @param source Source to play on.
+ */
+static void al_voiceStart( alVoice *v, ALuint source )
+{
+   v->u.al.source = source;
 
    soundLock();
 
@@ -957,21 +1107,17 @@ static int al_playVoice( alVoice *v, alSound *s,
    alSourcei( v->u.al.source, AL_BUFFER, v->u.al.buffer );
 
    /* Enable positional sound. */
-   alSourcei( v->u.al.source, AL_SOURCE_RELATIVE, relative );
-
-   /* Update position. */
-   v->u.al.pos[0] = px;
-   v->u.al.pos[1] = py;
-   v->u.al.pos[2] = 0.;
-   v->u.al.vel[0] = vx;
-   v->u.al.vel[1] = vy;
-   v->u.al.vel[2] = 0.;
+   alSourcei( v->u.al.source, AL_SOURCE_RELATIVE, v->u.al.relative );
 
    /* Set up properties. */
    alSourcef(  v->u.al.source, AL_GAIN, svolume );
    alSourcefv( v->u.al.source, AL_POSITION, v->u.al.pos );
    alSourcefv( v->u.al.source, AL_VELOCITY, v->u.al.vel );
 
+   /* Resume where it was. */
+   if (v->u.al.elapsed > 0.)
+      alSourcef( v->u.al.source, AL_SEC_OFFSET, v->u.al.elapsed );
+
    /* Start playing. */
    alSourcePlay( v->u.al.source );
 
@@ -979,6 +1125,73 @@ static int al_playVoice( alVoice *v, alSound *s,
    al_checkErr();
 
    soundUnlock();
+}
+
+
+/**
+ * @brief Takes the source away from a voice.
+ *
+ *    @param v Voice to virtualize.
+ */
+static void al_voiceVirtualize( alVoice *v )
+{
+   soundLock();
+
+   /* Stop and remove buffer so it doesn't start up again. */
+   alSourceStop( v->u.al.source );
+   alSourcei( v->u.al.source, AL_BUFFER, AL_NONE );
+
+   /* Check for errors. */
+   al_checkErr();
+
+   soundUnlock();
+
+   /* Put source back on the list. */
+   source_stack[source_nstack] = v->u.al.source;
+   source_nstack++;
+   v->u.al.source = 0;
+}
+
+
+/**
+ * @brief Plays a voice.
+ *
+ * Voices that can't get a source play virtually, so this doesn't fail.
+ */
+static int al_playVoice( alVoice *v, alSound *s,
+      ALfloat px, ALfloat py, ALfloat vx, ALfloat vy, ALint relative )
+{
+   ALuint source;
+
+   /* Set up the voice. */
+   v->u.al.source    = 0;
+   v->u.al.buffer    = s->u.al.buf;
+   v->u.al.relative  = relative;
+   v->u.al.loudness  = s->u.al.loudness;
+   v->u.al.length    = s->length;
+   v->u.al.elapsed   = 0.;
+
+   /* Update position. */
+   v->u.al.pos[0] = px;
+   v->u.al.pos[1] = py;
+   v->u.al.pos[2] = 0.;
+   v->u.al.vel[0] = vx;
+   v->u.al.vel[1] = vy;
+   v->u.al.vel[2] = 0.;
+
+   /* Inaudible voices don't need a source. */
+   v->u.al.priority = al_voicePriority( v );
+   if (v->u.al.priority < SOUND_PRIORITY_AUDIBLE)
+      return 0;
+
+   /* Get a source, stealing one if needed. */
+   source = sound_al_getSource();
+   if (source == 0)
+      source = al_stealSource( v->u.al.priority );
+   if (source == 0)
+      return 0;
+
+   al_voiceStart( v, source );
 
    return 0;
 }
@@ -1039,10 +1252,28 @@ void sound_al_updateVoice( alVoice *v )
 {
    ALint state;
 
-   /* Invalid source, mark to delete. */
+   /* Keep track of play time. */
+   v->u.al.elapsed += al_dt;
+
+   /* Virtual voice. */
    if (v->u.al.source == 0) {
-      v->state = VOICE_DESTROY;
-      return;
+      if (v->state != VOICE_PLAYING)
+         return;
+
+      /* Finished playing. */
+      if (v->u.al.elapsed >= v->u.al.length) {
+         v->state = VOICE_STOPPED;
+         return;
+      }
+
+      /* Only gets a free source back, stealing here would thrash. */
+      v->u.al.priority = al_voicePriority( v );
+      if (al_paused || (source_nstack <= 0) ||
+            (v->u.al.priority < SOUND_PRIORITY_AUDIBLE)) {
+         al_nvirtual++;
+         return;
+      }
+      al_voiceStart( v, sound_al_getSource() );
    }
 
    soundLock();
@@ -1068,6 +1299,18 @@ void sound_al_updateVoice( alVoice *v )
       v->state = VOICE_STOPPED;
       return;
    }
+   soundUnlock();
+
+   /* Release the source if it can't be heard. */
+   v->u.al.priority = al_voicePriority( v );
+   if (v->u.al.priority < SOUND_PRIORITY_AUDIBLE) {
+      al_voiceVirtualize( v );
+      al_nvirtual++;
+      return;
+   }
+   al_nactive++;
+
+   soundLock();
 
    /* Set up properties. */
    alSourcef(  v->u.al.source, AL_GAIN, svolume );
@@ -1103,6 +1346,7 @@ void sound_al_stop( alVoice* voice )
  */
 void sound_al_pause (void)
 {
+   al_paused = 1;
    soundLock();
    al_pausev( source_ntotal, source_total );
    /* Check for errors. */
@@ -1116,6 +1360,7 @@ void sound_al_pause (void)
  */
 void sound_al_resume (void)
 {
+   al_paused = 0;
    soundLock();
    al_resumev( source_ntotal, source_total );
    /* Check for errors. */
@@ -1130,6 +1375,7 @@ void sound_al_resume (void)
 void sound_al_setSpeed( double s )
 {
    int i;
+   al_speed = s;
    soundLock();
    for (i=0; i<source_nall; i++)
       alSourcef( source_all[i], AL_PITCH, s );
@@ -1164,6 +1410,7 @@ int sound_al_updateListener( double dir, double px, double py,
    pos[1] = py;
    pos[2] = 0.;
    alListenerfv( AL_POSITION, pos );
+   memcpy( al_listener, pos, sizeof(pos) );
    vel[0] = vx;
    vel[1] = vy;
    vel[2] = 0.;
@@ -1475,6 +1722,19 @@ void sound_al_update (void)
 
    t = SDL_GetTicks();
 
+   /* Play time for the voices, which get updated after this. */
+   al_dt    = (al_paused || (al_ticks == 0)) ? 0. :
+         (double)(t - al_ticks) / 1000. * al_speed;
+   al_ticks = t;
+
+   /* New statistics. */
+   al_nactiveLast  = al_nactive;
+   al_nvirtualLast = al_nvirtual;
+   al_nstolenLast  = al_nstolen;
+   al_nactive      = 0;
+   al_nvirtual     = 0;
+   al_nstolen      = 0;
+
    for (i=0; i<al_ngroups; i++) {
       g = &al_groups[i];
       /* Handle fadeout. */
@@ -1511,6 +1771,21 @@ void sound_al_update (void)
 }
 
 
+/**
+ * @brief Gets the voice statistics of the last update.
+ *
+ *    @param[out] active Voices playing on a source.
+ *    @param[out] virt Voices tracked without a source.
+ *    @param[out] stolen Sources taken from lower priority voices.
+ */
+void sound_al_stats( int *active, int *virt, int *stolen )
+{
+   *active = al_nactiveLast;
+   *virt   = al_nvirtualLast;
+   *stolen = al_nstolenLast;
+}
+
+
 #ifdef DEBUGGING
 /**
  * @brief Converts an OpenAL error to a string.
@@ -96,6 +96,7 @@ void sound_al_stop( alVoice *v );
 void sound_al_pause (void);
 void sound_al_resume (void);
 void sound_al_setSpeed( double s );
+void sound_al_stats( int *active, int *virt, int *stolen );
 
 
 /*
@@ -47,6 +47,7 @@ typedef struct alSound_ {
 #if USE_OPENAL
       struct {
          ALuint buf; /**< Buffer data. */
+         ALfloat loudness; /**< RMS level of the buffer, from 0 to 1. */
       } al; /**< For OpenAL backend. */
 #endif /* USE_OPENAL */
 #if USE_SDLMIX
@@ -95,8 +96,13 @@ typedef struct alVoice_ {
       struct {
          ALfloat pos[3]; /**< Position of the voice. */
          ALfloat vel[3]; /**< Velocity of the voice. */
-         ALuint source; /**< Source current in use. */
+         ALuint source; /**< Source current in use, 0 if virtual. */
          ALuint buffer; /**< Buffer attached to the voice. */
+         ALint relative; /**< Whether it's relative to the listener. */
+         ALfloat loudness; /**< Loudness of the buffer. */
+         double length; /**< Length of the buffer in seconds. */
+         double elapsed; /**< Time it has been playing in seconds. */
+         double priority; /**< Priority when last updated. */
       } al; /**< For OpenAL backend. */
 #endif /* USE_OPENAL */
 #if USE_SDLMIX
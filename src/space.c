@@ -14,6 +14,9 @@
 
 #include <stdlib.h>
 #include <math.h>
+#if HAS_POSIX
+#include <sys/time.h>
+#endif /* HAS_POSIX */
 
 #include "nxml.h"
 
@@ -26,6 +29,7 @@
 #include "weapon.h"
 #include "toolkit.h"
 #include "spfx.h"
+#include "explosion.h"
 #include "ntime.h"
 #include "nebula.h"
 #include "sound.h"
@@ -106,6 +110,7 @@ extern int pilot_nstack;
  * star stack and friends
  */
 #define STAR_BUF  100   /**< Area to leave around screen for stars, more = less repitition */
+#define SPACE_STARS_CHUNK 64 /**< Stars to get random numbers for at once. */
 /**
  * @struct Star
  *
@@ -116,6 +121,35 @@ static GLfloat *star_vertex = NULL; /**< Vertex of the stars. */
 static GLfloat *star_colour = NULL; /**< Brightness of the stars. */
 static unsigned int nstars = 0; /**< total stars */
 static unsigned int mstars = 0; /**< memory stars are taking */
+/* Stars moved by a vertex program. */
+static gl_vbo *star_shaderVBO = NULL; /**< Static star positions for the vertex program. */
+static GLuint star_program    = 0; /**< Vertex program scrolling the stars. */
+static int star_programTried  = 0; /**< Already tried to create star_program. */
+static GLint star_uOffset     = -1; /**< Location of the star_offset uniform. */
+static GLint star_uDims       = -1; /**< Location of the star_dims uniform. */
+static GLint star_uStreak     = -1; /**< Location of the star_streak uniform. */
+static double star_x          = 0.; /**< X distance travelled, kept within the star buffer. */
+static double star_y          = 0.; /**< Y distance travelled, kept within the star buffer. */
+/**
+ * @brief Vertex program for the stars.
+ *
+ * Each vertex is (x, y, brightness, end) where end is 1 for the tail of the
+ *  hyperspace streak.  Stars scroll slower the dimmer they are and wrap
+ *  around the star buffer.
+ */
+static const char star_vertProgram[] =
+   "uniform vec2 star_offset;\n"
+   "uniform vec2 star_dims;\n"
+   "uniform vec2 star_streak;\n"
+   "void main(void)\n"
+   "{\n"
+   "   vec2 pos;\n"
+   "   pos  = gl_Vertex.xy - star_offset / (9.0 - 10.0*gl_Vertex.z);\n"
+   "   pos  = mod( pos + 0.5*star_dims, star_dims ) - 0.5*star_dims;\n"
+   "   pos += gl_Vertex.w * gl_Vertex.z * star_streak;\n"
+   "   gl_Position   = gl_ModelViewProjectionMatrix * vec4( pos, 0.0, 1.0 );\n"
+   "   gl_FrontColor = gl_Color;\n"
+   "}\n";
 
 
 /*
@@ -138,8 +172,15 @@ static void system_parseJumps( const xmlNodePtr parent );
 /* misc */
 static int system_calcSecurity( StarSystem *sys );
 static void system_setFaction( StarSystem *sys );
+static void space_starDims( GLfloat *w, GLfloat *h );
+static GLfloat* space_starsShaderData (void);
+static void space_starsWrap( GLfloat w, GLfloat h );
+static void space_renderStarsProgram( const double dt );
 static void space_addFleet( Fleet* fleet, int init );
 static PlanetClass planetclass_get( const char a );
+#ifdef DEBUGGING
+static double space_time (void);
+#endif /* DEBUGGING */
 /*
  * Externed prototypes.
  */
@@ -659,19 +700,30 @@ static void space_addFleet( Fleet* fleet, int init )
  */
 void space_initStars( int n )
 {
-   unsigned int i;
+   unsigned int i, j;
    GLfloat w, h, hw, hh;
+   GLfloat *data;
    double size;
+   RngStream rs;
+   double r[3*SPACE_STARS_CHUNK];
+
+   /* Try to set up the vertex program. */
+   if (!star_programTried) {
+      star_programTried = 1;
+      star_program = gl_shaderCreate( "stars", star_vertProgram, NULL );
+      if (star_program != 0) {
+         star_uOffset = nglGetUniformLocation( star_program, "star_offset" );
+         star_uDims   = nglGetUniformLocation( star_program, "star_dims" );
+         star_uStreak = nglGetUniformLocation( star_program, "star_streak" );
+      }
+   }
 
    /* Calculate size. */
    size  = SCREEN_W*SCREEN_H+STAR_BUF*STAR_BUF;
    size /= pow2(conf.zoom_far);
 
    /* Calculate star buffer. */
-   w  = (SCREEN_W + 2.*STAR_BUF);
-   w += conf.zoom_stars * (w / conf.zoom_far - 1.);
-   h  = (SCREEN_H + 2.*STAR_BUF);
-   h += conf.zoom_stars * (h / conf.zoom_far - 1.);
+   space_starDims( &w, &h );
    hw = w / 2.;
    hh = h / 2.;
 
@@ -685,17 +737,25 @@ void space_initStars( int n )
       star_colour = realloc( star_colour, nstars * sizeof(GLfloat) * 8 );
       mstars = nstars;
    }
+   /* Same stars every time the system is visited. */
+   rng_streamInit( &rs, "stars", (cur_system != NULL) ?
+         (uint32_t)(cur_system - systems_stack) : 0, 0 );
    for (i=0; i < nstars; i++) {
+      /* Get random numbers in bulk. */
+      j = i % SPACE_STARS_CHUNK;
+      if (j == 0)
+         rng_streamFillFp( &rs, r, 3*MIN( SPACE_STARS_CHUNK, nstars-i ) );
+
       /* Set the position. */
-      star_vertex[4*i+0] = RNGF()*w - hw;
-      star_vertex[4*i+1] = RNGF()*h - hh;
+      star_vertex[4*i+0] = r[3*j+0]*w - hw;
+      star_vertex[4*i+1] = r[3*j+1]*h - hh;
       star_vertex[4*i+2] = 0.;
       star_vertex[4*i+3] = 0.;
       /* Set the colour. */
       star_colour[8*i+0] = 1.;
       star_colour[8*i+1] = 1.;
       star_colour[8*i+2] = 1.;
-      star_colour[8*i+3] = RNGF()*0.6 + 0.2;
+      star_colour[8*i+3] = r[3*j+2]*0.6 + 0.2;
       star_colour[8*i+4] = 1.;
       star_colour[8*i+5] = 1.;
       star_colour[8*i+6] = 1.;
@@ -711,13 +771,59 @@ void space_initStars( int n )
       gl_vboDestroy( star_colourVBO );
       star_colourVBO = NULL;
    }
+   if (star_shaderVBO != NULL) {
+      gl_vboDestroy( star_shaderVBO );
+      star_shaderVBO = NULL;
+   }
 
    /* Create now VBO. */
-   star_vertexVBO = gl_vboCreateStream(
-         nstars * sizeof(GLfloat) * 4, star_vertex );
    star_colourVBO = gl_vboCreateStatic(
          nstars * sizeof(GLfloat) * 8, star_colour );
+   if (star_program != 0) {
+      /* Positions only change when wrapping, the vertex program moves them. */
+      data = space_starsShaderData();
+      star_shaderVBO = gl_vboCreateStatic(
+            nstars * sizeof(GLfloat) * 8, data );
+      free(data);
+      star_x = 0.;
+      star_y = 0.;
+   }
+   else
+      star_vertexVBO = gl_vboCreateStream(
+            nstars * sizeof(GLfloat) * 4, star_vertex );
+}
+
+
+/**
+ * @brief Gets the dimensions of the area the stars wrap around in.
+ *
+ *    @param[out] w Width of the star buffer.
+ *    @param[out] h Height of the star buffer.
+ */
+static void space_starDims( GLfloat *w, GLfloat *h )
+{
+   *w  = (SCREEN_W + 2.*STAR_BUF);
+   *w += conf.zoom_stars * (*w / conf.zoom_far - 1.);
+   *h  = (SCREEN_H + 2.*STAR_BUF);
+   *h += conf.zoom_stars * (*h / conf.zoom_far - 1.);
+}
+
+
+#ifdef DEBUGGING
+/**
+ * @brief Gets the time in seconds, fine enough to time spawning a pilot.
+ */
+static double space_time (void)
+{
+#if HAS_POSIX
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.;
+#else /* HAS_POSIX */
+   return (double)SDL_GetTicks() / 1000.;
+#endif /* HAS_POSIX */
 }
+#endif /* DEBUGGING */
 
 
 /**
@@ -729,6 +835,10 @@ void space_init ( const char* sysname )
 {
    char* nt;
    int i;
+#ifdef DEBUGGING
+   int n;
+   double t;
+#endif /* DEBUGGING */
 
    /* cleanup some stuff */
    player_clear(); /* clears targets */
@@ -736,6 +846,7 @@ void space_init ( const char* sysname )
    pilots_clean(); /* destroy all the current pilots, except player */
    weapon_clear(); /* get rid of all the weapons */
    spfx_clear(); /* get rid of the explosions */
+   expl_clear(); /* get rid of pending explosion damage */
    space_spawn = 1; /* spawn is enabled by default. */
    interference_timer = 0.; /* Restart timer. */
 
@@ -792,10 +903,22 @@ void space_init ( const char* sysname )
    pilot_updateSensorRange();
 
    /* set up fleets -> pilots */
+#ifdef DEBUGGING
+   t = space_time();
+   n = pilot_nstack;
+#endif /* DEBUGGING */
    for (i=0; i < cur_system->nfleets; i++) {
       if (RNG(0,100) <= (cur_system->fleets[i].chance/2)) /* fleet check (50% chance) */
          space_addFleet( cur_system->fleets[i].fleet, 1 );
    }
+#ifdef DEBUGGING
+   /* Spawn cost, to keep an eye on system entry hitches. */
+   n = pilot_nstack - n;
+   t = (space_time() - t) * 1000.;
+   if (n > 0)
+      DEBUG("Spawned %d pilots in %.3f ms (%.3f ms per pilot)",
+            n, t, t / (double)n );
+#endif /* DEBUGGING */
 
    /* start the spawn timer */
    spawn_timer = -1.;
@@ -1688,6 +1811,128 @@ void space_renderOverlay( const double dt )
 }
 
 
+/**
+ * @brief Builds the vertices of the vertex program from the star positions.
+ *
+ *    @return Newly allocated vertices, 8 floats per star.
+ */
+static GLfloat* space_starsShaderData (void)
+{
+   unsigned int i;
+   GLfloat *data;
+
+   data = malloc( nstars * sizeof(GLfloat) * 8 );
+   for (i=0; i < nstars; i++) {
+      data[8*i+0] = star_vertex[4*i+0];
+      data[8*i+1] = star_vertex[4*i+1];
+      data[8*i+2] = star_colour[8*i+3];
+      data[8*i+3] = 0.;
+      data[8*i+4] = star_vertex[4*i+0];
+      data[8*i+5] = star_vertex[4*i+1];
+      data[8*i+6] = star_colour[8*i+3];
+      data[8*i+7] = 1.;
+   }
+   return data;
+}
+
+
+/**
+ * @brief Keeps the distance travelled within the star buffer.
+ *
+ * The offset is a float on the GPU and loses precision as it grows, so whole
+ *  star buffers are taken out of it.  Dimmer stars scroll slower, so each
+ *  star is moved by its share of what was taken out and nothing on screen
+ *  changes.
+ *
+ *    @param w Width of the star buffer.
+ *    @param h Height of the star buffer.
+ */
+static void space_starsWrap( GLfloat w, GLfloat h )
+{
+   unsigned int i;
+   double dx, dy, b, x, y;
+   GLfloat *data;
+
+   dx = star_x - fmod( star_x, w );
+   dy = star_y - fmod( star_y, h );
+   if ((dx == 0.) && (dy == 0.))
+      return;
+   star_x -= dx;
+   star_y -= dy;
+
+   for (i=0; i < nstars; i++) {
+      b = 9. - 10.*star_colour[8*i+3];
+      x = fmod( star_vertex[4*i+0] - dx/b + w/2., w );
+      y = fmod( star_vertex[4*i+1] - dy/b + h/2., h );
+      star_vertex[4*i+0] = ((x < 0.) ? x+w : x) - w/2.;
+      star_vertex[4*i+1] = ((y < 0.) ? y+h : y) - h/2.;
+   }
+
+   data = space_starsShaderData();
+   gl_vboSubData( star_shaderVBO, 0, nstars * sizeof(GLfloat) * 8, data );
+   free(data);
+}
+
+
+/**
+ * @brief Renders the stars with the vertex program.
+ *
+ * The CPU only keeps track of how far the player has travelled, scrolling,
+ *  wrapping and the hyperspace streaks are done on the GPU.
+ *
+ *    @param dt Current delta tick.
+ */
+static void space_renderStarsProgram( const double dt )
+{
+   GLfloat w, h, m, x, y;
+
+   space_starDims( &w, &h );
+   x = y = 0.;
+
+   if ((player != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
+         !player_isFlag(PLAYER_CREATING) &&
+         pilot_isFlag(player,PILOT_HYPERSPACE) && /* hyperspace fancy effects */
+         (player->ptimer < HYPERSPACE_STARS_BLUR)) {
+
+      /* lines will be based on velocity */
+      m  = HYPERSPACE_STARS_BLUR-player->ptimer;
+      m /= HYPERSPACE_STARS_BLUR;
+      m *= HYPERSPACE_STARS_LENGTH;
+      x = m*cos(VANGLE(player->solid->vel)+M_PI);
+      y = m*sin(VANGLE(player->solid->vel)+M_PI);
+   }
+   else if (!paused && (player != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
+         !player_isFlag(PLAYER_CREATING)) { /* update position */
+      star_x += player->solid->vel.x * dt;
+      star_y += player->solid->vel.y * dt;
+      space_starsWrap( w, h );
+   }
+
+   nglUseProgram( star_program );
+   nglUniform2f( star_uOffset, star_x, star_y );
+   nglUniform2f( star_uDims, w, h );
+   nglUniform2f( star_uStreak, x, y );
+
+   if ((x != 0.) || (y != 0.)) {
+      glShadeModel(GL_SMOOTH);
+      gl_vboActivate( star_shaderVBO, GL_VERTEX_ARRAY, 4, GL_FLOAT, 0 );
+      gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 0 );
+      glDrawArrays( GL_LINES, 0, 2*nstars );
+      glShadeModel(GL_FLAT);
+   }
+   else {
+      /* Skip the streak tails. */
+      gl_vboActivate( star_shaderVBO, GL_VERTEX_ARRAY, 4, GL_FLOAT, 8 * sizeof(GLfloat) );
+      gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 8 * sizeof(GLfloat) );
+      glDrawArrays( GL_POINTS, 0, nstars );
+   }
+
+   gl_vboDeactivate();
+   nglUseProgram( 0 );
+   gl_checkErr();
+}
+
+
 /**
  * @brief Renders the starry background.
  *
@@ -1712,6 +1957,12 @@ void space_renderStars( const double dt )
    gl_matrixPush();
       gl_matrixScale( z, z );
 
+   if (star_program != 0) {
+      space_renderStarsProgram( dt );
+      gl_matrixPop();
+      return;
+   }
+
    if ((player != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
          !player_isFlag(PLAYER_CREATING) &&
          pilot_isFlag(player,PILOT_HYPERSPACE) && /* hyperspace fancy effects */
@@ -1746,10 +1997,7 @@ void space_renderStars( const double dt )
             !player_isFlag(PLAYER_CREATING)) { /* update position */
 
          /* Calculate some dimensions. */
-         w  = (SCREEN_W + 2.*STAR_BUF);
-         w += conf.zoom_stars * (w / conf.zoom_far - 1.);
-         h  = (SCREEN_H + 2.*STAR_BUF);
-         h += conf.zoom_stars * (h / conf.zoom_far - 1.);
+         space_starDims( &w, &h );
          hw = w/2.;
          hh = h/2.;
 
@@ -1779,8 +2027,8 @@ void space_renderStars( const double dt )
       }
 
       /* Render. */
-      gl_vboActivate( star_vertexVBO, GL_VERTEX_ARRAY, 2, GL_FLOAT, 2 * sizeof(GLfloat) );
-      gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 4 * sizeof(GLfloat) );
+      gl_vboActivate( star_vertexVBO, GL_VERTEX_ARRAY, 2, GL_FLOAT, 4 * sizeof(GLfloat) );
+      gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 8 * sizeof(GLfloat) );
       glDrawArrays( GL_POINTS, 0, nstars );
       gl_checkErr();
    }
@@ -1871,6 +2119,21 @@ void space_exit (void)
    }
    nstars = 0;
    mstars = 0;
+   if (star_vertexVBO != NULL) {
+      gl_vboDestroy( star_vertexVBO );
+      star_vertexVBO = NULL;
+   }
+   if (star_colourVBO != NULL) {
+      gl_vboDestroy( star_colourVBO );
+      star_colourVBO = NULL;
+   }
+   if (star_shaderVBO != NULL) {
+      gl_vboDestroy( star_shaderVBO );
+      star_shaderVBO = NULL;
+   }
+   gl_shaderDestroy( star_program );
+   star_program      = 0;
+   star_programTried = 0;
 }
 
 
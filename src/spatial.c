@@ -0,0 +1,257 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file spatial.c
+ *
+ * @brief Uniform grid spatial index for radius queries.
+ *
+ * Elements are hashed by the grid cell their center lies in.  A query walks
+ *  the cells overlapping the query circle grown by the largest element radius
+ *  so that large elements near a cell border are never missed.
+ */
+
+
+#include "spatial.h"
+
+#include "naev.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+
+#define SPATIAL_CHUNK      64 /**< Minimum allocation chunk. */
+#define SPATIAL_BUCKETS    16 /**< Minimum amount of buckets. */
+
+
+/*
+ * Prototypes.
+ */
+static int spatial_hash( const SpatialIndex *si, int cx, int cy );
+static int spatial_pushResult( SpatialIndex *si, int nres, int data );
+
+
+/**
+ * @brief Initializes an empty spatial index.
+ *
+ *    @param si Spatial index to initialize.
+ *    @param cell Width of a grid cell, should be on the order of the usual
+ *           query radius.
+ */
+void spatial_init( SpatialIndex *si, double cell )
+{
+   memset( si, 0, sizeof(SpatialIndex) );
+   si->cell = cell;
+}
+
+
+/**
+ * @brief Frees the memory used by a spatial index.
+ *
+ *    @param si Spatial index to free.
+ */
+void spatial_free( SpatialIndex *si )
+{
+   double cell;
+
+   free(si->data);
+   free(si->x);
+   free(si->y);
+   free(si->r);
+   free(si->cx);
+   free(si->cy);
+   free(si->order);
+   free(si->start);
+   free(si->res);
+
+   /* Keep it usable. */
+   cell = si->cell;
+   spatial_init( si, cell );
+}
+
+
+/**
+ * @brief Removes all the elements from a spatial index.
+ *
+ *    @param si Spatial index to clear.
+ */
+void spatial_clear( SpatialIndex *si )
+{
+   si->n        = 0;
+   si->nbuckets = 0;
+   si->maxr     = 0.;
+}
+
+
+/**
+ * @brief Adds an element to a spatial index.
+ *
+ * The element is not visible to queries until spatial_build() is called.
+ *
+ *    @param si Spatial index to add to.
+ *    @param data User data to return in queries.
+ *    @param x X position of the element.
+ *    @param y Y position of the element.
+ *    @param r Radius of the element.
+ */
+void spatial_add( SpatialIndex *si, int data, double x, double y, double r )
+{
+   int n;
+
+   /* Grow memory. */
+   if (si->n >= si->mn) {
+      si->mn    = MAX( SPATIAL_CHUNK, 2*si->mn );
+      si->data  = realloc( si->data,  sizeof(int)    * si->mn );
+      si->x     = realloc( si->x,     sizeof(double) * si->mn );
+      si->y     = realloc( si->y,     sizeof(double) * si->mn );
+      si->r     = realloc( si->r,     sizeof(double) * si->mn );
+      si->cx    = realloc( si->cx,    sizeof(int)    * si->mn );
+      si->cy    = realloc( si->cy,    sizeof(int)    * si->mn );
+      si->order = realloc( si->order, sizeof(int)    * si->mn );
+   }
+
+   n = si->n++;
+   si->data[n] = data;
+   si->x[n]    = x;
+   si->y[n]    = y;
+   si->r[n]    = r;
+   si->cx[n]   = (int)floor( x / si->cell );
+   si->cy[n]   = (int)floor( y / si->cell );
+   si->maxr    = MAX( si->maxr, r );
+}
+
+
+/**
+ * @brief Gets the bucket of a grid cell.
+ */
+static int spatial_hash( const SpatialIndex *si, int cx, int cy )
+{
+   unsigned int h;
+   h = ((unsigned int)cx * 73856093U) ^ ((unsigned int)cy * 19349663U);
+   return (int)(h & (unsigned int)(si->nbuckets-1));
+}
+
+
+/**
+ * @brief Sorts the elements of a spatial index into buckets.
+ *
+ * Uses a counting sort so building is linear in the amount of elements.
+ *
+ *    @param si Spatial index to build.
+ */
+void spatial_build( SpatialIndex *si )
+{
+   int i, h;
+
+   /* Power of two buckets, around one per element. */
+   si->nbuckets = SPATIAL_BUCKETS;
+   while (si->nbuckets < si->n)
+      si->nbuckets <<= 1;
+   if (si->nbuckets+1 > si->mbuckets) {
+      si->mbuckets = si->nbuckets+1;
+      si->start    = realloc( si->start, sizeof(int) * si->mbuckets );
+   }
+
+   /* Count. */
+   memset( si->start, 0, sizeof(int) * (si->nbuckets+1) );
+   for (i=0; i<si->n; i++)
+      si->start[ spatial_hash( si, si->cx[i], si->cy[i] ) + 1 ]++;
+
+   /* Prefix sum. */
+   for (i=0; i<si->nbuckets; i++)
+      si->start[i+1] += si->start[i];
+
+   /* Scatter, start[h] is used as the insertion point and restored after. */
+   for (i=0; i<si->n; i++) {
+      h = spatial_hash( si, si->cx[i], si->cy[i] );
+      si->order[ si->start[h]++ ] = i;
+   }
+   for (i=si->nbuckets; i>0; i--)
+      si->start[i] = si->start[i-1];
+   si->start[0] = 0;
+}
+
+
+/**
+ * @brief Appends a result to the result buffer.
+ */
+static int spatial_pushResult( SpatialIndex *si, int nres, int data )
+{
+   if (nres >= si->mres) {
+      si->mres = MAX( SPATIAL_CHUNK, 2*si->mres );
+      si->res  = realloc( si->res, sizeof(int) * si->mres );
+   }
+   si->res[nres] = data;
+   return nres+1;
+}
+
+
+/**
+ * @brief Gets all the elements overlapping a circle.
+ *
+ * An element overlaps when the distance between its position and the center
+ *  of the query is below the sum of both radius.
+ *
+ *    @param si Spatial index to query.
+ *    @param x X position of the query center.
+ *    @param y Y position of the query center.
+ *    @param r Radius of the query.
+ *    @param[out] res Data of the overlapping elements, only valid until the
+ *                    next query.
+ *    @return Number of overlapping elements.
+ */
+int spatial_query( SpatialIndex *si, double x, double y, double r,
+      const int **res )
+{
+   int i, j, k, e, h;
+   int cx0, cx1, cy0, cy1;
+   int nres;
+   double qr, d;
+
+   nres = 0;
+   *res = si->res;
+   if (si->n == 0)
+      return 0;
+
+   /* Grow by the largest element so border elements are caught. */
+   qr  = r + si->maxr;
+   cx0 = (int)floor( (x-qr) / si->cell );
+   cx1 = (int)floor( (x+qr) / si->cell );
+   cy0 = (int)floor( (y-qr) / si->cell );
+   cy1 = (int)floor( (y+qr) / si->cell );
+
+   /* Huge query, cheaper to just check everything. */
+   if ((double)(cx1-cx0+1) * (double)(cy1-cy0+1) > (double)si->nbuckets) {
+      for (e=0; e<si->n; e++) {
+         d = r + si->r[e];
+         if (pow2(si->x[e]-x) + pow2(si->y[e]-y) < pow2(d))
+            nres = spatial_pushResult( si, nres, si->data[e] );
+      }
+      *res = si->res;
+      return nres;
+   }
+
+   for (i=cx0; i<=cx1; i++) {
+      for (j=cy0; j<=cy1; j++) {
+         h = spatial_hash( si, i, j );
+         for (k=si->start[h]; k<si->start[h+1]; k++) {
+            e = si->order[k];
+
+            /* Different cells can share a bucket, only report once. */
+            if ((si->cx[e] != i) || (si->cy[e] != j))
+               continue;
+
+            d = r + si->r[e];
+            if (pow2(si->x[e]-x) + pow2(si->y[e]-y) < pow2(d))
+               nres = spatial_pushResult( si, nres, si->data[e] );
+         }
+      }
+   }
+
+   *res = si->res;
+   return nres;
+}
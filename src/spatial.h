@@ -0,0 +1,60 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+
+#ifndef SPATIAL_H
+#  define SPATIAL_H
+
+
+/**
+ * @struct SpatialIndex
+ *
+ * @brief Uniform hashed grid used to answer radius queries over circles.
+ *
+ * Elements are added with spatial_add() and then spatial_build() sorts them
+ *  into buckets.  The index is meant to be rebuilt from scratch whenever the
+ *  elements move, memory is kept between builds.
+ */
+typedef struct SpatialIndex_ {
+   double cell; /**< Width of a grid cell. */
+   double maxr; /**< Largest radius of an element in the index. */
+
+   /* Elements. */
+   int n; /**< Number of elements. */
+   int mn; /**< Allocated elements. */
+   int *data; /**< User data of each element. */
+   double *x; /**< X position of each element. */
+   double *y; /**< Y position of each element. */
+   double *r; /**< Radius of each element. */
+   int *cx; /**< Grid cell X of each element. */
+   int *cy; /**< Grid cell Y of each element. */
+   int *order; /**< Elements sorted by bucket. */
+
+   /* Buckets. */
+   int nbuckets; /**< Number of buckets, always a power of two. */
+   int mbuckets; /**< Allocated buckets. */
+   int *start; /**< Offset of each bucket in order, has nbuckets+1 entries. */
+
+   /* Query results. */
+   int *res; /**< Result buffer. */
+   int mres; /**< Allocated results. */
+} SpatialIndex;
+
+
+/* Creation. */
+void spatial_init( SpatialIndex *si, double cell );
+void spatial_free( SpatialIndex *si );
+
+/* Building. */
+void spatial_clear( SpatialIndex *si );
+void spatial_add( SpatialIndex *si, int data, double x, double y, double r );
+void spatial_build( SpatialIndex *si );
+
+/* Querying. */
+int spatial_query( SpatialIndex *si, double x, double y, double r,
+      const int **res );
+
+
+#endif /* SPATIAL_H */
@@ -43,6 +43,8 @@
 #define SPFX_CHUNK_MAX  16384 /**< Maximum chunk to alloc when needed */
 #define SPFX_CHUNK_MIN  256 /**< Minimum chunk to alloc when needed */
 
+#define SPFX_VBO_MIN    256 /**< Minimum amount of effects to allocate render space for. */
+
 #define SHAKE_VEL_MOD   0.0008 /**< Shake modifier. */
 
 #define HAPTIC_UPDATE_INTERVAL   0.1 /**< Time between haptic updates. */
@@ -56,6 +58,7 @@ static double shake_rad = 0.; /**< Current shake radius (0 = no shake). */
 static Vector2d shake_pos = { .x = 0., .y = 0. }; /**< Current shake position. */
 static Vector2d shake_vel = { .x = 0., .y = 0. }; /**< Current shake velocity. */
 static int shake_off = 1; /**< 1 if shake is not active. */
+static RngStream shake_rng; /**< Shake direction, kept off the simulation's random numbers. */
 
 
 #if SDL_VERSION_ATLEAST(1,3,0)
@@ -110,13 +113,21 @@ static int spfx_nstack_back = 0; /**< Number of special effects in back. */
 static int spfx_mstack_back = 0; /**< Memory allocated for special effects in back. */
 
 
+/*
+ * Batched rendering, effects get sorted by type and each type is drawn at once.
+ */
+static gl_vbo *spfx_vbo       = NULL; /**< VBO holding the vertices and texture coordinates. */
+static GLfloat *spfx_vertex   = NULL; /**< Vertex and texture data being built. */
+static int spfx_mvertex       = 0; /**< Amount of effects spfx_vertex can hold. */
+static int *spfx_batch        = NULL; /**< Per effect type batch positions. */
+
+
 /*
  * prototypes
  */
 /* General. */
 static int spfx_base_parse( SPFX_Base *temp, const xmlNodePtr parent );
 static void spfx_base_free( SPFX_Base *effect );
-static void spfx_destroy( SPFX *layer, int *nlayer, int spfx );
 static void spfx_update_layer( SPFX *layer, int *nlayer, const double dt );
 /* Haptic. */
 static int spfx_hapticInit (void);
@@ -216,6 +227,8 @@ int spfx_load (void)
    xmlNodePtr node;
    xmlDocPtr doc;
 
+   rng_streamInit( &shake_rng, "shake", 0, 0 );
+
    /* Load and read the data. */
    buf = ndata_read( SPFX_DATA, &bufsize );
    doc = xmlParseMemory( buf, bufsize );
@@ -250,6 +263,9 @@ int spfx_load (void)
    /* Shrink back to minimum - shouldn't change ever. */
    spfx_effects = realloc(spfx_effects, sizeof(SPFX_Base) * spfx_neffects);
 
+   /* Batch positions for rendering. */
+   spfx_batch = malloc( sizeof(int) * (spfx_neffects+1) );
+
    /* Clean up. */
    xmlFreeDoc(doc);
    free(buf);
@@ -283,6 +299,17 @@ void spfx_free (void)
    spfx_stack_back = NULL;
    spfx_mstack_back = 0;
 
+   /* Clean up rendering. */
+   if (spfx_vbo != NULL) {
+      gl_vboDestroy( spfx_vbo );
+      spfx_vbo = NULL;
+   }
+   free(spfx_vertex);
+   spfx_vertex  = NULL;
+   spfx_mvertex = 0;
+   free(spfx_batch);
+   spfx_batch   = NULL;
+
    /* now clear the effects */
    for (i=0; i<spfx_neffects; i++)
       spfx_base_free( &spfx_effects[i] );
@@ -310,7 +337,7 @@ void spfx_add( int effect,
    SPFX *cur_spfx;
    double ttl, anim;
 
-   if ((effect < 0) || (effect > spfx_neffects)) {
+   if ((effect < 0) || (effect >= spfx_neffects)) {
       WARN("Trying to add spfx with invalid effect!");
       return;
    }
@@ -364,15 +391,9 @@ void spfx_add( int effect,
  */
 void spfx_clear (void)
 {
-   int i;
-
-   /* Clear front layer */
-   for (i=spfx_nstack_front-1; i>=0; i--)
-      spfx_destroy( spfx_stack_front, &spfx_nstack_front, i );
-
-   /* Clear back layer */
-   for (i=spfx_nstack_back-1; i>=0; i--)
-      spfx_destroy( spfx_stack_back, &spfx_nstack_back, i );
+   /* Clear the layers, effects don't own any memory. */
+   spfx_nstack_front = 0;
+   spfx_nstack_back  = 0;
 
    /* Clear rumble */
    shake_rad = 0.;
@@ -380,20 +401,6 @@ void spfx_clear (void)
    shake_vel.x = shake_vel.y = 0.;
 }
 
-/**
- * @brief Destroys an active spfx.
- *
- *    @param layer Layer the spfx is on.
- *    @param nlayer Pointer to the number of elements in the layer.
- *    @param spfx Position of the spfx in the stack.
- */
-static void spfx_destroy( SPFX *layer, int *nlayer, int spfx )
-{
-   (*nlayer)--;
-   memmove( &layer[spfx], &layer[spfx+1], (*nlayer-spfx)*sizeof(SPFX) );
-}
-
-
 /**
  * @brief Updates all the spfx.
  *
@@ -407,7 +414,10 @@ void spfx_update( const double dt )
 
 
 /**
- * @brief Updates an individual spfx.
+ * @brief Updates an individual spfx layer.
+ *
+ * Dead effects are compacted out in a single pass keeping the order of the
+ *  survivors.
  *
  *    @param layer Layer the spfx is on.
  *    @param nlayer Pointer to the assosciated nlayer.
@@ -415,21 +425,25 @@ void spfx_update( const double dt )
  */
 static void spfx_update_layer( SPFX *layer, int *nlayer, const double dt )
 {
-   int i;
+   int i, n;
 
+   n = 0;
    for (i=0; i<*nlayer; i++) {
       layer[i].timer -= dt; /* less time to live */
 
       /* time to die! */
-      if (layer[i].timer < 0.) {
-         spfx_destroy( layer, nlayer, i );
-         i--;
+      if (layer[i].timer < 0.)
          continue;
-      }
 
       /* actually update it */
       vect_cadd( &layer[i].pos, dt*VX(layer[i].vel), dt*VY(layer[i].vel) );
+
+      /* Keep it. */
+      if (n != i)
+         layer[n] = layer[i];
+      n++;
    }
+   *nlayer = n;
 }
 
 
@@ -469,7 +483,7 @@ void spfx_begin( const double dt )
          if (VMOD(shake_pos) > shake_rad) { /* change direction */
             vect_pset( &shake_pos, shake_rad, VANGLE(shake_pos) );
             vect_pset( &shake_vel, SHAKE_VEL_MOD*shake_rad, 
-                  -VANGLE(shake_pos) + (RNGF()-0.5) * M_PI );
+                  -VANGLE(shake_pos) + (RNGSF(&shake_rng)-0.5) * M_PI );
          }
 
          /* the shake decays over time */
@@ -528,7 +542,7 @@ void spfx_shake( double mod )
    shake_rad += mod;
    if (shake_rad > SHAKE_MAX)
       shake_rad = SHAKE_MAX;
-   vect_pset( &shake_vel, SHAKE_VEL_MOD*shake_rad, RNGF() * 2. * M_PI );
+   vect_pset( &shake_vel, SHAKE_VEL_MOD*shake_rad, RNGSF(&shake_rng) * 2. * M_PI );
 
    /* Rumble if it wasn't rumbling before. */
    spfx_hapticRumble(mod);
@@ -658,15 +672,20 @@ void spfx_cinematic (void)
 /**
  * @brief Renders the entire spfx layer.
  *
+ * Effects are bucketed by type so that each type gets drawn with a single
+ *  draw call.
+ *
  *    @param layer Layer to render.
  */
 void spfx_render( const int layer )
 {
    SPFX *spfx_stack;
-   int i, spfx_nstack;
+   int i, j, n, spfx_nstack;
    SPFX_Base *effect;
+   glTexture *gfx;
    int sx, sy;
-   double time;
+   double time, x, y, w, h, tx, ty, z;
+   GLfloat *vertex, *tex;
 
    
    /* get the appropriate layer */
@@ -686,25 +705,117 @@ void spfx_render( const int layer )
          return;
    }
 
-   /* Now render the layer */
+   /* Nothing to do. */
+   if (spfx_nstack == 0)
+      return;
+
+   /* Make sure there's room, 6 vertices with 2 vertex and 2 texture coords each. */
+   if (spfx_mvertex < spfx_nstack) {
+      spfx_mvertex = MAX( spfx_mvertex, SPFX_VBO_MIN );
+      while (spfx_mvertex < spfx_nstack)
+         spfx_mvertex *= 2;
+      spfx_vertex = realloc( spfx_vertex, sizeof(GLfloat) * spfx_mvertex * 6*(2+2) );
+      if (spfx_vbo == NULL)
+         spfx_vbo = gl_vboCreateStream( sizeof(GLfloat) * spfx_mvertex * 6*(2+2), NULL );
+      else
+         gl_vboData( spfx_vbo, sizeof(GLfloat) * spfx_mvertex * 6*(2+2), NULL );
+   }
+   vertex = &spfx_vertex[ 0 ];
+   tex    = &spfx_vertex[ spfx_mvertex * 6*2 ];
+   gl_cameraZoomGet( &z );
+
+   /* First pass counts the visible effects of each type. */
+   memset( spfx_batch, 0, sizeof(int) * (spfx_neffects+1) );
    for (i=spfx_nstack-1; i>=0; i--) {
       effect = &spfx_effects[ spfx_stack[i].effect ];
+      gfx    = effect->gfx;
 
       /* Simplifies */
-      sx = (int)effect->gfx->sx;
-      sy = (int)effect->gfx->sy;
+      sx = (int)gfx->sx;
+      sy = (int)gfx->sy;
 
       if (!paused) { /* don't calculate frame if paused */
          time = fmod(spfx_stack[i].timer,effect->anim) / effect->anim;
          spfx_stack[i].lastframe = sx * sy * MIN(time, 1.);
       }
-      
-      /* Renders */
-      gl_blitSprite( effect->gfx, 
-            VX(spfx_stack[i].pos), VY(spfx_stack[i].pos),
-            spfx_stack[i].lastframe % sx,
-            spfx_stack[i].lastframe / sx,
-            NULL );
+
+      /* Check if inbounds. */
+      gl_gameToScreenCoords( &x, &y, VX(spfx_stack[i].pos) - gfx->sw/2.,
+            VY(spfx_stack[i].pos) - gfx->sh/2. );
+      w = gfx->sw*z;
+      h = gfx->sh*z;
+      if ((fabs(x) > SCREEN_W/2 + w) || (fabs(y) > SCREEN_H/2 + h))
+         continue;
+
+      spfx_batch[ spfx_stack[i].effect+1 ]++;
    }
+
+   /* Turn counts into batch positions. */
+   for (i=0; i<spfx_neffects; i++)
+      spfx_batch[i+1] += spfx_batch[i];
+
+   /* Second pass builds the geometry. */
+   for (i=spfx_nstack-1; i>=0; i--) {
+      effect = &spfx_effects[ spfx_stack[i].effect ];
+      gfx    = effect->gfx;
+      sx     = (int)gfx->sx;
+
+      gl_gameToScreenCoords( &x, &y, VX(spfx_stack[i].pos) - gfx->sw/2.,
+            VY(spfx_stack[i].pos) - gfx->sh/2. );
+      w = gfx->sw*z;
+      h = gfx->sh*z;
+      if ((fabs(x) > SCREEN_W/2 + w) || (fabs(y) > SCREEN_H/2 + h))
+         continue;
+
+      /* Texture coords. */
+      tx = gfx->sw*(double)(spfx_stack[i].lastframe % sx)/gfx->rw;
+      ty = gfx->sh*(gfx->sy-(double)(spfx_stack[i].lastframe / sx)-1)/gfx->rh;
+
+      /* Two triangles. */
+      j = 12 * spfx_batch[ spfx_stack[i].effect ]++;
+      vertex[j+0]  = x;          tex[j+0]  = tx;
+      vertex[j+1]  = y;          tex[j+1]  = ty;
+      vertex[j+2]  = x + w;      tex[j+2]  = tx + gfx->srw;
+      vertex[j+3]  = y;          tex[j+3]  = ty;
+      vertex[j+4]  = x;          tex[j+4]  = tx;
+      vertex[j+5]  = y + h;      tex[j+5]  = ty + gfx->srh;
+      vertex[j+6]  = x + w;      tex[j+6]  = tx + gfx->srw;
+      vertex[j+7]  = y;          tex[j+7]  = ty;
+      vertex[j+8]  = x + w;      tex[j+8]  = tx + gfx->srw;
+      vertex[j+9]  = y + h;      tex[j+9]  = ty + gfx->srh;
+      vertex[j+10] = x;          tex[j+10] = tx;
+      vertex[j+11] = y + h;      tex[j+11] = ty + gfx->srh;
+   }
+
+   /* Batch positions are now the batch ends. */
+   n = spfx_batch[ spfx_neffects-1 ];
+   if (n == 0)
+      return;
+
+   /* Upload. */
+   gl_vboSubData( spfx_vbo, 0, sizeof(GLfloat) * n*12, vertex );
+   gl_vboSubData( spfx_vbo, sizeof(GLfloat) * spfx_mvertex*12, sizeof(GLfloat) * n*12, tex );
+   gl_vboActivateOffset( spfx_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( spfx_vbo, GL_TEXTURE_COORD_ARRAY,
+         sizeof(GLfloat) * spfx_mvertex*12, 2, GL_FLOAT, 0 );
+
+   /* Draw each type at once. */
+   glEnable(GL_TEXTURE_2D);
+   COLOUR(cWhite);
+   j = 0;
+   for (i=0; i<spfx_neffects; i++) {
+      if (spfx_batch[i] == j)
+         continue;
+      glBindTexture( GL_TEXTURE_2D, spfx_effects[i].gfx->texture );
+      glDrawArrays( GL_TRIANGLES, 6*j, 6*(spfx_batch[i]-j) );
+      j = spfx_batch[i];
+   }
+
+   /* Clear state. */
+   gl_vboDeactivate();
+   glDisable(GL_TEXTURE_2D);
+
+   /* anything failed? */
+   gl_checkErr();
 }
 
@@ -61,6 +61,7 @@ typedef enum WidgetStatus_ {
 #define WGT_FLAG_CANFOCUS     (1<<0)   /**< Widget can get focus. */
 #define WGT_FLAG_RAWINPUT     (1<<1)   /**< Widget should always get raw input. */
 #define WGT_FLAG_ALWAYSMMOVE  (1<<2)   /**< Widget should always get mouse motion events. */
+#define WGT_FLAG_LIVE         (1<<3)   /**< Widget is drawn every frame instead of from the window cache. */
 #define WGT_FLAG_KILL         (1<<9)   /**< Widget should die. */
 #define wgt_setFlag(w,f)      ((w)->flags |= (f)) /**< Sets a widget flag. */
 #define wgt_rmFlag(w,f)       ((w)->flags &= ~(f)) /**< Removes a widget flag. */
@@ -128,6 +129,7 @@ typedef struct Widget_ {
 #define WINDOW_NORENDER    (1<<2) /**< Window does not render even if it should. */
 #define WINDOW_NOBORDER    (1<<3) /**< Window does not need border. */
 #define WINDOW_FULLSCREEN  (1<<4) /**< Window is fullscreen. */
+#define WINDOW_NOCACHE     (1<<5) /**< Window can not be rendered into a cache. */
 #define WINDOW_KILL        (1<<9) /**< Window should die. */
 #define window_isFlag(w,f) ((w)->flags & (f)) /**< Checks a window flag. */
 #define window_setFlag(w,f) ((w)->flags |= (f)) /**< Sets a window flag. */
@@ -163,6 +165,11 @@ typedef struct Window_ {
 
    int focus; /**< Current focused widget. */
    Widget *widgets; /**< Widget storage. */
+
+   /* Render cache. */
+   int dirty; /**< Cache must be redrawn. */
+   GLuint fbo; /**< Framebuffer rendering into the cache, 0 if none. */
+   glTexture *cache; /**< Border and static widgets of the window. */
 } Window;
 
 
@@ -171,6 +178,7 @@ Window* toolkit_getActiveWindow (void);
 Window* window_wget( const unsigned int wid );
 int toolkit_inputWindow( Window *wdw, SDL_Event *event, int purge );
 void window_render( Window* w );
+void window_renderCached( Window* w );
 void window_renderOverlay( Window* w );
 
 
@@ -12,6 +12,16 @@
 #include "tk/toolkit_priv.h"
 
 
+/* Creation. */
+static Widget* iar_create( const unsigned int wid,
+      const int x, const int y, const int w, const int h,
+      char* name, const int iw, const int ih, int nelem,
+      void (*call) (unsigned int,char*),
+      void (*rmcall) (unsigned int,char*) );
+/* Elements. */
+static glTexture* iar_getImage( Widget* iar, int elem );
+static const char* iar_getCaption( Widget* iar, int elem );
+static const char* iar_getQuantity( Widget* iar, int elem, char *buf, int len );
 /* Render. */
 static void iar_render( Widget* iar, double bx, double by );
 static void iar_renderOverlay( Widget* iar, double bx, double by );
@@ -58,11 +68,70 @@ void window_addImageArray( const unsigned int wid,
                            glTexture** tex, char** caption, int nelem,
                            void (*call) (unsigned int wdw, char* wgtname),
                            void (*rmcall) (unsigned int wdw, char* wgtname) )
+{
+   Widget *wgt = iar_create( wid, x, y, w, h, name, iw, ih, nelem,
+         call, rmcall );
+   if (wgt == NULL)
+      return;
+
+   wgt->dat.iar.images     = tex;
+   wgt->dat.iar.captions   = caption;
+}
+
+
+/**
+ * @brief Adds a virtualized Image Array widget.
+ *
+ * Instead of taking ownership of arrays of elements, the elements are fetched
+ *  from the data source only when they are drawn or queried.  Opening it does
+ *  not depend on the number of elements.
+ *
+ *    @param wid Window to add to.
+ *    @param x X position.
+ *    @param y Y position.
+ *    @param w Width.
+ *    @param h Height.
+ *    @param name Internal widget name.
+ *    @param iw Image width to use.
+ *    @param ih Image height to use.
+ *    @param src Data source to use (copied, data is freed with src->free).
+ *    @param nelem Elements in the data source.
+ *    @param call Callback when modified.
+ *    @param rmcall Callback when right clicked.
+ */
+void window_addImageArraySource( const unsigned int wid,
+      const int x, const int y, /* position */
+      const int w, const int h, /* size */
+      char* name, const int iw, const int ih,
+      const ImageArraySource *src, int nelem,
+      void (*call) (unsigned int wdw, char* wgtname),
+      void (*rmcall) (unsigned int wdw, char* wgtname) )
+{
+   Widget *wgt = iar_create( wid, x, y, w, h, name, iw, ih, nelem,
+         call, rmcall );
+   if (wgt == NULL) {
+      if (src->free != NULL)
+         src->free( src->data );
+      return;
+   }
+
+   wgt->dat.iar.src        = *src;
+}
+
+
+/**
+ * @brief Creates the common part of an Image Array widget.
+ */
+static Widget* iar_create( const unsigned int wid,
+      const int x, const int y, const int w, const int h,
+      char* name, const int iw, const int ih, int nelem,
+      void (*call) (unsigned int,char*),
+      void (*rmcall) (unsigned int,char*) )
 {
    Window *wdw = window_wget(wid);
    Widget *wgt = window_newWidget(wdw, name);
    if (wgt == NULL)
-      return;
+      return NULL;
 
    /* generic */
    wgt->type   = WIDGET_IMAGEARRAY;
@@ -81,8 +150,6 @@ void window_addImageArray( const unsigned int wid,
    wgt->mclickevent        = iar_mclick;
    wgt->mmoveevent         = iar_mmove;
    wgt_setFlag(wgt, WGT_FLAG_ALWAYSMMOVE);
-   wgt->dat.iar.images     = tex;
-   wgt->dat.iar.captions   = caption;
    wgt->dat.iar.nelements  = nelem;
    wgt->dat.iar.selected   = 0;
    wgt->dat.iar.pos        = 0;
@@ -97,6 +164,54 @@ void window_addImageArray( const unsigned int wid,
 
    if (wdw->focus == -1) /* initialize the focus */
       toolkit_nextFocus( wdw );
+
+   return wgt;
+}
+
+
+/**
+ * @brief Gets the image of an element.
+ */
+static glTexture* iar_getImage( Widget* iar, int elem )
+{
+   if (iar->dat.iar.src.image != NULL)
+      return iar->dat.iar.src.image( iar->dat.iar.src.data, elem );
+   if (iar->dat.iar.images == NULL)
+      return NULL;
+   return iar->dat.iar.images[elem];
+}
+
+
+/**
+ * @brief Gets the caption of an element.
+ */
+static const char* iar_getCaption( Widget* iar, int elem )
+{
+   if (iar->dat.iar.src.caption != NULL)
+      return iar->dat.iar.src.caption( iar->dat.iar.src.data, elem );
+   if (iar->dat.iar.captions == NULL)
+      return NULL;
+   return iar->dat.iar.captions[elem];
+}
+
+
+/**
+ * @brief Gets the quantity text of an element.
+ *
+ *    @param iar Image array to get quantity of.
+ *    @param elem Element to get quantity of.
+ *    @param buf Buffer the data source can write to.
+ *    @param len Length of buf.
+ *    @return The quantity text or NULL if there is none.
+ */
+static const char* iar_getQuantity( Widget* iar, int elem, char *buf, int len )
+{
+   if (iar->dat.iar.quantity != NULL)
+      return iar->dat.iar.quantity[elem];
+   if ((iar->dat.iar.src.quantity != NULL) &&
+         iar->dat.iar.src.quantity( iar->dat.iar.src.data, elem, buf, len ))
+      return buf;
+   return NULL;
 }
 
 
@@ -125,11 +240,15 @@ static void iar_render( Widget* iar, double bx, double by )
    double x,y, w,h, xcurs,ycurs;
    double scroll_pos;
    int xelem, yelem;
+   int jstart, jend;
    double xspace;
    glColour *c, *dc, *lc, tc;
    int is_selected;
    int tw;
    double d;
+   glTexture *image;
+   const char *caption, *quantity;
+   char buf[32];
 
    /*
     * Calculations.
@@ -160,11 +279,13 @@ static void iar_render( Widget* iar, double bx, double by )
    toolkit_drawScrollbar( x + iar->w - 10., y, 10., iar->h, scroll_pos );
 
    /*
-    * Main drawing loop.
+    * Main drawing loop, only goes over the visible rows.
     */
+   jstart = MAX( 0, (int)floor( iar->dat.iar.pos / h ) );
+   jend   = MIN( yelem, (int)ceil( (iar->dat.iar.pos + iar->h) / h ) + 1 );
    toolkit_clip( x, y, iar->w, iar->h );
-   ycurs = y + iar->h + (double)SCREEN_H/2. - h + iar->dat.iar.pos;
-   for (j=0; j<yelem; j++) {
+   ycurs = y + iar->h + (double)SCREEN_H/2. - h + iar->dat.iar.pos - jstart*h;
+   for (j=jstart; j<jend; j++) {
       xcurs = x + xspace + (double)SCREEN_W/2.;
       for (i=0; i<xelem; i++) {
 
@@ -183,35 +304,34 @@ static void iar_render( Widget* iar, double bx, double by )
                   w - 4., h - 4., &cDConsole, NULL );
 
          /* image */
-         if (iar->dat.iar.images[pos] != NULL)
-            gl_blitScale( iar->dat.iar.images[pos],
+         image = iar_getImage( iar, pos );
+         if (image != NULL)
+            gl_blitScale( image,
                   xcurs + 5., ycurs + gl_smallFont.h + 7.,
                   iar->dat.iar.iw, iar->dat.iar.ih, NULL );
 
          /* caption */
-         if (iar->dat.iar.captions[pos] != NULL)
+         caption = iar_getCaption( iar, pos );
+         if (caption != NULL)
             gl_printMidRaw( &gl_smallFont, iar->dat.iar.iw, xcurs + 5., ycurs + 5.,
-                     (is_selected) ? &cBlack : &cWhite,
-                     iar->dat.iar.captions[pos] );
+                     (is_selected) ? &cBlack : &cWhite, caption );
 
          /* quantity. */
-         if (iar->dat.iar.quantity != NULL) {
-            if (iar->dat.iar.quantity[pos] != NULL) {
-               /* Rectangle to hilight better. */
-               tw = gl_printWidthRaw( &gl_smallFont,
-                     iar->dat.iar.quantity[pos] );
-               tc.r = cBlack.r;
-               tc.g = cBlack.g;
-               tc.b = cBlack.b;
-               tc.a = 0.75;
-               toolkit_drawRect( xcurs-(double)SCREEN_W/2. + 3.,
-                     ycurs-(double)SCREEN_H/2. + 5. + iar->dat.iar.ih,
-                     tw + 4., gl_smallFont.h + 4., &tc, NULL );
-               /* Quantity number. */
-               gl_printMaxRaw( &gl_smallFont, iar->dat.iar.iw,
-                     xcurs + 5., ycurs + iar->dat.iar.ih + 7.,
-                     &cWhite, iar->dat.iar.quantity[pos] );
-            }
+         quantity = iar_getQuantity( iar, pos, buf, sizeof(buf) );
+         if (quantity != NULL) {
+            /* Rectangle to hilight better. */
+            tw = gl_printWidthRaw( &gl_smallFont, quantity );
+            tc.r = cBlack.r;
+            tc.g = cBlack.g;
+            tc.b = cBlack.b;
+            tc.a = 0.75;
+            toolkit_drawRect( xcurs-(double)SCREEN_W/2. + 3.,
+                  ycurs-(double)SCREEN_H/2. + 5. + iar->dat.iar.ih,
+                  tw + 4., gl_smallFont.h + 4., &tc, NULL );
+            /* Quantity number. */
+            gl_printMaxRaw( &gl_smallFont, iar->dat.iar.iw,
+                  xcurs + 5., ycurs + iar->dat.iar.ih + 7.,
+                  &cWhite, quantity );
          }
 
          /* outline */
@@ -438,9 +558,13 @@ static void iar_cleanup( Widget* iar )
 {
    int i;
 
+   /* Data source. */
+   if (iar->dat.iar.src.free != NULL)
+      iar->dat.iar.src.free( iar->dat.iar.src.data );
+
    if (iar->dat.iar.nelements > 0) { /* Free each text individually */
       for (i=0; i<iar->dat.iar.nelements; i++) {
-         if (iar->dat.iar.captions[i])
+         if (iar->dat.iar.captions && iar->dat.iar.captions[i])
             free(iar->dat.iar.captions[i]);
          if (iar->dat.iar.alts && iar->dat.iar.alts[i])
             free(iar->dat.iar.alts[i]);
@@ -448,8 +572,10 @@ static void iar_cleanup( Widget* iar )
             free(iar->dat.iar.quantity[i]);
       }  
       /* Free the arrays */
-      free( iar->dat.iar.captions );
-      free( iar->dat.iar.images );
+      if (iar->dat.iar.captions)
+         free( iar->dat.iar.captions );
+      if (iar->dat.iar.images)
+         free( iar->dat.iar.images );
       if (iar->dat.iar.alts)
          free(iar->dat.iar.alts);
       if (iar->dat.iar.quantity)
@@ -502,13 +628,9 @@ static void iar_scroll( Widget* iar, int direction )
 static int iar_focusImage( Widget* iar, double bx, double by )
 {
    int i,j;
-   double x,y, w,h, ycurs,xcurs;
+   double w,h, ycurs,xcurs;
    int xelem, xspace, yelem;
 
-   /* positions */
-   x = bx + iar->x;
-   y = by + iar->y;
-
    /* element dimensions */
    iar_getDim( iar, &w, &h );
 
@@ -518,23 +640,25 @@ static int iar_focusImage( Widget* iar, double bx, double by )
    xspace = (((int)iar->w - 10) % (int)w) / (xelem + 1);
    if (bx < iar->w - 10.) {
 
-      /* Loop through elements until finding collision. */
-      ycurs = iar->h - h + iar->dat.iar.pos;
-      for (j=0; j<yelem; j++) {
-         xcurs = xspace;
-         for (i=0; i<xelem; i++) {
-            /* Out of elements. */
-            if ((j*xelem + i) >= iar->dat.iar.nelements)
-               break;
-
-            /* Check for collision. */
-            if ((bx > xcurs) && (bx < xcurs+w-4.) &&
-                  (by > ycurs) && (by < ycurs+h-4.)) {
-               return j*xelem + i;
-            }
-            xcurs += xspace + w;
-         }
-         ycurs -= h;
+      /* Row under the mouse. */
+      j = (int)floor( (iar->h + iar->dat.iar.pos - by) / h );
+      if ((j < 0) || (j >= yelem))
+         return -1;
+      ycurs = iar->h - h + iar->dat.iar.pos - j*h;
+      if ((by <= ycurs) || (by >= ycurs+h-4.))
+         return -1;
+
+      /* Loop through the row until finding collision. */
+      xcurs = xspace;
+      for (i=0; i<xelem; i++) {
+         /* Out of elements. */
+         if ((j*xelem + i) >= iar->dat.iar.nelements)
+            break;
+
+         /* Check for collision. */
+         if ((bx > xcurs) && (bx < xcurs+w-4.))
+            return j*xelem + i;
+         xcurs += xspace + w;
       }
    }
 
@@ -630,10 +754,10 @@ static char* toolkit_getNameById( Widget *wgt, int elem )
       return NULL;
 
    /* Nothing selected. */
-   if (elem == -1)
+   if ((elem < 0) || (elem >= wgt->dat.iar.nelements))
       return NULL;
 
-   return wgt->dat.iar.captions[ elem ];
+   return (char*)iar_getCaption( wgt, elem );
 }
 
 
@@ -660,6 +784,7 @@ char* toolkit_getImageArray( const unsigned int wid, const char* name )
 int toolkit_setImageArray( const unsigned int wid, const char* name, char* elem )
 {
    int i;
+   const char *caption;
    Widget *wgt = iar_getWidget( wid, name );
    if (wgt == NULL)
       return -1;
@@ -672,7 +797,8 @@ int toolkit_setImageArray( const unsigned int wid, const char* name, char* elem
 
    /* Try to find the element. */
    for (i=0; i<wgt->dat.iar.nelements; i++) {
-      if (strcmp(elem,wgt->dat.iar.captions[i])==0) {
+      caption = iar_getCaption( wgt, i );
+      if ((caption != NULL) && (strcmp(elem,caption)==0)) {
          wgt->dat.iar.selected = i;
          return 0;
       }
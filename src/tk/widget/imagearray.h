@@ -13,6 +13,21 @@
 #include "colour.h"
 
 
+/**
+ * @brief Data source for a virtualized image array.
+ *
+ * Elements are only fetched when they are visible or queried, so the image
+ *  array does not need to hold a copy of a large catalogue.
+ */
+typedef struct ImageArraySource_ {
+   glTexture* (*image) (void *data, int elem); /**< Gets the image of an element. */
+   const char* (*caption) (void *data, int elem); /**< Gets the caption of an element. */
+   int (*quantity) (void *data, int elem, char *buf, int len); /**< Writes the quantity of an element, returns 0 if there is none (optional). */
+   void (*free) (void *data); /**< Frees the data when the widget is destroyed (optional). */
+   void *data; /**< Data passed to the functions. */
+} ImageArraySource;
+
+
 /**
  * @brief The image array widget data.
  */
@@ -21,6 +36,7 @@ typedef struct WidgetImageArrayData_ {
    char **captions; /**< Corresponding caption array. */
    char **alts; /**< Alt text when mouse over. */
    char **quantity; /**< Number in top-left corner. */
+   ImageArraySource src; /**< Data source, used instead of the arrays when set. */
    int nelements; /**< Number of elements. */
    int xelem; /**< Number of horizontal elements. */
    int yelem; /**< Number of vertical elements. */
@@ -44,6 +60,13 @@ void window_addImageArray( const unsigned int wid,
       glTexture** tex, char** caption, int nelem, /* elements */    
       void (*call) (unsigned int,char*), /* update callback */
       void (*rmcall) (unsigned int,char*) ); /* right click callback */
+void window_addImageArraySource( const unsigned int wid,
+      const int x, const int y, /* position */
+      const int w, const int h, /* size */
+      char* name, const int iw, const int ih, /* name and image sizes */
+      const ImageArraySource *src, int nelem, /* elements */
+      void (*call) (unsigned int,char*), /* update callback */
+      void (*rmcall) (unsigned int,char*) ); /* right click callback */
 
 /* Misc functions. */
 char* toolkit_getImageArray( const unsigned int wid, const char* name );
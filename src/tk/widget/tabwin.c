@@ -279,7 +279,7 @@ static void tab_render( Widget* tab, double bx, double by )
    }
 
    /* Render the active window. */
-   window_render( wdw );
+   window_renderCached( wdw );
 
    /* Render tabs ontop. */
    x = 20;
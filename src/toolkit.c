@@ -14,6 +14,7 @@
 #include "naev.h"
 
 #include <stdarg.h>
+#include <math.h>
 
 #include "tk/toolkit_priv.h"
 
@@ -24,6 +25,7 @@
 #include "nstd.h"
 #include "dialogue.h"
 #include "conf.h"
+#include "replay.h"
 
 
 #define INPUT_DELAY      conf.repeat_delay /**< Delay before starting to repeat. */
@@ -69,6 +71,15 @@ static gl_vbo *toolkit_vbo; /**< Toolkit VBO. */
 static GLsizei toolkit_vboColourOffset; /**< Colour offset. */
 
 
+/*
+ * Render cache.
+ */
+static int toolkit_wgtDraws      = 0; /**< Widgets drawn so far this frame. */
+static int toolkit_wgtDrawsLast  = 0; /**< Widgets drawn last frame. */
+static double toolkit_clipX      = 0.; /**< X offset in pixels of the render target. */
+static double toolkit_clipY      = 0.; /**< Y offset in pixels of the render target. */
+
+
 /*
  * static prototypes
  */
@@ -82,6 +93,16 @@ static int toolkit_isFocusable( Widget *wgt );
 static Widget* toolkit_getFocus( Window *wdw );
 /* render */
 static void window_renderBorder( Window* w );
+static void window_renderFocus( Window *w, double x, double y );
+static void widget_render( Widget *wgt, double x, double y );
+static int widget_isDynamic( Widget *wgt );
+static int widget_overlaps( Widget *a, Widget *b );
+/* render cache */
+static int toolkit_hasCache (void);
+static int window_cacheCreate( Window *w );
+static void window_cacheFree( Window *w );
+static void window_cacheSort( Window *w );
+static void window_cacheUpdate( Window *w );
 /* Death. */
 static void widget_kill( Widget *wgt );
 static void window_kill( Window *wdw );
@@ -118,6 +139,8 @@ void toolkit_delay (void)
  */
 void toolkit_setPos( Window *wdw, Widget *wgt, int x, int y )
 {
+   wdw->dirty = 1;
+
    /* X position. */
    if (x < 0)
       wgt->x = wdw->w - wgt->w + x;
@@ -145,6 +168,7 @@ Widget* window_newWidget( Window* w, const char *name )
    /* NULL protection. */
    if (w==NULL)
       return NULL;
+   w->dirty = 1;
 
    /* Try to find one with the same name first. */
    wlast = NULL;
@@ -220,6 +244,9 @@ Window* window_wget( const unsigned int wid )
 /**
  * @brief Gets a widget from window id and widgetname.
  *
+ * Everything that modifies a widget from outside of the toolkit goes through
+ *  here, so the window is marked as needing to be redrawn.
+ *
  *    @param wid ID of the window to get widget from.
  *    @param name Name of the widget to get.
  *    @return Widget matching name in the window.
@@ -233,6 +260,7 @@ Widget* window_getwgt( const unsigned int wid, const char* name )
    wdw = window_wget(wid);
    if (wdw == NULL)
       return NULL;
+   wdw->dirty = 1;
 
    /* Find the widget. */
    for (wgt=wdw->widgets; wgt!=NULL; wgt=wgt->next)
@@ -667,6 +695,7 @@ static void window_kill( Window *wdw )
       wdw->close_fptr( wdw->id, wdw->name);
 
    /* Destroy the window. */
+   window_cacheFree( wdw );
    if (wdw->name)
       free(wdw->name);
    wgt = wdw->widgets;
@@ -742,6 +771,7 @@ void window_destroyWidget( unsigned int wid, const char* wgtname )
       wdw->focus = -1;
 
    /* There's dead stuff now. */
+   wdw->dirty  = 1;
    window_dead = 1;
    wgt_setFlag( wgt, WGT_FLAG_KILL );
 }
@@ -929,8 +959,8 @@ void toolkit_drawAltText( int bx, int by, const char *alt )
 void toolkit_clip( int x, int y, int w, int h )
 {
    double rx, ry, rw, rh;
-   rx = (x + (double)SCREEN_W/2) / gl_screen.mxscale;
-   ry = (y + (double)SCREEN_H/2) / gl_screen.myscale;
+   rx = (x + (double)SCREEN_W/2) / gl_screen.mxscale - toolkit_clipX;
+   ry = (y + (double)SCREEN_H/2) / gl_screen.myscale - toolkit_clipY;
    rw = w / gl_screen.mxscale;
    rh = h / gl_screen.myscale;
    glScissor( rx, ry, rw, rh );
@@ -1297,6 +1327,73 @@ static void window_renderBorder( Window* w )
 }
 
 
+/**
+ * @brief Renders a widget.
+ *
+ *    @param wgt Widget to render.
+ *    @param x X position of the window.
+ *    @param y Y position of the window.
+ */
+static void widget_render( Widget *wgt, double x, double y )
+{
+   if (wgt->render == NULL)
+      return;
+   wgt->render( wgt, x, y );
+   toolkit_wgtDraws++;
+}
+
+
+/**
+ * @brief Checks to see if a widget must be redrawn every frame.
+ *
+ * Custom widgets draw whatever they want and tabbed windows draw their active
+ *  window, so neither can be cached.
+ *
+ *    @param wgt Widget to check.
+ *    @return 1 if the widget is animated.
+ */
+static int widget_isDynamic( Widget *wgt )
+{
+   return ((wgt->type == WIDGET_CUST) ||
+         (wgt->type == WIDGET_TABBEDWINDOW));
+}
+
+
+/**
+ * @brief Checks to see if two widgets overlap.
+ *
+ *    @param a Widget to check.
+ *    @param b Widget to check against.
+ *    @return 1 if they overlap.
+ */
+static int widget_overlaps( Widget *a, Widget *b )
+{
+   return ((a->x < b->x + b->w) && (b->x < a->x + a->w) &&
+         (a->y < b->y + b->h) && (b->y < a->y + a->h));
+}
+
+
+/**
+ * @brief Renders the outline of the focused widget.
+ *
+ *    @param w Window to render focus of.
+ *    @param x X position of the window.
+ *    @param y Y position of the window.
+ */
+static void window_renderFocus( Window *w, double x, double y )
+{
+   Widget *wgt;
+
+   if (w->focus == -1)
+      return;
+
+   wgt = toolkit_getFocus( w );
+   if (wgt == NULL)
+      return;
+   toolkit_drawOutline( x+wgt->x, y+wgt->y, wgt->w, wgt->h, 3, &cBlack, NULL );
+}
+
+
 /**
  * @brief Renders a window.
  *
@@ -1304,7 +1401,7 @@ static void window_renderBorder( Window* w )
  */
 void window_render( Window *w )
 {
-   double x, y, wid, hei;
+   double x, y;
    Widget *wgt;
 
    /* position */
@@ -1319,25 +1416,238 @@ void window_render( Window *w )
     * widgets
     */
    for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next)
-      if (wgt->render != NULL)
-         wgt->render( wgt, x, y );
+      widget_render( wgt, x, y );
 
    /*
     * focused widget
     */
-   if (w->focus != -1) {
-      wgt = toolkit_getFocus( w );
-      if (wgt == NULL)
-         return;
-      x  += wgt->x;
-      y  += wgt->y;
-      wid = wgt->w;
-      hei = wgt->h;
-      toolkit_drawOutline( x, y, wid, hei, 3, &cBlack, NULL );
+   window_renderFocus( w, x, y );
+}
+
+
+/**
+ * @brief Checks to see if windows can be rendered into caches.
+ */
+static int toolkit_hasCache (void)
+{
+   return ((nglGenFramebuffers != NULL) && (nglBlendFuncSeparate != NULL));
+}
+
+
+/**
+ * @brief Creates the render cache of a window.
+ *
+ *    @param w Window to create cache of.
+ *    @return 0 on success.
+ */
+static int window_cacheCreate( Window *w )
+{
+   GLuint tex;
+   GLenum status;
+   int pw, ph, rw, rh;
+
+   /* Size in real pixels. */
+   pw = (int)ceil( w->w / gl_screen.mxscale );
+   ph = (int)ceil( w->h / gl_screen.myscale );
+   rw = gl_pot( pw );
+   rh = gl_pot( ph );
+
+   /* Create the texture. */
+   glGenTextures( 1, &tex );
+   glBindTexture( GL_TEXTURE_2D, tex );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, rw, rh, 0,
+         GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+
+   /* Attach it to the framebuffer. */
+   nglGenFramebuffers( 1, &w->fbo );
+   nglBindFramebuffer( GL_FRAMEBUFFER, w->fbo );
+   nglFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+         GL_TEXTURE_2D, tex, 0 );
+   status = nglCheckFramebufferStatus( GL_FRAMEBUFFER );
+   nglBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   if (status != GL_FRAMEBUFFER_COMPLETE) {
+      WARN("Unable to create render cache for window '%s'.", w->name);
+      nglDeleteFramebuffers( 1, &w->fbo );
+      glDeleteTextures( 1, &tex );
+      w->fbo = 0;
+      window_setFlag( w, WINDOW_NOCACHE );
+      gl_checkErr();
+      return -1;
+   }
+
+   /* Texture to blit, covers whole pixels. */
+   w->cache          = calloc( 1, sizeof(glTexture) );
+   w->cache->texture = tex;
+   w->cache->w       = pw * gl_screen.mxscale;
+   w->cache->h       = ph * gl_screen.myscale;
+   w->cache->rw      = rw;
+   w->cache->rh      = rh;
+   w->cache->sx      = 1.;
+   w->cache->sy      = 1.;
+   w->cache->sw      = w->cache->w;
+   w->cache->sh      = w->cache->h;
+   w->cache->srw     = (double)pw / (double)rw;
+   w->cache->srh     = (double)ph / (double)rh;
+   w->dirty          = 1;
+
+   gl_checkErr();
+
+   return 0;
+}
+
+
+/**
+ * @brief Frees the render cache of a window.
+ *
+ *    @param w Window to free cache of.
+ */
+static void window_cacheFree( Window *w )
+{
+   if (w->fbo != 0) {
+      nglDeleteFramebuffers( 1, &w->fbo );
+      w->fbo = 0;
+   }
+   if (w->cache != NULL) {
+      glDeleteTextures( 1, &w->cache->texture );
+      free( w->cache );
+      w->cache = NULL;
+   }
+}
+
+
+/**
+ * @brief Decides which widgets of a window are drawn from its cache.
+ *
+ * Animated widgets are drawn every frame, and so is any widget overlapping
+ *  one before it that is drawn every frame.  Everything else can be cached,
+ *  since compositing the cache first still leaves each widget below the ones
+ *  that come after it.
+ *
+ *    @param w Window to sort widgets of.
+ */
+static void window_cacheSort( Window *w )
+{
+   Widget *wgt, *prev;
+
+   for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next) {
+      wgt_rmFlag( wgt, WGT_FLAG_LIVE );
+      if (widget_isDynamic( wgt )) {
+         wgt_setFlag( wgt, WGT_FLAG_LIVE );
+         continue;
+      }
+      for (prev=w->widgets; prev!=wgt; prev=prev->next) {
+         if (wgt_isFlag( prev, WGT_FLAG_LIVE ) && widget_overlaps( prev, wgt )) {
+            wgt_setFlag( wgt, WGT_FLAG_LIVE );
+            break;
+         }
+      }
    }
 }
 
 
+/**
+ * @brief Redraws the border and static widgets of a window into its cache.
+ *
+ *    @param w Window to update cache of.
+ */
+static void window_cacheUpdate( Window *w )
+{
+   double x, y;
+   Widget *wgt;
+
+   /* position */
+   x = w->x - (double)SCREEN_W/2.;
+   y = w->y - (double)SCREEN_H/2.;
+
+   /* Render into the cache with the window filling it. */
+   nglBindFramebuffer( GL_FRAMEBUFFER, w->fbo );
+   glViewport( 0, 0, (GLsizei)(w->cache->srw * w->cache->rw),
+         (GLsizei)(w->cache->srh * w->cache->rh) );
+   gl_matrixMode( GL_PROJECTION );
+   gl_matrixPush();
+   glLoadIdentity();
+   glOrtho( x, x + w->cache->w, y, y + w->cache->h, -1., 1. );
+   toolkit_clipX = w->x / gl_screen.mxscale;
+   toolkit_clipY = w->y / gl_screen.myscale;
+
+   /* Keep premultiplied alpha so it can be blended again. */
+   glClearColor( 0., 0., 0., 0. );
+   glClear( GL_COLOR_BUFFER_BIT );
+   nglBlendFuncSeparate( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+         GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+
+   /* See if needs border. */
+   if (!window_isFlag( w, WINDOW_NOBORDER ))
+      window_renderBorder(w);
+
+   /* Cached widgets. */
+   window_cacheSort( w );
+   for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next)
+      if (!wgt_isFlag( wgt, WGT_FLAG_LIVE ))
+         widget_render( wgt, x, y );
+
+   /* Restore state. */
+   glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+   glClearColor( 0., 0., 0., 1. );
+   toolkit_clipX = 0.;
+   toolkit_clipY = 0.;
+   gl_matrixPop();
+   nglBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   glViewport( 0, 0, gl_screen.rw, gl_screen.rh );
+   gl_checkErr();
+
+   w->dirty = 0;
+}
+
+
+/**
+ * @brief Renders a window through its render cache.
+ *
+ * The border and static widgets are only redrawn when the window is dirty.
+ *  Animated widgets and whatever they cover are drawn on top every frame in
+ *  their original order, followed by the focus.  Falls back to
+ *  window_render() when caching is not possible.
+ *
+ *    @param w Window to render.
+ */
+void window_renderCached( Window *w )
+{
+   double x, y;
+   Widget *wgt;
+
+   /* Cache must be usable. */
+   if (!toolkit_hasCache() || window_isFlag( w, WINDOW_NOCACHE ) ||
+         ((w->fbo == 0) && (window_cacheCreate( w ) != 0))) {
+      window_render( w );
+      return;
+   }
+
+   /* Update if needed. */
+   if (w->dirty)
+      window_cacheUpdate( w );
+
+   /* position */
+   x = w->x - (double)SCREEN_W/2.;
+   y = w->y - (double)SCREEN_H/2.;
+
+   /* Composite the cache, it has premultiplied alpha. */
+   glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+   gl_blitTexture( w->cache, x, y, w->cache->w, w->cache->h,
+         0., 0., w->cache->srw, w->cache->srh, NULL );
+   glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+   /* Widgets drawn every frame, in order. */
+   for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next)
+      if (wgt_isFlag( wgt, WGT_FLAG_LIVE ))
+         widget_render( wgt, x, y );
+
+   /* focused widget */
+   window_renderFocus( w, x, y );
+}
+
+
 /**
  * @brief Renders the window overlays.
  *
@@ -1393,17 +1703,32 @@ void toolkit_render (void)
 {
    Window *w;
 
+   /* New frame. */
+   toolkit_wgtDrawsLast = toolkit_wgtDraws;
+   toolkit_wgtDraws     = 0;
+
    /* Render base. */
    for (w = windows; w!=NULL; w = w->next) {
       if (!window_isFlag(w, WINDOW_NORENDER) &&
                !window_isFlag(w, WINDOW_KILL)) {
-         window_render(w);
+         window_renderCached(w);
          window_renderOverlay(w);
       }
    }
 }
 
 
+/**
+ * @brief Gets the number of widgets drawn in the last frame.
+ *
+ *    @return Number of widget render calls in the last frame.
+ */
+int toolkit_widgetDraws (void)
+{
+   return toolkit_wgtDrawsLast;
+}
+
+
 /**
  * @brief Toolkit input handled here.
  *
@@ -1451,6 +1776,11 @@ int toolkit_inputWindow( Window *wdw, SDL_Event *event, int purge )
    int ret;
    ret = 0;
 
+   /* Input can change anything in the window, mouse motion is checked per
+    * widget since it usually changes nothing. */
+   if (event->type != SDL_MOUSEMOTION)
+      wdw->dirty = 1;
+
    /* Event handler. */
    if (wdw->eventevent != NULL)
       wdw->eventevent( wdw->id, event );
@@ -1595,6 +1925,7 @@ static void toolkit_mouseEventWidget( Window *w, Widget *wgt,
       Uint8 type, Uint8 button, int x, int y, int rx, int ry )
 {
    int inbounds;
+   WidgetStatus status;
 
    /* Widget translations. */
    x -= wgt->x;
@@ -1607,6 +1938,7 @@ static void toolkit_mouseEventWidget( Window *w, Widget *wgt,
    switch (type) {
       case SDL_MOUSEMOTION:
          /* Change the status of the widget if mouse isn't down. */
+         status = wgt->status;
 
          /* Not scrolling. */
          if (wgt->status != WIDGET_STATUS_SCROLLING) {
@@ -1624,9 +1956,14 @@ static void toolkit_mouseEventWidget( Window *w, Widget *wgt,
          if (wgt_isFlag( wgt, WGT_FLAG_ALWAYSMMOVE ))
             inbounds = 1;
 
-         /* Try to give the event to the widget. */
+         /* Hovering changes how it looks. */
+         if (wgt->status != status)
+            w->dirty = 1;
+
+         /* Try to give the event to the widget, it changed if it used it. */
          if (inbounds && (wgt->mmoveevent != NULL))
-            (*wgt->mmoveevent)( wgt, x, y, rx, ry );
+            if ((*wgt->mmoveevent)( wgt, x, y, rx, ry ))
+               w->dirty = 1;
 
          break;
 
@@ -1685,7 +2022,7 @@ static void toolkit_regKey( SDLKey key, SDLKey c )
 {
    if ((input_key==0) && (input_keyTime==0)) {
       input_key         = key;
-      input_keyTime     = SDL_GetTicks();
+      input_keyTime     = replay_getTicks();
       input_keyCounter  = 0;
       input_text        = nstd_checkascii(c) ? c : 0;
    }
@@ -1843,6 +2180,7 @@ static void toolkit_purgeDead (void)
                /* Kill target. */
                wgtkill->next = NULL;
                widget_kill( wgtkill );
+               wdw->dirty    = 1;
             }
             /* Save position. */
             wgtlast = wgt;
@@ -1897,7 +2235,7 @@ void toolkit_update (void)
    if (input_key == 0)
       return;
 
-   t = SDL_GetTicks();
+   t = replay_getTicks();
 
    /* Should be repeating. */
    if (input_keyTime + INPUT_DELAY + input_keyCounter*INPUT_FREQ > t)
@@ -1912,7 +2250,7 @@ void toolkit_update (void)
       wdw = toolkit_getActiveWindow();
       if (wdw == NULL)
          return;
-
+      wdw->dirty = 1;
 
       /* See if widget needs event. */
       for (wgt=wdw->widgets; wgt!=NULL; wgt=wgt->next) {
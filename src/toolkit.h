@@ -66,6 +66,7 @@ void window_onClose( unsigned int wid, void (*fptr)(unsigned int,char*) );
  * render
  */
 void toolkit_render (void);
+int toolkit_widgetDraws (void);
 
 
 /*
@@ -20,11 +20,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "SDL.h"
+
 #include "log.h"
 #include "nxml.h"
 #include "space.h"
 #include "ndata.h"
 #include "fleet.h"
+#include "map.h"
+#include "economy.h"
 
 
 #define CHUNK_SIZE      32 /**< Size of chunk to allocate. */
@@ -117,6 +121,27 @@ typedef struct UniDiff_ {
 } UniDiff_t;
 
 
+/**
+ * @struct UniDiffData_t
+ *
+ * @brief A diff as parsed from the data file, ready to be applied.
+ */
+typedef struct UniDiffData_ {
+   char *name; /**< Name of the diff. */
+   UniHunk_t *hunks; /**< Hunks to apply. */
+   int nhunks; /**< Number of hunks. */
+   int mhunks; /**< Memory of hunks. */
+} UniDiffData_t;
+
+
+/*
+ * Diff catalogue.
+ */
+static UniDiffData_t *diff_data = NULL; /**< Parsed diffs sorted by name. */
+static int diff_ndata = 0; /**< Number of parsed diffs. */
+static int diff_parsed = 0; /**< Whether the diff file has been parsed. */
+
+
 /*
  * Diff stack.
  */
@@ -129,12 +154,17 @@ static int diff_mstack = 0; /**< Currently allocated diffs. */
  * Prototypes.
  */
 static UniDiff_t* diff_get( const char *name );
+static int diff_dataCompare( const void *p1, const void *p2 );
+static int diff_dataSearch( const void *key, const void *elem );
+static UniDiffData_t* diff_getData( const char *name );
+static int diff_parse (void);
+static void diff_addHunk( UniDiffData_t *data, UniHunk_t *hunk );
+static int diff_parseSystem( UniDiffData_t *data, xmlNodePtr node );
+static int diff_parseShip( UniDiffData_t *data, xmlNodePtr node );
+static int diff_parseOutfit( UniDiffData_t *data, xmlNodePtr node );
 static UniDiff_t *diff_newDiff (void);
 static int diff_removeDiff( UniDiff_t *diff );
-static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node );
-static int diff_patchShip( UniDiff_t *diff, xmlNodePtr node );
-static int diff_patchOutfit( UniDiff_t *diff, xmlNodePtr node );
-static int diff_patch( xmlNodePtr parent );
+static int diff_patch( const UniDiffData_t *data );
 static int diff_patchHunk( UniHunk_t *hunk );
 static void diff_hunkFailed( UniDiff_t *diff, UniHunk_t *hunk );
 static void diff_hunkSuccess( UniDiff_t *diff, UniHunk_t *hunk );
@@ -175,6 +205,44 @@ static UniDiff_t* diff_get( const char *name )
 }
 
 
+/**
+ * @brief Compares two parsed diffs by name for qsort.
+ */
+static int diff_dataCompare( const void *p1, const void *p2 )
+{
+   const UniDiffData_t *d1, *d2;
+   d1 = (const UniDiffData_t*) p1;
+   d2 = (const UniDiffData_t*) p2;
+   return strcmp( d1->name, d2->name );
+}
+
+
+/**
+ * @brief Compares a name against a parsed diff for bsearch.
+ */
+static int diff_dataSearch( const void *key, const void *elem )
+{
+   return strcmp( (const char*)key, ((const UniDiffData_t*)elem)->name );
+}
+
+
+/**
+ * @brief Gets a parsed diff by name, parsing the diff file if needed.
+ *
+ *    @param name Name of the diff to get.
+ *    @return The parsed diff or NULL if not found.
+ */
+static UniDiffData_t* diff_getData( const char *name )
+{
+   if (!diff_parsed)
+      diff_parse();
+   if (diff_ndata == 0)
+      return NULL;
+   return bsearch( name, diff_data, diff_ndata, sizeof(UniDiffData_t),
+         diff_dataSearch );
+}
+
+
 /**
  * @brief Applies a diff to the universe.
  *
@@ -183,67 +251,153 @@ static UniDiff_t* diff_get( const char *name )
  */
 int diff_apply( const char *name )
 {
-   xmlNodePtr node;
-   xmlDocPtr doc;
-   uint32_t bufsize;
-   char *buf;
-   char *diffname;
+   UniDiffData_t *data;
 
    /* Check if already applied. */
    if (diff_isApplied(name))
       return 0;
 
+   data = diff_getData( name );
+   if (data == NULL) {
+      WARN("UniDiff '%s' not found in "DIFF_DATA".", name);
+      return -1;
+   }
+
+   return diff_patch( data );
+}
+
+
+/**
+ * @brief Applies a list of diffs to the universe as a single batch.
+ *
+ * The economy is only refreshed once after all the diffs are applied instead
+ *  of once per planet that changes.
+ *
+ *    @param names Diffs to apply.
+ *    @param n Number of diffs to apply.
+ *    @return 0 on success, -1 if any of the diffs failed to apply.
+ */
+int diff_applyList( const char **names, int n )
+{
+   int i, ret;
+
+   ret = 0;
+   economy_delayRefresh();
+   for (i=0; i<n; i++)
+      if (diff_apply( names[i] ))
+         ret = -1;
+   economy_execRefresh();
+
+   return ret;
+}
+
+
+/**
+ * @brief Parses the diff file into the catalogue of diffs.
+ *
+ * This is only done once, applying a diff afterwards just looks it up.
+ *
+ *    @return 0 on success.
+ */
+static int diff_parse (void)
+{
+   xmlNodePtr node, cur;
+   xmlDocPtr doc;
+   uint32_t bufsize;
+   char *buf;
+   UniDiffData_t *data;
+   int mdata;
+
+   /* Only try once. */
+   diff_parsed = 1;
+
    buf = ndata_read( DIFF_DATA, &bufsize );
    doc = xmlParseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode;
    if (strcmp((char*)node->name,"unidiffs")) {
       ERR("Malformed unidiff file: missing root element 'unidiffs'");
-      return 0;
+      xmlFreeDoc(doc);
+      free(buf);
+      return -1;
    }
 
    node = node->xmlChildrenNode; /* first system node */
    if (node == NULL) {
       ERR("Malformed unidiff file: does not contain elements");
-      return 0;
+      xmlFreeDoc(doc);
+      free(buf);
+      return -1;
    }
 
+   mdata = 0;
    do {
-      if (xml_isNode(node,"unidiff")) {
-         /* Check to see if it's the diff we're looking for. */
-         xmlr_attr(node,"name",diffname);
-         if (strcmp(diffname,name)==0) {
-            /* Apply it. */
-            diff_patch( node );
-
-            /* Clean up. */
-            free(diffname);
-            xmlFreeDoc(doc);
-            free(buf);
-
-            return 0;
-         }
-         free(diffname);
+      if (!xml_isNode(node,"unidiff"))
+         continue;
+
+      /* Grow memory. */
+      diff_ndata++;
+      if (diff_ndata > mdata) {
+         mdata += CHUNK_SIZE;
+         diff_data = realloc( diff_data, sizeof(UniDiffData_t) * mdata );
+      }
+      data = &diff_data[diff_ndata-1];
+      memset( data, 0, sizeof(UniDiffData_t) );
+      xmlr_attr(node,"name",data->name);
+      if (data->name == NULL) {
+         WARN("Unidiff in "DIFF_DATA" has no 'name' tag.");
+         diff_ndata--;
+         continue;
       }
+
+      /* Parse the hunks. */
+      cur = node->xmlChildrenNode;
+      do {
+         if (xml_isNode(cur,"system"))
+            diff_parseSystem( data, cur );
+         else if (xml_isNode(cur, "outfit"))
+            diff_parseOutfit( data, cur );
+         else if (xml_isNode(cur, "ship"))
+            diff_parseShip( data, cur );
+      } while (xml_nextNode(cur));
    } while (xml_nextNode(node));
 
-   /* More clean up. */
+   /* Clean up. */
    xmlFreeDoc(doc);
    free(buf);
 
-   WARN("UniDiff '%s' not found in "DIFF_DATA".", name);
-   return -1;
+   /* Sort for fast lookups. */
+   qsort( diff_data, diff_ndata, sizeof(UniDiffData_t), diff_dataCompare );
+
+   return 0;
 }
 
 
 /**
- * @brief Patches a system.
+ * @brief Adds a hunk to a parsed diff.
  *
- *    @param diff Diff that is doing the patching.
+ *    @param data Parsed diff to add hunk to.
+ *    @param hunk Hunk to add.
+ */
+static void diff_addHunk( UniDiffData_t *data, UniHunk_t *hunk )
+{
+   data->nhunks++;
+   if (data->nhunks > data->mhunks) {
+      data->mhunks += CHUNK_SIZE;
+      data->hunks = realloc(data->hunks, sizeof(UniHunk_t) * data->mhunks);
+   }
+   memcpy( &data->hunks[data->nhunks-1], hunk, sizeof(UniHunk_t) );
+}
+
+
+/**
+ * @brief Parses the hunks that patch a system.
+ *
+ *    @param data Parsed diff to add hunks to.
  *    @param node Node containing the system.
  *    @return 0 on success.
  */
-static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
+static int diff_parseSystem( UniDiffData_t *data, xmlNodePtr node )
 {
    UniHunk_t base, hunk;
    xmlNodePtr cur;
@@ -253,52 +407,39 @@ static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
    memset(&base, 0, sizeof(UniHunk_t));
    base.target.type = HUNK_TARGET_SYSTEM;
    xmlr_attr(node,"name",base.target.u.name);
-   if (base.target.u.name==NULL)
-      WARN("Unidiff '%s' has a system node without a 'name' tag", diff->name);
+   if (base.target.u.name==NULL) {
+      WARN("Unidiff '%s' has a system node without a 'name' tag", data->name);
+      return -1;
+   }
 
    /* Now parse the possible changes. */
    cur = node->xmlChildrenNode;
    do {
+      memset(&hunk, 0, sizeof(UniHunk_t));
       if (xml_isNode(cur,"planet")) {
-         hunk.target.type = base.target.type;
-         hunk.target.u.name = strdup(base.target.u.name);
-
-         /* Get the planet to modify. */
-         xmlr_attr(cur,"name",hunk.u.name);
-
          /* Get the type. */
          buf = xml_get(cur);
          if (buf==NULL) {
-            WARN("Unidiff '%s': Null hunk type.", diff->name);
+            WARN("Unidiff '%s': Null hunk type.", data->name);
             continue;
          }
          if (strcmp(buf,"add")==0)
             hunk.type = HUNK_TYPE_PLANET_ADD;
          else if (strcmp(buf,"remove")==0)
             hunk.type = HUNK_TYPE_PLANET_REMOVE;
+         else {
+            WARN("Unidiff '%s': Unknown hunk type '%s'.", data->name, buf);
+            continue;
+         }
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         /* Get the planet to modify. */
+         xmlr_attr(cur,"name",hunk.u.name);
       }
       else if (xml_isNode(cur, "fleet")) {
-         hunk.target.type = base.target.type;
-         hunk.target.u.name = strdup(base.target.u.name);
-
-         /* Get the fleet properties. */
-         xmlr_attr(cur,"name",buf);
-         hunk.u.fleet.fleet = fleet_get(buf);
-         free(buf);
-         xmlr_attr(cur,"chance",buf);
-         hunk.u.fleet.chance = atoi(buf);
-         free(buf);
-
          /* Get the type. */
          buf = xml_get(cur);
          if (buf==NULL) {
-            WARN("Unidiff '%s': Null hunk type.", diff->name);
+            WARN("Unidiff '%s': Null hunk type.", data->name);
             continue;
          }
          if (strcmp(buf,"add")==0)
@@ -306,79 +447,78 @@ static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
          else if (strcmp(buf,"remove")==0)
             hunk.type = HUNK_TYPE_FLEET_REMOVE;
          else {
-            WARN("Unknown hunk type.");
-            hunk.type = HUNK_TYPE_NONE;
+            WARN("Unidiff '%s': Unknown hunk type '%s'.", data->name, buf);
+            continue;
          }
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
-      }
-      else if (xml_isNode(cur, "fleetgroup")) {
-         hunk.target.type = base.target.type;
-         hunk.target.u.name = strdup(base.target.u.name);
-
          /* Get the fleet properties. */
          xmlr_attr(cur,"name",buf);
-         hunk.u.fleetgroup = fleet_getGroup(buf);
+         hunk.u.fleet.fleet = fleet_get(buf);
          free(buf);
-
+         xmlr_attr(cur,"chance",buf);
+         hunk.u.fleet.chance = atoi(buf);
+         free(buf);
+      }
+      else if (xml_isNode(cur, "fleetgroup")) {
          /* Get the type. */
          buf = xml_get(cur);
          if (buf==NULL) {
-            WARN("Unidiff '%s': Null hunk type.", diff->name);
+            WARN("Unidiff '%s': Null hunk type.", data->name);
             continue;
          }
          if (strcmp(buf,"add")==0)
             hunk.type = HUNK_TYPE_FLEETGROUP_ADD;
          else if (strcmp(buf,"remove")==0)
             hunk.type = HUNK_TYPE_FLEETGROUP_REMOVE;
+         else {
+            WARN("Unidiff '%s': Unknown hunk type '%s'.", data->name, buf);
+            continue;
+         }
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         /* Get the fleet properties. */
+         xmlr_attr(cur,"name",buf);
+         hunk.u.fleetgroup = fleet_getGroup(buf);
+         free(buf);
       }
+      else
+         continue;
+
+      hunk.target.type   = base.target.type;
+      hunk.target.u.name = strdup(base.target.u.name);
+      diff_addHunk( data, &hunk );
    } while (xml_nextNode(cur));
 
    /* Clean up some stuff. */
    free(base.target.u.name);
-   base.target.u.name = NULL;
 
    return 0;
 }
 
 
 /**
- * @brief Patches a ship.
+ * @brief Parses the hunks that patch a ship.
  *
- *    @param diff Diff that is doing the patching.
+ *    @param data Parsed diff to add hunks to.
  *    @param node Node containing the ship.
  *    @return 0 on success.
  */
-static int diff_patchShip( UniDiff_t *diff, xmlNodePtr node )
+static int diff_parseShip( UniDiffData_t *data, xmlNodePtr node )
 {
-   UniHunk_t base, hunk;
+   UniHunk_t hunk;
    xmlNodePtr cur;
-   Ship *s;
+   char *name;
 
-   /* Set the target. */
-   memset(&base, 0, sizeof(UniHunk_t));
-   base.target.type = HUNK_TARGET_SHIP;
-   xmlr_attr(node,"name",base.target.u.name);
-   if (base.target.u.name==NULL) {
-      WARN("Unidiff '%s' has an ship node without a 'name' tag", diff->name);
+   xmlr_attr(node,"name",name);
+   if (name==NULL) {
+      WARN("Unidiff '%s' has an ship node without a 'name' tag", data->name);
       return -1;
    }
 
    /* Make sure ship exists. */
-   s = ship_get(base.target.u.name);
-   if (s == NULL) {
+   if (ship_get(name) == NULL) {
       WARN("Unidiff '%s' ship '%s' to patch does not exist",
-            diff->name, base.target.u.name );
+            data->name, name );
+      free(name);
       return -1;
    }
 
@@ -386,59 +526,48 @@ static int diff_patchShip( UniDiff_t *diff, xmlNodePtr node )
    cur = node->xmlChildrenNode;
    do {
       if (xml_isNode(cur,"tech")) {
-         hunk.target.type = base.target.type;
-         hunk.target.u.name = strdup(base.target.u.name);
+         memset(&hunk, 0, sizeof(UniHunk_t));
+         hunk.target.type = HUNK_TARGET_SHIP;
+         hunk.target.u.name = strdup(name);
 
-         /* Outfit type is constant. */
+         /* Ship type is constant, old value is known when applying. */
          hunk.type = HUNK_TYPE_SHIP_TECH;
-
-         /* Get the data. */
-         hunk.u.i.old = s->tech;
          hunk.u.i.new = xml_getInt(cur);
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         diff_addHunk( data, &hunk );
       }
    } while (xml_nextNode(cur));
 
-   /* Clean up some stuff. */
-   free(base.target.u.name);
-   base.target.u.name = NULL;
+   free(name);
 
    return 0;
 }
 
 
 /**
- * @brief Patches an outfit.
+ * @brief Parses the hunks that patch an outfit.
  *
- *    @param diff Diff that is doing the patching.
+ *    @param data Parsed diff to add hunks to.
  *    @param node Node containing the outfit.
  *    @return 0 on success.
  */
-static int diff_patchOutfit( UniDiff_t *diff, xmlNodePtr node )
+static int diff_parseOutfit( UniDiffData_t *data, xmlNodePtr node )
 {
-   UniHunk_t base, hunk;
+   UniHunk_t hunk;
    xmlNodePtr cur;
-   Outfit *o;
+   char *name;
 
-   /* Set the target. */
-   memset(&base, 0, sizeof(UniHunk_t));
-   base.target.type = HUNK_TARGET_OUTFIT;
-   xmlr_attr(node,"name",base.target.u.name);
-   if (base.target.u.name==NULL) {
-      WARN("Unidiff '%s' has an outfit node without a 'name' tag", diff->name);
+   xmlr_attr(node,"name",name);
+   if (name==NULL) {
+      WARN("Unidiff '%s' has an outfit node without a 'name' tag", data->name);
       return -1;
    }
 
    /* Make sure outfit exists. */
-   o = outfit_get(base.target.u.name);
-   if (o == NULL) {
+   if (outfit_get(name) == NULL) {
       WARN("Unidiff '%s' outfit '%s' to patch does not exist",
-            diff->name, base.target.u.name );
+            data->name, name );
+      free(name);
       return -1;
    }
 
@@ -446,60 +575,80 @@ static int diff_patchOutfit( UniDiff_t *diff, xmlNodePtr node )
    cur = node->xmlChildrenNode;
    do {
       if (xml_isNode(cur,"tech")) {
-         hunk.target.type = base.target.type;
-         hunk.target.u.name = strdup(base.target.u.name);
+         memset(&hunk, 0, sizeof(UniHunk_t));
+         hunk.target.type = HUNK_TARGET_OUTFIT;
+         hunk.target.u.name = strdup(name);
 
-         /* Outfit type is constant. */
+         /* Outfit type is constant, old value is known when applying. */
          hunk.type = HUNK_TYPE_OUTFIT_TECH;
-
-         /* Get the data. */
-         hunk.u.i.old = o->tech;
          hunk.u.i.new = xml_getInt(cur);
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         diff_addHunk( data, &hunk );
       }
    } while (xml_nextNode(cur));
 
-   /* Clean up some stuff. */
-   free(base.target.u.name);
-   base.target.u.name = NULL;
+   free(name);
 
    return 0;
 }
 
 
 /**
- * @brief Actually applies a diff in XML node form.
+ * @brief Actually applies a parsed diff.
  *
- *    @param parent Node containing the diff information.
+ *    @param data Parsed diff to apply.
  *    @return 0 on success.
  */
-static int diff_patch( xmlNodePtr parent )
+static int diff_patch( const UniDiffData_t *data )
 {
    int i;
    UniDiff_t *diff;
-   UniHunk_t *fail;
-   xmlNodePtr node;
+   UniHunk_t hunk, *fail;
+   Ship *s;
+   Outfit *o;
    char *target;
 
    /* Prepare it. */
    diff = diff_newDiff();
    memset(diff, 0, sizeof(UniDiff_t));
-   xmlr_attr(parent,"name",diff->name);
+   diff->name = strdup(data->name);
 
-   node = parent->xmlChildrenNode;
-   do {
-      if (xml_isNode(node,"system"))
-         diff_patchSystem( diff, node );
-      else if (xml_isNode(node, "outfit"))
-         diff_patchOutfit( diff, node );
-      else if (xml_isNode(node, "ship"))
-         diff_patchShip( diff, node );
-   } while (xml_nextNode(node));
+   for (i=0; i<data->nhunks; i++) {
+      /* The diff owns its own copy of the hunk. */
+      memcpy( &hunk, &data->hunks[i], sizeof(UniHunk_t) );
+      hunk.target.u.name = strdup( hunk.target.u.name );
+      switch (hunk.type) {
+         case HUNK_TYPE_PLANET_ADD:
+         case HUNK_TYPE_PLANET_REMOVE:
+            if (hunk.u.name != NULL)
+               hunk.u.name = strdup( hunk.u.name );
+            break;
+
+         /* Store the current value so it can be reverted. */
+         case HUNK_TYPE_SHIP_TECH:
+            s = ship_get( hunk.target.u.name );
+            if (s != NULL)
+               hunk.u.i.old = s->tech;
+            break;
+         case HUNK_TYPE_OUTFIT_TECH:
+            o = outfit_get( hunk.target.u.name );
+            if (o != NULL)
+               hunk.u.i.old = o->tech;
+            break;
+
+         default:
+            break;
+      }
+
+      /* Apply diff. */
+      if (diff_patchHunk( &hunk ) < 0)
+         diff_hunkFailed( diff, &hunk );
+      else
+         diff_hunkSuccess( diff, &hunk );
+   }
+
+   /* Systems may have changed. */
+   map_invalidate();
 
    if (diff->nfailed > 0) {
       DEBUG("Unidiff '%s' failed to apply %d hunks.", diff->name, diff->nfailed);
@@ -675,9 +824,32 @@ void diff_remove( const char *name )
  */
 void diff_clear (void)
 {
+   /* Only refresh the economy once. */
+   economy_delayRefresh();
    while (diff_nstack > 0) {
       diff_removeDiff(&diff_stack[diff_nstack-1]);
    }
+   economy_execRefresh();
+}
+
+
+/**
+ * @brief Frees the catalogue of parsed diffs.
+ */
+void diff_free (void)
+{
+   int i, j;
+
+   for (i=0; i<diff_ndata; i++) {
+      free(diff_data[i].name);
+      for (j=0; j<diff_data[i].nhunks; j++)
+         diff_cleanupHunk( &diff_data[i].hunks[j] );
+      free(diff_data[i].hunks);
+   }
+   free(diff_data);
+   diff_data   = NULL;
+   diff_ndata  = 0;
+   diff_parsed = 0;
 }
 
 
@@ -760,6 +932,9 @@ static int diff_removeDiff( UniDiff_t *diff )
          DEBUG("Failed to remove hunk type '%d'.", hunk.type);
    }
 
+   /* Systems may have changed. */
+   map_invalidate();
+
    diff_cleanup(diff);
    diff_nstack--;
    i = diff - diff_stack;
@@ -847,20 +1022,40 @@ int diff_save( xmlTextWriterPtr writer )
 int diff_load( xmlNodePtr parent )
 {
    xmlNodePtr node, cur;
+   const char **names;
+   int n, m;
+   Uint32 t;
+
+   t = SDL_GetTicks();
 
    diff_clear();
 
-   node = parent->xmlChildrenNode;
+   /* Gather the names, they point into the save document. */
+   names = NULL;
+   n     = 0;
+   m     = 0;
+   node  = parent->xmlChildrenNode;
    do {
       if (xml_isNode(node,"diffs")) {
          cur = node->xmlChildrenNode;
          do {
-            if (xml_isNode(cur,"diff"))
-               diff_apply( xml_get(cur) );
+            if (xml_isNode(cur,"diff") && (xml_get(cur) != NULL)) {
+               if (n >= m) {
+                  m    += CHUNK_SIZE;
+                  names = realloc( names, sizeof(char*) * m );
+               }
+               names[n++] = xml_get(cur);
+            }
          } while (xml_nextNode(cur));
       }
    } while (xml_nextNode(node));
 
+   /* Apply them all at once. */
+   diff_applyList( names, n );
+   free(names);
+
+   DEBUG("Loaded %d unidiffs in %u ms.", n, (unsigned int)(SDL_GetTicks() - t));
+
    return 0;
 
 }
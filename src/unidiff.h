@@ -9,9 +9,11 @@
 
 
 int diff_apply( const char *name );
+int diff_applyList( const char **names, int n );
 void diff_remove( const char *name );
 void diff_clear (void);
 int diff_isApplied( const char *name );
+void diff_free (void);
 
 
 #endif /* UNIDIFF_H */
@@ -31,6 +31,7 @@
 #include "gui.h"
 #include "ai.h"
 #include "ai_extra.h"
+#include "spatial.h"
 
 
 #define weapon_isSmart(w)     (w->think != NULL) /**< Checks if the weapon w is smart. */
@@ -90,6 +91,7 @@ typedef struct Weapon_ {
    void (*think)(struct Weapon_*, const double); /**< for the smart missiles */
 
    char status; /**< Weapon status - to check for jamming */
+   char exploded; /**< Caught in an explosion, destroyed in weapon_explodeEnd(). */
 } Weapon;
 
 
@@ -102,15 +104,14 @@ static Weapon** wfrontLayer = NULL; /**< infront of pilots, behind player */
 static int nwfrontLayer = 0; /**< number of elements */
 static int mwfrontLayer = 0; /**< alloced memory size */
 
-/* Graphics. */
-static gl_vbo  *weapon_vbo     = NULL; /**< Weapon VBO. */
-static GLfloat *weapon_vboData = NULL; /**< Data of weapon VBO. */
-static int weapon_vboSize      = 0; /**< Size of the VBO. */
-
-
 /* Internal stuff. */
 static int beam_idgen = 0; /**< Beam identifier generator. */
 
+/* Area damage. */
+#define WEAPON_INDEX_CELL  256. /**< Grid cell size of the explosion index. */
+static SpatialIndex weapon_index; /**< Spatial index of weapons for explosions. */
+static int weapon_indexed = 0; /**< Whether weapon_index is currently valid. */
+
 
 /*
  * Prototypes
@@ -126,10 +127,10 @@ static void weapon_hit( Weapon* w, Pilot* p, WeaponLayer layer, Vector2d* pos );
 static void weapon_hitBeam( Weapon* w, Pilot* p, WeaponLayer layer,
       Vector2d pos[2], const double dt );
 static void weapon_destroy( Weapon* w, WeaponLayer layer );
+static void weapon_cleanup( Weapon* w );
 static void weapon_free( Weapon* w );
-static void weapon_explodeLayer( WeaponLayer layer,
-      double x, double y, double radius,
-      const Pilot *parent, int mode );
+static void weapon_indexLayer( WeaponLayer layer );
+static void weapon_explodeLayerEnd( WeaponLayer layer );
 static int weapon_checkCanHit( Weapon* w, Pilot *p );
 /* think */
 static void think_seeker( Weapon* w, const double dt );
@@ -143,7 +144,7 @@ static void weapon_setTurn( Weapon *w, double turn );
 
 
 /**
- * @brief Draws the minimap weapons (used in player.c).
+ * @brief Adds the minimap weapons to the radar batch (used in gui.c).
  *
  *    @param res Minimap resolution.
  *    @param w Width of minimap.
@@ -154,15 +155,10 @@ static void weapon_setTurn( Weapon *w, double turn );
 void weapon_minimap( const double res, const double w,
       const double h, const RadarShape shape, double alpha )
 {
-   int i, rc, p;
+   int i, rc;
    double x, y;
    Weapon *wp;
    glColour *c;
-   GLsizei offset;
-
-   /* Get offset. */
-   p = 0;
-   offset = weapon_vboSize;
 
    if (shape==RADAR_CIRCLE)
       rc = (int)(w*w);
@@ -194,18 +190,8 @@ void weapon_minimap( const double res, const double w,
       else
          c = &cNeutral;
 
-      /* Set the colour. */
-      weapon_vboData[ offset + 4*p + 0 ] = c->r;
-      weapon_vboData[ offset + 4*p + 1 ] = c->g;
-      weapon_vboData[ offset + 4*p + 2 ] = c->b;
-      weapon_vboData[ offset + 4*p + 3 ] = alpha;
-
       /* Put the pixel. */
-      weapon_vboData[ 2*p + 0 ] = x;
-      weapon_vboData[ 2*p + 1 ] = y;
-
-      /* "Add" pixel. */
-      p++;
+      gui_radarPoint( x, y, c, alpha );
    }
    for (i=0; i<nwfrontLayer; i++) {
       wp = wfrontLayer[i];
@@ -232,37 +218,8 @@ void weapon_minimap( const double res, const double w,
       else
          c = &cNeutral;
 
-      /* Set the colour. */
-      weapon_vboData[ offset + 4*p + 0 ] = c->r;
-      weapon_vboData[ offset + 4*p + 1 ] = c->g;
-      weapon_vboData[ offset + 4*p + 2 ] = c->b;
-      weapon_vboData[ offset + 4*p + 3 ] = alpha;
-
       /* Put the pixel. */
-      weapon_vboData[ 2*p + 0 ] = x;
-      weapon_vboData[ 2*p + 1 ] = y;
-
-      /* "Add" pixel. */
-      p++;
-   }
-
-   /* Only render with something to draw. */
-   if (p > 0) {
-      /* Upload data changes. */
-      gl_vboSubData( weapon_vbo, 0, sizeof(GLfloat) * 2*p, weapon_vboData );
-      gl_vboSubData( weapon_vbo, offset * sizeof(GLfloat),
-            sizeof(GLfloat) * 4*p, &weapon_vboData[offset] );
-
-      /* Activate VBO. */
-      gl_vboActivateOffset( weapon_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-      gl_vboActivateOffset( weapon_vbo, GL_COLOR_ARRAY, offset * sizeof(GLfloat),
-            4, GL_FLOAT, 0 );
-
-      /* Render VBO. */
-      glDrawArrays( GL_POINTS, 0, p );
-
-      /* Disable VBO. */
-      gl_vboDeactivate();
+      gui_radarPoint( x, y, c, alpha );
    }
 }
 
@@ -476,6 +433,50 @@ void weapons_update( const double dt )
 }
 
 
+/**
+ * @brief Stores the weapons' positions before a simulation step.
+ */
+void weapons_snapshot (void)
+{
+   int i;
+   for (i=0; i<nwbackLayer; i++)
+      solid_snapshot( wbackLayer[i]->solid );
+   for (i=0; i<nwfrontLayer; i++)
+      solid_snapshot( wfrontLayer[i]->solid );
+}
+
+
+/**
+ * @brief Places the weapons where they should be displayed.
+ *
+ * Must be paired with weapons_presentEnd() before the next simulation step.
+ *
+ *    @param alpha Fraction of a step elapsed since the last simulation step.
+ *    @param dt Length of a simulation step.
+ */
+void weapons_presentBegin( double alpha, double dt )
+{
+   int i;
+   for (i=0; i<nwbackLayer; i++)
+      solid_presentBegin( wbackLayer[i]->solid, alpha, dt );
+   for (i=0; i<nwfrontLayer; i++)
+      solid_presentBegin( wfrontLayer[i]->solid, alpha, dt );
+}
+
+
+/**
+ * @brief Puts the weapons back at their simulated positions.
+ */
+void weapons_presentEnd (void)
+{
+   int i;
+   for (i=0; i<nwbackLayer; i++)
+      solid_presentEnd( wbackLayer[i]->solid );
+   for (i=0; i<nwfrontLayer; i++)
+      solid_presentEnd( wfrontLayer[i]->solid );
+}
+
+
 /**
  * @brief Updates all the weapons in the layer.
  *
@@ -1324,7 +1325,6 @@ void weapon_add( const Outfit* outfit, const double dir,
    Weapon *w;
    Weapon **curLayer;
    int *mLayer, *nLayer;
-   GLsizei size;
 
    if (!outfit_isBolt(outfit) &&
          !outfit_isAmmo(outfit)) {
@@ -1369,13 +1369,6 @@ void weapon_add( const Outfit* outfit, const double dir,
             break;
       }
       curLayer[(*nLayer)++] = w;
-
-      /* Grow the vertex stuff. */
-      weapon_vboSize = mwfrontLayer + mwbacklayer;
-      size = sizeof(GLfloat) * (2+4) * weapon_vboSize;
-      weapon_vboData = realloc( weapon_vboData, size );
-      if (weapon_vbo == NULL)
-         weapon_vbo = gl_vboCreateStream( size, NULL );
    }
 }
 
@@ -1403,7 +1396,6 @@ int beam_start( const Outfit* outfit,
    Weapon *w;
    Weapon **curLayer;
    int *mLayer, *nLayer;
-   GLsizei size;
 
    if (!outfit_isBeam(outfit)) {
       ERR("Trying to create a Beam Weapon from a non-beam outfit.");
@@ -1450,13 +1442,6 @@ int beam_start( const Outfit* outfit,
             break;
       }
       curLayer[(*nLayer)++] = w;
-
-      /* Grow the vertex stuff. */
-      weapon_vboSize = mwfrontLayer + mwbacklayer;
-      size = sizeof(GLfloat) * (2+4) * weapon_vboSize;
-      weapon_vboData = realloc( weapon_vboData, size );
-      if (weapon_vbo == NULL)
-         weapon_vbo = gl_vboCreateStream( size, NULL );
    }
 
    return w->ID;
@@ -1518,24 +1503,9 @@ static void weapon_destroy( Weapon* w, WeaponLayer layer )
    int i;
    Weapon** wlayer;
    int *nlayer;
-   Pilot *pilot_target;
-
-   /* Decrement target lockons if needed */
-   if (outfit_isSeeker(w->outfit)) {
-      pilot_target = pilot_get( w->target );
-      if (pilot_target != NULL)
-         pilot_target->lockons--;
-   }
 
-   /* Stop playing sound if beam weapon. */
-   if (outfit_isBeam(w->outfit)) {
-      sound_stop( w->voice );
-      sound_playPos(w->outfit->u.bem.sound_off,
-            w->solid->pos.x,
-            w->solid->pos.y,
-            w->solid->vel.x,
-            w->solid->vel.y);
-   }
+   /* Clean up what the weapon was doing. */
+   weapon_cleanup( w );
 
    switch (layer) {
       case WEAPON_LAYER_BG:
@@ -1567,6 +1537,34 @@ static void weapon_destroy( Weapon* w, WeaponLayer layer )
 }
 
 
+/**
+ * @brief Stops what a weapon is doing before it goes away.
+ *
+ *    @param w Weapon to clean up.
+ */
+static void weapon_cleanup( Weapon* w )
+{
+   Pilot *pilot_target;
+
+   /* Decrement target lockons if needed */
+   if (outfit_isSeeker(w->outfit)) {
+      pilot_target = pilot_get( w->target );
+      if (pilot_target != NULL)
+         pilot_target->lockons--;
+   }
+
+   /* Stop playing sound if beam weapon. */
+   if (outfit_isBeam(w->outfit)) {
+      sound_stop( w->voice );
+      sound_playPos(w->outfit->u.bem.sound_off,
+            w->solid->pos.x,
+            w->solid->pos.y,
+            w->solid->vel.x,
+            w->solid->vel.y);
+   }
+}
+
+
 /**
  * @brief Frees the weapon.
  *
@@ -1623,42 +1621,108 @@ void weapon_exit (void)
       mwfrontLayer = 0;
    }
 
-   /* Destroy VBO. */
-   if (weapon_vbo != NULL) {
-      free( weapon_vboData );
-      weapon_vboData = NULL;
-      gl_vboDestroy( weapon_vbo );
-      weapon_vbo = NULL;
+   /* Free the explosion index. */
+   spatial_free( &weapon_index );
+}
+
+
+/**
+ * @brief Prepares the weapons for a batch of explosions.
+ *
+ * Builds a spatial index of both layers.  Weapons caught in an explosion are
+ *  only marked so the layers stay untouched until weapon_explodeEnd().
+ */
+void weapon_explodeBegin (void)
+{
+   if (weapon_index.cell <= 0.)
+      spatial_init( &weapon_index, WEAPON_INDEX_CELL );
+
+   spatial_clear( &weapon_index );
+   weapon_indexLayer( WEAPON_LAYER_BG );
+   weapon_indexLayer( WEAPON_LAYER_FG );
+   spatial_build( &weapon_index );
+   weapon_indexed = 1;
+}
+
+
+/**
+ * @brief Adds all the weapons of a layer to the explosion index.
+ */
+static void weapon_indexLayer( WeaponLayer layer )
+{
+   int i;
+   Weapon **curLayer;
+   int nLayer;
+
+   if (layer == WEAPON_LAYER_BG) {
+      curLayer = wbackLayer;
+      nLayer   = nwbackLayer;
    }
+   else {
+      curLayer = wfrontLayer;
+      nLayer   = nwfrontLayer;
+   }
+
+   /* Only missiles and bolts can be destroyed by explosions. */
+   for (i=0; i<nLayer; i++)
+      if (outfit_isAmmo(curLayer[i]->outfit) || outfit_isBolt(curLayer[i]->outfit))
+         spatial_add( &weapon_index, (i << 1) | (int)layer,
+               curLayer[i]->solid->pos.x, curLayer[i]->solid->pos.y, 0. );
 }
 
 
 /**
  * @brief Clears possible exploded weapons.
+ *
+ * Must be called between weapon_explodeBegin() and weapon_explodeEnd().
  */
 void weapon_explode( double x, double y, double radius,
       DamageType dtype, double damage,
-      const Pilot *parent, int mode )
+      unsigned int parent, int mode )
 {
    (void)dtype;
    (void)damage;
-   weapon_explodeLayer( WEAPON_LAYER_FG, x, y, radius, parent, mode );
-   weapon_explodeLayer( WEAPON_LAYER_BG, x, y, radius, parent, mode );
+   (void)parent;
+   int i, n, l;
+   const int *res;
+   Weapon *w;
+
+   if (!weapon_indexed) {
+      WARN("Weapon explosion without a weapon index!");
+      return;
+   }
+
+   /* Mark the weapons affected. */
+   n = spatial_query( &weapon_index, x, y, radius, &res );
+   for (i=0; i<n; i++) {
+      l = res[i] >> 1;
+      w = ((res[i] & 1) == WEAPON_LAYER_BG) ? wbackLayer[l] : wfrontLayer[l];
+      if (((mode & EXPL_MODE_MISSILE) && outfit_isAmmo(w->outfit)) ||
+            ((mode & EXPL_MODE_BOLT) && outfit_isBolt(w->outfit)))
+         w->exploded = 1;
+   }
 }
 
 
 /**
- * @brief Explodes all the things on a layer.
+ * @brief Finishes a batch of explosions, destroying the weapons hit.
  */
-static void weapon_explodeLayer( WeaponLayer layer,
-      double x, double y, double radius,
-      const Pilot *parent, int mode )
+void weapon_explodeEnd (void)
 {
-   (void)parent;
-   int i;
+   weapon_explodeLayerEnd( WEAPON_LAYER_BG );
+   weapon_explodeLayerEnd( WEAPON_LAYER_FG );
+   weapon_indexed = 0;
+}
+
+
+/**
+ * @brief Destroys the exploded weapons on a layer in one pass.
+ */
+static void weapon_explodeLayerEnd( WeaponLayer layer )
+{
+   int i, j;
    Weapon **curLayer;
    int *nLayer;
-   double dist, rad2;
 
    /* set the proper layer */
    switch (layer) {
@@ -1676,22 +1740,16 @@ static void weapon_explodeLayer( WeaponLayer layer,
          return;
    }
 
-   rad2 = radius*radius;
-
-   /* Now try to destroy the weapons affected. */
-   for (i=0; i<*nLayer; i++) {
-      if (((mode & EXPL_MODE_MISSILE) && outfit_isAmmo(curLayer[i]->outfit)) ||
-            ((mode & EXPL_MODE_BOLT) && outfit_isBolt(curLayer[i]->outfit))) {
-
-         dist = pow2(curLayer[i]->solid->pos.x - x) +
-               pow2(curLayer[i]->solid->pos.y - y);
-
-         if (dist < rad2) {
-            weapon_destroy(curLayer[i], layer);
-            i--;
-         }
+   /* Compact the layer keeping the order. */
+   for (i=0, j=0; i<*nLayer; i++) {
+      if (curLayer[i]->exploded) {
+         weapon_cleanup( curLayer[i] );
+         weapon_free( curLayer[i] );
       }
+      else
+         curLayer[j++] = curLayer[i];
    }
+   *nLayer = j;
 }
 
 
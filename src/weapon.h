@@ -42,9 +42,11 @@ void beam_end( const unsigned int parent, int beam );
 /*
  * Misc stuff.
  */
+void weapon_explodeBegin (void);
 void weapon_explode( double x, double y, double radius,
       DamageType dtype, double damage,
-      const Pilot *parent, int mode );
+      unsigned int parent, int mode );
+void weapon_explodeEnd (void);
 void weapon_toggleSafety (void);
 
 
@@ -52,6 +54,9 @@ void weapon_toggleSafety (void);
  * update
  */
 void weapons_update( const double dt );
+void weapons_snapshot (void);
+void weapons_presentBegin( double alpha, double dt );
+void weapons_presentEnd (void);
 void weapons_render( const WeaponLayer layer, const double dt );
 
 
@@ -0,0 +1,461 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Checks and benchmarks beam collisions.
+ *
+ * Runs the real CollideLineSprite() from collision.c against synthetic
+ *  sprite sheets.  The result is compared with a reference that samples the
+ *  line every 0.001 pixels and with the routine the game used before
+ *  collisions walked the transparency map exactly.  A benchmark then fires
+ *  beams through a dense fleet with both routines.
+ */
+
+
+#include <stdlib.h> /* exit() */
+#include <stdio.h> /* printf() */
+#include <string.h> /* memset() */
+#include <math.h> /* cos() */
+#include <getopt.h> /* getopt_long */
+
+#include "naev.h"
+#include "collision.h"
+#include "opengl.h"
+#include "log.h"
+#include "util.h"
+
+
+#define SPRITE_W        64 /**< Width of a synthetic sprite. */
+#define SPRITE_H        48 /**< Height of a synthetic sprite. */
+#define SPRITE_X        6 /**< Sprites on the x axis of the sheet. */
+#define SPRITE_Y        6 /**< Sprites on the y axis of the sheet. */
+
+#define REF_STEP        0.001 /**< Sampling step of the reference in pixels. */
+#define HIT_EXACT       0.01 /**< Maximum distance to the reference for an exact hit. */
+#define HIT_CORNER      2. /**< Maximum distance when grazing a pixel corner. */
+#define CORNER_RATIO    0.001 /**< Maximum ratio of hits allowed to graze corners. */
+
+
+/*
+ * Prototypes.
+ */
+static void print_usage( char *appname );
+static void coll_sheet( glTexture *t );
+static int coll_opaque( const glTexture *t, int sx, int sy, double x, double y );
+static int coll_reference( const Vector2d* ap, double ad, double al,
+      const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
+      Vector2d *crash );
+static int coll_old( const Vector2d* ap, double ad, double al,
+      const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
+      Vector2d crash[2] );
+static int coll_check( const glTexture *t, int n );
+static void coll_bench( const glTexture *t, int beams, int pilots, int frames );
+/* Needed by collision.c */
+int gl_isTrans( const glTexture* t, const int x, const int y );
+
+
+static void print_usage( char *appname )
+{
+   printf(
+         "Usage is: %s [options]\n"
+         "   Checks CollideLineSprite() against a reference and benchmarks it.\n"
+         "   Options:\n"
+         "     -n, --lines N       Random lines to check (default 20000).\n"
+         "     -b, --beams N       Beams in the benchmark (default 100).\n"
+         "     -p, --pilots N      Pilots in the benchmark (default 300).\n"
+         "     -f, --frames N      Frames to benchmark (default 50).\n"
+         "     -r, --seed N        Random seed (default 7).\n"
+         "     -c, --check         Only check, skip the benchmark.\n"
+         "     -h, --help          Display this message and exit.\n",
+         appname );
+}
+
+
+/**
+ * @brief Checks to see if a pixel is transparent, same as opengl_tex.c.
+ */
+int gl_isTrans( const glTexture* t, const int x, const int y )
+{
+   int i;
+
+   i = y*(int)(t->w) + x;
+   return !(t->trans[ i/8 ] & (1 << (i%8)));
+}
+
+
+/**
+ * @brief Creates a sheet of ship-like sprites.
+ *
+ * Every sprite is a jittered ellipse with a pattern of holes near its edge
+ *  so beams can pass through thin parts.
+ */
+static void coll_sheet( glTexture *t )
+{
+   int s, x, y, ox, oy, k, on;
+   double a, b, cx, cy, u, v;
+
+   memset( t, 0, sizeof(glTexture) );
+   t->name  = "synthetic";
+   t->sw    = SPRITE_W;
+   t->sh    = SPRITE_H;
+   t->sx    = SPRITE_X;
+   t->sy    = SPRITE_Y;
+   t->w     = SPRITE_W * SPRITE_X;
+   t->h     = SPRITE_H * SPRITE_Y;
+   t->trans = calloc( (int)(t->w * t->h) / 8 + 1, 1 );
+
+   for (s=0; s<SPRITE_X*SPRITE_Y; s++) {
+      ox = (s % SPRITE_X) * SPRITE_W;
+      oy = (s / SPRITE_X) * SPRITE_H;
+      a  = 10. + util_rand()*20.;
+      b  = 8. + util_rand()*14.;
+      cx = SPRITE_W/2. + util_rand()*6. - 3.;
+      cy = SPRITE_H/2. + util_rand()*6. - 3.;
+      for (y=0; y<SPRITE_H; y++) {
+         for (x=0; x<SPRITE_W; x++) {
+            u  = (x + 0.5 - cx) / a;
+            v  = (y + 0.5 - cy) / b;
+            on = (u*u + v*v < 1.) &&
+                  !(((x/5 + y/7) % 4 == 0) && (u*u + v*v > 0.3));
+            if (on) {
+               k = (oy + y) * (int)t->w + ox + x;
+               t->trans[ k/8 ] |= 1 << (k%8);
+            }
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Checks to see if a point relative to the sprite corner is opaque.
+ */
+static int coll_opaque( const glTexture *t, int sx, int sy, double x, double y )
+{
+   int px, py, rsy;
+
+   px = (int)floor(x);
+   py = (int)floor(y);
+   if ((px < 0) || (py < 0) || (px >= t->sw) || (py >= t->sh))
+      return 0;
+   rsy = t->sy - sy - 1;
+   return !gl_isTrans( t, sx*(int)t->sw + px, rsy*(int)t->sh + py );
+}
+
+
+/**
+ * @brief Finds the first hit by sampling the line finely.
+ */
+static int coll_reference( const Vector2d* ap, double ad, double al,
+      const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
+      Vector2d *crash )
+{
+   double bl[2], d, c, s;
+
+   bl[0] = bp->x - bt->sw/2.;
+   bl[1] = bp->y - bt->sh/2.;
+   c = cos(ad);
+   s = sin(ad);
+   for (d=0.; d<=al; d+=REF_STEP) {
+      if (coll_opaque( bt, bsx, bsy, ap->x + d*c - bl[0], ap->y + d*s - bl[1] )) {
+         crash->x = ap->x + d*c;
+         crash->y = ap->y + d*s;
+         return 1;
+      }
+   }
+   return 0;
+}
+
+
+/**
+ * @brief The routine CollideLineSprite() used before the exact traversal.
+ *
+ * Kept to measure how much the results moved and for the benchmark.
+ */
+static int coll_old( const Vector2d* ap, double ad, double al,
+      const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
+      Vector2d crash[2] )
+{
+   int x,y, rbsy, bbx,bby;
+   double ep[2], bl[2], tr[2], v[2], mod;
+   int hits, real_hits;
+   Vector2d tmp_crash, border[2];
+
+   /* Set up end point of line. */
+   ep[0] = ap->x + al*cos(ad);
+   ep[1] = ap->y + al*sin(ad);
+
+   /* Set up top right corner of the rectangle. */
+   tr[0] = bp->x + bt->sw/2.;
+   tr[1] = bp->y + bt->sh/2.;
+   /* Set up bottom left corner of the rectangle. */
+   bl[0] = bp->x - bt->sw/2.;
+   bl[1] = bp->y - bt->sh/2.;
+
+   /* Rectangular collisions. */
+   hits = 0;
+   if (CollideLineLine(ap->x, ap->y, ep[0], ep[1],
+         bl[0], bl[1], bl[0], tr[1], &tmp_crash) == 1)
+      border[hits++] = tmp_crash;
+   if (CollideLineLine(ap->x, ap->y, ep[0], ep[1],
+         bl[0], tr[1], tr[0], tr[1], &tmp_crash) == 1)
+      border[hits++] = tmp_crash;
+   if ((hits < 2) && CollideLineLine(ap->x, ap->y, ep[0], ep[1],
+         tr[0], tr[1], tr[0], bl[1], &tmp_crash) == 1)
+      border[hits++] = tmp_crash;
+   if ((hits < 2) && CollideLineLine(ap->x, ap->y, ep[0], ep[1],
+         tr[0], bl[1], bl[0], bl[1], &tmp_crash) == 1)
+      border[hits++] = tmp_crash;
+   if (hits == 0)
+      return 0;
+   if (hits == 1) {
+      border[1].x = ep[0];
+      border[1].y = ep[1];
+   }
+
+   /* Sample every two pixels, truncating to ints. */
+   real_hits = 0;
+   v[0] = border[1].x - border[0].x;
+   v[1] = border[1].y - border[0].y;
+   mod = MOD(v[0],v[1])/2.;
+   v[0] /= mod;
+   v[1] /= mod;
+   rbsy = bt->sy - bsy - 1;
+   bbx =  bsx*(int)(bt->sw);
+   bby = rbsy*(int)(bt->sh);
+   x = border[0].x - bl[0] + v[0];
+   y = border[0].y - bl[1] + v[1];
+   while ((x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh)) {
+      if (!gl_isTrans(bt, bbx+(int)x, bby+(int)y)) {
+         crash[real_hits].x = x + bl[0];
+         crash[real_hits].y = y + bl[1];
+         real_hits++;
+         break;
+      }
+      x += v[0];
+      y += v[1];
+   }
+   x = border[1].x - bl[0] - v[0];
+   y = border[1].y - bl[1] - v[1];
+   while ((x > 0.) && (x < bt->sw) && (y > 0.) && (y < bt->sh)) {
+      if (!gl_isTrans(bt, bbx+(int)x, bby+(int)y)) {
+         crash[real_hits].x = x + bl[0];
+         crash[real_hits].y = y + bl[1];
+         real_hits++;
+         break;
+      }
+      x -= v[0];
+      y -= v[1];
+   }
+   if (real_hits == 0)
+      return 0;
+   if (real_hits == 1)
+      crash[1] = crash[0];
+   return 1;
+}
+
+
+/**
+ * @brief Checks CollideLineSprite() against the reference.
+ *
+ * Every hit and miss must match.  The first hit must be where the reference
+ *  finds it, lines grazing a pixel corner can fall between the reference
+ *  samples so a few of them may be off by up to a pixel or two.
+ *
+ *    @return 0 if the check passed.
+ */
+static int coll_check( const glTexture *t, int n )
+{
+   int i, sx, sy, hn, ho, hr, ret;
+   int hits, agree, agree_old, common, corner, bad;
+   double ang, r, ad, al, e, max_ref, sum_old, max_old;
+   Vector2d bp, ap, cn[2], co[2], cr;
+
+   hits      = 0;
+   agree     = 0;
+   agree_old = 0;
+   common    = 0;
+   corner    = 0;
+   bad       = 0;
+   max_ref   = 0.;
+   sum_old   = 0.;
+   max_old   = 0.;
+   bp.x      = 0.;
+   bp.y      = 0.;
+   for (i=0; i<n; i++) {
+      /* Lines aimed roughly at the sprite from all around. */
+      ang  = util_rand() * 2. * M_PI;
+      r    = 30. + util_rand() * 200.;
+      ap.x = r * cos(ang);
+      ap.y = r * sin(ang);
+      ad   = atan2( -ap.y, -ap.x ) + (util_rand() - 0.5) * 0.6;
+      al   = util_rand() * 400.;
+      sx   = util_randInt( SPRITE_X );
+      sy   = util_randInt( SPRITE_Y );
+
+      hn = CollideLineSprite( &ap, ad, al, t, sx, sy, &bp, cn );
+      ho = coll_old( &ap, ad, al, t, sx, sy, &bp, co );
+      hr = coll_reference( &ap, ad, al, t, sx, sy, &bp, &cr );
+      hits      += hn;
+      agree     += (hn == hr);
+      agree_old += (hn == ho);
+
+      if (hn && hr) {
+         e = hypot( cn[0].x - cr.x, cn[0].y - cr.y );
+         max_ref = MAX( max_ref, e );
+         if (e > HIT_CORNER)
+            bad++;
+         else if (e > HIT_EXACT)
+            corner++;
+      }
+      if (hn && ho) {
+         e = hypot( cn[0].x - co[0].x, cn[0].y - co[0].y );
+         sum_old += e;
+         max_old  = MAX( max_old, e );
+         common++;
+      }
+   }
+
+   printf( "%d lines, %d hits\n", n, hits );
+   printf( "   reference: %d agree, first hit off by at most %.4f px, %d grazing corners\n",
+         agree, max_ref, corner );
+   printf( "   old:       %d agree, first hit off by %.2f px on average, %.2f px at most\n",
+         agree_old, (common > 0) ? sum_old / (double)common : 0., max_old );
+
+   ret = 0;
+   if (agree != n) {
+      WARN("%d lines disagree with the reference on hitting.", n - agree);
+      ret = -1;
+   }
+   if (bad > 0) {
+      WARN("%d hits are more than %.0f px from the reference.", bad, HIT_CORNER);
+      ret = -1;
+   }
+   if (corner > CORNER_RATIO * (double)MAX(hits,1)) {
+      WARN("%d hits are not exact, too many to be corners.", corner);
+      ret = -1;
+   }
+   return ret;
+}
+
+
+/**
+ * @brief Benchmarks beams against a dense fleet with both routines.
+ */
+static void coll_bench( const glTexture *t, int beams, int pilots, int frames )
+{
+   int i, j, k, w;
+   long hits;
+   double start, dt[2];
+   Vector2d *pp, *bpos, crash[2];
+   double *bd;
+
+   pp   = malloc( sizeof(Vector2d) * pilots );
+   bpos = malloc( sizeof(Vector2d) * beams );
+   bd   = malloc( sizeof(double) * beams );
+   for (i=0; i<pilots; i++) {
+      pp[i].x = util_rand() * 3000.;
+      pp[i].y = util_rand() * 3000.;
+   }
+   for (i=0; i<beams; i++) {
+      bpos[i].x = util_rand() * 3000.;
+      bpos[i].y = util_rand() * 3000.;
+      bd[i]     = util_rand() * 2. * M_PI;
+   }
+
+   printf( "%d beams of range 500 against %d pilots over 3000x3000\n", beams, pilots );
+   for (w=0; w<2; w++) {
+      hits  = 0;
+      start = util_time();
+      for (k=0; k<frames; k++)
+         for (i=0; i<beams; i++)
+            for (j=0; j<pilots; j++)
+               hits += (w==0) ?
+                     coll_old( &bpos[i], bd[i], 500., t,
+                        j % SPRITE_X, j % SPRITE_Y, &pp[j], crash ) :
+                     CollideLineSprite( &bpos[i], bd[i], 500., t,
+                        j % SPRITE_X, j % SPRITE_Y, &pp[j], crash );
+      dt[w] = (util_time() - start) / (double)MAX(frames,1);
+      printf( "   %s %8.3f ms per frame, %ld hits\n", (w==0) ? "old" : "new",
+            dt[w] * 1000., hits / MAX(frames,1) );
+   }
+   if (dt[1] > 0.)
+      printf( "   %.1fx faster\n", dt[0] / dt[1] );
+
+   free( pp );
+   free( bpos );
+   free( bd );
+}
+
+
+int main( int argc, char** argv )
+{
+   static struct option long_options[] = {
+      { "help", no_argument, 0, 'h' },
+      { "lines", required_argument, 0, 'n' },
+      { "beams", required_argument, 0, 'b' },
+      { "pilots", required_argument, 0, 'p' },
+      { "frames", required_argument, 0, 'f' },
+      { "seed", required_argument, 0, 'r' },
+      { "check", no_argument, 0, 'c' },
+      { NULL, 0, 0, 0 }
+   };
+   int option_index;
+   int c, ret;
+   int lines, beams, pilots, frames, check;
+   unsigned int seed;
+   glTexture t;
+
+   /* Defaults. */
+   lines  = 20000;
+   beams  = 100;
+   pilots = 300;
+   frames = 50;
+   seed   = 7;
+   check  = 0;
+
+   /* Handle parameters. */
+   while ((c = getopt_long( argc, argv,
+         "hn:b:p:f:r:c",
+         long_options, &option_index)) != -1) {
+      switch (c) {
+         case 'h':
+            print_usage( argv[0] );
+            exit(EXIT_SUCCESS);
+         case 'n':
+            lines = atoi(optarg);
+            break;
+         case 'b':
+            beams = atoi(optarg);
+            break;
+         case 'p':
+            pilots = atoi(optarg);
+            break;
+         case 'f':
+            frames = atoi(optarg);
+            break;
+         case 'r':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+         case 'c':
+            check = 1;
+            break;
+         default:
+            print_usage( argv[0] );
+            exit(EXIT_FAILURE);
+      }
+   }
+
+   util_seed( seed );
+   coll_sheet( &t );
+
+   ret = coll_check( &t, lines );
+   if (!check)
+      coll_bench( &t, beams, pilots, frames );
+
+   free( t.trans );
+   exit( (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
@@ -0,0 +1,114 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file util.c
+ *
+ * @brief Helpers shared by the standalone tools.
+ *
+ * Holds the ndata_read() that replaces the game's so the tools can read the
+ *  data files straight from a directory, a wall clock timer and a seedable
+ *  random number source that stays apart from the game's own generator.
+ */
+
+
+#include "util.h"
+
+#include <stdlib.h> /* malloc() */
+#include <stdio.h> /* fopen() */
+#include <limits.h> /* PATH_MAX */
+#include <sys/time.h> /* gettimeofday() */
+
+#include "naev.h"
+#include "ndata.h"
+#include "log.h"
+
+
+static const char *util_datadir = "."; /**< Where to read data from. */
+
+
+/**
+ * @brief Sets the directory ndata_read() reads from.
+ *
+ *    @param datadir Directory holding the data files, must stay valid.
+ */
+void util_setDatadir( const char *datadir )
+{
+   util_datadir = datadir;
+}
+
+
+/**
+ * @brief Reads a file relative to the data directory.
+ *
+ * Replaces the ndata version so the game code linked into the tools can load
+ *  its data files.
+ */
+void* ndata_read( const char* filename, uint32_t *filesize )
+{
+   char path[PATH_MAX];
+   FILE *f;
+   long size;
+   char *buf;
+
+   snprintf( path, sizeof(path), "%s/%s", util_datadir, filename );
+   f = fopen( path, "rb" );
+   if (f == NULL) {
+      WARN("Unable to open '%s'.", path);
+      return NULL;
+   }
+   fseek( f, 0, SEEK_END );
+   size = ftell( f );
+   fseek( f, 0, SEEK_SET );
+   buf = malloc( size+1 );
+   if ((buf == NULL) || (fread( buf, 1, size, f ) != (size_t)size)) {
+      WARN("Unable to read '%s'.", path);
+      free(buf);
+      fclose(f);
+      return NULL;
+   }
+   buf[size] = '\0';
+   fclose(f);
+
+   *filesize = (uint32_t)size;
+   return buf;
+}
+
+
+/**
+ * @brief Gets the wall clock time in seconds.
+ */
+double util_time (void)
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.;
+}
+
+
+/**
+ * @brief Seeds the tool's random numbers.
+ */
+void util_seed( unsigned int seed )
+{
+   srand( seed );
+}
+
+
+/**
+ * @brief Gets a random number in [0:1).
+ */
+double util_rand (void)
+{
+   return (double)rand() / ((double)RAND_MAX + 1.);
+}
+
+
+/**
+ * @brief Gets a random integer in [0:n).
+ */
+int util_randInt( int n )
+{
+   return (int)(util_rand() * (double)n);
+}
@@ -0,0 +1,29 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+
+#ifndef UTIL_H
+#  define UTIL_H
+
+
+/*
+ * Data.
+ */
+void util_setDatadir( const char *datadir );
+
+/*
+ * Timing.
+ */
+double util_time (void);
+
+/*
+ * Random numbers.
+ */
+void util_seed( unsigned int seed );
+double util_rand (void);
+int util_randInt( int n );
+
+
+#endif /* UTIL_H */
@@ -0,0 +1,758 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Standalone economy simulator.
+ *
+ * Loads the universe (or generates a synthetic one) and steps the real
+ *  economy_update() over a long time horizon without running the game.  Prices
+ *  are dumped as a CSV time series and the time taken by every step is
+ *  recorded so the solver scaling can be measured.
+ */
+
+
+#include <stdlib.h> /* exit() */
+#include <stdio.h> /* printf() */
+#include <string.h> /* strcmp() */
+#include <stdint.h> /* uint32_t */
+#include <math.h> /* sqrt() */
+#include <unistd.h> /* getopt */
+#include <getopt.h> /* getopt_long */
+
+#include "naev.h"
+#include "nxml.h"
+#include "economy.h"
+#include "space.h"
+#include "faction.h"
+#include "spfx.h"
+#include "pilot.h"
+#include "ntime.h"
+#include "ndata.h"
+#include "rng.h"
+#include "log.h"
+#include "util.h"
+
+
+#define SYSTEM_DATA     "dat/ssys.xml" /**< Star system XML file. */
+#define PLANET_DATA     "dat/planet.xml" /**< Planet XML file. */
+#define FACTION_DATA    "dat/faction.xml" /**< Faction XML file. */
+
+#define SYNTH_JUMPS     3 /**< Average jumps per synthetic system. */
+#define SYNTH_PLANETS   2 /**< Maximum planets per synthetic system. */
+
+
+/**
+ * @brief Minimal faction relationship information.
+ */
+typedef struct SimFaction_ {
+   char *name; /**< Faction name. */
+   char **allies; /**< Names of allies. */
+   int nallies; /**< Number of allies. */
+   char **enemies; /**< Names of enemies. */
+   int nenemies; /**< Number of enemies. */
+} SimFaction;
+
+
+/* Universe, economy.c externs the systems. */
+StarSystem *systems_stack     = NULL; /**< Star system stack. */
+int systems_nstack            = 0; /**< Number of star systems. */
+static Planet *planet_stack   = NULL; /**< Planet stack. */
+static int planet_nstack      = 0; /**< Number of planets. */
+static SimFaction *sim_factions = NULL; /**< Factions. */
+static int sim_nfactions      = 0; /**< Number of factions. */
+
+
+/*
+ * Prototypes.
+ */
+static void print_usage( char *appname );
+static char** sim_parseList( xmlNodePtr parent, const char *tag, int *n );
+static int sim_loadFactions (void);
+static int sim_getFaction( const char *name );
+static int sim_loadPlanets (void);
+static Planet* sim_getPlanet( const char *name );
+static int sim_loadSystems (void);
+static int sim_synthetic( int n );
+static int sim_outputSystem( const char *list, const char *name );
+static int sim_getPrices( unsigned int *prices );
+static int sim_check( int steps, unsigned int dt, uint32_t seed );
+/* Needed by economy.c */
+int areEnemies( int a, int b );
+int areAllies( int a, int b );
+int spfx_get( char* name );
+void spfx_add( const int effect,
+      const double px, const double py,
+      const double vx, const double vy,
+      const int layer );
+Pilot* pilot_get( const unsigned int id );
+/* Exported by economy.c */
+unsigned int economy_getPrice( const Commodity *com,
+      const StarSystem *sys, const Planet *p );
+
+
+static void print_usage( char *appname )
+{
+   printf(
+         "Usage is: %s [options] [datadir]\n"
+         "   Steps the economy and prints prices as CSV.\n"
+         "   Options:\n"
+         "     -n, --steps N       Number of steps to simulate (default 100).\n"
+         "     -d, --dt STU        Time per step in STU (default 10).\n"
+         "     -e, --every N       Only output prices every N steps (default 1).\n"
+         "     -g, --synthetic N   Generate a synthetic universe of N systems.\n"
+         "     -s, --systems LIST  Comma separated systems to output (default all).\n"
+         "     -o, --output FILE   Write prices to FILE instead of stdout.\n"
+         "     -t, --timing FILE   Write per step timing CSV to FILE.\n"
+         "     -r, --seed N        Seed the random number generator.\n"
+         "     -q, --quiet         Don't output prices, just time.\n"
+         "     -c, --check         Check that one long update matches stepping.\n"
+         , appname );
+}
+
+
+/**
+ * @brief Gets the price of every commodity in every system.
+ *
+ *    @param[out] prices Prices, if NULL they are only counted.
+ *    @return Number of prices.
+ */
+static int sim_getPrices( unsigned int *prices )
+{
+   int i, j, n;
+   Commodity *com;
+
+   n = 0;
+   for (i=0; i<systems_nstack; i++) {
+      for (j=0; (com = commodity_getN(j)) != NULL; j++) {
+         if (com->price <= 0.)
+            continue;
+         if (prices != NULL)
+            prices[n] = economy_getPrice( com, &systems_stack[i], NULL );
+         n++;
+      }
+   }
+   return n;
+}
+
+
+/**
+ * @brief Checks that updating the economy once over a long time gives the same
+ *  prices as stepping it over the same time.
+ *
+ *    @param steps Number of steps.
+ *    @param dt Time per step in STU.
+ *    @param seed Seed to use for both runs.
+ *    @return 0 if both agree.
+ */
+static int sim_check( int steps, unsigned int dt, uint32_t seed )
+{
+   int i, n, bad;
+   double *prod;
+   unsigned int *stepped, *coalesced;
+
+   /* Save the initial production. */
+   prod = malloc( sizeof(double) * planet_nstack );
+   for (i=0; i<planet_nstack; i++)
+      prod[i] = planet_stack[i].cur_prodfactor;
+   n         = sim_getPrices( NULL );
+   stepped   = malloc( sizeof(unsigned int) * n );
+   coalesced = malloc( sizeof(unsigned int) * n );
+
+   /* Stepped. */
+   rng_initSeed( seed );
+   for (i=0; i<steps; i++)
+      economy_update( dt * NTIME_UNIT_LENGTH );
+   sim_getPrices( stepped );
+
+   /* Coalesced, from the same starting state. */
+   economy_destroy();
+   for (i=0; i<planet_nstack; i++)
+      planet_stack[i].cur_prodfactor = prod[i];
+   economy_init();
+   rng_initSeed( seed );
+   economy_update( steps * dt * NTIME_UNIT_LENGTH );
+   sim_getPrices( coalesced );
+
+   /* Compare. */
+   bad = 0;
+   for (i=0; i<n; i++)
+      if (stepped[i] != coalesced[i])
+         bad++;
+   if (bad > 0)
+      fprintf( stderr, "Check failed: %d of %d prices differ after %d steps of %u STU\n",
+            bad, n, steps, dt );
+   else
+      fprintf( stderr, "Check passed: %d prices agree after %d steps of %u STU\n",
+            n, steps, dt );
+
+   free(prod);
+   free(stepped);
+   free(coalesced);
+   return (bad > 0) ? -1 : 0;
+}
+
+
+/**
+ * @brief Parses a list of child nodes into strings.
+ */
+static char** sim_parseList( xmlNodePtr parent, const char *tag, int *n )
+{
+   xmlNodePtr node;
+   char **list;
+
+   list = NULL;
+   *n   = 0;
+   node = parent->xmlChildrenNode;
+   do {
+      if (xml_isNode(node, tag) && (xml_get(node) != NULL)) {
+         list = realloc( list, sizeof(char*) * ++(*n) );
+         list[*n-1] = xml_getStrd(node);
+      }
+   } while (xml_nextNode(node));
+
+   return list;
+}
+
+
+/**
+ * @brief Loads the faction relationships.
+ */
+static int sim_loadFactions (void)
+{
+   uint32_t bufsize;
+   char *buf;
+   xmlNodePtr node, cur;
+   xmlDocPtr doc;
+   SimFaction *f;
+
+   buf = ndata_read( FACTION_DATA, &bufsize );
+   if (buf == NULL)
+      return -1;
+   doc = xmlParseMemory( buf, bufsize );
+   if (doc == NULL) {
+      WARN("'%s' is not valid XML.", FACTION_DATA);
+      free(buf);
+      return -1;
+   }
+
+   node = doc->xmlChildrenNode->xmlChildrenNode;
+   do {
+      if (!xml_isNode(node, "faction"))
+         continue;
+      sim_factions = realloc( sim_factions, sizeof(SimFaction) * ++sim_nfactions );
+      f = &sim_factions[ sim_nfactions-1 ];
+      memset( f, 0, sizeof(SimFaction) );
+      f->name = xml_nodeProp( node, "name" );
+      cur = node->xmlChildrenNode;
+      do {
+         if (xml_isNode(cur, "allies"))
+            f->allies = sim_parseList( cur, "ally", &f->nallies );
+         else if (xml_isNode(cur, "enemies"))
+            f->enemies = sim_parseList( cur, "enemy", &f->nenemies );
+      } while (xml_nextNode(cur));
+   } while (xml_nextNode(node));
+
+   xmlFreeDoc(doc);
+   free(buf);
+   return 0;
+}
+
+
+/**
+ * @brief Gets a faction by name, -1 if not found.
+ */
+static int sim_getFaction( const char *name )
+{
+   int i;
+   for (i=0; i<sim_nfactions; i++)
+      if (strcmp(sim_factions[i].name, name)==0)
+         return i;
+   return -1;
+}
+
+
+/**
+ * @brief Checks to see if two factions are enemies.
+ */
+int areEnemies( int a, int b )
+{
+   int i;
+   if ((a==b) || (a<0) || (b<0))
+      return 0;
+   for (i=0; i<sim_factions[a].nenemies; i++)
+      if (strcmp(sim_factions[a].enemies[i], sim_factions[b].name)==0)
+         return 1;
+   for (i=0; i<sim_factions[b].nenemies; i++)
+      if (strcmp(sim_factions[b].enemies[i], sim_factions[a].name)==0)
+         return 1;
+   return 0;
+}
+
+
+/**
+ * @brief Checks to see if two factions are allies.
+ */
+int areAllies( int a, int b )
+{
+   int i;
+   if (a==b)
+      return 1;
+   if ((a<0) || (b<0))
+      return 0;
+   for (i=0; i<sim_factions[a].nallies; i++)
+      if (strcmp(sim_factions[a].allies[i], sim_factions[b].name)==0)
+         return 1;
+   for (i=0; i<sim_factions[b].nallies; i++)
+      if (strcmp(sim_factions[b].allies[i], sim_factions[a].name)==0)
+         return 1;
+   return 0;
+}
+
+
+/*
+ * Effects and pilots don't exist here, only jettisoning uses them.
+ */
+int spfx_get( char* name ) { (void) name; return -1; }
+void spfx_add( const int effect,
+      const double px, const double py,
+      const double vx, const double vy,
+      const int layer )
+{ (void) effect; (void) px; (void) py; (void) vx; (void) vy; (void) layer; }
+Pilot* pilot_get( const unsigned int id ) { (void) id; return NULL; }
+
+
+/**
+ * @brief Loads the economically relevant part of the planets.
+ */
+static int sim_loadPlanets (void)
+{
+   uint32_t bufsize;
+   char *buf, *faction;
+   xmlNodePtr node, cur, ccur, scur;
+   xmlDocPtr doc;
+   Planet *p;
+
+   buf = ndata_read( PLANET_DATA, &bufsize );
+   if (buf == NULL)
+      return -1;
+   doc = xmlParseMemory( buf, bufsize );
+   if (doc == NULL) {
+      WARN("'%s' is not valid XML.", PLANET_DATA);
+      free(buf);
+      return -1;
+   }
+
+   node = doc->xmlChildrenNode->xmlChildrenNode;
+   do {
+      if (!xml_isNode(node, "planet"))
+         continue;
+      planet_stack = realloc( planet_stack, sizeof(Planet) * ++planet_nstack );
+      p = &planet_stack[ planet_nstack-1 ];
+      memset( p, 0, sizeof(Planet) );
+      p->name    = xml_nodeProp( node, "name" );
+      p->faction = -1;
+      cur = node->xmlChildrenNode;
+      do {
+         if (!xml_isNode(cur, "general"))
+            continue;
+         ccur = cur->xmlChildrenNode;
+         do {
+            xmlr_int(ccur, "population", p->population );
+            xmlr_float(ccur, "prodfactor", p->prodfactor );
+            if (xml_isNode(ccur, "faction")) {
+               faction = xml_get(ccur);
+               if (faction != NULL)
+                  p->faction = sim_getFaction( faction );
+            }
+            /* Any service other than landing makes the planet inhabited. */
+            else if (xml_isNode(ccur, "services")) {
+               scur = ccur->xmlChildrenNode;
+               do {
+                  if ((scur != NULL) && (scur->type == XML_NODE_START) &&
+                        !xml_isNode(scur, "land"))
+                     p->services |= PLANET_SERVICE_INHABITED;
+               } while (xml_nextNode(scur));
+            }
+         } while (xml_nextNode(ccur));
+      } while (xml_nextNode(cur));
+      p->cur_prodfactor = p->prodfactor;
+   } while (xml_nextNode(node));
+
+   xmlFreeDoc(doc);
+   free(buf);
+   return 0;
+}
+
+
+/**
+ * @brief Gets a planet by name.
+ */
+static Planet* sim_getPlanet( const char *name )
+{
+   int i;
+   for (i=0; i<planet_nstack; i++)
+      if (strcmp(planet_stack[i].name, name)==0)
+         return &planet_stack[i];
+   WARN("Planet '%s' not found.", name);
+   return NULL;
+}
+
+
+/**
+ * @brief Loads the economically relevant part of the star systems.
+ */
+static int sim_loadSystems (void)
+{
+   uint32_t bufsize;
+   char *buf, *ptrc;
+   char ***jumps, **planets;
+   int *njumps;
+   int i, j, k, n;
+   xmlNodePtr node, cur, ccur;
+   xmlDocPtr doc;
+   StarSystem *sys;
+   Planet *p;
+
+   buf = ndata_read( SYSTEM_DATA, &bufsize );
+   if (buf == NULL)
+      return -1;
+   doc = xmlParseMemory( buf, bufsize );
+   if (doc == NULL) {
+      WARN("'%s' is not valid XML.", SYSTEM_DATA);
+      free(buf);
+      return -1;
+   }
+
+   /* First pass loads everything but the jumps which are names. */
+   jumps  = NULL;
+   njumps = NULL;
+   node = doc->xmlChildrenNode->xmlChildrenNode;
+   do {
+      if (!xml_isNode(node, "ssys"))
+         continue;
+      systems_stack = realloc( systems_stack, sizeof(StarSystem) * ++systems_nstack );
+      jumps  = realloc( jumps,  sizeof(char**) * systems_nstack );
+      njumps = realloc( njumps, sizeof(int) * systems_nstack );
+      sys = &systems_stack[ systems_nstack-1 ];
+      memset( sys, 0, sizeof(StarSystem) );
+      sys->name    = xml_nodeProp( node, "name" );
+      sys->faction = -1;
+      jumps[ systems_nstack-1 ]  = NULL;
+      njumps[ systems_nstack-1 ] = 0;
+      cur = node->xmlChildrenNode;
+      do {
+         if (xml_isNode(cur, "planets")) {
+            planets = sim_parseList( cur, "planet", &n );
+            for (i=0; i<n; i++) {
+               p = sim_getPlanet( planets[i] );
+               if (p != NULL) {
+                  sys->planets = realloc( sys->planets, sizeof(Planet*) * ++sys->nplanets );
+                  sys->planets[ sys->nplanets-1 ] = p;
+                  /* Same as space.c, last planet with a faction wins. */
+                  if (p->faction != -1)
+                     sys->faction = p->faction;
+               }
+               free( planets[i] );
+            }
+            free( planets );
+         }
+         else if (xml_isNode(cur, "jumps"))
+            jumps[ systems_nstack-1 ] = sim_parseList( cur, "jump",
+                  &njumps[ systems_nstack-1 ] );
+         else if (xml_isNode(cur, "general")) {
+            ccur = cur->xmlChildrenNode;
+            do {
+               if (xml_isNode(ccur, "nebula")) {
+                  ptrc = xml_nodeProp( ccur, "volatility" );
+                  if (ptrc != NULL) {
+                     sys->nebu_volatility = atof(ptrc);
+                     free(ptrc);
+                  }
+                  sys->nebu_density = xml_getFloat(ccur);
+               }
+            } while (xml_nextNode(ccur));
+         }
+      } while (xml_nextNode(cur));
+   } while (xml_nextNode(node));
+
+   /* Second pass resolves the jumps. */
+   for (i=0; i<systems_nstack; i++) {
+      sys = &systems_stack[i];
+      sys->jumps = malloc( sizeof(int) * MAX(njumps[i],1) );
+      for (j=0; j<njumps[i]; j++) {
+         for (k=0; k<systems_nstack; k++)
+            if (strcmp(systems_stack[k].name, jumps[i][j])==0)
+               break;
+         if (k < systems_nstack)
+            sys->jumps[ sys->njumps++ ] = k;
+         else
+            WARN("System '%s' has jump to unknown system '%s'.", sys->name, jumps[i][j]);
+         free( jumps[i][j] );
+      }
+      free( jumps[i] );
+   }
+   free( jumps );
+   free( njumps );
+
+   xmlFreeDoc(doc);
+   free(buf);
+   return 0;
+}
+
+
+/**
+ * @brief Generates a synthetic universe.
+ *
+ * Systems are laid out on a ring with additional random jumps to nearby
+ *  systems so the admittance matrix stays sparse and banded much like a real
+ *  universe.
+ *
+ *    @param n Number of systems to generate.
+ *    @return 0 on success.
+ */
+static int sim_synthetic( int n )
+{
+   int i, j, k, l, m;
+   char buf[64];
+   StarSystem *sys;
+   Planet *p;
+
+   systems_nstack = n;
+   systems_stack  = calloc( n, sizeof(StarSystem) );
+   planet_nstack  = n * SYNTH_PLANETS;
+   planet_stack   = calloc( planet_nstack, sizeof(Planet) );
+
+   for (i=0; i<n; i++) {
+      sys = &systems_stack[i];
+      snprintf( buf, sizeof(buf), "Synthetic %d", i );
+      sys->name    = strdup( buf );
+      sys->faction = (sim_nfactions > 0) ? RNG( 0, sim_nfactions-1 ) : -1;
+      sys->jumps   = malloc( sizeof(int) * 2 * SYNTH_JUMPS );
+
+      /* Planets. */
+      sys->planets = malloc( sizeof(Planet*) * SYNTH_PLANETS );
+      m = RNG( 0, SYNTH_PLANETS );
+      for (j=0; j<m; j++) {
+         p = &planet_stack[ i*SYNTH_PLANETS + j ];
+         snprintf( buf, sizeof(buf), "Synthetic %d-%d", i, j );
+         p->name           = strdup( buf );
+         p->faction        = sys->faction;
+         p->population     = RNG( 1000, 20000000 );
+         p->prodfactor     = 0.1 + RNGF();
+         p->cur_prodfactor = p->prodfactor;
+         p->services       = PLANET_SERVICE_INHABITED;
+         sys->planets[ sys->nplanets++ ] = p;
+      }
+   }
+
+   /* Jumps, always keep the ring so it's connected. */
+   for (i=0; i<n; i++) {
+      m = RNG( 0, SYNTH_JUMPS-1 );
+      for (j=0; j<=m; j++) {
+         k = (j==0) ? (i+1) % n : (i + RNG( 2, 32 )) % n;
+         if ((k == i) || (systems_stack[i].njumps >= 2*SYNTH_JUMPS) ||
+               (systems_stack[k].njumps >= 2*SYNTH_JUMPS))
+            continue;
+         for (l=0; l<systems_stack[i].njumps; l++)
+            if (systems_stack[i].jumps[l] == k)
+               break;
+         if (l < systems_stack[i].njumps)
+            continue;
+         systems_stack[i].jumps[ systems_stack[i].njumps++ ] = k;
+         systems_stack[k].jumps[ systems_stack[k].njumps++ ] = i;
+      }
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Checks to see if a system is in the comma separated output list.
+ */
+static int sim_outputSystem( const char *list, const char *name )
+{
+   const char *s;
+   size_t len;
+
+   if (list == NULL)
+      return 1;
+
+   len = strlen(name);
+   for (s=list; s!=NULL; s=strchr(s,',')) {
+      if (*s == ',')
+         s++;
+      if ((strncmp(s, name, len)==0) && ((s[len]==',') || (s[len]=='\0')))
+         return 1;
+   }
+   return 0;
+}
+
+
+int main( int argc, char** argv )
+{
+   static struct option long_options[] = {
+      { "help", no_argument, 0, 'h' },
+      { "steps", required_argument, 0, 'n' },
+      { "dt", required_argument, 0, 'd' },
+      { "every", required_argument, 0, 'e' },
+      { "synthetic", required_argument, 0, 'g' },
+      { "systems", required_argument, 0, 's' },
+      { "output", required_argument, 0, 'o' },
+      { "timing", required_argument, 0, 't' },
+      { "seed", required_argument, 0, 'r' },
+      { "quiet", no_argument, 0, 'q' },
+      { "check", no_argument, 0, 'c' },
+      { NULL, 0, 0, 0 }
+   };
+   int option_index;
+   int c, i, j, k;
+   int steps, every, synthetic, quiet, check;
+   uint32_t seed;
+   unsigned int dt, t;
+   char *systems;
+   FILE *fout, *ftime;
+   double start, step, total, worst;
+   Commodity *com;
+
+   /* Defaults. */
+   steps     = 100;
+   dt        = 10;
+   every     = 1;
+   synthetic = 0;
+   quiet     = 0;
+   check     = 0;
+   seed      = 0;
+   systems   = NULL;
+   fout      = stdout;
+   ftime     = NULL;
+   rng_init();
+
+   /* Handle parameters. */
+   while ((c = getopt_long( argc, argv,
+         "hn:d:e:g:s:o:t:r:qc",
+         long_options, &option_index)) != -1) {
+      switch (c) {
+         case 'h':
+            print_usage( argv[0] );
+            exit(EXIT_SUCCESS);
+         case 'n':
+            steps = atoi(optarg);
+            break;
+         case 'd':
+            dt = strtoul(optarg, NULL, 10);
+            break;
+         case 'e':
+            every = MAX( 1, atoi(optarg) );
+            break;
+         case 'g':
+            synthetic = atoi(optarg);
+            break;
+         case 's':
+            systems = optarg;
+            break;
+         case 'o':
+            fout = fopen( optarg, "w" );
+            if (fout == NULL)
+               ERR("Unable to open '%s' for writing.", optarg);
+            break;
+         case 't':
+            ftime = fopen( optarg, "w" );
+            if (ftime == NULL)
+               ERR("Unable to open '%s' for writing.", optarg);
+            break;
+         case 'r':
+            seed = strtoul(optarg, NULL, 10);
+            rng_initSeed( seed );
+            break;
+         case 'q':
+            quiet = 1;
+            break;
+         case 'c':
+            check = 1;
+            break;
+         default:
+            print_usage( argv[0] );
+            exit(EXIT_FAILURE);
+      }
+   }
+   if (optind < argc)
+      util_setDatadir( argv[optind] );
+
+   /* Load the data. */
+   start = util_time();
+   if (commodity_load())
+      ERR("Unable to load commodities.");
+   if (sim_loadFactions())
+      WARN("Unable to load factions, all systems will be neutral.");
+   if (synthetic > 0)
+      sim_synthetic( synthetic );
+   else if (sim_loadPlanets() || sim_loadSystems())
+      ERR("Unable to load the universe.");
+   fprintf( stderr, "Loaded %d systems in %.3f s\n", systems_nstack, util_time() - start );
+
+   /* Initialize, this also factorizes the matrix. */
+   start = util_time();
+   economy_init();
+   fprintf( stderr, "Initialized economy in %.3f s\n", util_time() - start );
+
+   /* Only check. */
+   if (check) {
+      c = sim_check( steps, dt, seed );
+      economy_destroy();
+      commodity_free();
+      exit( (c == 0) ? EXIT_SUCCESS : EXIT_FAILURE );
+   }
+
+   /* Get the commodities with prices. */
+   if (!quiet)
+      fprintf( fout, "step,time,system,commodity,price\n" );
+   if (ftime != NULL)
+      fprintf( ftime, "step,time,seconds\n" );
+
+   /* Simulate. */
+   t     = 0;
+   total = 0.;
+   worst = 0.;
+   for (i=0; i<=steps; i++) {
+      if (i > 0) {
+         start = util_time();
+         economy_update( dt * NTIME_UNIT_LENGTH );
+         step  = util_time() - start;
+         total += step;
+         worst  = MAX( worst, step );
+         t     += dt * NTIME_UNIT_LENGTH;
+         if (ftime != NULL)
+            fprintf( ftime, "%d,%u,%.9f\n", i, t, step );
+      }
+
+      if (quiet || (i % every != 0))
+         continue;
+      for (j=0; j<systems_nstack; j++) {
+         if (!sim_outputSystem( systems, systems_stack[j].name ))
+            continue;
+         for (k=0; (com = commodity_getN(k)) != NULL; k++) {
+            if (com->price <= 0.)
+               continue;
+            fprintf( fout, "%d,%u,\"%s\",\"%s\",%u\n", i, t,
+                  systems_stack[j].name, com->name,
+                  economy_getPrice( com, &systems_stack[j], NULL ) );
+         }
+      }
+   }
+   fprintf( stderr, "Simulated %d steps of %u STU: %.6f s total, %.6f s average, %.6f s worst\n",
+         steps, dt, total, (steps > 0) ? total / (double)steps : 0., worst );
+
+   /* Clean up. */
+   economy_destroy();
+   commodity_free();
+   if (fout != stdout)
+      fclose( fout );
+   if (ftime != NULL)
+      fclose( ftime );
+
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,311 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Benchmarks looking pilots up by ID.
+ *
+ * Compares the two ways pilot_get() has found pilots: a binary search over the
+ *  pilot stack sorted by ID, and the arena handles pilot.c uses now where the
+ *  ID holds the slot and a generation.  The pilots live in chunks like the
+ *  pilot arena and are spread over random slots as they are after a long
+ *  game.  Both lookups are copies of the ones in pilot.c and are run with the
+ *  same random pilots.
+ */
+
+
+#include <stdlib.h> /* exit() */
+#include <stdio.h> /* printf() */
+#include <string.h> /* memset() */
+#include <getopt.h> /* getopt_long */
+
+#include "naev.h"
+#include "pilot.h"
+#include "log.h"
+#include "util.h"
+
+
+#define GET_CHUNK       128 /**< Pilots per arena chunk, as in pilot.c. */
+#define GET_SLOTBITS    16 /**< Bits of the ID used for the arena slot. */
+#define GET_SLOTMASK    ((1U<<GET_SLOTBITS)-1) /**< Mask of the slot in an ID. */
+#define GET_MAX         60000 /**< Most pilots the handles can hold. */
+
+
+/**
+ * @brief Chunk of the pilot arena.
+ */
+typedef struct GetChunk_ {
+   Solid solids[GET_CHUNK]; /**< Physics state of the pilots. */
+   Pilot pilots[GET_CHUNK]; /**< The pilots. */
+} GetChunk;
+
+
+/**
+ * @brief Handle of an arena slot.
+ */
+typedef struct GetHandle_ {
+   unsigned int id; /**< Last ID given out for the slot. */
+   Pilot *p; /**< Pilot with that ID or NULL. */
+} GetHandle;
+
+
+static GetChunk **get_chunks = NULL; /**< Arena chunks. */
+static int get_nchunks = 0; /**< Arena chunks allocated. */
+static GetHandle *get_handles = NULL; /**< Handles of the arena slots. */
+static Pilot **get_stack = NULL; /**< Pilot stack, sorted by ID. */
+static int get_nstack = 0; /**< Pilots in the stack. */
+
+
+/*
+ * Prototypes.
+ */
+static void print_usage( char *appname );
+static void get_create( int n );
+static void get_free (void);
+static Pilot* get_search( const unsigned int id );
+static Pilot* get_handle( const unsigned int id );
+static double get_time( Pilot* (*get)(const unsigned int), const unsigned int *ids,
+      int nids, int lookups );
+static void get_bench( int n, int lookups );
+
+
+static void print_usage( char *appname )
+{
+   printf(
+         "Usage is: %s [options]\n"
+         "   Benchmarks looking pilots up by ID with a binary search and with handles.\n"
+         "   Options:\n"
+         "     -n, --pilots N      Number of pilots (default 100, 1000, 10000 and 60000).\n"
+         "     -l, --lookups N     Lookups to time (default 20000000).\n"
+         "     -r, --seed N        Seed the random number generator.\n"
+         "     -h, --help          Display this message and exit.\n",
+         appname );
+}
+
+
+/**
+ * @brief Puts n pilots in random slots of the arena.
+ *
+ * The stack gets them in creation order so the plain IDs are sorted.
+ */
+static void get_create( int n )
+{
+   int i, j, t, nslots;
+   int *slots;
+   Pilot *p;
+
+   get_nchunks = (n + GET_CHUNK - 1) / GET_CHUNK;
+   nslots      = get_nchunks * GET_CHUNK;
+   get_chunks  = malloc( sizeof(GetChunk*) * get_nchunks );
+   for (i=0; i<get_nchunks; i++)
+      get_chunks[i] = calloc( 1, sizeof(GetChunk) );
+   get_handles = calloc( nslots, sizeof(GetHandle) );
+   get_stack   = malloc( sizeof(Pilot*) * n );
+   get_nstack  = n;
+
+   /* Shuffle the slots. */
+   slots = malloc( sizeof(int) * nslots );
+   for (i=0; i<nslots; i++)
+      slots[i] = i;
+   for (i=nslots-1; i>0; i--) {
+      j        = util_randInt( i+1 );
+      t        = slots[i];
+      slots[i] = slots[j];
+      slots[j] = t;
+   }
+
+   for (i=0; i<n; i++) {
+      p        = &get_chunks[ slots[i] / GET_CHUNK ]->pilots[ slots[i] % GET_CHUNK ];
+      p->slot  = slots[i];
+      p->solid = &get_chunks[ slots[i] / GET_CHUNK ]->solids[ slots[i] % GET_CHUNK ];
+      get_stack[i] = p;
+   }
+   free( slots );
+}
+
+
+/**
+ * @brief Frees the arena.
+ */
+static void get_free (void)
+{
+   int i;
+
+   for (i=0; i<get_nchunks; i++)
+      free( get_chunks[i] );
+   free( get_chunks );
+   free( get_handles );
+   free( get_stack );
+   get_chunks  = NULL;
+   get_nchunks = 0;
+   get_handles = NULL;
+   get_stack   = NULL;
+   get_nstack  = 0;
+}
+
+
+/**
+ * @brief Binary search over the stack, as pilot_get() used to do.
+ */
+static Pilot* get_search( const unsigned int id )
+{
+   int l,m,h;
+
+   l = 0;
+   h = get_nstack-1;
+   while (l <= h) {
+      m = (l+h) >> 1;
+      if (get_stack[m]->id > id) h = m-1;
+      else if (get_stack[m]->id < id) l = m+1;
+      else
+         return (pilot_isFlag(get_stack[m], PILOT_DELETE)) ? NULL : get_stack[m];
+   }
+   return NULL;
+}
+
+
+/**
+ * @brief Handle lookup, as pilot_get() does now.
+ */
+static Pilot* get_handle( const unsigned int id )
+{
+   unsigned int slot;
+   Pilot *p;
+
+   slot = id & GET_SLOTMASK;
+   if (slot >= (unsigned int)(get_nchunks*GET_CHUNK))
+      return NULL;
+   if (get_handles[slot].id != id)
+      return NULL;
+   p = get_handles[slot].p;
+   if ((p==NULL) || pilot_isFlag(p, PILOT_DELETE))
+      return NULL;
+   return p;
+}
+
+
+/**
+ * @brief Times a lookup.
+ *
+ *    @param get Lookup to time.
+ *    @param ids IDs to look up, cycled through.
+ *    @param nids Number of IDs.
+ *    @param lookups Number of lookups to do.
+ *    @return Nanoseconds per lookup.
+ */
+static double get_time( Pilot* (*get)(const unsigned int), const unsigned int *ids,
+      int nids, int lookups )
+{
+   int i, found;
+   double start;
+
+   found = 0;
+   start = util_time();
+   for (i=0; i<lookups; i++)
+      found += (get( ids[i % nids] ) != NULL);
+   start = util_time() - start;
+   if (found != lookups)
+      WARN("Only found %d of %d pilots.", found, lookups);
+   return start * 1000000000. / (double)lookups;
+}
+
+
+/**
+ * @brief Benchmarks both lookups with n pilots.
+ */
+static void get_bench( int n, int lookups )
+{
+   int i, nids;
+   unsigned int *ids, *picks;
+   Pilot *p;
+   double ts, th;
+
+   get_create( n );
+   nids  = MIN( lookups, 1<<20 );
+   ids   = malloc( sizeof(unsigned int) * nids );
+   picks = malloc( sizeof(unsigned int) * nids );
+   for (i=0; i<nids; i++)
+      picks[i] = util_randInt( n );
+
+   /* Sequential IDs in creation order. */
+   for (i=0; i<n; i++)
+      get_stack[i]->id = i+2;
+   for (i=0; i<nids; i++)
+      ids[i] = get_stack[ picks[i] ]->id;
+   ts = get_time( get_search, ids, nids, lookups );
+
+   /* Slot and generation. */
+   for (i=0; i<n; i++) {
+      p     = get_stack[i];
+      p->id = (3U << GET_SLOTBITS) | (unsigned int)p->slot;
+      get_handles[ p->slot ].id = p->id;
+      get_handles[ p->slot ].p  = p;
+   }
+   for (i=0; i<nids; i++)
+      ids[i] = get_stack[ picks[i] ]->id;
+   th = get_time( get_handle, ids, nids, lookups );
+
+   printf( "   %6d %12.1f ns %9.1f ns\n", n, ts, th );
+
+   free( ids );
+   free( picks );
+   get_free();
+}
+
+
+int main( int argc, char** argv )
+{
+   static struct option long_options[] = {
+      { "pilots", required_argument, 0, 'n' },
+      { "lookups", required_argument, 0, 'l' },
+      { "seed", required_argument, 0, 'r' },
+      { "help", no_argument, 0, 'h' },
+      { NULL, 0, 0, 0 } };
+   int option_index;
+   int c;
+   int pilots, lookups;
+   unsigned int seed;
+
+   /* Defaults. */
+   pilots  = 0;
+   lookups = 20000000;
+   seed    = 0;
+
+   /* Handle parameters. */
+   while ((c = getopt_long( argc, argv,
+         "hn:l:r:",
+         long_options, &option_index)) != -1) {
+      switch (c) {
+         case 'h':
+            print_usage( argv[0] );
+            exit(EXIT_SUCCESS);
+         case 'n':
+            pilots = CLAMP( 1, GET_MAX, atoi(optarg) );
+            break;
+         case 'l':
+            lookups = MAX( 1, atoi(optarg) );
+            break;
+         case 'r':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+         default:
+            print_usage( argv[0] );
+            exit(EXIT_FAILURE);
+      }
+   }
+
+   util_seed( seed );
+   printf( "%d random lookups\n", lookups );
+   printf( "   %6s %15s %12s\n", "pilots", "binary search", "handle" );
+   if (pilots > 0)
+      get_bench( pilots, lookups );
+   else {
+      get_bench( 100, lookups );
+      get_bench( 1000, lookups );
+      get_bench( 10000, lookups );
+      get_bench( 60000, lookups );
+   }
+   exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,312 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Benchmarks pilot.query() against filtering pilot.get() in Lua.
+ *
+ * Fills the system with pilots of a few factions scattered around and runs
+ *  the real pilot, vec2 and faction libraries from nlua_pilot.c, nlua_vec2.c
+ *  and nlua_faction.c.  Both sides look for the pirates within a radius of
+ *  the center: one gets all the pirates and checks their distance in Lua,
+ *  the other asks pilot.query() reusing its result table.  The time and the
+ *  memory allocated per query are reported for each.
+ */
+
+
+#include <stdlib.h> /* exit() */
+#include <stdio.h> /* printf() */
+#include <string.h> /* memset() */
+#include <getopt.h> /* getopt_long */
+
+#include "naev.h"
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "nlua_pilot.h"
+#include "nlua_vec2.h"
+#include "nlua_faction.h"
+#include "nlua_ship.h"
+#include "pilot.h"
+#include "player.h"
+#include "faction.h"
+#include "fleet.h"
+#include "outfit.h"
+#include "space.h"
+#include "ai.h"
+#include "log.h"
+#include "util.h"
+
+
+#define QUERY_FACTIONS  4 /**< Factions the pilots belong to, 1 is the pirates. */
+#define QUERY_SPREAD    10000. /**< Pilots are within this of the center. */
+#define QUERY_RADIUS    3000. /**< Radius of the query. */
+
+
+/**
+ * @brief The two ways of finding the pirates nearby.
+ */
+static const char query_script[] =
+   "local f = { faction.get(\"Pirate\") }\n"
+   "local c = vec2.new( 0, 0 )\n"
+   "local t = {}\n"
+   "function lua_side( r )\n"
+   "   local out = {}\n"
+   "   for _,p in ipairs( pilot.get( f ) ) do\n"
+   "      if p:pos():dist( c ) < r then\n"
+   "         out[ #out+1 ] = p\n"
+   "      end\n"
+   "   end\n"
+   "   return #out\n"
+   "end\n"
+   "function native_side( r )\n"
+   "   t = pilot.query( { factions=f, pos=c, radius=r, disabled=false }, t )\n"
+   "   return #t\n"
+   "end\n";
+
+
+static Pilot *query_pilots = NULL; /**< Pilots. */
+static Solid *query_solids = NULL; /**< Pilot physics. */
+/* Needed by nlua_pilot.c */
+Pilot** pilot_stack = NULL; /**< Pilot stack. */
+int pilot_nstack = 0; /**< Pilots in the stack. */
+Pilot* player = NULL; /**< There is no player. */
+int space_spawn = 1; /**< Spawning enabled. */
+
+
+/*
+ * Prototypes.
+ */
+static void print_usage( char *appname );
+static void query_create( int n );
+static void query_run( lua_State *L, const char *func, int queries,
+      int *found, double *us, double *bytes );
+static int query_bench( int n, int queries );
+
+
+static void print_usage( char *appname )
+{
+   printf(
+         "Usage is: %s [options]\n"
+         "   Benchmarks pilot.query() against filtering pilot.get() in Lua.\n"
+         "   Options:\n"
+         "     -n, --pilots N      Number of pilots (default 100, 300 and 1000).\n"
+         "     -q, --queries N     Queries to time (default 2000).\n"
+         "     -r, --seed N        Seed the random number generator.\n"
+         "     -h, --help          Display this message and exit.\n",
+         appname );
+}
+
+
+/*
+ * Stand ins for what nlua_pilot.c uses from the rest of the game, only the
+ *  ones the queries reach do anything.
+ */
+Pilot* pilot_get( const unsigned int id )
+{
+   if ((id < 1) || ((int)id > pilot_nstack))
+      return NULL;
+   return pilot_stack[id-1];
+}
+int pilot_isHostile( const Pilot *p ) { return (p->faction == 1); }
+int faction_get( const char* name ) { return (strcmp(name,"Pirate")==0) ? 1 : 0; }
+char* faction_name( int f ) { (void) f; return "Pirate"; }
+char* faction_longname( int f ) { (void) f; return "Pirate"; }
+int* faction_getAllies( int f, int *n ) { (void) f; *n = 0; return NULL; }
+int* faction_getEnemies( int f, int *n ) { (void) f; *n = 0; return NULL; }
+double faction_getPlayer( int f ) { (void) f; return 0.; }
+char* faction_getStanding( double mod ) { (void) mod; return "Neutral"; }
+void faction_modPlayer( int f, double mod ) { (void) f; (void) mod; }
+void faction_modPlayerRaw( int f, double mod ) { (void) f; (void) mod; }
+int areAllies( int a, int b ) { return (a == b); }
+int areEnemies( int a, int b ) { return (a != b) && ((a == 1) || (b == 1)); }
+Fleet* fleet_get( const char* name ) { (void) name; return NULL; }
+int fleet_createPilot( Fleet *flt, FleetPilot *plt, double dir,
+      Vector2d *pos, Vector2d *vel, const char* ai, unsigned int flags )
+{ (void) flt; (void) plt; (void) dir; (void) pos; (void) vel; (void) ai; (void) flags; return 0; }
+Outfit* outfit_get( const char* name ) { (void) name; return NULL; }
+Outfit* outfit_ammo( const Outfit* o ) { (void) o; return NULL; }
+int outfit_amount( const Outfit* o ) { (void) o; return 0; }
+int pilot_addAmmo( Pilot* pilot, PilotOutfitSlot *s, Outfit* ammo, int quantity )
+{ (void) pilot; (void) s; (void) ammo; (void) quantity; return 0; }
+int pilot_addOutfitRaw( Pilot* pilot, Outfit* outfit, PilotOutfitSlot *s )
+{ (void) pilot; (void) outfit; (void) s; return 0; }
+int pilot_addOutfitTest( Pilot* pilot, Outfit* outfit, PilotOutfitSlot *s, int warn )
+{ (void) pilot; (void) outfit; (void) s; (void) warn; return -1; }
+int pilot_rmOutfit( Pilot* pilot, PilotOutfitSlot *s ) { (void) pilot; (void) s; return 0; }
+int pilot_rmOutfitRaw( Pilot* pilot, PilotOutfitSlot *s ) { (void) pilot; (void) s; return 0; }
+void pilot_calcStats( Pilot* pilot ) { (void) pilot; }
+void pilot_broadcast( Pilot *p, const char *msg, int ignore_int )
+{ (void) p; (void) msg; (void) ignore_int; }
+void pilot_message( Pilot *p, unsigned int target, const char *msg, int ignore_int )
+{ (void) p; (void) target; (void) msg; (void) ignore_int; }
+char pilot_getFactionColourChar( const Pilot *p ) { (void) p; return 'N'; }
+unsigned int pilot_getNearestEnemy( const Pilot* p ) { (void) p; return 0; }
+void pilot_setHostile( Pilot *p ) { (void) p; }
+void pilot_setFriendly( Pilot *p ) { (void) p; }
+void pilots_clean (void) { }
+void player_hailStart (void) { }
+void player_message( const char *fmt, ... ) { (void) fmt; }
+void ai_cleartasks( Pilot* p ) { (void) p; }
+void ai_destroy( Pilot* p ) { (void) p; }
+Task *ai_newtask( Pilot *p, const char *func, int pos )
+{ (void) p; (void) func; (void) pos; return NULL; }
+int ai_pinit( Pilot *p, const char *ai ) { (void) p; (void) ai; return 0; }
+int nlua_loadShip( lua_State *L, int readonly ) { (void) L; (void) readonly; return 0; }
+LuaShip* lua_pushship( lua_State *L, LuaShip ship ) { (void) ship; lua_pushnil(L); return NULL; }
+
+
+/**
+ * @brief Scatters n pilots of random factions around the center.
+ */
+static void query_create( int n )
+{
+   int i;
+
+   free( query_pilots );
+   free( query_solids );
+   free( pilot_stack );
+   query_pilots = calloc( n, sizeof(Pilot) );
+   query_solids = calloc( n, sizeof(Solid) );
+   pilot_stack  = malloc( n * sizeof(Pilot*) );
+   for (i=0; i<n; i++) {
+      query_pilots[i].id      = i+1;
+      query_pilots[i].faction = util_randInt( QUERY_FACTIONS );
+      query_pilots[i].solid   = &query_solids[i];
+      if (util_randInt(10) == 0)
+         pilot_setFlag( &query_pilots[i], PILOT_DISABLED );
+      query_solids[i].pos.x   = (2.*util_rand()-1.) * QUERY_SPREAD;
+      query_solids[i].pos.y   = (2.*util_rand()-1.) * QUERY_SPREAD;
+      pilot_stack[i] = &query_pilots[i];
+   }
+   pilot_nstack = n;
+}
+
+
+/**
+ * @brief Times a query function.
+ *
+ *    @param L State with the functions loaded.
+ *    @param func Function to run.
+ *    @param queries Times to run it.
+ *    @param[out] found Pilots it found.
+ *    @param[out] us Microseconds per query.
+ *    @param[out] bytes Bytes allocated per query.
+ */
+static void query_run( lua_State *L, const char *func, int queries,
+      int *found, double *us, double *bytes )
+{
+   int i, kb;
+   double start;
+
+   /* Garbage piles up so it can be measured. */
+   lua_gc( L, LUA_GCCOLLECT, 0 );
+   lua_gc( L, LUA_GCSTOP, 0 );
+   kb    = lua_gc( L, LUA_GCCOUNT, 0 );
+   start = util_time();
+   for (i=0; i<queries; i++) {
+      lua_getglobal( L, func );
+      lua_pushnumber( L, QUERY_RADIUS );
+      if (lua_pcall( L, 1, 1, 0 ))
+         ERR("%s failed: %s", func, lua_tostring(L,-1));
+      *found = (int)lua_tonumber( L, -1 );
+      lua_pop( L, 1 );
+   }
+   *us    = (util_time() - start) * 1000000. / (double)queries;
+   *bytes = (double)(lua_gc( L, LUA_GCCOUNT, 0 ) - kb) * 1024. / (double)queries;
+   lua_gc( L, LUA_GCRESTART, 0 );
+}
+
+
+/**
+ * @brief Benchmarks both sides with n pilots.
+ *
+ *    @return 0 if both found the same pilots.
+ */
+static int query_bench( int n, int queries )
+{
+   lua_State *L;
+   int nl, nn;
+   double ul, un, bl, bn;
+
+   query_create( n );
+
+   L = luaL_newstate();
+   luaL_openlibs( L );
+   nlua_loadVector( L );
+   nlua_loadFaction( L, 0 );
+   nlua_loadPilot( L, 0 );
+   if (luaL_dostring( L, query_script ))
+      ERR("Unable to load the script: %s", lua_tostring(L,-1));
+
+   query_run( L, "lua_side", queries, &nl, &ul, &bl );
+   query_run( L, "native_side", queries, &nn, &un, &bn );
+   lua_close( L );
+
+   printf( "   %6d %9d %9.1f us %8.0f B %9.1f us %8.0f B\n",
+         n, nn, ul, bl, un, bn );
+   if (nl != nn) {
+      WARN("Lua filtering found %d pilots, the query %d.", nl, nn);
+      return -1;
+   }
+   return 0;
+}
+
+
+int main( int argc, char** argv )
+{
+   static struct option long_options[] = {
+      { "pilots", required_argument, 0, 'n' },
+      { "queries", required_argument, 0, 'q' },
+      { "seed", required_argument, 0, 'r' },
+      { "help", no_argument, 0, 'h' },
+      { NULL, 0, 0, 0 } };
+   int option_index;
+   int c, ret;
+   int pilots, queries;
+   unsigned int seed;
+
+   /* Defaults. */
+   pilots  = 0;
+   queries = 2000;
+   seed    = 0;
+
+   /* Handle parameters. */
+   while ((c = getopt_long( argc, argv,
+         "hn:q:r:",
+         long_options, &option_index)) != -1) {
+      switch (c) {
+         case 'h':
+            print_usage( argv[0] );
+            exit(EXIT_SUCCESS);
+         case 'n':
+            pilots = MAX( 1, atoi(optarg) );
+            break;
+         case 'q':
+            queries = MAX( 1, atoi(optarg) );
+            break;
+         case 'r':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+         default:
+            print_usage( argv[0] );
+            exit(EXIT_FAILURE);
+      }
+   }
+
+   util_seed( seed );
+   printf( "Pirates within %.0f, %d queries\n", QUERY_RADIUS, queries );
+   printf( "   %6s %9s %20s %20s\n", "pilots", "found", "Lua filtering", "native query" );
+   if (pilots > 0)
+      ret = query_bench( pilots, queries );
+   else
+      ret = query_bench( 100, queries ) | query_bench( 300, queries ) |
+            query_bench( 1000, queries );
+
+   free( query_pilots );
+   free( query_solids );
+   free( pilot_stack );
+   exit( (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
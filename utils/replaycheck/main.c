@@ -0,0 +1,381 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Checks that a recording replays to the same state.
+ *
+ * Drives replay.c through a scripted session: a few pilots fly about using
+ *  the game's random numbers while the scripted input thrusts and turns the
+ *  first one.  When recording, frames are also "rendered" and the music
+ *  chooses songs, which the replay skips just like the game does.  The
+ *  render side draws from its own streams and the music from a Lua state
+ *  with nlua_loadRndStream() as gui.c, spfx.c and music.c do, so the replay
+ *  must end up in the same state.  With --global they use the global
+ *  generator as they used to, which makes it diverge.
+ */
+
+
+#include <stdlib.h> /* exit() */
+#include <stdio.h> /* printf() */
+#include <string.h> /* memset() */
+#include <math.h> /* cos() */
+#include <getopt.h> /* getopt_long */
+
+#include "naev.h"
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "nlua_rnd.h"
+#include "replay.h"
+#include "pilot.h"
+#include "conf.h"
+#include "rng.h"
+#include "log.h"
+
+
+#define CHECK_PILOTS    16 /**< Pilots flying about. */
+#define CHECK_DT        16 /**< Recorded frame length in ms. */
+#define CHECK_SONG      50 /**< Frames between music choices. */
+#define CHECK_LAYERS    4 /**< Interference layers, as in gui.c. */
+#define CHECK_THRUST    100. /**< Acceleration of the pilots. */
+
+
+static int check_global = 0; /**< Render and music use the global generator. */
+static int check_frames = 600; /**< Frames to record. */
+static int check_frame = 0; /**< Frame being recorded. */
+static int check_queued = 0; /**< Scripted event of the frame already polled. */
+static int check_thrust = 0; /**< Player is thrusting. */
+static int check_turn = 0; /**< Player is turning. */
+static Pilot check_pilots[CHECK_PILOTS]; /**< Pilots. */
+static Solid check_solids[CHECK_PILOTS]; /**< Pilot physics. */
+static RngStream check_renderRng; /**< Render side random numbers. */
+static RngStream check_musicRng; /**< Music random numbers. */
+static lua_State *check_music = NULL; /**< Music state. */
+static double check_render = 0.; /**< Sink for the rendered values. */
+
+
+/*
+ * Prototypes.
+ */
+static void print_usage( char *appname );
+static void check_reset (void);
+static void check_input( const SDL_Event *event );
+static void check_update( double dt );
+static void check_renderFrame (void);
+static void check_song (void);
+static uint32_t check_state (void);
+static uint32_t check_run (void);
+/* Needed by replay.c */
+Pilot** pilot_stack = NULL;
+int pilot_nstack = 0;
+PlayerConf_t conf;
+unsigned int ntime_get (void);
+int SDL_PollEvent( SDL_Event *event );
+Uint32 SDL_GetTicks (void);
+
+
+static void print_usage( char *appname )
+{
+   printf(
+         "Usage is: %s [options] [file]\n"
+         "   Records a scripted session to file, replays it and checks they agree.\n"
+         "   Options:\n"
+         "     -n, --frames N      Number of frames to record (default 600).\n"
+         "     -g, --global        Render and music use the global generator as they used to.\n"
+         "     -h, --help          Display this message and exit.\n",
+         appname );
+}
+
+
+/**
+ * @brief Game time is the frame count, replay.c hashes it.
+ */
+unsigned int ntime_get (void)
+{
+   return (unsigned int)check_frame;
+}
+
+
+/**
+ * @brief Gets the scripted input while recording.
+ *
+ * Turns and thrusts the player on and off every few frames and quits at the
+ *  end of the session.
+ */
+int SDL_PollEvent( SDL_Event *event )
+{
+   if (!replay_isRecording() || check_queued)
+      return 0;
+   check_queued = 1;
+
+   memset( event, 0, sizeof(SDL_Event) );
+   if (check_frame >= check_frames)
+      event->type = SDL_QUIT;
+   else if (check_frame % 40 == 0)
+      event->type = SDL_KEYDOWN;
+   else if (check_frame % 40 == 25)
+      event->type = SDL_KEYUP;
+   else
+      return 0;
+   event->key.keysym.sym = (check_frame % 80 < 40) ? SDLK_UP : SDLK_LEFT;
+   return 1;
+}
+
+
+/**
+ * @brief Nothing runs on the wall clock.
+ */
+Uint32 SDL_GetTicks (void)
+{
+   return 0;
+}
+
+
+/**
+ * @brief Puts the pilots back where the session starts.
+ */
+static void check_reset (void)
+{
+   int i;
+   double a;
+
+   memset( check_pilots, 0, sizeof(check_pilots) );
+   memset( check_solids, 0, sizeof(check_solids) );
+   for (i=0; i<CHECK_PILOTS; i++) {
+      a = 2. * M_PI * (double)i / (double)CHECK_PILOTS;
+      check_pilots[i].id      = i+1;
+      check_pilots[i].solid   = &check_solids[i];
+      check_pilots[i].armour  = 100.;
+      check_pilots[i].shield  = 100.;
+      check_pilots[i].energy  = 100.;
+      check_solids[i].pos.x   = 1000. * cos(a);
+      check_solids[i].pos.y   = 1000. * sin(a);
+      check_solids[i].dir     = a + M_PI;
+      pilot_stack[i] = &check_pilots[i];
+   }
+   pilot_nstack = CHECK_PILOTS;
+   check_frame  = 0;
+   check_thrust = 0;
+   check_turn   = 0;
+}
+
+
+/**
+ * @brief Handles an input event like input.c would.
+ */
+static void check_input( const SDL_Event *event )
+{
+   int *key;
+
+   key = (event->key.keysym.sym == SDLK_UP) ? &check_thrust : &check_turn;
+   if (event->type == SDL_KEYDOWN)
+      *key = 1;
+   else if (event->type == SDL_KEYUP)
+      *key = 0;
+}
+
+
+/**
+ * @brief Updates the pilots, drawing from the global generator like the AI
+ *  and weapons do.
+ */
+static void check_update( double dt )
+{
+   int i;
+   Pilot *p;
+   Solid *s;
+
+   for (i=0; i<pilot_nstack; i++) {
+      p = pilot_stack[i];
+      s = p->solid;
+
+      /* The player obeys the input, the rest wander. */
+      if (i == 0)
+         s->dir += (check_turn) ? dt : 0.;
+      else
+         s->dir += RNG_2SIGMA() * dt;
+      if ((i > 0) || check_thrust) {
+         s->vel.x += CHECK_THRUST * cos(s->dir) * dt;
+         s->vel.y += CHECK_THRUST * sin(s->dir) * dt;
+      }
+      s->pos.x += s->vel.x * dt;
+      s->pos.y += s->vel.y * dt;
+
+      /* Stray shots. */
+      if (RNG(0,99) == 0) {
+         if (p->shield > 0.)
+            p->shield = MAX( 0., p->shield - 5. );
+         else
+            p->armour = MAX( 0., p->armour - 5. );
+      }
+   }
+}
+
+
+/**
+ * @brief Draws the random numbers a frame renders with, the interference
+ *  layer of gui.c and the shake of spfx.c.
+ */
+static void check_renderFrame (void)
+{
+   if (check_global)
+      check_render += RNG(0, CHECK_LAYERS-1) + RNGF();
+   else
+      check_render += RNGS(&check_renderRng, 0, CHECK_LAYERS-1) +
+            RNGSF(&check_renderRng);
+}
+
+
+/**
+ * @brief Lets the music choose a song like snd/music.lua does.
+ */
+static void check_song (void)
+{
+   const char *choose = "return rnd.rnd(1,5) + rnd.rnd()";
+
+   if (luaL_dostring( check_music, choose ) != 0)
+      ERR("Unable to choose a song: %s", lua_tostring(check_music, -1));
+   check_render += lua_tonumber( check_music, -1 );
+   lua_pop( check_music, 1 );
+}
+
+
+/**
+ * @brief Hashes the state of the pilots.
+ */
+static uint32_t check_state (void)
+{
+   int i;
+   uint32_t h;
+   const uint8_t *b;
+   size_t j;
+
+   h = 2166136261U;
+   for (i=0; i<pilot_nstack; i++) {
+      b = (const uint8_t*) pilot_stack[i]->solid;
+      for (j=0; j<sizeof(Solid); j++)
+         h = (h ^ b[j]) * 16777619U;
+      b = (const uint8_t*) &pilot_stack[i]->armour;
+      for (j=0; j<sizeof(double); j++)
+         h = (h ^ b[j]) * 16777619U;
+   }
+   return h;
+}
+
+
+/**
+ * @brief Runs the session until it quits.
+ *
+ *    @return Hash of the final state.
+ */
+static uint32_t check_run (void)
+{
+   SDL_Event event;
+   double dt;
+   int quit;
+
+   check_reset();
+   quit = 0;
+   while (!quit) {
+      check_queued = 0;
+      while (replay_pollEvent( &event )) {
+         if (event.type == SDL_QUIT)
+            quit = 1;
+         else
+            check_input( &event );
+      }
+      if (quit)
+         break;
+
+      dt = (double)replay_frame( CHECK_DT ) / 1000.;
+      check_update( dt );
+      if (!replay_isReplaying()) {
+         check_renderFrame();
+         if (check_frame % CHECK_SONG == 0)
+            check_song();
+      }
+      check_frame++;
+      replay_endFrame();
+   }
+   return check_state();
+}
+
+
+int main( int argc, char** argv )
+{
+   static struct option long_options[] = {
+      { "frames", required_argument, 0, 'n' },
+      { "global", no_argument, 0, 'g' },
+      { "help", no_argument, 0, 'h' },
+      { NULL, 0, 0, 0 } };
+   int option_index;
+   int c;
+   char *file;
+   uint32_t recorded, replayed;
+
+   /* Handle parameters. */
+   while ((c = getopt_long( argc, argv,
+         "hn:g",
+         long_options, &option_index)) != -1) {
+      switch (c) {
+         case 'h':
+            print_usage( argv[0] );
+            exit(EXIT_SUCCESS);
+         case 'n':
+            check_frames = MAX( 1, atoi(optarg) );
+            break;
+         case 'g':
+            check_global = 1;
+            break;
+         default:
+            print_usage( argv[0] );
+            exit(EXIT_FAILURE);
+      }
+   }
+   file = (optind < argc) ? argv[optind] : "replaycheck.rpl";
+
+   rng_init();
+   pilot_stack = malloc( sizeof(Pilot*) * CHECK_PILOTS );
+   rng_streamInit( &check_renderRng, "interference", 0, 0 );
+   rng_streamInit( &check_musicRng, "music", 0, 0 );
+   check_music = luaL_newstate();
+   luaL_openlibs( check_music );
+   if (check_global)
+      nlua_loadRnd( check_music );
+   else
+      nlua_loadRndStream( check_music, &check_musicRng );
+   conf.width  = 800;
+   conf.height = 600;
+
+   /* Record. */
+   conf.record = file;
+   if (replay_init())
+      ERR("Unable to record to '%s'.", file);
+   recorded = check_run();
+   replay_exit();
+   conf.record = NULL;
+
+   /* Replay. */
+   conf.replay = file;
+   if (replay_init())
+      ERR("Unable to replay '%s'.", file);
+   replayed = check_run();
+   replay_exit();
+   conf.replay = NULL;
+
+   lua_close( check_music );
+   free( pilot_stack );
+
+   printf( "%d frames, %s render and music random numbers\n", check_frames,
+         (check_global) ? "global" : "separate" );
+   printf( "   recorded %08x\n   replayed %08x\n", recorded, replayed );
+   if (recorded != replayed) {
+      printf( "Replay diverged.\n" );
+      exit(EXIT_FAILURE);
+   }
+   printf( "Replay matches.\n" );
+   exit(EXIT_SUCCESS);
+}
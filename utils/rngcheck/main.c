@@ -0,0 +1,137 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Checks and benchmarks the random streams.
+ *
+ * Runs rng_streamCheck() from rng.c, which verifies the Philox known answers
+ *  and that bulk, seek and single draws agree, then times the ways of
+ *  getting random numbers.
+ */
+
+
+#include <stdlib.h> /* exit() */
+#include <stdio.h> /* printf() */
+#include <getopt.h> /* getopt_long */
+
+#include "naev.h"
+#include "rng.h"
+#include "log.h"
+#include "util.h"
+
+
+#define BENCH_CHUNK     64 /**< Numbers per bulk fill, same as the starfield. */
+
+
+/*
+ * Prototypes.
+ */
+static void print_usage( char *appname );
+static void check_bench( int n );
+
+
+static void print_usage( char *appname )
+{
+   printf(
+         "Usage is: %s [options]\n"
+         "   Checks that the random streams give the numbers they should.\n"
+         "   Options:\n"
+         "     -n, --numbers N     Numbers to time each way (default 10000000).\n"
+         "     -c, --check         Only check, skip the benchmark.\n"
+         "     -h, --help          Display this message and exit.\n",
+         appname );
+}
+
+
+/**
+ * @brief Times single and bulk stream draws against the twister.
+ */
+static void check_bench( int n )
+{
+   int i, j;
+   uint32_t sum, buf[BENCH_CHUNK];
+   double start, single, bulk, mt;
+   RngStream rs;
+
+   rng_initSeed( 1 );
+   n = MAX( n, BENCH_CHUNK );
+
+   sum = 0;
+   rng_streamInit( &rs, "bench", 0, 0 );
+   start = util_time();
+   for (i=0; i<n; i++)
+      sum += rng_streamInt( &rs );
+   single = util_time() - start;
+
+   rng_streamInit( &rs, "bench", 0, 0 );
+   start = util_time();
+   for (i=0; i<n; i+=BENCH_CHUNK) {
+      rng_streamFill( &rs, buf, BENCH_CHUNK );
+      for (j=0; j<BENCH_CHUNK; j++)
+         sum += buf[j];
+   }
+   bulk = util_time() - start;
+
+   start = util_time();
+   for (i=0; i<n; i++)
+      sum += randint();
+   mt = util_time() - start;
+
+   printf( "%d numbers, ns per number:\n", n );
+   printf( "   stream single %6.2f\n", single * 1e9 / (double)n );
+   printf( "   stream bulk   %6.2f\n", bulk * 1e9 / (double)n );
+   printf( "   twister       %6.2f\n", mt * 1e9 / (double)n );
+   printf( "   (checksum %08x)\n", sum );
+}
+
+
+int main( int argc, char** argv )
+{
+   static struct option long_options[] = {
+      { "help", no_argument, 0, 'h' },
+      { "numbers", required_argument, 0, 'n' },
+      { "check", no_argument, 0, 'c' },
+      { NULL, 0, 0, 0 }
+   };
+   int option_index;
+   int c, n, check, fail;
+
+   /* Defaults. */
+   n     = 10000000;
+   check = 0;
+
+   /* Handle parameters. */
+   while ((c = getopt_long( argc, argv,
+         "hn:c",
+         long_options, &option_index)) != -1) {
+      switch (c) {
+         case 'h':
+            print_usage( argv[0] );
+            exit(EXIT_SUCCESS);
+         case 'n':
+            n = atoi(optarg);
+            break;
+         case 'c':
+            check = 1;
+            break;
+         default:
+            print_usage( argv[0] );
+            exit(EXIT_FAILURE);
+      }
+   }
+
+   rng_init();
+   fail = rng_streamCheck();
+   if (fail == 0)
+      printf( "Random streams are correct.\n" );
+   else
+      WARN("%d random stream checks failed.", fail);
+
+   if (!check)
+      check_bench( n );
+
+   exit( (fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
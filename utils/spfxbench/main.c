@@ -0,0 +1,420 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Stress benchmark for the special effects.
+ *
+ * Destroys a fleet of capital ships at once using the same death sequence as
+ *  pilot.c (random small and medium explosions followed by a large one and
+ *  the debris) and times the real spfx.c updating and rendering the
+ *  effects.  OpenGL is stubbed out, so the render times only cover building
+ *  the geometry, and draw calls are counted instead of drawn.
+ */
+
+
+#include <stdlib.h> /* exit() */
+#include <stdio.h> /* printf() */
+#include <string.h> /* memset() */
+#include <math.h> /* cos() */
+#include <getopt.h> /* getopt_long */
+
+#include "naev.h"
+#include "spfx.h"
+#include "debris.h"
+#include "opengl.h"
+#include "opengl_vbo.h"
+#include "ndata.h"
+#include "nxml.h"
+#include "rng.h"
+#include "log.h"
+#include "util.h"
+
+
+#define BENCH_DT        (1./60.) /**< Time per frame. */
+#define BENCH_SPACING   150. /**< Distance between the ships. */
+#define BENCH_SPRITE    64. /**< Size of an effect sprite. */
+
+/* Goddard like capital ship. */
+#define SHIP_MASS       4750. /**< Mass of the ships. */
+#define SHIP_ARMOUR     1000. /**< Armour of the ships. */
+#define SHIP_SHIELD     1600. /**< Shield of the ships. */
+#define SHIP_SIZE       128. /**< Width and height of the ship sprites. */
+
+
+/**
+ * @brief A dying ship.
+ */
+typedef struct BenchShip_ {
+   Vector2d pos; /**< Position. */
+   Vector2d vel; /**< Velocity. */
+   double ptimer; /**< Time left until it's gone, as pilot->ptimer. */
+   double timer; /**< Time until the next explosion, as pilot->timer[1]. */
+   int exploded; /**< Already had the final explosion. */
+} BenchShip;
+
+
+/**
+ * @brief Stub vbo, nothing is uploaded.
+ */
+struct gl_vbo_s {
+   GLsizei size; /**< Size requested. */
+};
+
+
+static unsigned long bench_draws = 0; /**< Draw calls issued. */
+
+
+/*
+ * Prototypes.
+ */
+static void print_usage( char *appname );
+static int bench_ship( BenchShip *s, double dt );
+static void bench_run( int nships, int frames );
+/* Needed by spfx.c */
+glInfo gl_screen;
+glColour cWhite = { .r=1., .g=1., .b=1., .a=1. };
+glColour cBlack = { .r=0., .g=0., .b=0., .a=1. };
+int paused = 0;
+glTexture* xml_parseTexture( xmlNodePtr node,
+      const char *path, int defsx, int defsy,
+      const unsigned int flags );
+void gl_freeTexture( glTexture* texture );
+void gl_cameraZoomGet( double *zoom );
+void gl_gameToScreenCoords( double *nx, double *ny, double bx, double by );
+void gl_renderRect( double x, double y, double w, double h, const glColour *c );
+void gl_defViewport (void);
+gl_vbo* gl_vboCreateStream( GLsizei size, void* data );
+void gl_vboData( gl_vbo *vbo, GLsizei size, void* data );
+void gl_vboSubData( gl_vbo *vbo, GLint offset, GLsizei size, void* data );
+void gl_vboActivateOffset( gl_vbo *vbo, GLuint class, GLuint offset,
+      GLint size, GLenum type, GLsizei stride );
+void gl_vboDeactivate (void);
+void gl_vboDestroy( gl_vbo* vbo );
+
+
+static void print_usage( char *appname )
+{
+   printf(
+         "Usage is: %s [options] [datadir]\n"
+         "   Destroys a fleet of capital ships and times the special effects.\n"
+         "   Options:\n"
+         "     -n, --ships N       Number of ships to destroy (default 100).\n"
+         "     -f, --frames N      Frames to simulate (default 600).\n"
+         "     -r, --seed N        Seed the random number generator.\n"
+         "     -h, --help          Display this message and exit.\n",
+         appname );
+}
+
+
+/**
+ * @brief Creates a sprite sheet of the size of the effects without loading it.
+ */
+glTexture* xml_parseTexture( xmlNodePtr node,
+      const char *path, int defsx, int defsy,
+      const unsigned int flags )
+{
+   glTexture *t;
+   char *buf;
+
+   (void) path;
+   (void) flags;
+
+   t = calloc( 1, sizeof(glTexture) );
+   buf = xml_get(node);
+   if (buf != NULL)
+      t->name = strdup( buf );
+   t->sx   = defsx;
+   t->sy   = defsy;
+   xmlr_attr(node,"sx",buf);
+   if (buf != NULL) {
+      t->sx = atoi(buf);
+      free(buf);
+   }
+   xmlr_attr(node,"sy",buf);
+   if (buf != NULL) {
+      t->sy = atoi(buf);
+      free(buf);
+   }
+   t->sw  = BENCH_SPRITE;
+   t->sh  = BENCH_SPRITE;
+   t->w   = t->sw * t->sx;
+   t->h   = t->sh * t->sy;
+   t->rw  = t->w;
+   t->rh  = t->h;
+   t->srw = t->sw / t->rw;
+   t->srh = t->sh / t->rh;
+   return t;
+}
+void gl_freeTexture( glTexture* texture )
+{
+   free( texture->name );
+   free( texture );
+}
+void gl_cameraZoomGet( double *zoom )
+{
+   *zoom = 1.;
+}
+void gl_gameToScreenCoords( double *nx, double *ny, double bx, double by )
+{
+   /* Camera sits at the origin. */
+   *nx = bx;
+   *ny = by;
+}
+void gl_renderRect( double x, double y, double w, double h, const glColour *c )
+{
+   (void) x;
+   (void) y;
+   (void) w;
+   (void) h;
+   (void) c;
+}
+void gl_defViewport (void)
+{
+}
+gl_vbo* gl_vboCreateStream( GLsizei size, void* data )
+{
+   gl_vbo *vbo;
+
+   (void) data;
+   vbo = malloc( sizeof(gl_vbo) );
+   vbo->size = size;
+   return vbo;
+}
+void gl_vboData( gl_vbo *vbo, GLsizei size, void* data )
+{
+   (void) data;
+   vbo->size = size;
+}
+void gl_vboSubData( gl_vbo *vbo, GLint offset, GLsizei size, void* data )
+{
+   (void) data;
+   if (offset + size > vbo->size)
+      WARN("Uploading %d bytes past the end of the vbo.",
+            offset + size - vbo->size);
+}
+void gl_vboActivateOffset( gl_vbo *vbo, GLuint class, GLuint offset,
+      GLint size, GLenum type, GLsizei stride )
+{
+   (void) vbo;
+   (void) class;
+   (void) offset;
+   (void) size;
+   (void) type;
+   (void) stride;
+}
+void gl_vboDeactivate (void)
+{
+}
+void gl_vboDestroy( gl_vbo* vbo )
+{
+   free( vbo );
+}
+void glBindTexture( GLenum target, GLuint texture )
+{
+   (void) target;
+   (void) texture;
+}
+void glColor4d( GLdouble r, GLdouble g, GLdouble b, GLdouble a )
+{
+   (void) r;
+   (void) g;
+   (void) b;
+   (void) a;
+}
+void glEnable( GLenum cap )
+{
+   (void) cap;
+}
+void glDisable( GLenum cap )
+{
+   (void) cap;
+}
+void glMatrixMode( GLenum mode )
+{
+   (void) mode;
+}
+void glLoadIdentity (void)
+{
+}
+void glOrtho( GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
+      GLdouble near_val, GLdouble far_val )
+{
+   (void) left;
+   (void) right;
+   (void) bottom;
+   (void) top;
+   (void) near_val;
+   (void) far_val;
+}
+void glDrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+   (void) mode;
+   (void) first;
+   (void) count;
+   bench_draws++;
+}
+
+
+/**
+ * @brief Runs the death sequence of a ship like pilot_update does.
+ *
+ *    @return 1 while the ship is still around.
+ */
+static int bench_ship( BenchShip *s, double dt )
+{
+   double a, px, py;
+
+   s->ptimer -= dt;
+   if (s->timer > 0.)
+      s->timer -= dt;
+   vect_cadd( &s->pos, dt*VX(s->vel), dt*VY(s->vel) );
+
+   /* Completely destroyed. */
+   if (s->ptimer < 0.)
+      return 0;
+
+   /* Final explosion. */
+   if (!s->exploded && (s->ptimer < 0.200)) {
+      spfx_add( spfx_get("ExpL"), VX(s->pos), VY(s->pos),
+            VX(s->vel), VY(s->vel), SPFX_LAYER_BACK );
+      debris_add( SHIP_MASS, SHIP_SIZE/2., VX(s->pos), VY(s->pos),
+            VX(s->vel), VY(s->vel) );
+      s->exploded = 1;
+   }
+   /* Random explosions on the hull. */
+   else if (s->timer <= 0.) {
+      s->timer = 0.08 * (s->ptimer - s->timer) / s->ptimer;
+      a  = RNGF()*2.*M_PI;
+      px = VX(s->pos) + cos(a)*RNGF()*SHIP_SIZE/2.;
+      py = VY(s->pos) + sin(a)*RNGF()*SHIP_SIZE/2.;
+      if (RNGF() > 0.8)
+         spfx_add( spfx_get("ExpM"), px, py, VX(s->vel), VY(s->vel),
+               SPFX_LAYER_BACK );
+      else
+         spfx_add( spfx_get("ExpS"), px, py, VX(s->vel), VY(s->vel),
+               SPFX_LAYER_BACK );
+   }
+   return 1;
+}
+
+
+/**
+ * @brief Destroys the fleet and times the effects.
+ */
+static void bench_run( int nships, int frames )
+{
+   int i, f, side, alive;
+   unsigned long draws, peak_draws;
+   double start, t, upd, upd_max, ren, ren_max;
+   BenchShip *ships;
+
+   /* Lay the fleet out on a grid centered on the camera. */
+   ships = malloc( sizeof(BenchShip) * nships );
+   side  = (int)ceil( sqrt( (double)nships ) );
+   for (i=0; i<nships; i++) {
+      vect_cset( &ships[i].pos,
+            ((double)(i % side) - (side-1)/2.) * BENCH_SPACING,
+            ((double)(i / side) - (side-1)/2.) * BENCH_SPACING );
+      vect_pset( &ships[i].vel, RNGF()*50., RNGF()*2.*M_PI );
+      ships[i].ptimer   = 1. + sqrt(10.*SHIP_ARMOUR*SHIP_SHIELD)/1500.;
+      ships[i].timer    = 0.;
+      ships[i].exploded = 0;
+   }
+
+   upd = upd_max = ren = ren_max = 0.;
+   peak_draws = 0;
+   alive = nships;
+   for (f=0; f<frames; f++) {
+      /* Update. */
+      start = util_time();
+      alive = 0;
+      for (i=0; i<nships; i++)
+         alive += bench_ship( &ships[i], BENCH_DT );
+      spfx_update( BENCH_DT );
+      t = util_time() - start;
+      upd += t;
+      upd_max = MAX( upd_max, t );
+
+      /* Render. */
+      draws = bench_draws;
+      start = util_time();
+      spfx_begin( BENCH_DT );
+      spfx_render( SPFX_LAYER_BACK );
+      spfx_render( SPFX_LAYER_FRONT );
+      spfx_end();
+      t = util_time() - start;
+      ren += t;
+      ren_max = MAX( ren_max, t );
+      peak_draws = MAX( peak_draws, bench_draws - draws );
+   }
+
+   printf( "%d ships over %d frames (%d left):\n", nships, frames, alive );
+   printf( "   update  %8.4f ms mean  %8.4f ms worst\n",
+         upd * 1000. / (double)frames, upd_max * 1000. );
+   printf( "   render  %8.4f ms mean  %8.4f ms worst\n",
+         ren * 1000. / (double)frames, ren_max * 1000. );
+   printf( "   draws   %8.1f mean     %8lu worst\n",
+         (double)bench_draws / (double)frames, peak_draws );
+
+   free( ships );
+}
+
+
+int main( int argc, char** argv )
+{
+   static struct option long_options[] = {
+      { "help", no_argument, 0, 'h' },
+      { "ships", required_argument, 0, 'n' },
+      { "frames", required_argument, 0, 'f' },
+      { "seed", required_argument, 0, 'r' },
+      { NULL, 0, 0, 0 }
+   };
+   int option_index;
+   int c, nships, frames;
+   unsigned int seed;
+
+   /* Defaults. */
+   nships = 100;
+   frames = 600;
+   seed   = 7;
+
+   /* Handle parameters. */
+   while ((c = getopt_long( argc, argv,
+         "hn:f:r:",
+         long_options, &option_index)) != -1) {
+      switch (c) {
+         case 'h':
+            print_usage( argv[0] );
+            exit(EXIT_SUCCESS);
+         case 'n':
+            nships = atoi(optarg);
+            break;
+         case 'f':
+            frames = atoi(optarg);
+            break;
+         case 'r':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+         default:
+            print_usage( argv[0] );
+            exit(EXIT_FAILURE);
+      }
+   }
+   if (optind < argc)
+      util_setDatadir( argv[optind] );
+
+   gl_screen.w = 1280;
+   gl_screen.h = 800;
+   rng_init();
+   rng_initSeed( seed );
+   if (spfx_load() != 0)
+      exit(EXIT_FAILURE);
+
+   bench_run( nships, frames );
+
+   spfx_free();
+   exit(EXIT_SUCCESS);
+}